@@ -36,8 +36,8 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 POSSIBILITY OF SUCH DAMAGE.
 */
 #include "Arduino.h"
-#include "instruction.h"
-#include <util/delay.h>
+#include <util/atomic.h>
+#include "adb_rx.h"
 
 
 #define kPS2LEDCaps 1
@@ -53,25 +53,39 @@ POSSIBILITY OF SUCH DAMAGE.
 #define kModDelete 64
 
 extern int ps2ledstate;
-extern uint8_t mousepending;
-extern uint8_t kbdpending;
+// Shared with the INT0/Timer1 handlers that run the bus.
+extern volatile uint8_t mousepending;
+extern volatile uint8_t kbdpending;
 
 
-extern uint16_t mouseByte0;
-extern uint16_t mouseByte1;
+// Mouse motion not yet reported to the Mac, in counts. Each Talk R0 drains up
+// to MOUSE_REPORT_MAX per axis and leaves the rest for the next poll.
+extern volatile int16_t mouseDx;
+extern volatile int16_t mouseDy;
+#define MOUSE_REPORT_MAX 63
+#define MOUSE_ACCUM_MAX 1024 // two screen widths; more would only pin the cursor to an edge
 
-extern uint16_t kbdreg0;
-extern uint8_t kbdsrq;
-extern uint8_t mousesrq;
-extern uint8_t modifierkeys;
+// Key transitions waiting for Talk R0, two per reply. Each keeps the modifier
+// byte the host sent with it; register 2 takes that value when the key goes out,
+// so the Mac never sees a modifier ahead of the keys before it.
+#define KBD_QUEUE_LEN 32 // power of two
+extern volatile uint8_t modifierkeys;
 
 #define ADB_PORT PORTD
 #define ADB_PIN PIND
 #define ADB_DDR DDRD
-#define ADB_DATA_BIT 2
+#define ADB_DATA_BIT 2 // PD2 = INT0
 
 
 void adbSetup();
 void adbLoop();
+// Add host motion to the pending registers. Returns 0 (and takes nothing) when
+// the button changes while earlier motion is still unreported: the caller
+// retries after the next poll, so a click never lands before the move.
+uint8_t adbMouseAdd(int8_t dx, int8_t dy, uint8_t down);
+// Queue a key transition. Returns 0 (and takes nothing) when the queue is full.
+uint8_t adbKeyPush(uint8_t code, uint8_t up, uint8_t modifiers);
+// Free slots in the key queue.
+uint8_t adbKeyRoom();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef ADB_RX_H
+#define ADB_RX_H
+
+#include <stdint.h>
+
+// Device-side ADB command decoder. It sees only the level after each edge of
+// the data line and the Timer1 time of the edge, and touches no registers, so
+// the Linux host build tests it (host/test/test_adb_rx.cpp). adb.cpp feeds it
+// from INT0 and drives the line for whatever it returns.
+
+// Bus timing in us (Guide to the Macintosh Family Hardware); names match
+// src/adb_device.h on the Pico side.
+#define ADB_BIT_CELL_US 100
+#define ADB_BIT1_LOW_US 35
+#define ADB_BIT0_LOW_US 65
+#define ADB_BIT_THRESHOLD_US 50 // shorter low = 1
+#define ADB_BIT_MAX_US 130
+#define ADB_ATTN_MIN_US 500     // attention is 800 us nominal
+#define ADB_RESET_MIN_US 2800   // global reset is >= 3 ms
+#define ADB_TLT_US 180          // stop bit to reply start bit
+#define ADB_SRQ_US 300          // stop bit stretched by a service request
+// Timer1 runs free at F_CPU/8.
+#define ADB_TICKS(us) ((uint16_t)((us) * (F_CPU / 8000000UL)))
+
+// Data waiting for the Mac, sampled on every edge.
+#define ADB_PENDING_MOUSE 1
+#define ADB_PENDING_KBD 2
+
+enum
+{
+	ADB_RX_IDLE, // waiting for attention
+	ADB_RX_CMD,  // receiving the 8 command bits
+	ADB_RX_STOP, // waiting for the command's stop bit
+};
+
+typedef struct adb_rx
+{
+	uint8_t state;
+	uint16_t fallAt; // Timer1 at the last falling edge
+	uint8_t bits;
+	uint8_t cmd;
+	uint8_t srq; // assert SRQ on this command's stop bit
+} adb_rx_t;
+
+// What the caller does after an edge.
+enum
+{
+	ADB_EDGE_NONE,
+	ADB_EDGE_SRQ,     // stop bit just began: hold it low for ADB_SRQ_US, then answer cmd
+	ADB_EDGE_COMMAND, // stop bit ended at this edge: answer cmd
+};
+
+// Which reply a completed command gets.
+enum
+{
+	ADB_REPLY_NONE,     // not ours, or nothing to send
+	ADB_REPLY_MOUSE,    // mouse Talk R0 with motion or a button change pending
+	ADB_REPLY_KBD,      // keyboard Talk R0 with keys pending
+	ADB_REPLY_KBD_REG2, // keyboard Talk R2: modifiers and LEDs
+	ADB_REPLY_UNKNOWN,  // ours but not handled
+};
+
+// One edge at Timer1 time now; level is the line after it. Returns ADB_EDGE_*.
+uint8_t adb_rx_edge(adb_rx_t *rx, uint8_t level, uint16_t now, uint8_t pending);
+// ADB_REPLY_* for command byte cmd, given ADB_PENDING_* at its stop bit.
+uint8_t adb_reply_for(uint8_t cmd, uint8_t pending);
+
+#endif
@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#ifndef LINK_H
+#define LINK_H
+
+// Serial link from the Pico (src/input_uart.h has the same layout).
+//
+// Frame, Pico -> here:  A5 len seq payload[len] crc_lo crc_hi
+// Ack, here -> Pico:    5A seq credits crc_lo crc_hi
+//
+// The payload is 4-byte input records as the Pico gets them over USB
+// (src/input_events.h): mouse = 01 buttons dx dy, key = 02 code flags
+// modifiers. An empty frame only asks for an ack. seq counts 1..255 and
+// wraps to 1; seq 0 follows a Pico reset. A frame with the seq taken last is
+// a repeat whose ack was lost, seq 0 included: seq 0 comes once per Pico
+// boot, so a second one in a row is the first frame sent again. A frame is
+// acked once all of its events are taken, with the free slots in the key
+// queue as credits; the Pico never sends more keys than that, and sends the
+// frame again if no ack comes. The CRC is _crc_ccitt_update() over len, seq
+// and payload (or seq and credits), starting from 0xFFFF.
+#define LINK_BAUD 1000000 // exact at 16 MHz with U2X
+#define LINK_SYNC 0xA5
+#define LINK_ACK_SYNC 0x5A
+#define LINK_EVENT_BYTES 4
+#define LINK_EVENTS_MAX 8
+#define LINK_FRAME_MAX (3 + LINK_EVENTS_MAX * LINK_EVENT_BYTES + 2)
+
+#define LINK_EV_MOUSE 0x01
+#define LINK_EV_KEY 0x02
+
+#endif
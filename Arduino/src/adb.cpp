@@ -38,16 +38,19 @@ POSSIBILITY OF SUCH DAMAGE.
 
 
 int ps2ledstate = 0;
-uint8_t mousepending = 0;
-uint8_t kbdpending = 0;
+volatile uint8_t mousepending = 0;
+volatile uint8_t kbdpending = 0;
 
-uint16_t mouseByte0 = 0;
-uint16_t mouseByte1 = 0;
-uint16_t kbdreg0 = 0;
+volatile int16_t mouseDx = 0;
+volatile int16_t mouseDy = 0;
+static volatile uint8_t mouseDown = 0;     // current button state from the host
+static volatile uint8_t mouseDownSent = 0; // button state in the last Talk R0 reply
+static uint8_t kbdqueue[KBD_QUEUE_LEN]; // ADB key code, bit 7 = key up
+static uint8_t kbdmods[KBD_QUEUE_LEN];
+static volatile uint8_t kbdhead = 0;
+static volatile uint8_t kbdtail = 0;
 
-uint8_t kbdsrq = 0;
-uint8_t mousesrq = 0;
-uint8_t modifierkeys = 0xFF;
+volatile uint8_t modifierkeys = 0xFF;
 
 // The original data_lo code would just set the bit as an output
 // That works for a host, since the host is doing the pullup on the ADB line,
@@ -60,206 +63,273 @@ uint8_t modifierkeys = 0xFF;
 	}
 #define data_hi() (ADB_DDR &= ~(1 << ADB_DATA_BIT))
 #define data_in() (ADB_PIN & (1 << ADB_DATA_BIT))
-static inline uint16_t wait_data_lo(uint16_t us)
+
+// Bus state machine. INT0 fires on every edge of the data line and timestamps
+// it from Timer1 (free running, 0.5 us ticks); adb_rx_edge() (adb_rx.cpp)
+// decodes commands from the low times. Replies and SRQ are played from Timer1
+// compare A, so nothing here busy-waits and loop() keeps reading serial
+// between edges.
+enum
 {
-	do
-	{
-		if (!data_in())
-			break;
-		_delay_us(1 - (6 * 1000000.0 / F_CPU));
-	} while (--us);
-	return us;
-}
-static inline uint16_t wait_data_hi(uint16_t us)
+	ADB_LISTEN, // INT0 feeds the decoder
+	ADB_SRQ,    // holding the stop bit low for a service request
+	ADB_REPLY,  // playing a Talk reply
+};
+
+static volatile uint8_t adbstate = ADB_LISTEN;
+static adb_rx_t rx;
+static uint16_t txdata;
+static uint8_t txbit;      // 0 start bit, 1..16 data, 17 stop bit
+static uint8_t txlow;      // line currently driven low
+static volatile uint8_t unknowncmd = 0; // for adbLoop() to report
+
+static int16_t clamp_accum(int16_t v)
 {
-	do
-	{
-		if (data_in())
-			break;
-		_delay_us(1 - (6 * 1000000.0 / F_CPU));
-	} while (--us);
-	return us;
+	if (v > MOUSE_ACCUM_MAX)
+		return MOUSE_ACCUM_MAX;
+	if (v < -MOUSE_ACCUM_MAX)
+		return -MOUSE_ACCUM_MAX;
+	return v;
 }
 
-static inline void place_bit0(void)
+static int8_t take_report(volatile int16_t *accum)
 {
-	data_lo();
-	_delay_us(65);
-	data_hi();
-	_delay_us(35);
+	int16_t v = *accum;
+	if (v > MOUSE_REPORT_MAX)
+		v = MOUSE_REPORT_MAX;
+	else if (v < -MOUSE_REPORT_MAX)
+		v = -MOUSE_REPORT_MAX;
+	*accum -= v;
+	return (int8_t)v;
 }
-static inline void place_bit1(void)
+
+uint8_t adbMouseAdd(int8_t dx, int8_t dy, uint8_t down)
 {
-	data_lo();
-	_delay_us(35);
-	data_hi();
-	_delay_us(65);
+	down = down ? 1 : 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (down != mouseDown && (mouseDx || mouseDy))
+			return 0;
+		mouseDown = down;
+		mouseDx = clamp_accum(mouseDx + dx);
+		mouseDy = clamp_accum(mouseDy + dy);
+		mousepending = mouseDx || mouseDy || mouseDown != mouseDownSent;
+	}
+	return 1;
 }
-static inline void send_byte(uint8_t data)
+
+uint8_t adbKeyPush(uint8_t code, uint8_t up, uint8_t modifiers)
 {
-	for (int i = 0; i < 8; i++)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		if (data & (0x80 >> i))
-			place_bit1();
-		else
-			place_bit0();
+		if ((uint8_t)(kbdhead - kbdtail) == KBD_QUEUE_LEN)
+			return 0;
+		uint8_t i = kbdhead & (KBD_QUEUE_LEN - 1);
+		kbdqueue[i] = (code & 0x7F) | (up ? 0x80 : 0);
+		kbdmods[i] = modifiers;
+		kbdhead++;
+		kbdpending = 1;
 	}
+	return 1;
 }
-static uint8_t inline adb_recv_cmd(uint8_t srq)
-{
-	uint8_t bits;
-	uint16_t data = 0;
 
-	// find attention & start bit
-	if (!wait_data_lo(5000))
-		return 0;
-	uint16_t lowtime = wait_data_hi(1000);
-	if (!lowtime || lowtime > 500)
+uint8_t adbKeyRoom()
+{
+	uint8_t room;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		return 0;
+		room = KBD_QUEUE_LEN - (uint8_t)(kbdhead - kbdtail);
 	}
-	wait_data_lo(100);
+	return room;
+}
 
-	for (bits = 0; bits < 8; bits++)
-	{
-		uint8_t lo = wait_data_hi(130);
-		if (!lo)
-		{
-			goto out;
-		}
-		uint8_t hi = wait_data_lo(lo);
-		if (!hi)
-		{
-			goto out;
-		}
-		hi = lo - hi;
-		lo = 130 - lo;
+// Next queued transition for Talk R0, or 0xFF (no key) once the queue is empty.
+static uint8_t take_key(void)
+{
+	if (kbdtail == kbdhead)
+		return 0xFF;
+	uint8_t i = kbdtail & (KBD_QUEUE_LEN - 1);
+	kbdtail++;
+	modifierkeys = kbdmods[i];
+	return kbdqueue[i];
+}
 
-		data <<= 1;
-		if (lo < hi)
-		{
-			data |= 1;
-		}
-	}
+static void schedule_at(uint16_t at)
+{
+	OCR1A = at;
+	TIFR1 = 1 << OCF1A;
+	TIMSK1 |= 1 << OCIE1A;
+}
 
-	if (srq)
-	{
-		data_lo();
-		_delay_us(250);
-		data_hi();
-	}
-	else
-	{
-		// Stop bit normal low time is 70uS + can have an SRQ time of 300uS
-		wait_data_hi(400);
-	}
+// Back to listening once the line is ours no more. Our own edges set INTF0
+// while INT0 was masked; drop them.
+static void rx_resume(void)
+{
+	TIMSK1 &= ~(1 << OCIE1A);
+	EIFR = 1 << INTF0;
+	EIMSK |= 1 << INT0;
+	adbstate = ADB_LISTEN;
+}
 
-	return data;
-out:
-	return 0;
+static void start_reply(uint16_t data, uint16_t stop_end)
+{
+	txdata = data;
+	txbit = 0;
+	txlow = 0;
+	adbstate = ADB_REPLY;
+	EIMSK &= ~(1 << INT0);
+	schedule_at(stop_end + ADB_TICKS(ADB_TLT_US)); // stop to start time
 }
 
+static uint8_t tx_bit_value(uint8_t i)
+{
+	if (i == 0)
+		return 1; // start bit
+	if (i > 16)
+		return 0; // stop bit
+	return (txdata >> (16 - i)) & 1;
+}
 
-void adbSetup(){
-	ADB_DDR &= ~(1 << ADB_DATA_BIT);
+static uint16_t mouse_reply(void)
+{
+	// Drain what fits in the 7-bit fields; the rest goes out on the next poll
+	// (SRQ keeps it coming if the Mac is elsewhere).
+	int8_t dy = take_report(&mouseDy);
+	int8_t dx = take_report(&mouseDx);
+	uint8_t mouseByte0 = (!mouseDown) << 7 | (dy & 0x7F);
+	uint8_t mouseByte1 = 0x80 | (dx & 0x7F);
+	mouseDownSent = mouseDown;
+	mousepending = mouseDx || mouseDy;
+	return (uint16_t)mouseByte0 << 8 | mouseByte1;
 }
 
-/// @brief Main ADB loop
-/// This function is called repeatedly to handle ADB commands.
-/// It checks for pending mouse and keyboard commands, processes them,
-/// and sends the appropriate responses back to the Macintosh.
-void adbLoop()
+static uint16_t keyboard_reply(void)
 {
+	// Two transitions per reply, as the register 0 format allows; whatever is
+	// left raises SRQ again while the Mac polls the mouse.
+	uint8_t key0 = take_key();
+	uint8_t key1 = take_key();
+	kbdpending = kbdtail != kbdhead;
+	return (uint16_t)key0 << 8 | key1;
+}
 
-	uint8_t cmd = 0;
-	if (mousepending || kbdpending)
+static uint16_t keyboard_reg2(void)
+{
+	uint8_t adbleds = 0xFF;
+	if (!(ps2ledstate & kPS2LEDCaps)) // not used at the moment. My keyboard doesn't have leds.
+		adbleds &= ~2;
+	if (!(ps2ledstate & kPS2LEDScroll))
+		adbleds &= ~4;
+	if (!(ps2ledstate & kPS2LEDNum))
+		adbleds &= ~1;
+	return (uint16_t)modifierkeys << 8 | adbleds;
+}
+
+static uint8_t pending_flags(void)
+{
+	return (mousepending ? ADB_PENDING_MOUSE : 0) | (kbdpending ? ADB_PENDING_KBD : 0);
+}
+
+// The command's stop bit has ended at stop_end: answer it if it is ours.
+static void command_done(uint16_t stop_end)
+{
+	switch (adb_reply_for(rx.cmd, pending_flags()))
 	{
-		cmd = adb_recv_cmd(mousesrq | kbdsrq);
+	case ADB_REPLY_MOUSE:
+		start_reply(mouse_reply(), stop_end);
+		return;
+	case ADB_REPLY_KBD:
+		start_reply(keyboard_reply(), stop_end);
+		return;
+	case ADB_REPLY_KBD_REG2:
+		start_reply(keyboard_reg2(), stop_end);
+		return;
+	case ADB_REPLY_UNKNOWN:
+		unknowncmd = rx.cmd;
+		break;
+	default:
+		break;
 	}
+	rx_resume();
+}
 
+ISR(INT0_vect)
+{
+	uint16_t now = TCNT1;
+	switch (adb_rx_edge(&rx, data_in() != 0, now, pending_flags()))
+	{
+	case ADB_EDGE_SRQ:
+		data_lo();
+		adbstate = ADB_SRQ;
+		EIMSK &= ~(1 << INT0);
+		schedule_at(now + ADB_TICKS(ADB_SRQ_US));
+		break;
+	case ADB_EDGE_COMMAND:
+		command_done(now);
+		break;
+	default:
+		break;
+	}
+}
 
-	if (((cmd >> 4) & 0x0F) == 3) // A message meant for the mouse
+// Timer1 compare A: end of an SRQ, or the next edge of a reply.
+ISR(TIMER1_COMPA_vect)
+{
+	if (adbstate == ADB_SRQ)
 	{
-		switch (cmd & 0x0F)
-		{
-		case 0xC: // mouse movement
-			if (mousepending)
-			{
-				_delay_us(180);				  // stop to start time / interframe delay
-				ADB_DDR |= 1 << ADB_DATA_BIT; // set output
-				place_bit1();				  // start bit
-				send_byte(mouseByte0);
-				send_byte(mouseByte1);
-				place_bit0();					 // stop bit
-				ADB_DDR &= ~(1 << ADB_DATA_BIT); // set input
-				mousepending = 0;
-				mousesrq = 0;
-			}
-			break;
-		default:
-			Serial.print("Unknown cmd: ");
-			Serial.println(cmd, HEX);
-			break;
-		}
+		data_hi();
+		adbstate = ADB_LISTEN;
+		command_done(OCR1A);
+		return;
 	}
-	else
+	if (adbstate != ADB_REPLY)
 	{
-		if (mousepending) // not a mouse command, but we have a pending mouse command so request attention.
-			mousesrq = 1;
+		rx_resume();
+		return;
 	}
-
-	if (((cmd >> 4) & 0x0F) == 2) // A message meant for the keyboard
+	uint8_t one = tx_bit_value(txbit);
+	if (!txlow)
+	{
+		data_lo();
+		txlow = 1;
+		OCR1A += one ? ADB_TICKS(ADB_BIT1_LOW_US) : ADB_TICKS(ADB_BIT0_LOW_US);
+		return;
+	}
+	data_hi();
+	txlow = 0;
+	if (txbit == 17)
 	{
-		uint8_t adbleds;
-		switch (cmd & 0x0F)
-		{
-		case 0xC: // talk register 0, keyboard data
-			if (kbdpending)
-			{
-				kbdsrq = 0;
-				_delay_us(180);				  // stop to start time / interframe delay
-				ADB_DDR |= 1 << ADB_DATA_BIT; // set output
-				place_bit1();				  // start bit
-				send_byte((kbdreg0 >> 8) & 0x00FF);
-				send_byte(kbdreg0 & 0x00FF);
-				place_bit0();					 // stop bit
-				ADB_DDR &= ~(1 << ADB_DATA_BIT); // set input
-				// Serial.println("Keyboard update: " + String(kbdreg0 >> 8) + ", " + String(kbdreg0 & 0x00FF));
-				kbdpending = 0;
-			}
-			break;
-		case 0xD: // talk register 1
-			break;
-		case 0xE: // talk register 2, led state
-			adbleds = 0xFF; 
-			if (!(ps2ledstate & kPS2LEDCaps)) // not used at the moment. My keyboard doesn't have leds.
-				adbleds &= ~2;
-			if (!(ps2ledstate & kPS2LEDScroll))
-				adbleds &= ~4;
-			if (!(ps2ledstate & kPS2LEDNum))
-				adbleds &= ~1;
+		rx_resume();
+		return;
+	}
+	OCR1A += one ? ADB_TICKS(ADB_BIT_CELL_US - ADB_BIT1_LOW_US) : ADB_TICKS(ADB_BIT_CELL_US - ADB_BIT0_LOW_US);
+	txbit++;
+}
 
-			_delay_us(180);				  // stop to start time / interframe delay
-			ADB_DDR |= 1 << ADB_DATA_BIT; // set output
-			place_bit1();				  // start bit
-			send_byte(modifierkeys);
-			send_byte(adbleds);
-			place_bit0();					 // stop bit
-			ADB_DDR &= ~(1 << ADB_DATA_BIT); // set input
+void adbSetup(){
+	ADB_DDR &= ~(1 << ADB_DATA_BIT);
+	// Timer1 free running at F_CPU/8 (TimerOne is not used alongside this).
+	TCCR1A = 0;
+	TCCR1B = 1 << CS11;
+	TIMSK1 = 0;
+	// INT0 on any edge of the data line.
+	EICRA = (EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC00);
+	rx_resume();
+}
 
-			break;
-		case 0xF: // talk register 3
-			// sets device address
-			break;
-		default:
-			Serial.print("Unknown cmd: ");
-			Serial.println(cmd, HEX);
-			break;
-		}
-	}
-	else
+/// @brief Main ADB loop
+/// The bus itself runs from INT0 and Timer1 interrupts; this only reports
+/// what the interrupt handlers can't print. The serial port carries the Pico
+/// link, so the report is built in only with -DADB_DEBUG.
+void adbLoop()
+{
+#ifdef ADB_DEBUG
+	uint8_t cmd = unknowncmd;
+	if (cmd)
 	{
-		if (kbdpending)
-			kbdsrq = 1;
+		unknowncmd = 0;
+		Serial.print("Unknown cmd: ");
+		Serial.println(cmd, HEX);
 	}
+#endif
 }
@@ -0,0 +1,87 @@
+#include "adb_rx.h"
+
+uint8_t adb_rx_edge(adb_rx_t *rx, uint8_t level, uint16_t now, uint8_t pending)
+{
+	if (!level)
+	{
+		rx->fallAt = now;
+		if (rx->state == ADB_RX_STOP && rx->srq)
+		{
+			// Stretch the stop bit: the Mac polls whoever has data next.
+			rx->state = ADB_RX_IDLE;
+			return ADB_EDGE_SRQ;
+		}
+		return ADB_EDGE_NONE;
+	}
+
+	uint16_t low = now - rx->fallAt;
+	if (low >= ADB_TICKS(ADB_RESET_MIN_US))
+	{
+		rx->state = ADB_RX_IDLE;
+		return ADB_EDGE_NONE;
+	}
+	if (low >= ADB_TICKS(ADB_ATTN_MIN_US))
+	{
+		// Attention; the sync gap follows and the first low is bit 7.
+		rx->state = ADB_RX_CMD;
+		rx->bits = 0;
+		rx->cmd = 0;
+		return ADB_EDGE_NONE;
+	}
+
+	switch (rx->state)
+	{
+	case ADB_RX_CMD:
+		if (low > ADB_TICKS(ADB_BIT_MAX_US))
+		{
+			rx->state = ADB_RX_IDLE;
+			break;
+		}
+		rx->cmd = rx->cmd << 1 | (low < ADB_TICKS(ADB_BIT_THRESHOLD_US));
+		if (++rx->bits == 8)
+		{
+			// SRQ goes on any command not addressed to the device with data.
+			uint8_t addr = rx->cmd >> 4;
+			rx->srq = ((pending & ADB_PENDING_MOUSE) && addr != 3) ||
+			          ((pending & ADB_PENDING_KBD) && addr != 2);
+			rx->state = ADB_RX_STOP;
+		}
+		break;
+	case ADB_RX_STOP:
+		rx->state = ADB_RX_IDLE;
+		return ADB_EDGE_COMMAND;
+	default:
+		break;
+	}
+	return ADB_EDGE_NONE;
+}
+
+uint8_t adb_reply_for(uint8_t cmd, uint8_t pending)
+{
+	uint8_t addr = cmd >> 4;
+	uint8_t reg = cmd & 0x0F;
+	if (addr == 3) // A message meant for the mouse
+	{
+		if (reg == 0xC) // mouse movement
+			return (pending & ADB_PENDING_MOUSE) ? ADB_REPLY_MOUSE : ADB_REPLY_NONE;
+		return ADB_REPLY_UNKNOWN;
+	}
+	if (addr == 2) // A message meant for the keyboard
+	{
+		switch (reg)
+		{
+		case 0xC: // talk register 0, keyboard data
+			return (pending & ADB_PENDING_KBD) ? ADB_REPLY_KBD : ADB_REPLY_NONE;
+		case 0xD: // talk register 1
+			return ADB_REPLY_NONE;
+		case 0xE: // talk register 2, led state
+			return ADB_REPLY_KBD_REG2;
+		case 0xF: // talk register 3
+			// sets device address
+			return ADB_REPLY_NONE;
+		default:
+			return ADB_REPLY_UNKNOWN;
+		}
+	}
+	return ADB_REPLY_NONE;
+}
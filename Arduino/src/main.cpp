@@ -1,55 +1,110 @@
 #include "Arduino.h"
-#include "instruction.h"
+#include "link.h"
 #include <adb.h>
+#include <util/crc16.h>
 
-#define MAGIC_NUMBER 123 // chosen for optimal magicness
+uint8_t rxbuf[LINK_FRAME_MAX]; // frame being received
+uint8_t rxlen = 0;
+uint8_t frame[LINK_FRAME_MAX]; // frame whose events are being taken
+uint8_t framelen = 0;
+uint8_t framepos = 0;          // next event in frame
+uint8_t frameheld = 0;         // frame not yet fully taken, so not acked
+uint8_t lastseq = 0;           // last frame taken, for spotting repeats
+uint8_t haveseq = 0;
 
-MouseInstruction instruction;
-
-void setup()
+static void sendAck(uint8_t seq)
 {
-	Serial.begin(115200);
-	adbSetup();
-	Serial.println("adbpoll setup");
+	uint8_t ack[5] = {LINK_ACK_SYNC, seq, adbKeyRoom(), 0, 0};
+	uint16_t crc = 0xFFFF;
+	crc = _crc_ccitt_update(crc, ack[1]);
+	crc = _crc_ccitt_update(crc, ack[2]);
+	ack[3] = crc & 0xFF;
+	ack[4] = crc >> 8;
+	Serial.write(ack, sizeof(ack));
 }
 
-void loop()
+// Take the held frame's events in order. A click waiting for earlier motion
+// to be polled out, or a key with the queue full, holds the rest (and the ack)
+// until a later pass.
+static void takeEvents()
 {
-
-	
-	if ((!mousepending && !kbdpending) && Serial.available())
+	while (framepos < framelen)
 	{
-		Serial.readBytes((char *)&instruction, sizeof(MouseInstruction));
-		if (instruction.magic != MAGIC_NUMBER)
+		const uint8_t *ev = &frame[3 + framepos];
+		if (ev[0] == LINK_EV_MOUSE)
 		{
-			Serial.println("Invalid magic number: " + String(instruction.magic) + ", " + String(instruction.dx) + ", " + String(instruction.dy) + ", " + String(instruction.mouseIsDown));
-			Serial.read();
-			return;
+			if (!adbMouseAdd((int8_t)ev[2], (int8_t)ev[3], ev[1] & 1))
+				return;
 		}
-
-		if (instruction.updateType & UPDATE_MOUSE && !mousepending)
+		else if (ev[0] == LINK_EV_KEY)
 		{
-			Serial.println("Mouse update: " + String(instruction.dx) + ", " + String(instruction.dy) + ", " + String(instruction.mouseIsDown));
-			mousepending = 1;
-			mouseByte0 = (!instruction.mouseIsDown) << 7 | (instruction.dy & 0x7F);
-			mouseByte1 = 0x80 | (instruction.dx & 0x7F);
+			if (!adbKeyPush(ev[1], ev[2] & 1, ev[3]))
+				return;
 		}
+		framepos += LINK_EVENT_BYTES;
+	}
+	frameheld = 0;
+	lastseq = frame[2];
+	haveseq = 1;
+	sendAck(lastseq);
+}
 
-		if (instruction.updateType & UPDATE_KEYBOARD && !kbdpending)
-		{
-			// Serial.println("Keyboard update: " + String(instruction.keyCode) + ", " + String(instruction.isKeyUp) + ", " + String(instruction.modifierKeys));
-			kbdpending = 1;
-			kbdreg0 = instruction.keyCode;
-			if (instruction.isKeyUp)
-			{
-				kbdreg0 |= 0x80;
-			}
-			modifierkeys = instruction.modifierKeys;
-			kbdreg0 = (kbdreg0 << 8) | 0xFF;
-			
-		}
+// rxbuf holds a whole frame.
+static void frameReceived()
+{
+	uint8_t len = rxbuf[1];
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 1; i < 3 + len; i++)
+		crc = _crc_ccitt_update(crc, rxbuf[i]);
+	if (rxbuf[3 + len] != (crc & 0xFF) || rxbuf[4 + len] != (crc >> 8))
+		return; // the Pico sends it again
+	uint8_t seq = rxbuf[2];
+	if (frameheld)
+		return; // acked once the held frame is taken
+	if (haveseq && seq == lastseq)
+	{
+		sendAck(seq); // the ack was lost
+		return;
+	}
+	memcpy(frame, rxbuf, 3 + len);
+	framelen = len;
+	framepos = 0;
+	frameheld = 1;
+	takeEvents();
+}
+
+static void linkByte(uint8_t b)
+{
+	if (rxlen == 0 && b != LINK_SYNC)
+		return;
+	rxbuf[rxlen++] = b;
+	if (rxlen == 2 && (b % LINK_EVENT_BYTES || b > LINK_EVENTS_MAX * LINK_EVENT_BYTES))
+	{
+		rxlen = 0;
+		return;
+	}
+	if (rxlen >= 3 && rxlen == 5 + rxbuf[1])
+	{
+		frameReceived();
+		rxlen = 0;
+	}
+}
 
-	} 
+void setup()
+{
+	Serial.begin(LINK_BAUD);
+	adbSetup();
+}
+
+void loop()
+{
+	if (frameheld)
+		takeEvents();
+
+	// The bus runs from interrupts, so this loop only moves serial bytes:
+	// a frame's events are taken as soon as its last byte is in.
+	while (Serial.available())
+		linkByte(Serial.read());
 
 	adbLoop();
-}	
\ No newline at end of file
+}
@@ -0,0 +1,38 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/host/port/sim_dma.c" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_dma.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_dma.c.o.d"
+  "/root/repo/host/port/sim_pio.c" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_pio.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_pio.c.o.d"
+  "/root/repo/host/port/sim_platform.c" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_platform.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_platform.c.o.d"
+  "/root/repo/host/port/sim_uart.c" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_uart.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_uart.c.o.d"
+  "/root/repo/host/port/sim_usb.c" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_usb.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_usb.c.o.d"
+  "/root/repo/src/app_core.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/app_core.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/app_core.c.o.d"
+  "/root/repo/src/bench_frames.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/bench_frames.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/bench_frames.c.o.d"
+  "/root/repo/src/core_bridge.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/core_bridge.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/core_bridge.c.o.d"
+  "/root/repo/src/frame_trace.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/frame_trace.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/frame_trace.c.o.d"
+  "/root/repo/src/input_uart.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/input_uart.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/input_uart.c.o.d"
+  "/root/repo/src/line_monitor.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/line_monitor.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/line_monitor.c.o.d"
+  "/root/repo/src/main.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/main.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/main.c.o.d"
+  "/root/repo/src/signal_counter.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/signal_counter.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/signal_counter.c.o.d"
+  "/root/repo/src/usb_control.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/usb_control.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/usb_control.c.o.d"
+  "/root/repo/src/video_capture.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_capture.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_capture.c.o.d"
+  "/root/repo/src/video_core.c" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_core.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_core.c.o.d"
+  "/root/repo/host/sim/sim_host.c" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_host.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_host.c.o.d"
+  "/root/repo/host/sim/sim_input.c" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_input.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_input.c.o.d"
+  "/root/repo/host/sim/sim_main.c" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_main.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_main.c.o.d"
+  "/root/repo/host/sim/sim_source.c" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_source.c.o" "gcc" "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_source.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,49 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_dma.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_dma.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_pio.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_pio.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_platform.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_platform.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_uart.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_uart.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_usb.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/port/sim_usb.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/app_core.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/app_core.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/bench_frames.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/bench_frames.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/core_bridge.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/core_bridge.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/frame_trace.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/frame_trace.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/input_uart.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/input_uart.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/line_monitor.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/line_monitor.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/main.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/main.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/signal_counter.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/signal_counter.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/usb_control.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/usb_control.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_capture.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_capture.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_core.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/root/repo/src/video_core.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_host.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_host.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_input.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_input.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_main.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_main.c.o.d"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_source.c.o"
+  "CMakeFiles/ebd_ipkvm_sim.dir/sim/sim_source.c.o.d"
+  "ebd_ipkvm_sim"
+  "ebd_ipkvm_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/ebd_ipkvm_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
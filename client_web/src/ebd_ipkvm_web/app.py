@@ -4,25 +4,25 @@ from __future__ import annotations
 
 import asyncio
 import struct
+import sys
+import time
+from collections import deque
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Any, Dict, Optional
+from typing import Any, Deque, Dict, Optional
 
 from fastapi import FastAPI, HTTPException, WebSocket, WebSocketDisconnect
 from fastapi.responses import HTMLResponse, JSONResponse
 
+from .pointer import AbsolutePointer, PointerStats
+from .stream import FrameQueue, IngestThread, host_now_us
+
 STATIC_DIR = Path(__file__).resolve().parent / "static"
 INDEX_HTML = STATIC_DIR / "index.html"
+# ctypes bindings for the native ingest library, when run from a checkout.
+NATIVE_PY_DIR = Path(__file__).resolve().parents[3] / "native" / "python"
 
-W = 512
 H = 342
-LINE_BYTES = 64
-HEADER_BYTES = 8
-MAX_PAYLOAD = LINE_BYTES * 2
-RLE_FLAG = 0x8000
-LEN_MASK = 0x7FFF
-MAGIC0 = 0xEB
-MAGIC1 = 0xD1
 USB_VID = 0x2E8A
 USB_PID = 0x000A
 CTRL_REQ_CAPTURE_START = 0x01
@@ -33,6 +33,11 @@ CTRL_REQ_PS_ON = 0x08
 CTRL_REQ_PS_OFF = 0x09
 CTRL_REQ_BOOTSEL = 0x0A
 CTRL_REQ_REBOOT = 0x0B
+CTRL_REQ_GET_TIME = 0x81
+
+CLOCK_RESYNC_SECS = 10.0
+LATENCY_WINDOW = 600
+LATENCY_REPORT_SECS = 1.0
 
 DEFAULT_BOOT_WAIT_S = 0.0
 DEFAULT_DIAG_SECS = 0.0
@@ -46,6 +51,7 @@ class SessionState:
     websocket: Optional[WebSocket] = None
     stream_task: Optional[asyncio.Task[None]] = None
     stream_stop: asyncio.Event = field(default_factory=asyncio.Event)
+    pointer: AbsolutePointer = field(default_factory=AbsolutePointer)
     lock: asyncio.Lock = field(default_factory=asyncio.Lock)
 
 
@@ -57,8 +63,9 @@ class SessionManager:
         if self._state.stream_task or self._state.websocket is None:
             return
         self._state.stream_stop.clear()
+        self._state.pointer.reset()
         self._state.stream_task = asyncio.create_task(
-            stream_loop(self._state.websocket, self._state.stream_stop)
+            stream_loop(self._state.websocket, self._state.stream_stop, self._state.pointer)
         )
 
     async def _stop_stream(self) -> None:
@@ -114,6 +121,20 @@ class SessionManager:
         async with self._state.lock:
             return {"active": self._state.active, "owner_id": self._state.owner_id}
 
+    def pointer_event(self, data: Dict[str, Any]) -> None:
+        """Queue browser pointer input; the stream loop sends it with the frames."""
+        pointer = self._state.pointer
+        kind = data.get("type")
+        try:
+            if kind == "pointer":
+                pointer.set_target(int(data["x"]), int(data["y"]))
+            elif kind == "pointer_button":
+                pointer.set_buttons(bool(data.get("down")))
+            elif kind == "mouse":
+                pointer.move_relative(int(data["dx"]), int(data["dy"]))
+        except (KeyError, TypeError, ValueError):
+            pass
+
     async def attach_websocket(self, websocket: WebSocket) -> None:
         async with self._state.lock:
             if self._state.websocket is not None:
@@ -130,7 +151,7 @@ class SessionManager:
                 await self._stop_stream()
 
 
-def open_usb_stream() -> tuple[Any, int, Any]:
+def open_usb_stream() -> tuple[Any, int, Any, Any]:
     try:
         import usb.core
         import usb.util
@@ -169,7 +190,94 @@ def open_usb_stream() -> tuple[Any, int, Any]:
     )
     if ep_in is None:
         raise RuntimeError("Bulk IN endpoint not found.")
-    return dev, intf.bInterfaceNumber, ep_in
+    # Input records (src/input_events.h); older firmware has no OUT endpoint.
+    ep_out = usb.util.find_descriptor(
+        intf,
+        custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress)
+        == usb.util.ENDPOINT_OUT,
+    )
+    return dev, intf.bInterfaceNumber, ep_in, ep_out
+
+
+def import_native() -> Optional[Any]:
+    """The native/ ctypes bindings, or None when the library is not built."""
+    if NATIVE_PY_DIR.is_dir() and str(NATIVE_PY_DIR) not in sys.path:
+        sys.path.insert(0, str(NATIVE_PY_DIR))
+    try:
+        import ebd_ipkvm_host
+    except ImportError:
+        return None
+    return ebd_ipkvm_host if ebd_ipkvm_host.available() else None
+
+
+def open_native_ingest() -> Optional[Any]:
+    """libusb async bulk ingest from native/, or None to use pyusb."""
+    native = import_native()
+    if native is None:
+        return None
+    try:
+        return native.BulkIngest(USB_VID, USB_PID)
+    except native.NativeError:
+        return None
+
+
+def open_native_assembler() -> Optional[Any]:
+    """Native packet parser and frame assembler, or None to parse in Python."""
+    native = import_native()
+    if native is None:
+        return None
+    try:
+        return native.FrameAssembler()
+    except native.NativeError:
+        return None
+
+
+@dataclass
+class UsbStream:
+    """Bulk IN/OUT on the vendor interface, through native ingest or pyusb."""
+
+    dev: Any
+    intf_num: Optional[int] = None
+    ep_in: Any = None
+    ep_out: Any = None
+    ingest: Any = None
+
+    @property
+    def has_input(self) -> bool:
+        return self.ingest is not None or self.ep_out is not None
+
+    def read(self, timeout_s: float) -> bytes:
+        if self.ingest is not None:
+            try:
+                return self.ingest.read(timeout_s)
+            except RuntimeError:
+                return b""
+        return read_usb_stream(self.ep_in, timeout_s)
+
+    def write(self, records: bytes) -> bool:
+        if self.ingest is not None:
+            return self.ingest.write(records) == len(records)
+        return self.ep_out is not None and write_usb_input(self.ep_out, records)
+
+    def close(self) -> None:
+        if self.ingest is not None:
+            self.ingest.close()
+            return
+        try:
+            import usb.util
+
+            usb.util.release_interface(self.dev, self.intf_num)
+        except Exception:
+            pass
+
+
+def open_stream() -> UsbStream:
+    ingest = open_native_ingest()
+    if ingest is not None:
+        # The native side owns the interface; vendor EP0 requests need no claim.
+        return UsbStream(dev=open_usb_device_for_control(), ingest=ingest)
+    dev, intf_num, ep_in, ep_out = open_usb_stream()
+    return UsbStream(dev=dev, intf_num=intf_num, ep_in=ep_in, ep_out=ep_out)
 
 
 def read_usb_stream(ep_in: Any, timeout_s: float) -> bytes:
@@ -181,6 +289,14 @@ def read_usb_stream(ep_in: Any, timeout_s: float) -> bytes:
         return b""
 
 
+def write_usb_input(ep_out: Any, records: bytes) -> bool:
+    try:
+        ep_out.write(records, timeout=100)
+        return True
+    except Exception:
+        return False
+
+
 def open_usb_device_for_control() -> Any:
     try:
         import usb.core
@@ -210,6 +326,42 @@ def send_ep0_cmd(dev: Any, req: int) -> None:
         raise RuntimeError(f"EP0 control transfer failed (req=0x{req:02X}): {exc}") from exc
 
 
+def sync_device_clock(dev: Any, samples: int = 8) -> Optional[tuple[int, int, int]]:
+    """Return (device_us_64, host_us, rtt_us) from the shortest-RTT sample."""
+    best: Optional[tuple[int, int, int]] = None
+    for _ in range(samples):
+        try:
+            t0 = host_now_us()
+            raw = bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_TIME, 0, 0, 8))
+            t1 = host_now_us()
+        except Exception:
+            return None
+        if len(raw) < 8:
+            return None
+        rtt = t1 - t0
+        if best is None or rtt < best[2]:
+            best = (struct.unpack("<Q", raw)[0], (t0 + t1) // 2, rtt)
+    return best
+
+
+def device_to_host_us(clock: tuple[int, int, int], dev_us32: int) -> int:
+    dev64, host_us, _ = clock
+    delta = ((dev_us32 - (dev64 & 0xFFFFFFFF) + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+    return host_us + delta
+
+
+def latency_percentiles(samples: Deque[int]) -> Dict[str, float]:
+    vals = sorted(samples)
+    if not vals:
+        return {}
+
+    def pick(pct: float) -> float:
+        idx = min(len(vals) - 1, int(round(pct / 100.0 * (len(vals) - 1))))
+        return vals[idx] / 1000.0
+
+    return {"p50": pick(50), "p90": pick(90), "p99": pick(99), "max": vals[-1] / 1000.0}
+
+
 async def run_control_sequence(
     websocket: WebSocket,
     *,
@@ -248,63 +400,111 @@ async def run_control_sequence(
         await websocket.send_json({"type": "status", "message": f"EP0: {note}"})
 
 
-def pop_one_packet(buf: bytearray) -> Optional[bytes]:
-    n = len(buf)
-    i = 0
-    while i + 1 < n and not (buf[i] == MAGIC0 and buf[i + 1] == MAGIC1):
-        i += 1
-    if i > 0:
-        del buf[:i]
-    if len(buf) < HEADER_BYTES:
-        return None
-    plen = buf[6] | (buf[7] << 8)
-    payload_len = plen & LEN_MASK
-    if payload_len == 0 or payload_len > MAX_PAYLOAD:
-        del buf[:2]
-        return None
-    total_len = HEADER_BYTES + payload_len
-    if len(buf) < total_len:
-        return None
-    pkt = bytes(buf[:total_len])
-    del buf[:total_len]
-    return pkt
+def pointer_report(stats: PointerStats) -> Dict[str, Any]:
+    return {
+        "type": "pointer",
+        "targets": stats.targets,
+        "landed": stats.landed,
+        "given_up": stats.given_up,
+        "corrections": stats.corrections,
+        "lost": stats.lost,
+        "last_frames": stats.last_frames,
+        "last_moves": stats.last_moves,
+    }
 
 
-async def stream_loop(websocket: WebSocket, stop_event: asyncio.Event) -> None:
+async def stream_loop(
+    websocket: WebSocket, stop_event: asyncio.Event, pointer: AbsolutePointer
+) -> None:
     try:
-        dev, intf_num, ep_in = open_usb_stream()
+        stream = await asyncio.to_thread(open_stream)
     except RuntimeError as exc:
         await websocket.send_json(
             {"type": "error", "message": f"Failed to open USB stream: {exc}"}
         )
         return
-    buf = bytearray()
+    dev = stream.dev
+    clock = await asyncio.to_thread(sync_device_clock, dev)
+    last_clock_sync = time.monotonic()
+    last_report = last_clock_sync
+    lat_total: Deque[int] = deque(maxlen=LATENCY_WINDOW)
+    lat_device: Deque[int] = deque(maxlen=LATENCY_WINDOW)
+    lat_usb: Deque[int] = deque(maxlen=LATENCY_WINDOW)
+    assembler = open_native_assembler()
+    if stream.ingest is not None:
+        await websocket.send_json({"type": "status", "message": "USB: native async ingest."})
+    if assembler is not None:
+        await websocket.send_json({"type": "status", "message": "Frames: native assembler."})
+    if not stream.has_input:
+        await websocket.send_json(
+            {"type": "status", "message": "No bulk OUT endpoint: pointer input disabled."}
+        )
+    # Reading, parsing and assembly run on the ingest thread; this task only
+    # takes finished frames, runs the pointer and sends.
+    frames = FrameQueue(asyncio.get_running_loop())
+    reader = IngestThread(stream, assembler, frames)
+    reader.start()
     try:
         while not stop_event.is_set():
-            chunk = await asyncio.to_thread(read_usb_stream, ep_in, 0.25)
-            if not chunk:
-                continue
-            buf.extend(chunk)
-            while True:
-                pkt = pop_one_packet(buf)
-                if pkt is None:
-                    break
-                frame_id = pkt[2] | (pkt[3] << 8)
-                line_id = pkt[4] | (pkt[5] << 8)
-                plen = pkt[6] | (pkt[7] << 8)
-                payload_len = plen & LEN_MASK
-                if payload_len == 0 or payload_len > MAX_PAYLOAD or line_id >= H:
-                    continue
-                payload = pkt[8 : 8 + payload_len]
-                header = struct.pack("<HHHH", frame_id, line_id, plen, 0)
-                await websocket.send_bytes(header + payload)
+            if not reader.is_alive():
+                await websocket.send_json(
+                    {"type": "error", "message": reader.error or "USB ingest stopped."}
+                )
+                break
+            now = time.monotonic()
+            if clock is not None and now - last_clock_sync > CLOCK_RESYNC_SECS:
+                last_clock_sync = now
+                clock = await asyncio.to_thread(sync_device_clock, dev) or clock
+            if now - last_report > LATENCY_REPORT_SECS:
+                last_report = now
+                if lat_total:
+                    await websocket.send_json(
+                        {
+                            "type": "latency",
+                            "frames": len(lat_total),
+                            "vsync_to_host_ms": latency_percentiles(lat_total),
+                            "device_ms": latency_percentiles(lat_device),
+                            "usb_ms": latency_percentiles(lat_usb),
+                        }
+                    )
+                crc_ok, crc_bad, crc_incomplete = reader.integrity
+                await websocket.send_json(
+                    {
+                        "type": "integrity",
+                        "crc_ok": crc_ok,
+                        "crc_bad": crc_bad,
+                        "crc_incomplete": crc_incomplete,
+                        "frames_dropped": frames.dropped,
+                    }
+                )
+                if pointer.stats.targets:
+                    await websocket.send_json(pointer_report(pointer.stats))
+            records = pointer.take_records()
+            if records and stream.has_input:
+                await asyncio.to_thread(stream.write, records)
+            await frames.wait(0.1)
+            for frame in frames.take():
+                if clock is not None:
+                    for vsync_us, last_us, rx_us in frame.ends:
+                        lat_total.append(rx_us - device_to_host_us(clock, vsync_us))
+                        lat_device.append((last_us - vsync_us) & 0xFFFFFFFF)
+                        lat_usb.append(rx_us - device_to_host_us(clock, last_us))
+                for note in frame.notes:
+                    await websocket.send_json({"type": "status", "message": note})
+                for line in range(H):
+                    pointer.add_line(frame.frame_id, line, frame.row(line))
+                pointer.end_frame(frame.frame_id)
+                records = pointer.take_records()
+                if records and stream.has_input:
+                    await asyncio.to_thread(stream.write, records)
+                if frame.dirty:
+                    await websocket.send_bytes(frame.message())
     finally:
-        try:
-            import usb.util
-
-            usb.util.release_interface(dev, intf_num)
-        except Exception:
-            pass
+        reader.stop()
+        await asyncio.to_thread(reader.join)
+        stream.close()
+        if assembler is not None:
+            assembler.close()
 
 
 def create_app() -> FastAPI:
@@ -353,6 +553,8 @@ def create_app() -> FastAPI:
                     )
                 elif data.get("type") == "ping":
                     await websocket.send_json({"type": "pong"})
+                elif data.get("type") in ("pointer", "pointer_button", "mouse"):
+                    session_manager.pointer_event(data)
         except WebSocketDisconnect:
             await session_manager.detach_websocket(websocket)
         finally:
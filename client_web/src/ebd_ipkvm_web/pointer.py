@@ -0,0 +1,480 @@
+"""Absolute pointer on top of a relative ADB mouse, closed through the video.
+
+Browsers deliver absolute coordinates, the ADB mouse only takes dx/dy, and the
+Mac's pointer acceleration scales those by an amount that depends on speed.
+Instead of guessing, AbsolutePointer finds the Mac's arrow cursor in each
+frame, moves it toward the target and looks again, learning the Mac's gain
+for each size of move as it goes. Each correction costs one round trip
+(ADB poll + cursor VBL task + one frame), so it lands in a few frames.
+
+Locating the cursor: successive frames are diffed inside a window around
+where the cursor is expected; the changed area holds the old and new cursor
+images, and the new one is picked out with a bit-parallel test on the arrow's
+tip, then scored against the full 16x16 arrow (black body, white outline).
+Stream bits are 1 = white.
+"""
+
+from __future__ import annotations
+
+import struct
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple
+
+W = 512
+H = 342
+LINE_BYTES = 64
+FULL_ROW = (1 << W) - 1
+
+INPUT_EV_MOUSE = 0x01  # src/input_events.h: buttons (bit 0 = down), dx i8, dy i8 (+ = down)
+MOVE_MAX = 127
+
+# Classic QuickDraw arrow (the Mac's default cursor): data = black pixels,
+# mask = data + white outline. Hot spot (1, 1).
+ARROW_DATA = (
+    0x0000, 0x4000, 0x6000, 0x7000, 0x7800, 0x7C00, 0x7E00, 0x7F00,
+    0x7F80, 0x7C00, 0x6C00, 0x4600, 0x0600, 0x0300, 0x0300, 0x0000,
+)
+ARROW_MASK = (
+    0xC000, 0xE000, 0xF000, 0xF800, 0xFC00, 0xFE00, 0xFF00, 0xFF80,
+    0xFFC0, 0xFFE0, 0xFE00, 0xEF00, 0xCF00, 0x8780, 0x0780, 0x0380,
+)
+HOT_X = 1
+HOT_Y = 1
+ARROW_SIZE = 16
+
+MATCH_MIN = 0.92      # fraction of arrow pixels that must agree
+MATCH_MIN_PIXELS = 14 # at the screen edge, need at least this much arrow visible
+TARGET_Y_MAX = H - 4  # lower, fewer than four arrow rows (14 px) are on screen
+SEARCH_PAD = 24       # px around the old and predicted positions searched for changes
+TOLERANCE = 1         # px; landed when both axes are within this
+SETTLE_FRAMES = 6     # frames to wait for a move to show before judging it
+NUDGE = 8             # counts sent to make a lost cursor show itself
+MAX_CORRECTIONS = 12
+MAX_STALLS = 3
+BUTTON_WAIT_FRAMES = 30  # clicks wait this long for the cursor to land
+
+# Move sizes (device counts) that share a learned gain: the Mac accelerates
+# by speed, so a 2-count nudge and a 100-count jump scale differently.
+GAIN_BANDS = (2, 7, 31, MOVE_MAX * 2)
+GAIN_UNLEARNED = 2.0  # undershoot until measured: overshoot can pin the cursor to an edge
+GAIN_MIN = 0.25
+GAIN_MAX = 8.0
+GAIN_ALPHA = 0.5
+
+
+def popcount(v: int) -> int:
+    return bin(v).count("1")
+
+
+def mouse_record(buttons: int, dx: int, dy: int) -> bytes:
+    return struct.pack("<BBbb", INPUT_EV_MOUSE, buttons, dx, dy)
+
+
+def mouse_records(buttons: int, dx: int, dy: int) -> bytes:
+    """Split a move into records of at most MOVE_MAX counts per axis."""
+    out = bytearray()
+    while True:
+        sx = max(-MOVE_MAX, min(MOVE_MAX, dx))
+        sy = max(-MOVE_MAX, min(MOVE_MAX, dy))
+        out += mouse_record(buttons, sx, sy)
+        dx -= sx
+        dy -= sy
+        if dx == 0 and dy == 0:
+            return bytes(out)
+
+
+def _window(row: int, x0: int) -> int:
+    """16 pixels of a row starting at x0 (may be off either edge), pixel x0 in bit 15."""
+    return ((row << ARROW_SIZE) >> (W - x0)) & 0xFFFF
+
+
+def _valid_cols(x0: int) -> int:
+    lo = max(0, -x0)
+    hi = min(ARROW_SIZE, W - x0)
+    if hi <= lo:
+        return 0
+    return ((1 << (hi - lo)) - 1) << (ARROW_SIZE - hi)
+
+
+def arrow_score(rows: List[int], hx: int, hy: int) -> Tuple[int, int]:
+    """(agreeing pixels, visible arrow pixels) for the arrow with its hot spot at hx, hy."""
+    x0 = hx - HOT_X
+    y0 = hy - HOT_Y
+    valid = _valid_cols(x0)
+    score = 0
+    total = 0
+    for r in range(ARROW_SIZE):
+        y = y0 + r
+        if y < 0 or y >= H:
+            continue
+        win = _window(rows[y], x0)
+        data = ARROW_DATA[r] & valid
+        outline = ARROW_MASK[r] & ~ARROW_DATA[r] & valid
+        score += popcount(~win & data) + popcount(win & outline)
+        total += popcount(data | outline)
+    return score, total
+
+
+def arrow_matches(rows: List[int], hx: int, hy: int) -> bool:
+    score, total = arrow_score(rows, hx, hy)
+    return total >= MATCH_MIN_PIXELS and score >= MATCH_MIN * total
+
+
+def _tip_candidates(rows: List[int], hy: int) -> int:
+    """Row mask of hot spot columns where the arrow's first two rows fit.
+
+    Hot spot black with white on both sides and white above it and to the
+    upper left; next row black at the hot spot and right of it, white either
+    side. Bit (W-1-x) is column x. Off-screen pixels count as white.
+    """
+    edge_l = 1 << (W - 1)
+    above = rows[hy - 1] if hy > 0 else FULL_ROW
+    tip = rows[hy]
+    cand = ~tip & ((tip << 1) | 1) & ((tip >> 1) | edge_l)
+    cand &= above & ((above >> 1) | edge_l)
+    if hy + 1 < H:
+        body = rows[hy + 1]
+        cand &= ~body & ~(body << 1) & ((body >> 1) | edge_l) & ((body << 2) | 3)
+    return cand & FULL_ROW
+
+
+def find_arrow(
+    rows: List[int], x_lo: int, x_hi: int, y_lo: int, y_hi: int,
+    near: Optional[Tuple[int, int]] = None,
+) -> Optional[Tuple[int, int]]:
+    """Best arrow hot spot inside [x_lo, x_hi] x [y_lo, y_hi], nearest `near` on ties."""
+    x_lo = max(0, x_lo)
+    x_hi = min(W - 1, x_hi)
+    y_lo = max(0, y_lo)
+    y_hi = min(H - 1, y_hi)
+    if x_lo > x_hi or y_lo > y_hi:
+        return None
+    cols = ((1 << (x_hi - x_lo + 1)) - 1) << (W - 1 - x_hi)
+    best: Optional[Tuple[int, int]] = None
+    best_key: Tuple[float, int] = (0.0, 0)
+    for hy in range(y_lo, y_hi + 1):
+        cand = _tip_candidates(rows, hy) & cols
+        while cand:
+            bit = cand.bit_length() - 1
+            cand &= ~(1 << bit)
+            hx = W - 1 - bit
+            score, total = arrow_score(rows, hx, hy)
+            if total < MATCH_MIN_PIXELS or score < MATCH_MIN * total:
+                continue
+            dist = abs(hx - near[0]) + abs(hy - near[1]) if near else 0
+            key = (score / total, -dist)
+            if best is None or key > best_key:
+                best = (hx, hy)
+                best_key = key
+    return best
+
+
+def changed_box(
+    cur: List[int], prev: List[int], x_lo: int, x_hi: int, y_lo: int, y_hi: int
+) -> Optional[Tuple[int, int, int, int]]:
+    """Bounding box (x0, x1, y0, y1) of pixels that differ inside the window."""
+    x_lo = max(0, x_lo)
+    x_hi = min(W - 1, x_hi)
+    if x_lo > x_hi:
+        return None
+    cols = ((1 << (x_hi - x_lo + 1)) - 1) << (W - 1 - x_hi)
+    bx0 = W
+    bx1 = -1
+    by0 = -1
+    by1 = -1
+    for y in range(max(0, y_lo), min(H - 1, y_hi) + 1):
+        diff = (cur[y] ^ prev[y]) & cols
+        if not diff:
+            continue
+        if by0 < 0:
+            by0 = y
+        by1 = y
+        bx0 = min(bx0, W - diff.bit_length())
+        bx1 = max(bx1, W - (diff & -diff).bit_length())
+    if by0 < 0:
+        return None
+    return bx0, bx1, by0, by1
+
+
+@dataclass
+class Move:
+    dx: int
+    dy: int
+    start: Optional[Tuple[int, int]]  # None: sent while the cursor was lost
+    frames: int = 0
+    last: Optional[Tuple[int, int]] = None
+
+
+@dataclass
+class PointerStats:
+    targets: int = 0
+    landed: int = 0
+    given_up: int = 0
+    corrections: int = 0
+    lost: int = 0
+    last_frames: int = 0  # frames from target to landing, last landing
+    last_moves: int = 0
+
+
+@dataclass
+class AbsolutePointer:
+    """Closed-loop absolute pointer: feed it frames, send what it queues.
+
+    Call add_line() for each decoded line and end_frame() at each frame end
+    packet; set_target()/set_buttons() come from the client. take_records()
+    returns mouse records for the bulk OUT endpoint.
+    """
+
+    target: Optional[Tuple[int, int]] = None
+    pos: Optional[Tuple[int, int]] = None
+    last_seen: Tuple[int, int] = (W // 2, H // 2)
+    buttons: int = 0
+    stats: PointerStats = field(default_factory=PointerStats)
+    gains: Dict[int, List[float]] = field(default_factory=dict)
+    _frame_id: Optional[int] = None
+    _lines: List[int] = field(default_factory=lambda: [0] * H)
+    _seen: int = 0
+    _prev: Optional[List[int]] = None
+    _move: Optional[Move] = None
+    _frames: int = 0
+    _moves: int = 0
+    _stalls: int = 0
+    _last_counts: Tuple[int, int] = (0, 0)
+    _pending_buttons: List[int] = field(default_factory=list)
+    _button_wait: int = 0
+    _out: bytearray = field(default_factory=bytearray)
+
+    def set_target(self, x: int, y: int) -> None:
+        target = (max(0, min(W - 1, int(x))), max(0, min(TARGET_Y_MAX, int(y))))
+        if self.target is None:
+            self.stats.targets += 1
+            self._frames = 0
+            self._moves = 0
+            self._stalls = 0
+            self._last_counts = (0, 0)
+        self.target = target
+
+    def set_buttons(self, down: bool) -> None:
+        # Clicks go out once the cursor has landed, or they hit the wrong spot.
+        self._pending_buttons.append(1 if down else 0)
+        if self.target is None:
+            self._flush_buttons()
+
+    def move_relative(self, dx: int, dy: int) -> None:
+        """Plain relative motion (tracking off); the cursor estimate goes stale."""
+        self.target = None
+        self.pos = None
+        self._out += mouse_records(self.buttons, int(dx), int(dy))
+
+    def take_records(self) -> bytes:
+        out = bytes(self._out)
+        self._out.clear()
+        return out
+
+    def reset(self) -> None:
+        self.target = None
+        self.pos = None
+        self._prev = None
+        self._move = None
+        self._frame_id = None
+        self._seen = 0
+        self._pending_buttons.clear()
+        self._out.clear()
+
+    def add_line(self, frame_id: int, line_id: int, line: bytes) -> None:
+        if frame_id != self._frame_id:
+            self._frame_id = frame_id
+            self._seen = 0
+        self._lines[line_id] = int.from_bytes(line, "big")
+        self._seen += 1
+
+    def end_frame(self, frame_id: int) -> None:
+        if frame_id != self._frame_id or self._seen < H:
+            return
+        self._frame_id = None
+        cur = list(self._lines)
+        prev = self._prev
+        self._prev = cur
+        if prev is None:
+            if self.pos is not None and not arrow_matches(cur, *self.pos):
+                self.pos = None
+            return
+        self._step(cur, prev)
+
+    # -- control loop ------------------------------------------------------
+
+    def _gain(self, counts: int) -> float:
+        band = self._band(counts)
+        if band in self.gains:
+            return self.gains[band][0]
+        # Unlearned band: borrow the nearest learned one.
+        learned = sorted(self.gains, key=lambda b: abs(b - band))
+        return self.gains[learned[0]][0] if learned else GAIN_UNLEARNED
+
+    @staticmethod
+    def _band(counts: int) -> int:
+        for i, top in enumerate(GAIN_BANDS):
+            if counts <= top:
+                return i
+        return len(GAIN_BANDS) - 1
+
+    def _learn(self, counts: int, moved: int) -> None:
+        if abs(counts) < 2 or moved == 0 or (moved > 0) != (counts > 0):
+            return
+        gain = moved / counts
+        if not GAIN_MIN <= gain <= GAIN_MAX:
+            return
+        band = self._band(abs(counts))
+        if band in self.gains:
+            old = self.gains[band][0]
+            self.gains[band][0] = old + GAIN_ALPHA * (gain - old)
+        else:
+            self.gains[band] = [gain]
+
+    def _expected(self) -> Optional[Tuple[int, int]]:
+        if self.pos is None:
+            return None
+        if self._move is None or self._move.start is None:
+            return self.pos
+        mx, my = self._move.start
+        return (
+            mx + round(self._move.dx * self._gain(abs(self._move.dx))),
+            my + round(self._move.dy * self._gain(abs(self._move.dy))),
+        )
+
+    def _locate(self, cur: List[int], prev: List[int]) -> Optional[Tuple[int, int]]:
+        expect = self._expected()
+        if self.pos is None or expect is None:
+            box = changed_box(cur, prev, 0, W - 1, 0, H - 1)
+            near = None
+        else:
+            box = changed_box(
+                cur, prev,
+                min(self.pos[0], expect[0]) - SEARCH_PAD, max(self.pos[0], expect[0]) + SEARCH_PAD,
+                min(self.pos[1], expect[1]) - SEARCH_PAD, max(self.pos[1], expect[1]) + SEARCH_PAD,
+            )
+            near = expect
+        if box is None:
+            # Nothing moved: still there if it was seen before.
+            if self.pos is not None and arrow_matches(cur, *self.pos):
+                return self.pos
+            return None
+        x0, x1, y0, y1 = box
+        # The new arrow covers changed pixels; its hot spot sits in its upper
+        # left corner, so search up to one arrow left of and above the box.
+        found = find_arrow(cur, x0 - ARROW_SIZE, x1 + HOT_X, y0 - ARROW_SIZE, y1 + HOT_Y, near)
+        if found is None and self.pos is not None and arrow_matches(cur, *self.pos):
+            found = self.pos
+        return found
+
+    def _step(self, cur: List[int], prev: List[int]) -> None:
+        if self.target is None and self._move is None and not self._pending_buttons:
+            # Idle: keep the estimate honest without searching for it.
+            if self.pos is not None and not arrow_matches(cur, *self.pos):
+                self.pos = None
+            return
+        if self.target is not None:
+            self._frames += 1
+        pos = self._locate(cur, prev)
+        if pos is None and self.pos is not None:
+            self.stats.lost += 1
+        self.pos = pos
+        if pos is not None:
+            self.last_seen = pos
+
+        move = self._move
+        if move is not None:
+            move.frames += 1
+            # Wait for the move to show and then hold still for a frame: a
+            # long move spans several ADB polls and can be caught halfway.
+            arrived = pos is not None and pos != move.start and pos == move.last
+            move.last = pos
+            if not arrived and move.frames < SETTLE_FRAMES:
+                return
+            self._move = None
+            if pos is None:
+                # Not seen where it went: dead-reckon, so the next nudge
+                # heads away from the edge it probably ran into.
+                bx, by = move.start or self.last_seen
+                self.last_seen = (
+                    max(0, min(W - 1, bx + round(move.dx * self._gain(abs(move.dx))))),
+                    max(0, min(H - 1, by + round(move.dy * self._gain(abs(move.dy))))),
+                )
+            elif move.start is not None:
+                # A move that ended on an edge was cut short; it says nothing
+                # about the gain.
+                if 0 < pos[0] < W - 1:
+                    self._learn(move.dx, pos[0] - move.start[0])
+                if 0 < pos[1] < H - 1:
+                    self._learn(move.dy, pos[1] - move.start[1])
+                self._stalls = self._stalls + 1 if pos == move.start else 0
+
+        if self.target is None:
+            self._flush_buttons()
+            return
+        if self._pending_buttons:
+            self._button_wait += 1
+            if self._button_wait >= BUTTON_WAIT_FRAMES:
+                self._finish(landed=False)
+                return
+
+        if self._moves >= MAX_CORRECTIONS or self._stalls >= MAX_STALLS:
+            self._finish(landed=False)
+            return
+        if pos is None:
+            # Lost (hidden while typing, or pushed against an edge where too
+            # little of it shows): a small move toward the middle makes it
+            # redraw where the diff will find it.
+            lx, ly = self.last_seen
+            self._send(NUDGE if lx < W // 2 else -NUDGE, NUDGE if ly < H // 2 else -NUDGE, None)
+            return
+
+        ex = self.target[0] - pos[0]
+        ey = self.target[1] - pos[1]
+        if abs(ex) <= TOLERANCE and abs(ey) <= TOLERANCE:
+            self._finish(landed=True)
+            return
+        dx = self._counts(ex, self._last_counts[0])
+        dy = self._counts(ey, self._last_counts[1])
+        self._last_counts = (dx, dy)
+        self._send(dx, dy, pos)
+
+    def _counts(self, err: int, last: int) -> int:
+        """Device counts expected to move the cursor err pixels."""
+        if err == 0:
+            return 0
+        # The gain depends on the size of the move, which depends on the gain.
+        counts = round(err / self._gain(abs(err)))
+        counts = round(err / self._gain(abs(counts)))
+        # Never round a needed correction down to nothing.
+        if counts == 0:
+            counts = 1 if err > 0 else -1
+        # Overshot last time: the gain changes within a band, so halve the
+        # step rather than swing back by the same amount.
+        if last and (last > 0) != (counts > 0):
+            limit = max(1, abs(last) // 2)
+            counts = max(-limit, min(limit, counts))
+        return counts
+
+    def _send(self, dx: int, dy: int, start: Optional[Tuple[int, int]]) -> None:
+        self._out += mouse_records(self.buttons, dx, dy)
+        self._move = Move(dx, dy, start)
+        self._moves += 1
+        self.stats.corrections += 1
+
+    def _finish(self, landed: bool) -> None:
+        if landed:
+            self.stats.landed += 1
+            self.stats.last_frames = self._frames
+            self.stats.last_moves = self._moves
+        else:
+            self.stats.given_up += 1
+        self.target = None
+        self._flush_buttons()
+
+    def _flush_buttons(self) -> None:
+        for buttons in self._pending_buttons:
+            self.buttons = buttons
+            self._out += mouse_record(buttons, 0, 0)
+        self._pending_buttons.clear()
+        self._button_wait = 0
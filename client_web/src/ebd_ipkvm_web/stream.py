@@ -0,0 +1,314 @@
+"""Video ingest for the web bridge, off the event loop.
+
+One long-lived thread owns the bulk IN endpoint: it reads, splits the stream
+into packets, assembles whole frames (with the native assembler when it is
+built, in Python otherwise) and works out which lines changed since the last
+frame. Finished frames reach the event loop through a small queue that drops
+the oldest frame when the browser falls behind; a dropped frame's changed
+lines, frame end times and notes are folded into the next one, so the browser
+still receives every line that changed and the event loop only ever sends.
+"""
+
+from __future__ import annotations
+
+import asyncio
+import struct
+import threading
+import time
+import zlib
+from collections import deque
+from dataclasses import dataclass, field
+from typing import Any, Deque, List, Optional, Tuple
+
+W = 512
+H = 342
+LINE_BYTES = 64
+FRAME_BYTES = H * LINE_BYTES
+HEADER_BYTES = 8
+MAX_PAYLOAD = LINE_BYTES * 2
+RLE_FLAG = 0x8000
+LEN_MASK = 0x7FFF
+MAGIC0 = 0xEB
+MAGIC1 = 0xD1
+
+# Out-of-band frame end packet (see src/stream_protocol.h): timestamps + CRC-32.
+FRAME_END_LINE_ID = 0xFFF0
+FRAME_END_TS_BYTES = 12
+FRAME_END_CRC_BYTES = 16
+# Out-of-band payloads may exceed a line's (telemetry v5 is 138 bytes).
+AUX_PAYLOAD_MAX = 256
+
+READ_TIMEOUT_S = 0.05  # bounds how long stop() waits for the thread
+FRAME_QUEUE_DEPTH = 4  # frames waiting for the event loop (~67 ms at 60 Hz)
+ALL_LINES = (1 << H) - 1
+
+
+def host_now_us() -> int:
+    return time.monotonic_ns() // 1000
+
+
+def decode_rle_line(payload: bytes) -> Optional[bytes]:
+    if len(payload) % 2:
+        return None
+    out = bytearray()
+    for i in range(0, len(payload), 2):
+        count = payload[i]
+        if count == 0:
+            return None
+        out.extend(payload[i + 1 : i + 2] * count)
+        if len(out) > LINE_BYTES:
+            return None
+    if len(out) != LINE_BYTES:
+        return None
+    return bytes(out)
+
+
+@dataclass
+class FrameCrcCheck:
+    """Running CRC-32 over in-order lines, checked at each frame end packet."""
+
+    frame_id: Optional[int] = None
+    next_line: int = 0
+    crc: int = 0
+    ok: int = 0
+    bad: int = 0
+    incomplete: int = 0
+
+    def add_line(self, frame_id: int, line_id: int, line: Optional[bytes]) -> None:
+        if frame_id != self.frame_id:
+            self.frame_id = frame_id
+            self.next_line = 0
+            self.crc = 0
+        if line_id != self.next_line:
+            self.next_line = -1  # out of order or missing; frame cannot be checked
+            return
+        if line is None or len(line) != LINE_BYTES:
+            self.next_line = -1
+            return
+        self.crc = zlib.crc32(line, self.crc)
+        self.next_line += 1
+
+    def finish(self, frame_id: int, device_crc: int) -> Optional[str]:
+        if frame_id != self.frame_id or self.next_line != H:
+            self.incomplete += 1
+            return None
+        self.frame_id = None
+        if self.crc == device_crc:
+            self.ok += 1
+            return None
+        self.bad += 1
+        return f"CRC mismatch frame_id={frame_id} device=0x{device_crc:08X} host=0x{self.crc:08X}"
+
+
+def pop_one_packet(buf: bytearray) -> Optional[bytes]:
+    n = len(buf)
+    i = 0
+    while i + 1 < n and not (buf[i] == MAGIC0 and buf[i + 1] == MAGIC1):
+        i += 1
+    if i > 0:
+        del buf[:i]
+    if len(buf) < HEADER_BYTES:
+        return None
+    plen = buf[6] | (buf[7] << 8)
+    payload_len = plen & LEN_MASK
+    line_id = buf[4] | (buf[5] << 8)
+    max_payload = AUX_PAYLOAD_MAX if line_id >= FRAME_END_LINE_ID else MAX_PAYLOAD
+    if payload_len == 0 or payload_len > max_payload:
+        del buf[:2]
+        return None
+    total_len = HEADER_BYTES + payload_len
+    if len(buf) < total_len:
+        return None
+    pkt = bytes(buf[:total_len])
+    del buf[:total_len]
+    return pkt
+
+
+@dataclass
+class StreamFrame:
+    """A whole frame handed to the event loop."""
+
+    frame_id: int
+    bits: bytes  # H lines of LINE_BYTES, 1 = white
+    dirty: int  # bit n set: line n differs from the frame sent before
+    # Frame end packets (vsync_us, last_line_us, rx_us) for this frame and any
+    # dropped before it, and CRC mismatch notes likewise.
+    ends: List[Tuple[int, int, int]] = field(default_factory=list)
+    notes: List[str] = field(default_factory=list)
+
+    def row(self, line: int) -> bytes:
+        return self.bits[line * LINE_BYTES : (line + 1) * LINE_BYTES]
+
+    def message(self) -> bytes:
+        """The changed lines as one WebSocket message of raw line packets."""
+        out = bytearray()
+        dirty = self.dirty
+        for line in range(H):
+            if dirty >> line & 1:
+                out += struct.pack("<HHHH", self.frame_id, line, LINE_BYTES, 0)
+                out += self.row(line)
+        return bytes(out)
+
+
+class FrameQueue:
+    """Ingest thread -> event loop, bounded; full means the oldest frame goes."""
+
+    def __init__(self, loop: asyncio.AbstractEventLoop, depth: int = FRAME_QUEUE_DEPTH) -> None:
+        self._loop = loop
+        self._depth = depth
+        self._lock = threading.Lock()
+        self._frames: Deque[StreamFrame] = deque()
+        self._ready = asyncio.Event()
+        self.dropped = 0
+
+    def put(self, frame: StreamFrame) -> None:
+        """Called from the ingest thread."""
+        with self._lock:
+            self._frames.append(frame)
+            if len(self._frames) > self._depth:
+                old = self._frames.popleft()
+                nxt = self._frames[0]
+                nxt.dirty |= old.dirty
+                nxt.ends[:0] = old.ends
+                nxt.notes[:0] = old.notes
+                self.dropped += 1
+        self._loop.call_soon_threadsafe(self._ready.set)
+
+    def take(self) -> List[StreamFrame]:
+        """Everything queued, oldest first. Event loop only."""
+        # Cleared before taking: a put() racing with this sets it again.
+        self._ready.clear()
+        with self._lock:
+            frames = list(self._frames)
+            self._frames.clear()
+        return frames
+
+    async def wait(self, timeout_s: float) -> None:
+        try:
+            await asyncio.wait_for(self._ready.wait(), timeout_s)
+        except asyncio.TimeoutError:
+            pass
+
+
+class IngestThread(threading.Thread):
+    """Owns stream.read() and the frame assembly for one streaming session.
+
+    stream is app.UsbStream; assembler is the native FrameAssembler or None to
+    parse in Python. Both are used only from this thread until it has been
+    joined. Writes (input records) stay with the caller: both USB backends
+    take a bulk OUT while a bulk IN read is pending.
+    """
+
+    def __init__(self, stream: Any, assembler: Any, frames: FrameQueue) -> None:
+        super().__init__(name="ebd-ingest", daemon=True)
+        self._stream = stream
+        self._assembler = assembler
+        self._frames = frames
+        self._stop_event = threading.Event()
+        self._last_bits: Optional[bytes] = None
+        # Python parsing: the frame being filled in place, its lines carried
+        # over from the frames before it.
+        self._buf = bytearray()
+        self._bits = bytearray(FRAME_BYTES)
+        self._frame_id: Optional[int] = None
+        self._crc_check = FrameCrcCheck()
+        # (ok, bad, incomplete), replaced whole so the event loop can read it.
+        self.integrity: Tuple[int, int, int] = (0, 0, 0)
+        self.error: Optional[str] = None
+
+    def stop(self) -> None:
+        self._stop_event.set()
+
+    def run(self) -> None:
+        try:
+            while not self._stop_event.is_set():
+                chunk = self._stream.read(READ_TIMEOUT_S)
+                rx_us = host_now_us()
+                if self._assembler is not None:
+                    # Also runs the frame timeouts when nothing arrived.
+                    self._assembler.feed(chunk, rx_us)
+                    self._take_native()
+                elif chunk:
+                    self._parse(chunk, rx_us)
+        except Exception as exc:  # reported by the session, which then stops
+            self.error = f"USB ingest stopped: {exc}"
+
+    def _emit(self, frame_id: int, bits: bytes, ends: List[Tuple[int, int, int]],
+              notes: List[str]) -> None:
+        last = self._last_bits
+        if last is None:
+            dirty = ALL_LINES
+        else:
+            dirty = 0
+            for line in range(H):
+                at = line * LINE_BYTES
+                if bits[at : at + LINE_BYTES] != last[at : at + LINE_BYTES]:
+                    dirty |= 1 << line
+        self._last_bits = bits
+        self._frames.put(StreamFrame(frame_id, bits, dirty, ends, notes))
+
+    def _take_native(self) -> None:
+        taken = False
+        # Partial frames arrive whole, their missing lines carried from the
+        # previous frame, so the browser draws them too.
+        for frame in self._assembler.frames():
+            taken = True
+            ends = []
+            if frame.has_end:
+                ends.append((frame.vsync_us, frame.last_line_us, frame.end_rx_us))
+            notes = []
+            if frame.crc_bad:
+                notes.append(f"CRC mismatch frame_id={frame.frame_id} "
+                             f"device=0x{frame.device_crc:08X} host=0x{frame.host_crc:08X}")
+            self._emit(frame.frame_id, frame.bits, ends, notes)
+        if taken:
+            c = self._assembler.counters()
+            self.integrity = (c["crc_ok"], c["crc_bad"], c["crc_incomplete"])
+
+    def _parse(self, chunk: bytes, rx_us: int) -> None:
+        buf = self._buf
+        buf.extend(chunk)
+        while True:
+            pkt = pop_one_packet(buf)
+            if pkt is None:
+                break
+            frame_id = pkt[2] | (pkt[3] << 8)
+            line_id = pkt[4] | (pkt[5] << 8)
+            plen = pkt[6] | (pkt[7] << 8)
+            payload_len = plen & LEN_MASK
+            if line_id == FRAME_END_LINE_ID:
+                ends = []
+                notes = []
+                if payload_len >= FRAME_END_TS_BYTES:
+                    vsync_us, _, last_us = struct.unpack("<III", pkt[8 : 8 + FRAME_END_TS_BYTES])
+                    ends.append((vsync_us, last_us, rx_us))
+                if payload_len >= FRAME_END_CRC_BYTES:
+                    (device_crc,) = struct.unpack("<I", pkt[8 + 12 : 8 + 16])
+                    mismatch = self._crc_check.finish(frame_id, device_crc)
+                    if mismatch:
+                        notes.append(mismatch)
+                    c = self._crc_check
+                    self.integrity = (c.ok, c.bad, c.incomplete)
+                if frame_id == self._frame_id:
+                    self._emit(frame_id, bytes(self._bits), ends, notes)
+                    self._frame_id = None
+                continue
+            if payload_len == 0 or payload_len > MAX_PAYLOAD or line_id >= H:
+                continue
+            payload = pkt[8 : 8 + payload_len]
+            line = decode_rle_line(payload) if plen & RLE_FLAG else payload
+            self._crc_check.add_line(frame_id, line_id, line)
+            if line is None or len(line) != LINE_BYTES:
+                continue
+            current = self._frame_id
+            if current is not None and frame_id != current:
+                if (frame_id - current) & 0xFFFF >= 0x8000:
+                    # Late line for an earlier frame: it shows with this one.
+                    frame_id = current
+                else:
+                    # The previous frame's end packet was lost (or the
+                    # firmware sends none): it ends where this frame starts.
+                    self._emit(current, bytes(self._bits), [], [])
+            self._frame_id = frame_id
+            at = line_id * LINE_BYTES
+            self._bits[at : at + LINE_BYTES] = line
@@ -0,0 +1,31 @@
+#pragma once
+
+// Host stand-in for the pioasm output of src/adb_device.pio: the simulator
+// turns the simulated Mac's ADB transactions into rx words and decodes the
+// reply words the firmware feeds by DMA (host/sim/sim_adb.c).
+
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+
+#define adb_device_offset_reply 0
+#define adb_device_offset_rx 8
+
+static const pio_program_t adb_device_program = {
+    .length = 12,
+    .origin = -1,
+    .sim_kind = SIM_PIO_ADB_DEVICE,
+};
+
+static inline pio_sm_config adb_device_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+static inline void adb_device_program_init(PIO pio, uint sm, uint offset, uint pin) {
+    pio_sm_config c = adb_device_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_jmp_pin(&c, pin);
+    sm_config_set_in_shift(&c, false, true, 32);
+    pio_gpio_init(pio, pin);
+    pio_sm_init(pio, sm, offset + adb_device_offset_rx, &c);
+}
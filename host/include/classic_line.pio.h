@@ -0,0 +1,25 @@
+#pragma once
+
+// Host stand-in for the pioasm output of src/classic_line.pio: the simulator
+// replaces the program with sim_source.c feeding whole lines into the SM.
+
+#include "hardware/pio.h"
+
+static const pio_program_t classic_line_fall_pixrise_program = {
+    .length = 28,
+    .origin = -1,
+    .sim_kind = SIM_PIO_CAPTURE,
+};
+
+static inline pio_sm_config classic_line_fall_pixrise_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+static inline void classic_line_fall_pixrise_program_init(PIO pio, uint sm, uint offset, uint pin_video) {
+    pio_sm_config c = classic_line_fall_pixrise_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin_video);
+    sm_config_set_in_shift(&c, false, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+    pio_sm_init(pio, sm, offset, &c);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+enum irq_num {
+    USBCTRL_IRQ = 5,
+    PIO0_IRQ_0 = 7,
+    PIO1_IRQ_0 = 9,
+    IO_IRQ_BANK0 = 13,
+};
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_priority(uint num, uint8_t hardware_priority);
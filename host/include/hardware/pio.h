@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// Only the FIFO addresses are real: the capture DMA uses &rxf[sm] as its read
+// address, which host/port/sim_dma.c matches against the PIO model.
+typedef struct pio_hw {
+    uint32_t ctrl;
+    uint32_t fstat;
+    uint32_t fdebug;
+    uint32_t flevel;
+    uint32_t txf[4];
+    uint32_t rxf[4];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t sim_pio_hw[2];
+#define pio0 (&sim_pio_hw[0])
+#define pio1 (&sim_pio_hw[1])
+
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_FDEBUG_RXSTALL_LSB 0
+
+// Behaviour the simulator substitutes for a loaded program.
+typedef enum sim_pio_kind {
+    SIM_PIO_NONE = 0,
+    SIM_PIO_CAPTURE,
+    SIM_PIO_LINE_MONITOR,
+    SIM_PIO_SIGNAL_COUNTER,
+    SIM_PIO_ADB_DEVICE,
+} sim_pio_kind_t;
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+    sim_pio_kind_t sim_kind;
+} pio_program_t;
+
+enum pio_fifo_join {
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+typedef struct pio_sm_config {
+    uint in_base;
+    uint jmp_pin;
+    bool shift_right;
+    bool autopush;
+    uint push_threshold;
+    enum pio_fifo_join join;
+} pio_sm_config;
+
+enum pio_interrupt_source {
+    pis_sm0_rx_fifo_not_empty = 0,
+    pis_sm0_tx_fifo_not_full = 4,
+    pis_interrupt0 = 8,
+};
+
+enum pio_src_dest {
+    pio_pins = 0u,
+    pio_x = 1u,
+    pio_y = 2u,
+    pio_null = 3u,
+    pio_isr = 6u,
+    pio_osr = 7u,
+};
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_sm_claim(PIO pio, uint sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+
+static inline uint pio_get_index(PIO pio) {
+    return (uint)(pio - sim_pio_hw);
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+
+static inline uint pio_encode_jmp(uint addr) {
+    return addr & 0x1Fu;
+}
+
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) {
+    return 0xA000u | ((uint)dest << 5) | (uint)src;
+}
+
+static inline uint pio_encode_push(bool if_full, bool block) {
+    return 0x8000u | (if_full ? 0x40u : 0u) | (block ? 0x20u : 0u);
+}
+
+static inline pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = {0};
+    c.push_threshold = 32;
+    return c;
+}
+
+static inline void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->in_base = in_base;
+}
+
+static inline void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {
+    c->jmp_pin = pin;
+}
+
+static inline void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush,
+                                          uint push_threshold) {
+    c->shift_right = shift_right;
+    c->autopush = autopush;
+    c->push_threshold = push_threshold;
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+    (void)c;
+    (void)sideset_base;
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull,
+                                           uint pull_threshold) {
+    (void)c;
+    (void)shift_right;
+    (void)autopull;
+    (void)pull_threshold;
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+    (void)c;
+    (void)div;
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+    c->join = join;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+// Per-core SysTick, free running down from 0xFFFFFF at clk_sys. Every access
+// refreshes cvr from the host clock; writes to the registers have no effect.
+systick_hw_t *sim_systick_hw(void);
+#define systick_hw (sim_systick_hw())
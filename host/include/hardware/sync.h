@@ -0,0 +1,28 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+void sim_core_wait_event(void);
+void sim_core_send_event(void);
+
+static inline void __sev(void) {
+    sim_core_send_event();
+}
+
+static inline void __wfe(void) {
+    sim_core_wait_event();
+}
+
+// IRQs only run at a core's own poll points (sim_platform.c), never in the
+// middle of code that masks them, so there is nothing to mask.
+static inline uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+    (void)status;
+}
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
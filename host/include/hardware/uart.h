@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// Host stand-in for the UART subset the firmware uses. Transmit is modelled
+// only as DMA writes to the data register (host/port/sim_uart.c); the
+// simulated far end reads what was sent with sim_uart_read() and answers with
+// sim_uart_write(), which uart_getc() returns.
+typedef struct uart_hw {
+    volatile uint32_t dr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t *const sim_uart0;
+extern uart_inst_t *const sim_uart1;
+#define uart0 sim_uart0
+#define uart1 sim_uart1
+
+typedef enum {
+    UART_PARITY_NONE = 0,
+    UART_PARITY_EVEN = 1,
+    UART_PARITY_ODD = 2,
+} uart_parity_t;
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
@@ -0,0 +1,24 @@
+#pragma once
+
+// Host stand-in for the pioasm output of src/line_monitor.pio: the simulator
+// pushes a report only for lines it was told to glitch.
+
+#include "hardware/pio.h"
+
+static const pio_program_t line_monitor_program = {
+    .length = 16,
+    .origin = -1,
+    .sim_kind = SIM_PIO_LINE_MONITOR,
+};
+
+static inline pio_sm_config line_monitor_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+static inline void line_monitor_program_init(PIO pio, uint sm, uint offset, uint pin_hsync) {
+    pio_sm_config c = line_monitor_program_get_default_config(offset);
+    sm_config_set_jmp_pin(&c, pin_hsync);
+    sm_config_set_in_shift(&c, false, true, 32);
+    pio_sm_init(pio, sm, offset, &c);
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void multicore_launch_core1(void (*entry)(void));
@@ -0,0 +1,32 @@
+#pragma once
+
+// Host stand-in for the Pico SDK subset used by the firmware core (see
+// host/README.md). Declarations follow the SDK; behaviour lives in host/port.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+uint get_core_num(void);
+void stdio_init_all(void);
+
+// Simulated interrupts are delivered to a core only at its poll points.
+void sim_core_poll(void);
+
+static inline void tight_loop_contents(void) {
+    sim_core_poll();
+}
+
+#include "hardware/gpio.h"
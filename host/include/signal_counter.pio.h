@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for the pioasm output of src/signal_counter.pio: X and Y are
+// derived from the simulated signal's nominal frequency and duty cycle.
+
+#include "hardware/pio.h"
+
+#define signal_counter_offset_lo 3
+
+static const pio_program_t signal_counter_program = {
+    .length = 4,
+    .origin = -1,
+    .sim_kind = SIM_PIO_SIGNAL_COUNTER,
+};
+
+static inline pio_sm_config signal_counter_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+static inline void signal_counter_program_init(PIO pio, uint sm, uint offset, uint pin) {
+    pio_sm_config c = signal_counter_program_get_default_config(offset);
+    sm_config_set_jmp_pin(&c, pin);
+    sm_config_set_in_shift(&c, false, false, 32);
+    pio_sm_init(pio, sm, offset + signal_counter_offset_lo, &c);
+}
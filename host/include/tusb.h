@@ -0,0 +1,71 @@
+#pragma once
+
+// Host stand-in for the TinyUSB device API subset the firmware uses. The
+// "bus" is host/port/sim_usb.c; the simulated host side is declared in sim.h.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tusb_config.h"
+
+#define OPT_MODE_DEVICE 0x0001
+#define TUD_OPT_HIGH_SPEED 0
+
+enum {
+    CONTROL_STAGE_IDLE = 0,
+    CONTROL_STAGE_SETUP = 1,
+    CONTROL_STAGE_DATA = 2,
+    CONTROL_STAGE_ACK = 3,
+};
+
+enum {
+    TUSB_REQ_TYPE_STANDARD = 0,
+    TUSB_REQ_TYPE_CLASS = 1,
+    TUSB_REQ_TYPE_VENDOR = 2,
+};
+
+enum {
+    TUSB_DIR_OUT = 0,
+    TUSB_DIR_IN = 1,
+};
+
+typedef struct __attribute__((packed)) tusb_control_request {
+    union {
+        struct __attribute__((packed)) {
+            uint8_t recipient : 5;
+            uint8_t type : 2;
+            uint8_t direction : 1;
+        } bmRequestType_bit;
+        uint8_t bmRequestType;
+    };
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} tusb_control_request_t;
+
+bool tud_init(uint8_t rhport);
+void tud_task(void);
+bool tud_ready(void);
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len);
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const *request);
+// Implemented by the firmware (usb_control.c).
+void tud_umount_cb(void);
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+                                tusb_control_request_t const *request);
+
+uint32_t tud_vendor_write_available(void);
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize);
+uint32_t tud_vendor_flush(void);
+uint32_t tud_vendor_available(void);
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize);
+
+bool tud_cdc_n_connected(uint8_t itf);
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_available(uint8_t itf);
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_flush(uint8_t itf);
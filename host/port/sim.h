@@ -0,0 +1,104 @@
+#pragma once
+
+// Interfaces between the SDK/TinyUSB stand-ins (host/port) and the simulated
+// Mac and USB host (host/sim). Nothing here is visible to the firmware sources.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ---- Platform (sim_platform.c) ----
+
+// Microseconds since process start; time_us_64() returns the same clock.
+uint64_t sim_time_us(void);
+// Run the firmware's main() on a "core0" thread.
+void sim_start_firmware(int (*entry)(void));
+// Stop both cores at their next poll point (see sim_core_poll) and join them.
+void sim_stop_firmware(void);
+
+// ---- Video source (sim_source.c) ----
+
+// Mac Classic timing: 15.6672 MHz PIXCLK, 704 clocks per line, 370 lines.
+#define SIM_PIXCLK_HZ 15667200.0
+#define SIM_LINE_PIXCLK 704u
+#define SIM_FRAME_LINES 370u
+#define SIM_YOFF_LINES 28u
+#define SIM_ACTIVE_LINES 342u
+#define SIM_LINE_BYTES 64u
+#define SIM_VSYNC_LINES 4u
+#define SIM_HSYNC_PIXCLK 192u
+
+// Pins as wired in src/main.c.
+#define SIM_PIN_PIXCLK 0u
+#define SIM_PIN_VSYNC 1u
+#define SIM_PIN_HSYNC 2u
+#define SIM_PIN_VIDEO 3u
+
+typedef enum sim_pattern {
+    SIM_PATTERN_DESKTOP = 0,
+    SIM_PATTERN_NOISE,
+    SIM_PATTERN_BLANK,
+    SIM_PATTERN_FILE,
+} sim_pattern_t;
+
+typedef struct sim_source_config {
+    sim_pattern_t pattern;
+    const char *pbm_path;   // SIM_PATTERN_FILE: 512x342 P4 image
+    bool cursor;            // animate a 16x16 cursor, one position per frame
+    uint32_t glitch_every;  // every Nth frame has one out-of-spec line (0 = never)
+} sim_source_config_t;
+
+bool sim_source_init(const sim_source_config_t *cfg);
+double sim_source_line_ns(void);
+double sim_source_frame_ns(void);
+// Frame index whose VSYNC fall is the latest at or before t_us.
+uint64_t sim_source_frame_at(uint64_t t_us);
+// Lines that start at or after from_us and are complete by to_us.
+void sim_source_line_span(uint64_t from_us, uint64_t to_us, uint64_t *out_first, uint32_t *out_count);
+// Pixel bytes (MSB = leftmost pixel) of global line L = frame * 370 + row.
+void sim_source_line(uint64_t line, uint8_t out[SIM_LINE_BYTES]);
+// Edges (GPIO_IRQ_EDGE_* mask) seen on pin in (from_us, to_us].
+uint32_t sim_source_edges(unsigned pin, uint64_t from_us, uint64_t to_us);
+bool sim_source_level(unsigned pin, uint64_t t_us);
+// Nominal rate and high-time fraction for a PIO signal counter on pin.
+void sim_source_signal(unsigned pin, double *out_hz, double *out_duty);
+// Out-of-spec PIXCLK count delta for frame (0 = in spec).
+int32_t sim_source_glitch(uint64_t frame);
+
+// ---- USB bus, host side (sim_usb.c) ----
+
+typedef struct sim_usb_config {
+    uint32_t bulk_bytes_per_s; // vendor IN drain rate (0 = unlimited)
+    bool cdc_connected;
+    bool cdc_echo;             // copy CDC output to stderr
+} sim_usb_config_t;
+
+void sim_usb_init(const sim_usb_config_t *cfg);
+// Blocking vendor IN read; returns 0 on timeout.
+size_t sim_usb_bulk_read(uint8_t *dst, size_t cap, uint32_t timeout_ms);
+// EP0 vendor request executed by the device's tud_task(). Returns the number
+// of data bytes transferred, or -1 if the device stalled or timed out.
+int sim_usb_control(uint8_t bm_request_type, uint8_t b_request, uint16_t w_value,
+                    uint16_t w_index, void *data, uint16_t w_length, uint32_t timeout_ms);
+// Vendor OUT write; the device reads it with tud_vendor_read(). Returns the
+// bytes accepted (the endpoint buffer may be full).
+size_t sim_usb_bulk_write(const uint8_t *src, size_t len);
+void sim_usb_cdc_send(const char *text);
+uint64_t sim_usb_bulk_bytes(void);
+
+// ---- UART, far side (sim_uart.c) ----
+
+// Bytes the firmware has sent on UART index (the ADB controller's view).
+size_t sim_uart_read(unsigned index, uint8_t *dst, size_t cap);
+// Bytes sent to the firmware on UART index; it reads them with uart_getc().
+// Bytes past the receive buffer are lost, as on an overrun.
+void sim_uart_write(unsigned index, const uint8_t *src, size_t len);
+
+// ---- ADB bus, Mac side (sim_adb.c) ----
+
+// Low pulse widths (us) of the Mac's transactions that end in (from_us, to_us].
+size_t sim_adb_pulses(uint64_t from_us, uint64_t to_us, uint32_t *widths, size_t cap);
+// Reply words (adb_device.pio format, up to and including the end word) the
+// ADB device SM played after the firmware jumped it to the reply entry at
+// exec_us.
+void sim_adb_reply(uint64_t exec_us, const uint32_t *words, size_t count);
@@ -0,0 +1,249 @@
+// DMA model for the host build.
+//
+// DREQ_FORCE transfers (the bswap postprocess and the CRC pass) move their
+// data inside dma_channel_configure() but report busy for one clk_sys cycle
+// per transfer, as the real channel would. Transfers into a UART data
+// register do the same, busy for the bytes' time on the wire. A channel paced by a capture SM's
+// RX DREQ is advanced lazily: whenever the firmware looks at it, it is
+// credited with every source line the SM has finished since it started.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+
+#include "sim.h"
+#include "sim_hw.h"
+
+#define SIM_WORDS_PER_LINE (SIM_LINE_BYTES / 4u)
+
+dma_hw_t sim_dma_hw;
+
+typedef struct sim_dma_channel {
+    bool claimed;
+    bool busy;
+    dma_channel_config cfg;
+    uint8_t *write_addr;
+    const uint8_t *read_addr;
+    dma_channel_hw_t hw;
+
+    uint64_t done_us;  // forced transfers: when the channel goes idle
+
+    // RX-paced capture
+    bool from_pio;
+    PIO pio;
+    uint sm;
+    uint32_t lines_done;
+} sim_dma_channel_t;
+
+static pthread_mutex_t dma_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_dma_channel_t channels[NUM_DMA_CHANNELS];
+
+static int sniff_channel = -1;
+static bool sniff_invert = false;
+static uint32_t sniff_acc = 0;
+
+static uint32_t crc32r_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc;
+}
+
+static void run_forced(uint channel) {
+    sim_dma_channel_t *ch = &channels[channel];
+    uint32_t count = ch->hw.transfer_count;
+    uint size = 1u << ch->cfg.size;
+    bool sniff = ch->cfg.sniff && sniff_channel == (int)channel;
+    uint uart = 0;
+    bool to_uart = sim_uart_is_tx_fifo(ch->write_addr, &uart);
+    PIO tx_pio = NULL;
+    uint tx_sm = 0;
+    bool to_pio = !to_uart && sim_pio_is_tx_fifo(ch->write_addr, &tx_pio, &tx_sm);
+    while (ch->hw.transfer_count > 0) {
+        uint8_t word[4];
+        memcpy(word, ch->read_addr, size);
+        if (sniff) {
+            sniff_acc = crc32r_update(sniff_acc, word, size);
+        }
+        if (ch->cfg.bswap) {
+            for (uint i = 0; i < size / 2u; i++) {
+                uint8_t t = word[i];
+                word[i] = word[size - 1u - i];
+                word[size - 1u - i] = t;
+            }
+        }
+        if (to_uart) {
+            sim_uart_tx(uart, word[0]);
+        } else if (to_pio) {
+            uint32_t v = 0;
+            memcpy(&v, word, size);
+            sim_pio_tx(tx_pio, tx_sm, v);
+        } else {
+            memcpy(ch->write_addr, word, size);
+        }
+        if (ch->cfg.read_increment) {
+            ch->read_addr += size;
+        }
+        if (ch->cfg.write_increment) {
+            ch->write_addr += size;
+        }
+        ch->hw.transfer_count--;
+    }
+    // Start the busy window after the copy: the host copy (and the bitwise
+    // CRC) can take longer than the hardware would, and the firmware must
+    // still see the channel in flight when it first checks.
+    if (to_uart) {
+        ch->done_us = sim_time_us() + sim_uart_tx_us(uart, count);
+        return;
+    }
+    uint64_t clk_hz = clock_get_hz(clk_sys);
+    ch->done_us = sim_time_us() + ((uint64_t)count * 1000000u + clk_hz - 1u) / clk_hz;
+}
+
+// The capture program shifts left with autopush, so the first pixel of each
+// 32-pixel group lands in bit 31 and the word is stored little-endian; the
+// postprocess bswap restores display byte order.
+static void advance(uint channel) {
+    sim_dma_channel_t *ch = &channels[channel];
+    if (ch->busy && !ch->from_pio) {
+        ch->busy = sim_time_us() < ch->done_us;
+        return;
+    }
+    uint64_t first = 0;
+    uint32_t avail = 0;
+    if (!ch->busy || !ch->from_pio || !sim_pio_capture_lines(ch->pio, ch->sm, &first, &avail)) {
+        return;
+    }
+    while (ch->lines_done < avail && ch->hw.transfer_count >= SIM_WORDS_PER_LINE) {
+        uint8_t line[SIM_LINE_BYTES];
+        sim_source_line(first + ch->lines_done, line);
+        for (uint w = 0; w < SIM_WORDS_PER_LINE; w++) {
+            const uint8_t *b = &line[w * 4u];
+            uint32_t word = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+                            ((uint32_t)b[2] << 8) | b[3];
+            memcpy(ch->write_addr, &word, sizeof(word));
+            ch->write_addr += sizeof(word);
+        }
+        ch->hw.transfer_count -= SIM_WORDS_PER_LINE;
+        ch->lines_done++;
+    }
+    if (ch->hw.transfer_count < SIM_WORDS_PER_LINE) {
+        ch->busy = false;
+        if (ch->lines_done < avail) {
+            // The SM kept running past the end of the buffer.
+            sim_pio_capture_stall(ch->pio, ch->sm);
+        }
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    pthread_mutex_lock(&dma_lock);
+    int found = -1;
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!channels[i].claimed) {
+            channels[i].claimed = true;
+            found = (int)i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dma_lock);
+    if (found < 0 && required) {
+        fprintf(stderr, "[sim] no free DMA channel\n");
+        exit(1);
+    }
+    return found;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = {
+        .size = DMA_SIZE_32,
+        .read_increment = true,
+        .write_increment = false,
+        .bswap = false,
+        .sniff = false,
+        .dreq = DREQ_FORCE,
+    };
+    return c;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    pthread_mutex_lock(&dma_lock);
+    advance(channel);
+    pthread_mutex_unlock(&dma_lock);
+    return &channels[channel].hw;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger) {
+    pthread_mutex_lock(&dma_lock);
+    sim_dma_channel_t *ch = &channels[channel];
+    ch->cfg = *config;
+    ch->write_addr = (uint8_t *)write_addr;
+    ch->read_addr = (const uint8_t *)read_addr;
+    ch->hw.transfer_count = transfer_count;
+    ch->lines_done = 0;
+    ch->from_pio = config->dreq != DREQ_FORCE &&
+                   sim_pio_is_rx_fifo(read_addr, &ch->pio, &ch->sm);
+    ch->busy = trigger && transfer_count > 0;
+    if (ch->busy && !ch->from_pio) {
+        run_forced(channel);
+    }
+    pthread_mutex_unlock(&dma_lock);
+}
+
+void dma_channel_abort(uint channel) {
+    pthread_mutex_lock(&dma_lock);
+    channels[channel].busy = false;
+    pthread_mutex_unlock(&dma_lock);
+}
+
+bool dma_channel_is_busy(uint channel) {
+    pthread_mutex_lock(&dma_lock);
+    advance(channel);
+    bool busy = channels[channel].busy;
+    pthread_mutex_unlock(&dma_lock);
+    return busy;
+}
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+    (void)mode;
+    (void)force_channel_enable;
+    pthread_mutex_lock(&dma_lock);
+    sniff_channel = (int)channel;
+    pthread_mutex_unlock(&dma_lock);
+}
+
+void dma_sniffer_set_output_reverse_enabled(bool enable) {
+    // The model accumulates the reflected CRC directly, which is what the
+    // hardware returns with output reversal on.
+    (void)enable;
+}
+
+void dma_sniffer_set_output_invert_enabled(bool enable) {
+    pthread_mutex_lock(&dma_lock);
+    sniff_invert = enable;
+    pthread_mutex_unlock(&dma_lock);
+}
+
+void dma_sniffer_set_data_accumulator(uint32_t seed_value) {
+    pthread_mutex_lock(&dma_lock);
+    sniff_acc = seed_value;
+    pthread_mutex_unlock(&dma_lock);
+}
+
+uint32_t dma_sniffer_get_data_accumulator(void) {
+    pthread_mutex_lock(&dma_lock);
+    uint32_t value = sniff_invert ? ~sniff_acc : sniff_acc;
+    pthread_mutex_unlock(&dma_lock);
+    return value;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Hooks between the PIO and DMA models (host/port only).
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+// CAPTURE SM: source lines available since it was enabled. Returns false if
+// the SM is not a running capture program.
+bool sim_pio_capture_lines(PIO pio, uint sm, uint64_t *out_first_line, uint32_t *out_lines);
+// CAPTURE SM: latch RXSTALL (the DMA stopped draining while lines kept coming).
+void sim_pio_capture_stall(PIO pio, uint sm);
+// Map a DMA read address back to a PIO RX FIFO.
+bool sim_pio_is_rx_fifo(const volatile void *addr, PIO *out_pio, uint *out_sm);
+
+// Map a DMA write address back to a PIO TX FIFO, and deliver a word to it.
+bool sim_pio_is_tx_fifo(const volatile void *addr, PIO *out_pio, uint *out_sm);
+void sim_pio_tx(PIO pio, uint sm, uint32_t word);
+// PIO IRQ 0 line: any SM whose RX-not-empty source is enabled has data.
+bool sim_pio_irq0_pending(PIO pio);
+
+// Map a DMA write address to a UART data register; DMA into it is paced at
+// the UART's baud rate and lands in the host-side TX log.
+bool sim_uart_is_tx_fifo(const volatile void *addr, uint *out_index);
+void sim_uart_tx(uint index, uint8_t byte);
+// Microseconds to shift count bytes out of UART index (8N1).
+uint64_t sim_uart_tx_us(uint index, uint32_t count);
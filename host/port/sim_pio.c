@@ -0,0 +1,483 @@
+// PIO model for the host build.
+//
+// Programs are not interpreted: each loaded program carries a sim_kind from
+// its stand-in .pio.h and the state machine behaves as that program would,
+// evaluated lazily from the simulated clock:
+//   CAPTURE         lines of the source that start after the SM is enabled
+//                   (consumed by the capture DMA, see sim_dma.c)
+//   LINE_MONITOR    one RX word per out-of-spec line the source injects
+//   SIGNAL_COUNTER  X/Y derived from the pin's nominal rate and duty cycle
+//   ADB_DEVICE      one RX word per low pulse of the simulated Mac's ADB
+//                   transactions; reply words go to the Mac (sim_adb.c)
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+
+#include "pio_fdebug.h"
+#include "sim.h"
+#include "sim_hw.h"
+
+#define SIM_PIO_INSTR_MEM 32
+#define SIM_PIO_FIFO_DEPTH 8
+#define SIM_PIO_MAX_PROGRAMS 8
+#define SIM_PIO_ADB_TX_WORDS 32
+#define SIM_PIO_ADB_PULSES 32
+
+pio_hw_t sim_pio_hw[2];
+
+typedef struct sim_program_slot {
+    uint offset;
+    uint length;
+    sim_pio_kind_t kind;
+} sim_program_slot_t;
+
+typedef struct sim_sm {
+    bool claimed;
+    bool enabled;
+    sim_pio_kind_t kind;
+    uint pin;
+    uint fifo_depth;
+    uint32_t rx[SIM_PIO_FIFO_DEPTH];
+    uint rx_r;
+    uint rx_count;
+    uint32_t tx;
+    uint32_t isr;
+
+    uint64_t enabled_us;     // CAPTURE: when the SM last started
+    uint64_t next_frame;     // LINE_MONITOR: first frame not yet checked
+    uint64_t x_base_us;      // SIGNAL_COUNTER: when X/Y were last zeroed
+    uint64_t y_base_us;
+
+    uint program_offset;     // ADB_DEVICE: where the program was loaded
+    uint32_t adb_x;          // ADB_DEVICE: X of the rx loop
+    uint64_t adb_checked_us; // ADB_DEVICE: pulses ending up to here are pushed
+    bool adb_replying;       // ADB_DEVICE: jumped to reply, rx not running
+    uint64_t adb_exec_us;
+    uint32_t adb_tx[SIM_PIO_ADB_TX_WORDS];
+    uint adb_tx_count;
+} sim_sm_t;
+
+typedef struct sim_pio {
+    sim_program_slot_t programs[SIM_PIO_MAX_PROGRAMS];
+    uint program_count;
+    uint used;
+    uint32_t fdebug;
+    uint32_t irq0_sources;
+    sim_sm_t sm[NUM_PIO_STATE_MACHINES];
+} sim_pio_t;
+
+static pthread_mutex_t pio_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_pio_t pios[2];
+
+static inline uint pio_index(PIO pio) {
+    return (uint)(pio - sim_pio_hw);
+}
+
+static inline sim_pio_t *pio_state(PIO pio) {
+    return &pios[pio_index(pio)];
+}
+
+static const sim_program_slot_t *slot_at(const sim_pio_t *p, uint pc) {
+    for (uint i = 0; i < p->program_count; i++) {
+        if (pc >= p->programs[i].offset && pc < p->programs[i].offset + p->programs[i].length) {
+            return &p->programs[i];
+        }
+    }
+    return NULL;
+}
+
+static void rx_push(sim_pio_t *p, uint sm_index, uint32_t value) {
+    sim_sm_t *s = &p->sm[sm_index];
+    if (s->rx_count >= s->fifo_depth) {
+        p->fdebug |= 1u << (PIO_FDEBUG_RXSTALL_LSB + sm_index);
+        return;
+    }
+    s->rx[(s->rx_r + s->rx_count) % SIM_PIO_FIFO_DEPTH] = value;
+    s->rx_count++;
+}
+
+// LINE_MONITOR: report the glitched lines of every frame that has ended.
+static void advance_monitor(sim_pio_t *p, uint sm_index) {
+    sim_sm_t *s = &p->sm[sm_index];
+    if (!s->enabled) {
+        return;
+    }
+    uint64_t now_frame = sim_source_frame_at(sim_time_us());
+    while (s->next_frame < now_frame) {
+        int32_t delta = sim_source_glitch(s->next_frame);
+        if (delta != 0) {
+            // The SM pushes expected - counted.
+            rx_push(p, sm_index, (uint32_t)(-delta));
+        }
+        s->next_frame++;
+    }
+}
+
+// ADB_DEVICE: push X after each low pulse the Mac has finished since the last
+// look. X counts down once per us while the line is low; at 0 the loop's
+// jmp x-- falls through and splits the pulse, as on hardware. With the FIFO
+// full the SM would sit in its autopush stall and miss the pulse.
+static void advance_adb(sim_pio_t *p, uint sm_index) {
+    sim_sm_t *s = &p->sm[sm_index];
+    if (!s->enabled || s->adb_replying) {
+        return;
+    }
+    uint64_t now = sim_time_us();
+    uint32_t widths[SIM_PIO_ADB_PULSES];
+    size_t n = sim_adb_pulses(s->adb_checked_us, now, widths, SIM_PIO_ADB_PULSES);
+    s->adb_checked_us = now;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t w = widths[i];
+        if (s->rx_count >= s->fifo_depth) {
+            p->fdebug |= 1u << (PIO_FDEBUG_RXSTALL_LSB + sm_index);
+            continue;
+        }
+        if (s->adb_x == 0) {
+            s->adb_x = 0xFFFFFFFFu;
+            rx_push(p, sm_index, s->adb_x);
+            w--;
+        }
+        s->adb_x -= w;
+        rx_push(p, sm_index, s->adb_x);
+    }
+}
+
+// ADB_DEVICE: once the SM is on the reply path and the end word (low time 0)
+// is in the FIFO, hand the reply to the Mac and go back to rx with X = 0.
+static void finish_adb_reply(sim_sm_t *s) {
+    if (!s->adb_replying) {
+        return;
+    }
+    for (uint i = 0; i < s->adb_tx_count; i++) {
+        if ((s->adb_tx[i] >> 16) == 0) {
+            sim_adb_reply(s->adb_exec_us, s->adb_tx, i + 1u);
+            memmove(s->adb_tx, &s->adb_tx[i + 1u], (s->adb_tx_count - i - 1u) * sizeof(s->adb_tx[0]));
+            s->adb_tx_count -= i + 1u;
+            s->adb_replying = false;
+            s->adb_x = 0;
+            s->adb_checked_us = sim_time_us();
+            return;
+        }
+    }
+}
+
+static void advance_sm(sim_pio_t *p, uint sm_index) {
+    if (p->sm[sm_index].kind == SIM_PIO_LINE_MONITOR) {
+        advance_monitor(p, sm_index);
+    } else if (p->sm[sm_index].kind == SIM_PIO_ADB_DEVICE) {
+        advance_adb(p, sm_index);
+    }
+}
+
+// SIGNAL_COUNTER: both registers count down from zero.
+static uint32_t counter_reg(const sim_sm_t *s, bool want_y) {
+    double hz = 0.0;
+    double duty = 0.0;
+    sim_source_signal(s->pin, &hz, &duty);
+    uint64_t now = sim_time_us();
+    uint64_t base = want_y ? s->y_base_us : s->x_base_us;
+    double seconds = (double)(now - base) / 1e6;
+    double edges = floor(hz * seconds);
+    if (want_y) {
+        return (uint32_t)(0u - (uint32_t)(uint64_t)edges);
+    }
+    double high_cycles = duty * seconds * (double)clock_get_hz(clk_sys);
+    double high_iters = (high_cycles - edges) / 2.0;
+    if (high_iters < 0.0) {
+        high_iters = 0.0;
+    }
+    return (uint32_t)(0u - (uint32_t)(uint64_t)high_iters);
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    if (p->program_count >= SIM_PIO_MAX_PROGRAMS ||
+        p->used + program->length > SIM_PIO_INSTR_MEM) {
+        fprintf(stderr, "[sim] PIO%u instruction memory exhausted\n", pio_index(pio));
+        exit(1);
+    }
+    // The SDK allocates from the top of instruction memory down.
+    uint offset = SIM_PIO_INSTR_MEM - p->used - program->length;
+    p->programs[p->program_count++] = (sim_program_slot_t){
+        .offset = offset,
+        .length = program->length,
+        .kind = program->sim_kind,
+    };
+    p->used += program->length;
+    pthread_mutex_unlock(&pio_lock);
+    return offset;
+}
+
+void pio_sm_claim(PIO pio, uint sm) {
+    pthread_mutex_lock(&pio_lock);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    if (s->claimed) {
+        fprintf(stderr, "[sim] PIO%u SM%u already claimed\n", pio_index(pio), sm);
+        exit(1);
+    }
+    s->claimed = true;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    int found = -1;
+    for (uint i = 0; i < NUM_PIO_STATE_MACHINES; i++) {
+        if (!p->sm[i].claimed) {
+            p->sm[i].claimed = true;
+            found = (int)i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pio_lock);
+    if (found < 0 && required) {
+        fprintf(stderr, "[sim] no free state machine on PIO%u\n", pio_index(pio));
+        exit(1);
+    }
+    return found;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    sim_sm_t *s = &p->sm[sm];
+    s->enabled = false;
+    const sim_program_slot_t *slot = slot_at(p, initial_pc);
+    s->kind = slot ? slot->kind : SIM_PIO_NONE;
+    s->program_offset = slot ? slot->offset : 0;
+    s->adb_x = 0;
+    s->adb_replying = false;
+    s->adb_tx_count = 0;
+    s->pin = (s->kind == SIM_PIO_CAPTURE) ? config->in_base : config->jmp_pin;
+    s->fifo_depth = (config->join == PIO_FIFO_JOIN_RX) ? 8u : 4u;
+    s->rx_r = 0;
+    s->rx_count = 0;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    pthread_mutex_lock(&pio_lock);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    if (enabled && !s->enabled) {
+        uint64_t now = sim_time_us();
+        s->enabled_us = now;
+        s->next_frame = sim_source_frame_at(now) + 1u;
+        s->adb_checked_us = now;
+    }
+    s->enabled = enabled;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    pthread_mutex_lock(&pio_lock);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    s->rx_r = 0;
+    s->rx_count = 0;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+    (void)pio;
+    (void)sm;
+    (void)pin_base;
+    (void)pin_count;
+    (void)is_out;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+    (void)pio;
+    (void)sm;
+    (void)pin_values;
+    (void)pin_mask;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    (void)pin;
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    if (enabled) {
+        p->irq0_sources |= 1u << source;
+    } else {
+        p->irq0_sources &= ~(1u << source);
+    }
+    pthread_mutex_unlock(&pio_lock);
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    // DREQ_PIO0_TX0 = 0, DREQ_PIO0_RX0 = 4, DREQ_PIO1_TX0 = 8, DREQ_PIO1_RX0 = 12.
+    return pio_index(pio) * 8u + (is_tx ? 0u : 4u) + sm;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    advance_sm(p, sm);
+    bool empty = p->sm[sm].rx_count == 0;
+    pthread_mutex_unlock(&pio_lock);
+    return empty;
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm) {
+    pthread_mutex_lock(&pio_lock);
+    advance_sm(pio_state(pio), sm);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    uint32_t value = 0;
+    if (s->rx_count > 0) {
+        value = s->rx[s->rx_r];
+        s->rx_r = (s->rx_r + 1u) % SIM_PIO_FIFO_DEPTH;
+        s->rx_count--;
+    }
+    pthread_mutex_unlock(&pio_lock);
+    return value;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+    // Every blocking read in the firmware follows an injected push.
+    if (pio_sm_is_rx_fifo_empty(pio, sm)) {
+        fprintf(stderr, "[sim] blocking read on empty PIO%u SM%u RX FIFO\n", pio_index(pio), sm);
+        exit(1);
+    }
+    return pio_sm_get(pio, sm);
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    pthread_mutex_lock(&pio_lock);
+    pio_state(pio)->sm[sm].tx = data;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    sim_sm_t *s = &p->sm[sm];
+    uint op = instr & 0xE000u;
+    if (op == 0x0000u && s->kind == SIM_PIO_ADB_DEVICE &&
+        (instr & 0x1Fu) == s->program_offset) {
+        // jmp reply (the program's first instruction).
+        advance_adb(p, sm);
+        s->adb_replying = true;
+        s->adb_exec_us = sim_time_us();
+        finish_adb_reply(s);
+    } else if (op == 0xA000u) {
+        // mov dest, src
+        uint dest = (instr >> 5) & 7u;
+        uint src = instr & 7u;
+        uint64_t now = sim_time_us();
+        if (src == pio_null && dest == pio_x) {
+            s->x_base_us = now;
+        } else if (src == pio_null && dest == pio_y) {
+            s->y_base_us = now;
+        } else if (dest == pio_isr && (src == pio_x || src == pio_y) &&
+                   s->kind == SIM_PIO_SIGNAL_COUNTER) {
+            s->isr = counter_reg(s, src == pio_y);
+        }
+    } else if (op == 0x8000u && (instr & 0x80u) == 0) {
+        // push
+        rx_push(p, sm, s->isr);
+        s->isr = 0;
+    }
+    pthread_mutex_unlock(&pio_lock);
+}
+
+bool pio_fdebug_test(PIO pio, uint32_t mask) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    for (uint i = 0; i < NUM_PIO_STATE_MACHINES; i++) {
+        advance_sm(p, i);
+    }
+    bool set = (p->fdebug & mask) != 0;
+    pthread_mutex_unlock(&pio_lock);
+    return set;
+}
+
+void pio_fdebug_clear(PIO pio, uint32_t mask) {
+    pthread_mutex_lock(&pio_lock);
+    pio_state(pio)->fdebug &= ~mask;
+    pthread_mutex_unlock(&pio_lock);
+}
+
+bool sim_pio_capture_lines(PIO pio, uint sm, uint64_t *out_first_line, uint32_t *out_lines) {
+    pthread_mutex_lock(&pio_lock);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    bool capture = s->kind == SIM_PIO_CAPTURE && s->enabled;
+    if (capture) {
+        sim_source_line_span(s->enabled_us, sim_time_us(), out_first_line, out_lines);
+    }
+    pthread_mutex_unlock(&pio_lock);
+    return capture;
+}
+
+void sim_pio_capture_stall(PIO pio, uint sm) {
+    pthread_mutex_lock(&pio_lock);
+    pio_state(pio)->fdebug |= 1u << (PIO_FDEBUG_RXSTALL_LSB + sm);
+    pthread_mutex_unlock(&pio_lock);
+}
+
+bool sim_pio_is_rx_fifo(const volatile void *addr, PIO *out_pio, uint *out_sm) {
+    for (uint i = 0; i < 2; i++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (addr == (const volatile void *)&sim_pio_hw[i].rxf[sm]) {
+                *out_pio = &sim_pio_hw[i];
+                *out_sm = sm;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool sim_pio_is_tx_fifo(const volatile void *addr, PIO *out_pio, uint *out_sm) {
+    for (uint i = 0; i < 2; i++) {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (addr == (const volatile void *)&sim_pio_hw[i].txf[sm]) {
+                *out_pio = &sim_pio_hw[i];
+                *out_sm = sm;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void sim_pio_tx(PIO pio, uint sm, uint32_t word) {
+    pthread_mutex_lock(&pio_lock);
+    sim_sm_t *s = &pio_state(pio)->sm[sm];
+    if (s->adb_tx_count < SIM_PIO_ADB_TX_WORDS) {
+        s->adb_tx[s->adb_tx_count++] = word;
+    }
+    if (s->kind == SIM_PIO_ADB_DEVICE) {
+        finish_adb_reply(s);
+    }
+    pthread_mutex_unlock(&pio_lock);
+}
+
+bool sim_pio_irq0_pending(PIO pio) {
+    pthread_mutex_lock(&pio_lock);
+    sim_pio_t *p = pio_state(pio);
+    bool pending = false;
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (p->irq0_sources & (1u << (pis_sm0_rx_fifo_not_empty + sm))) {
+            advance_sm(p, sm);
+            pending = pending || p->sm[sm].rx_count > 0;
+        }
+    }
+    pthread_mutex_unlock(&pio_lock);
+    return pending;
+}
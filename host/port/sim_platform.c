@@ -0,0 +1,394 @@
+// Time, cores, events and GPIO/IRQ for the host build.
+//
+// Each RP2040 core is a pthread. Interrupts cannot preempt a thread, so a
+// core takes its pending GPIO or PIO IRQ at its next poll point:
+// tight_loop_contents(), sleep_us() and friends. Both firmware loops reach one
+// every iteration.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "pico/bootrom.h"
+#include "pico/multicore.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/structs/systick.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+
+#include "sim.h"
+#include "sim_hw.h"
+
+#define SIM_NUM_GPIOS 30
+#define SIM_CLK_SYS_HZ 125000000u
+#define SIM_WFE_TIMEOUT_US 1000
+
+static struct timespec start_time;
+static __thread uint core_num = 0;
+static __thread bool in_irq = false;
+static volatile bool exit_requested = false;
+static pthread_t core_threads[2];
+static bool core_running[2];
+
+static pthread_mutex_t event_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t event_cond = PTHREAD_COND_INITIALIZER;
+static bool event_latch[2];
+
+// SIO GPIO and the IO_BANK0 IRQ; guarded by gpio_lock.
+static pthread_mutex_t gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool gpio_is_out[SIM_NUM_GPIOS];
+static bool gpio_out_level[SIM_NUM_GPIOS];
+static uint32_t irq_enabled[SIM_NUM_GPIOS];
+static uint32_t irq_pending[SIM_NUM_GPIOS];
+static uint64_t edges_checked_us = 0;
+static irq_handler_t raw_handler = NULL;
+static uint32_t raw_handler_mask = 0;
+static int raw_handler_core = -1;
+static bool bank0_enabled[2];
+
+// PIO IRQ 0 lines (PIO0_IRQ_0, PIO1_IRQ_0); guarded by gpio_lock.
+static irq_handler_t pio_handler[2];
+static int pio_handler_core[2] = {-1, -1};
+static bool pio_irq_enabled[2];
+
+__attribute__((constructor)) static void sim_platform_init(void) {
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+uint64_t sim_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ns = (int64_t)(ts.tv_sec - start_time.tv_sec) * 1000000000LL +
+                 (ts.tv_nsec - start_time.tv_nsec);
+    return (uint64_t)(ns / 1000);
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)sim_time_us();
+}
+
+uint64_t time_us_64(void) {
+    return sim_time_us();
+}
+
+absolute_time_t get_absolute_time(void) {
+    return sim_time_us();
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return sim_time_us() + (uint64_t)ms * 1000u;
+}
+
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+    return t + (uint64_t)ms * 1000u;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+void sleep_us(uint64_t us) {
+    uint64_t deadline = sim_time_us() + us;
+    while (true) {
+        sim_core_poll();
+        uint64_t now = sim_time_us();
+        if (now >= deadline) {
+            return;
+        }
+        uint64_t step = deadline - now;
+        if (step > 50) {
+            step = 50;
+        }
+        struct timespec ts = {0, (long)step * 1000L};
+        nanosleep(&ts, NULL);
+    }
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000u);
+}
+
+uint get_core_num(void) {
+    return core_num;
+}
+
+void stdio_init_all(void) {
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    (void)clk_index;
+    return SIM_CLK_SYS_HZ;
+}
+
+static __thread systick_hw_t systick;
+
+systick_hw_t *sim_systick_hw(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)(now.tv_sec - start_time.tv_sec) * 1000000000ull +
+                  (uint64_t)(now.tv_nsec - start_time.tv_nsec);
+    uint64_t cycles = ns / (1000000000ull / SIM_CLK_SYS_HZ);
+    systick.cvr = (uint32_t)(0x00FFFFFFu - (cycles & 0x00FFFFFFu));
+    return &systick;
+}
+
+// ---- Cores ----
+
+typedef struct core_start {
+    uint num;
+    void (*entry)(void);
+    int (*main_entry)(void);
+} core_start_t;
+
+static core_start_t core_starts[2];
+
+static void *core_thread(void *arg) {
+    core_start_t *start = arg;
+    core_num = start->num;
+    if (start->main_entry) {
+        start->main_entry();
+    } else {
+        start->entry();
+    }
+    return NULL;
+}
+
+static void launch_core(uint num) {
+    if (pthread_create(&core_threads[num], NULL, core_thread, &core_starts[num]) != 0) {
+        fprintf(stderr, "[sim] failed to start core%u\n", num);
+        exit(1);
+    }
+    core_running[num] = true;
+}
+
+void sim_start_firmware(int (*entry)(void)) {
+    core_starts[0] = (core_start_t){.num = 0, .main_entry = entry};
+    launch_core(0);
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    core_starts[1] = (core_start_t){.num = 1, .entry = entry};
+    launch_core(1);
+}
+
+void sim_stop_firmware(void) {
+    __atomic_store_n(&exit_requested, true, __ATOMIC_RELEASE);
+    sim_core_send_event();
+    for (uint i = 0; i < 2; i++) {
+        if (core_running[i]) {
+            pthread_join(core_threads[i], NULL);
+            core_running[i] = false;
+        }
+    }
+}
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask) {
+    (void)usb_activity_gpio_pin_mask;
+    (void)disable_interface_mask;
+    fprintf(stderr, "[sim] firmware entered BOOTSEL; exiting\n");
+    exit(0);
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms) {
+    (void)pc;
+    (void)sp;
+    (void)delay_ms;
+    fprintf(stderr, "[sim] firmware requested a watchdog reboot; exiting\n");
+    exit(0);
+}
+
+// ---- SEV/WFE ----
+
+void sim_core_send_event(void) {
+    pthread_mutex_lock(&event_lock);
+    event_latch[0] = true;
+    event_latch[1] = true;
+    pthread_cond_broadcast(&event_cond);
+    pthread_mutex_unlock(&event_lock);
+}
+
+void sim_core_wait_event(void) {
+    pthread_mutex_lock(&event_lock);
+    if (!event_latch[core_num]) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += SIM_WFE_TIMEOUT_US * 1000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&event_cond, &event_lock, &ts);
+    }
+    event_latch[core_num] = false;
+    pthread_mutex_unlock(&event_lock);
+    sim_core_poll();
+}
+
+// ---- GPIO ----
+
+// Latch source edges on IRQ-enabled pins since the last check. Caller holds
+// gpio_lock.
+static void latch_edges(uint64_t now) {
+    if (now <= edges_checked_us) {
+        return;
+    }
+    for (uint gpio = 0; gpio < SIM_NUM_GPIOS; gpio++) {
+        if (irq_enabled[gpio] == 0 || gpio_is_out[gpio]) {
+            continue;
+        }
+        irq_pending[gpio] |= sim_source_edges(gpio, edges_checked_us, now);
+    }
+    edges_checked_us = now;
+}
+
+void gpio_init(uint gpio) {
+    pthread_mutex_lock(&gpio_lock);
+    gpio_is_out[gpio] = false;
+    gpio_out_level[gpio] = false;
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    pthread_mutex_lock(&gpio_lock);
+    gpio_is_out[gpio] = out;
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void gpio_disable_pulls(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+bool gpio_get(uint gpio) {
+    pthread_mutex_lock(&gpio_lock);
+    bool out = gpio_is_out[gpio];
+    bool level = gpio_out_level[gpio];
+    pthread_mutex_unlock(&gpio_lock);
+    return out ? level : sim_source_level(gpio, sim_time_us());
+}
+
+void gpio_put(uint gpio, bool value) {
+    pthread_mutex_lock(&gpio_lock);
+    gpio_out_level[gpio] = value;
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+    pthread_mutex_lock(&gpio_lock);
+    latch_edges(sim_time_us());
+    irq_pending[gpio] &= ~(event_mask & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE));
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    // As in the SDK, stale edges are cleared before the enable changes.
+    pthread_mutex_lock(&gpio_lock);
+    latch_edges(sim_time_us());
+    irq_pending[gpio] &= ~(event_mask & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE));
+    if (enabled) {
+        irq_enabled[gpio] |= event_mask;
+    } else {
+        irq_enabled[gpio] &= ~event_mask;
+    }
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    pthread_mutex_lock(&gpio_lock);
+    uint32_t events = irq_pending[gpio] & irq_enabled[gpio];
+    pthread_mutex_unlock(&gpio_lock);
+    return events;
+}
+
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler) {
+    pthread_mutex_lock(&gpio_lock);
+    raw_handler = handler;
+    raw_handler_mask = gpio_mask;
+    raw_handler_core = (int)core_num;
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num != PIO0_IRQ_0 && num != PIO1_IRQ_0) {
+        fprintf(stderr, "[sim] no model for exclusive handler on IRQ %u\n", num);
+        exit(1);
+    }
+    uint i = num == PIO1_IRQ_0 ? 1u : 0u;
+    pthread_mutex_lock(&gpio_lock);
+    pio_handler[i] = handler;
+    pio_handler_core[i] = (int)core_num;
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    pthread_mutex_lock(&gpio_lock);
+    if (num == IO_IRQ_BANK0) {
+        bank0_enabled[core_num] = enabled;
+    } else if (num == PIO0_IRQ_0 || num == PIO1_IRQ_0) {
+        pio_irq_enabled[num == PIO1_IRQ_0 ? 1u : 0u] = enabled;
+    }
+    pthread_mutex_unlock(&gpio_lock);
+}
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+    (void)num;
+    (void)hardware_priority;
+}
+
+void sim_core_poll(void) {
+    if (__atomic_load_n(&exit_requested, __ATOMIC_ACQUIRE)) {
+        pthread_exit(NULL);
+    }
+    if (in_irq) {
+        return;
+    }
+
+    pthread_mutex_lock(&gpio_lock);
+    irq_handler_t handler = NULL;
+    if (raw_handler && raw_handler_core == (int)core_num && bank0_enabled[core_num]) {
+        latch_edges(sim_time_us());
+        for (uint gpio = 0; gpio < SIM_NUM_GPIOS; gpio++) {
+            if ((raw_handler_mask & (1u << gpio)) && (irq_pending[gpio] & irq_enabled[gpio])) {
+                handler = raw_handler;
+                break;
+            }
+        }
+    }
+    irq_handler_t pio_handlers[2] = {NULL, NULL};
+    for (uint i = 0; i < 2; i++) {
+        if (pio_handler[i] && pio_handler_core[i] == (int)core_num && pio_irq_enabled[i]) {
+            pio_handlers[i] = pio_handler[i];
+        }
+    }
+    pthread_mutex_unlock(&gpio_lock);
+
+    if (handler) {
+        in_irq = true;
+        handler();
+        in_irq = false;
+    }
+    for (uint i = 0; i < 2; i++) {
+        if (pio_handlers[i] && sim_pio_irq0_pending(i ? pio1 : pio0)) {
+            in_irq = true;
+            pio_handlers[i]();
+            in_irq = false;
+        }
+    }
+    // Both firmware loops spin; give the other core (and the host) the CPU
+    // so IRQ latency stays in microseconds even on a single-CPU box.
+    sched_yield();
+}
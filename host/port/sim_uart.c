@@ -0,0 +1,144 @@
+// UART model for the host build.
+//
+// The firmware transmits only through DMA: a channel writing to a UART data
+// register moves its bytes into a per-UART log at once and stays busy for the
+// time the bytes would take on the wire (see sim_dma.c). The simulated far
+// end (the ADB controller) reads the log with sim_uart_read(). What it sends
+// back with sim_uart_write() is readable by the firmware at once.
+
+#include <pthread.h>
+#include <string.h>
+
+#include "hardware/dma.h"
+#include "hardware/uart.h"
+
+#include "sim.h"
+#include "sim_hw.h"
+
+#define SIM_UART_COUNT 2u
+#define SIM_UART_LOG_BYTES 4096u
+// The RP2040's receive FIFO.
+#define SIM_UART_RX_BYTES 32u
+
+struct uart_inst {
+    uart_hw_t hw;
+    uint baud;
+    uint8_t log[SIM_UART_LOG_BYTES];
+    size_t log_r;
+    size_t log_count;
+    uint8_t rx[SIM_UART_RX_BYTES];
+    size_t rx_r;
+    size_t rx_count;
+};
+
+static struct uart_inst uarts[SIM_UART_COUNT];
+static pthread_mutex_t uart_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uart_inst_t *const sim_uart0 = &uarts[0];
+uart_inst_t *const sim_uart1 = &uarts[1];
+
+uint uart_init(uart_inst_t *uart, uint baudrate) {
+    pthread_mutex_lock(&uart_lock);
+    uart->baud = baudrate;
+    uart->log_r = 0;
+    uart->log_count = 0;
+    uart->rx_r = 0;
+    uart->rx_count = 0;
+    pthread_mutex_unlock(&uart_lock);
+    return baudrate;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity) {
+    (void)uart;
+    (void)data_bits;
+    (void)stop_bits;
+    (void)parity;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+    (void)uart;
+    (void)enabled;
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart) {
+    return &uart->hw;
+}
+
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx) {
+    uint index = (uint)(uart - uarts);
+    return (is_tx ? DREQ_UART0_TX : DREQ_UART0_TX + 1u) + index * 2u;
+}
+
+bool uart_is_readable(uart_inst_t *uart) {
+    pthread_mutex_lock(&uart_lock);
+    bool readable = uart->rx_count > 0;
+    pthread_mutex_unlock(&uart_lock);
+    return readable;
+}
+
+char uart_getc(uart_inst_t *uart) {
+    uint8_t byte = 0;
+    pthread_mutex_lock(&uart_lock);
+    if (uart->rx_count > 0) {
+        byte = uart->rx[uart->rx_r];
+        uart->rx_r = (uart->rx_r + 1u) % SIM_UART_RX_BYTES;
+        uart->rx_count--;
+    }
+    pthread_mutex_unlock(&uart_lock);
+    return (char)byte;
+}
+
+bool sim_uart_is_tx_fifo(const volatile void *addr, uint *out_index) {
+    for (uint i = 0; i < SIM_UART_COUNT; i++) {
+        if (addr == (const volatile void *)&uarts[i].hw.dr) {
+            *out_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_uart_tx(uint index, uint8_t byte) {
+    struct uart_inst *u = &uarts[index];
+    pthread_mutex_lock(&uart_lock);
+    if (u->log_count < SIM_UART_LOG_BYTES) {
+        u->log[(u->log_r + u->log_count) % SIM_UART_LOG_BYTES] = byte;
+        u->log_count++;
+    }
+    pthread_mutex_unlock(&uart_lock);
+}
+
+uint64_t sim_uart_tx_us(uint index, uint32_t count) {
+    uint baud = uarts[index].baud ? uarts[index].baud : 115200u;
+    // Start bit, eight data bits, stop bit.
+    return ((uint64_t)count * 10u * 1000000u + baud - 1u) / baud;
+}
+
+size_t sim_uart_read(unsigned index, uint8_t *dst, size_t cap) {
+    if (index >= SIM_UART_COUNT) {
+        return 0;
+    }
+    struct uart_inst *u = &uarts[index];
+    pthread_mutex_lock(&uart_lock);
+    size_t n = u->log_count < cap ? u->log_count : cap;
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = u->log[u->log_r];
+        u->log_r = (u->log_r + 1u) % SIM_UART_LOG_BYTES;
+    }
+    u->log_count -= n;
+    pthread_mutex_unlock(&uart_lock);
+    return n;
+}
+
+void sim_uart_write(unsigned index, const uint8_t *src, size_t len) {
+    if (index >= SIM_UART_COUNT) {
+        return;
+    }
+    struct uart_inst *u = &uarts[index];
+    pthread_mutex_lock(&uart_lock);
+    for (size_t i = 0; i < len && u->rx_count < SIM_UART_RX_BYTES; i++) {
+        u->rx[(u->rx_r + u->rx_count) % SIM_UART_RX_BYTES] = src[i];
+        u->rx_count++;
+    }
+    pthread_mutex_unlock(&uart_lock);
+}
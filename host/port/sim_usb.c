@@ -0,0 +1,393 @@
+// TinyUSB device stand-in for the host build.
+//
+// Vendor IN: the firmware writes into a 64-byte endpoint FIFO (the size of
+// CFG_TUD_VENDOR_TX_BUFSIZE) which the "bus" drains into the host ring at a
+// fixed byte rate, so a slow bus backs up into the firmware's TX queue the
+// same way NAKs do on hardware. EP0 requests from the host are executed by the
+// device's tud_task() through the usual SETUP/DATA/ACK callback stages.
+// Vendor OUT is a CFG_TUD_VENDOR_RX_BUFSIZE FIFO the host fills and the
+// firmware drains with tud_vendor_read(); a full FIFO is a NAK.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+
+#include "sim.h"
+
+#define VENDOR_FIFO_BYTES CFG_TUD_VENDOR_TX_BUFSIZE
+#define VENDOR_RX_BYTES CFG_TUD_VENDOR_RX_BUFSIZE
+#define HOST_RING_BYTES (16u * 1024u * 1024u)
+#define CDC_TX_BYTES CFG_TUD_CDC_TX_BUFSIZE
+#define CDC_RX_BYTES 256u
+#define EP0_DATA_MAX 4096u
+// Bus credit never exceeds ~1 ms of traffic, like full-speed frame scheduling.
+#define BUS_BURST_US 1000u
+
+static sim_usb_config_t usb_cfg;
+static volatile bool device_ready = false;
+
+static pthread_mutex_t usb_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_cond = PTHREAD_COND_INITIALIZER;
+static uint8_t vendor_fifo[VENDOR_FIFO_BYTES];
+static uint32_t vendor_fifo_len = 0;
+static uint64_t bus_last_us = 0;
+static double bus_credit = 0.0;
+static uint8_t *host_ring = NULL;
+static size_t host_r = 0;
+static size_t host_count = 0;
+static uint64_t host_total = 0;
+
+static uint8_t vendor_rx[VENDOR_RX_BYTES];
+static uint32_t vendor_rx_len = 0;
+
+static uint8_t cdc_rx[CDC_RX_BYTES];
+static uint32_t cdc_rx_r = 0;
+static uint32_t cdc_rx_count = 0;
+
+typedef struct ep0_mailbox {
+    bool pending;
+    bool done;
+    bool abandoned; // host timed out; drop the result when it lands
+    tusb_control_request_t request;
+    uint8_t data[EP0_DATA_MAX];
+    int result;
+} ep0_mailbox_t;
+
+static pthread_mutex_t ep0_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ep0_cond = PTHREAD_COND_INITIALIZER;
+static ep0_mailbox_t ep0;
+static void *ep0_xfer_buf = NULL;
+static uint16_t ep0_xfer_len = 0;
+
+static void deadline_after_ms(struct timespec *ts, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000u;
+    ts->tv_nsec += (long)(ms % 1000u) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+void sim_usb_init(const sim_usb_config_t *cfg) {
+    usb_cfg = *cfg;
+    host_ring = malloc(HOST_RING_BYTES);
+    if (!host_ring) {
+        fprintf(stderr, "[sim] out of memory\n");
+        exit(1);
+    }
+}
+
+// Move what the bus can carry since the last call from the endpoint FIFO to
+// the host. Caller holds usb_lock.
+static void bus_drain(void) {
+    uint64_t now = sim_time_us();
+    uint32_t budget = vendor_fifo_len;
+    if (usb_cfg.bulk_bytes_per_s != 0) {
+        double rate = (double)usb_cfg.bulk_bytes_per_s / 1e6;
+        bus_credit += (double)(now - bus_last_us) * rate;
+        double cap = rate * BUS_BURST_US;
+        if (bus_credit > cap) {
+            bus_credit = cap;
+        }
+        if ((double)budget > bus_credit) {
+            budget = (uint32_t)bus_credit;
+        }
+    }
+    bus_last_us = now;
+
+    size_t space = HOST_RING_BYTES - host_count;
+    if (budget > space) {
+        budget = (uint32_t)space;
+    }
+    if (budget == 0) {
+        return;
+    }
+    size_t w = (host_r + host_count) % HOST_RING_BYTES;
+    for (uint32_t i = 0; i < budget; i++) {
+        host_ring[w] = vendor_fifo[i];
+        w = (w + 1u) % HOST_RING_BYTES;
+    }
+    memmove(vendor_fifo, &vendor_fifo[budget], vendor_fifo_len - budget);
+    vendor_fifo_len -= budget;
+    host_count += budget;
+    host_total += budget;
+    bus_credit -= budget;
+    pthread_cond_signal(&host_cond);
+}
+
+// ---- Device side (firmware) ----
+
+bool tud_init(uint8_t rhport) {
+    (void)rhport;
+    pthread_mutex_lock(&usb_lock);
+    bus_last_us = sim_time_us();
+    pthread_mutex_unlock(&usb_lock);
+    __atomic_store_n(&device_ready, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool tud_ready(void) {
+    return __atomic_load_n(&device_ready, __ATOMIC_ACQUIRE);
+}
+
+static int run_control_request(tusb_control_request_t *req, uint8_t *data) {
+    ep0_xfer_buf = NULL;
+    ep0_xfer_len = 0;
+    if (!tud_vendor_control_xfer_cb(0, CONTROL_STAGE_SETUP, req)) {
+        return -1;
+    }
+    int transferred = 0;
+    if (req->wLength > 0) {
+        if (ep0_xfer_buf == NULL) {
+            return -1;
+        }
+        uint16_t len = ep0_xfer_len < req->wLength ? ep0_xfer_len : req->wLength;
+        if (req->bmRequestType_bit.direction == TUSB_DIR_IN) {
+            memcpy(data, ep0_xfer_buf, len);
+        } else {
+            memcpy(ep0_xfer_buf, data, len);
+        }
+        transferred = len;
+        if (!tud_vendor_control_xfer_cb(0, CONTROL_STAGE_DATA, req)) {
+            return -1;
+        }
+    }
+    tud_vendor_control_xfer_cb(0, CONTROL_STAGE_ACK, req);
+    return transferred;
+}
+
+void tud_task(void) {
+    pthread_mutex_lock(&usb_lock);
+    bus_drain();
+    pthread_mutex_unlock(&usb_lock);
+
+    pthread_mutex_lock(&ep0_lock);
+    bool run = ep0.pending && !ep0.done;
+    tusb_control_request_t req = ep0.request;
+    pthread_mutex_unlock(&ep0_lock);
+    if (!run) {
+        return;
+    }
+    // ep0.data is only touched by the host thread before pending is set and
+    // after done is seen.
+    int result = run_control_request(&req, ep0.data);
+    pthread_mutex_lock(&ep0_lock);
+    ep0.result = result;
+    if (ep0.abandoned) {
+        ep0.abandoned = false;
+        ep0.pending = false;
+    } else {
+        ep0.done = true;
+    }
+    pthread_cond_broadcast(&ep0_cond);
+    pthread_mutex_unlock(&ep0_lock);
+}
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len) {
+    (void)rhport;
+    (void)request;
+    ep0_xfer_buf = buffer;
+    ep0_xfer_len = len;
+    return true;
+}
+
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const *request) {
+    (void)rhport;
+    (void)request;
+    return true;
+}
+
+uint32_t tud_vendor_write_available(void) {
+    pthread_mutex_lock(&usb_lock);
+    bus_drain();
+    uint32_t avail = VENDOR_FIFO_BYTES - vendor_fifo_len;
+    pthread_mutex_unlock(&usb_lock);
+    return avail;
+}
+
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize) {
+    pthread_mutex_lock(&usb_lock);
+    uint32_t n = VENDOR_FIFO_BYTES - vendor_fifo_len;
+    if (n > bufsize) {
+        n = bufsize;
+    }
+    memcpy(&vendor_fifo[vendor_fifo_len], buffer, n);
+    vendor_fifo_len += n;
+    bus_drain();
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+uint32_t tud_vendor_flush(void) {
+    pthread_mutex_lock(&usb_lock);
+    bus_drain();
+    uint32_t pending = vendor_fifo_len;
+    pthread_mutex_unlock(&usb_lock);
+    return pending;
+}
+
+uint32_t tud_vendor_available(void) {
+    pthread_mutex_lock(&usb_lock);
+    uint32_t n = vendor_rx_len;
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize) {
+    pthread_mutex_lock(&usb_lock);
+    uint32_t n = vendor_rx_len < bufsize ? vendor_rx_len : bufsize;
+    memcpy(buffer, vendor_rx, n);
+    memmove(vendor_rx, &vendor_rx[n], vendor_rx_len - n);
+    vendor_rx_len -= n;
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+bool tud_cdc_n_connected(uint8_t itf) {
+    (void)itf;
+    return usb_cfg.cdc_connected;
+}
+
+uint32_t tud_cdc_n_available(uint8_t itf) {
+    (void)itf;
+    pthread_mutex_lock(&usb_lock);
+    uint32_t n = cdc_rx_count;
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize) {
+    (void)itf;
+    uint8_t *dst = buffer;
+    pthread_mutex_lock(&usb_lock);
+    uint32_t n = 0;
+    while (n < bufsize && cdc_rx_count > 0) {
+        dst[n++] = cdc_rx[cdc_rx_r];
+        cdc_rx_r = (cdc_rx_r + 1u) % CDC_RX_BYTES;
+        cdc_rx_count--;
+    }
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf) {
+    (void)itf;
+    return CDC_TX_BYTES;
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize) {
+    (void)itf;
+    if (usb_cfg.cdc_echo) {
+        fwrite(buffer, 1, bufsize, stderr);
+    }
+    return bufsize;
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf) {
+    (void)itf;
+    if (usb_cfg.cdc_echo) {
+        fflush(stderr);
+    }
+    return 0;
+}
+
+// ---- Host side ----
+
+size_t sim_usb_bulk_read(uint8_t *dst, size_t cap, uint32_t timeout_ms) {
+    struct timespec deadline;
+    deadline_after_ms(&deadline, timeout_ms);
+    pthread_mutex_lock(&usb_lock);
+    while (host_count == 0) {
+        if (pthread_cond_timedwait(&host_cond, &usb_lock, &deadline) != 0) {
+            break;
+        }
+    }
+    size_t n = host_count < cap ? host_count : cap;
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = host_ring[host_r];
+        host_r = (host_r + 1u) % HOST_RING_BYTES;
+    }
+    host_count -= n;
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+int sim_usb_control(uint8_t bm_request_type, uint8_t b_request, uint16_t w_value,
+                    uint16_t w_index, void *data, uint16_t w_length, uint32_t timeout_ms) {
+    if (w_length > EP0_DATA_MAX) {
+        return -1;
+    }
+    struct timespec deadline;
+    deadline_after_ms(&deadline, timeout_ms);
+    pthread_mutex_lock(&ep0_lock);
+    while (ep0.pending) {
+        if (pthread_cond_timedwait(&ep0_cond, &ep0_lock, &deadline) != 0) {
+            pthread_mutex_unlock(&ep0_lock);
+            return -1;
+        }
+    }
+    ep0.request.bmRequestType = bm_request_type;
+    ep0.request.bRequest = b_request;
+    ep0.request.wValue = w_value;
+    ep0.request.wIndex = w_index;
+    ep0.request.wLength = w_length;
+    if (w_length > 0 && (bm_request_type & 0x80u) == 0) {
+        memcpy(ep0.data, data, w_length);
+    }
+    ep0.done = false;
+    ep0.pending = true;
+
+    int result = -1;
+    while (!ep0.done) {
+        if (pthread_cond_timedwait(&ep0_cond, &ep0_lock, &deadline) != 0) {
+            break;
+        }
+    }
+    if (ep0.done) {
+        result = ep0.result;
+        if (result > 0 && (bm_request_type & 0x80u) != 0) {
+            memcpy(data, ep0.data, (size_t)result);
+        }
+        ep0.pending = false;
+        pthread_cond_broadcast(&ep0_cond);
+    } else {
+        // The device still owns the request; the next caller waits for it.
+        ep0.abandoned = true;
+    }
+    pthread_mutex_unlock(&ep0_lock);
+    return result;
+}
+
+size_t sim_usb_bulk_write(const uint8_t *src, size_t len) {
+    pthread_mutex_lock(&usb_lock);
+    size_t n = VENDOR_RX_BYTES - vendor_rx_len;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(&vendor_rx[vendor_rx_len], src, n);
+    vendor_rx_len += (uint32_t)n;
+    pthread_mutex_unlock(&usb_lock);
+    return n;
+}
+
+void sim_usb_cdc_send(const char *text) {
+    pthread_mutex_lock(&usb_lock);
+    for (const char *p = text; *p && cdc_rx_count < CDC_RX_BYTES; p++) {
+        cdc_rx[(cdc_rx_r + cdc_rx_count) % CDC_RX_BYTES] = (uint8_t)*p;
+        cdc_rx_count++;
+    }
+    pthread_mutex_unlock(&usb_lock);
+}
+
+uint64_t sim_usb_bulk_bytes(void) {
+    pthread_mutex_lock(&usb_lock);
+    uint64_t total = host_total;
+    pthread_mutex_unlock(&usb_lock);
+    return total;
+}
@@ -0,0 +1,301 @@
+#include "sim_adb.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb_device.h"
+#include "sim.h"
+#include "sim_input.h"
+
+#define ADB_ATTN_US 800u
+#define ADB_SYNC_US 65u
+#define ADB_HOST_TLT_US 200u
+#define ADB_POLL_US 11000u
+// Command, stop bit, worst-case SRQ and Tlt, then a full reply.
+#define ADB_TXN_US 4500u
+#define TXN_PULSES_MAX 32u
+
+#define TALK(addr, reg) ((uint8_t)(((addr) << 4) | 0x0Cu | (reg)))
+#define LISTEN(addr, reg) ((uint8_t)(((addr) << 4) | 0x08u | (reg)))
+
+// Where Listen R3 moves the mouse during the probe.
+#define ADB_MOUSE_MOVED_ADDR 5u
+#define ADB_PROBE_TRIES 200u
+#define ADB_RETRIES 3u
+
+typedef struct adb_txn {
+    bool active;
+    uint64_t t0;         // attention falling edge
+    uint64_t stop_fall;  // command stop bit
+    uint64_t stop_end;
+    uint32_t pulses;
+    uint64_t end_us[TXN_PULSES_MAX];
+    uint32_t width_us[TXN_PULSES_MAX];
+    bool replied;
+    bool srq;
+    uint16_t data;
+} adb_txn_t;
+
+static pthread_t adb_thread;
+static volatile bool adb_stop = false;
+static pthread_mutex_t adb_lock = PTHREAD_MUTEX_INITIALIZER;
+static adb_txn_t txn;
+static sim_adb_report_t report;
+
+static void sleep_until_us(uint64_t t) {
+    uint64_t now = sim_time_us();
+    if (t <= now) {
+        return;
+    }
+    uint64_t us = t - now;
+    struct timespec ts = {(time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L};
+    nanosleep(&ts, NULL);
+}
+
+static void add_pulse(adb_txn_t *t, uint64_t fall_us, uint32_t width_us) {
+    t->end_us[t->pulses] = fall_us + width_us;
+    t->width_us[t->pulses] = width_us;
+    t->pulses++;
+}
+
+static void add_bits(adb_txn_t *t, uint64_t first_fall_us, uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++) {
+        bool one = (value >> (bits - 1u - i)) & 1u;
+        add_pulse(t, first_fall_us + (uint64_t)i * ADB_BIT_CELL_US, one ? ADB_BIT1_LOW_US : ADB_BIT0_LOW_US);
+    }
+}
+
+// Run one command on the bus and wait for its reply window to pass.
+static adb_txn_t transact(uint8_t cmd, const uint16_t *listen_data) {
+    adb_txn_t t;
+    memset(&t, 0, sizeof(t));
+    t.active = true;
+    t.t0 = sim_time_us() + 10u;
+    add_pulse(&t, t.t0, ADB_ATTN_US);
+    uint64_t bit0 = t.t0 + ADB_ATTN_US + ADB_SYNC_US;
+    add_bits(&t, bit0, cmd, 8);
+    t.stop_fall = bit0 + 8u * ADB_BIT_CELL_US;
+    t.stop_end = t.stop_fall + ADB_BIT0_LOW_US;
+    add_pulse(&t, t.stop_fall, ADB_BIT0_LOW_US);
+    if (listen_data) {
+        uint64_t start = t.stop_end + ADB_HOST_TLT_US;
+        add_pulse(&t, start, ADB_BIT1_LOW_US);
+        add_bits(&t, start + ADB_BIT_CELL_US, *listen_data, 16);
+        add_pulse(&t, start + 17u * ADB_BIT_CELL_US, ADB_BIT0_LOW_US);
+    }
+
+    pthread_mutex_lock(&adb_lock);
+    txn = t;
+    report.commands++;
+    pthread_mutex_unlock(&adb_lock);
+
+    sleep_until_us(t.t0 + ADB_TXN_US);
+
+    pthread_mutex_lock(&adb_lock);
+    t = txn;
+    txn.active = false;
+    pthread_mutex_unlock(&adb_lock);
+    return t;
+}
+
+// Reply timeline from the SM's point of view: it waits for the stop bit's
+// falling edge (or goes straight on if the line is already low), then each
+// word is Y + 3 us released and X + 1.5 us low.
+void sim_adb_reply(uint64_t exec_us, const uint32_t *words, size_t count) {
+    pthread_mutex_lock(&adb_lock);
+    if (!txn.active || exec_us > txn.stop_end) {
+        report.late++;
+        pthread_mutex_unlock(&adb_lock);
+        return;
+    }
+    double t = (double)(exec_us > txn.stop_fall ? exec_us : txn.stop_fall);
+    double release = (double)txn.stop_end;
+    double prev_fall = 0.0;
+    int bits = -1; // -1: start bit next
+    uint16_t data = 0;
+    bool bad = false;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t y = words[i] & 0xFFFFu;
+        uint32_t x = words[i] >> 16;
+        if (x == 0) {
+            break;
+        }
+        double fall = t + y + 3.0;
+        double low = x + 1.5;
+        t = fall + low;
+        if (i == 0 && low >= 200.0) {
+            txn.srq = true;
+            report.srqs++;
+            if (t > release) {
+                release = t;
+            }
+            continue;
+        }
+        if (bits < 0) {
+            double tlt = fall - release;
+            uint32_t tlt_us = tlt > 0.0 ? (uint32_t)tlt : 0u;
+            if (report.tlt_min_us == 0 || tlt_us < report.tlt_min_us) {
+                report.tlt_min_us = tlt_us;
+            }
+            if (tlt_us > report.tlt_max_us) {
+                report.tlt_max_us = tlt_us;
+            }
+            bad = bad || tlt < 140.0 || tlt > 260.0 || low >= ADB_BIT_THRESHOLD_US;
+            bits = 0;
+        } else if (bits < 16) {
+            double cell = fall - prev_fall;
+            bad = bad || cell < 90.0 || cell > 110.0;
+            data = (uint16_t)((data << 1) | (low < ADB_BIT_THRESHOLD_US ? 1u : 0u));
+            bits++;
+        }
+        prev_fall = fall;
+    }
+    if (bad) {
+        report.timing_bad++;
+    }
+    if (bits == 16) {
+        txn.replied = true;
+        txn.data = data;
+        report.replies++;
+    }
+    pthread_mutex_unlock(&adb_lock);
+}
+
+size_t sim_adb_pulses(uint64_t from_us, uint64_t to_us, uint32_t *widths, size_t cap) {
+    size_t n = 0;
+    pthread_mutex_lock(&adb_lock);
+    if (txn.active) {
+        for (uint32_t i = 0; i < txn.pulses && n < cap; i++) {
+            if (txn.end_us[i] > from_us && txn.end_us[i] <= to_us) {
+                widths[n++] = txn.width_us[i];
+            }
+        }
+    }
+    pthread_mutex_unlock(&adb_lock);
+    return n;
+}
+
+static inline int sext7(uint8_t v) {
+    return (int)(int8_t)(uint8_t)(v << 1) >> 1;
+}
+
+static void decode_mouse(uint16_t data) {
+    bool down = (data & 0x8000u) == 0;
+    int dy = sext7((uint8_t)(data >> 8));
+    int dx = sext7((uint8_t)data);
+    sim_input_seen_mouse(dx, dy, down);
+}
+
+static void decode_keys(uint16_t data) {
+    uint8_t keys[2] = {(uint8_t)(data >> 8), (uint8_t)data};
+    for (unsigned i = 0; i < 2; i++) {
+        if (keys[i] != 0xFFu) {
+            sim_input_seen_key(keys[i] & 0x7Fu, (keys[i] & 0x80u) != 0);
+        }
+    }
+}
+
+// Talk with the ADB Manager's retries: on a single host CPU the simulated IRQ
+// can miss a command now and then.
+static adb_txn_t talk(uint8_t cmd) {
+    adb_txn_t r;
+    for (uint32_t tries = 0; tries < ADB_RETRIES; tries++) {
+        r = transact(cmd, NULL);
+        if (r.replied) {
+            break;
+        }
+    }
+    return r;
+}
+
+static bool probe(void) {
+    // The firmware may still be starting: keep asking, as the ADB Manager
+    // does for devices that come up after it.
+    adb_txn_t r;
+    for (uint32_t tries = 0; tries < ADB_PROBE_TRIES; tries++) {
+        r = transact(TALK(ADB_KEYBOARD_ADDR, 3), NULL);
+        if (r.replied || __atomic_load_n(&adb_stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        sleep_until_us(sim_time_us() + ADB_POLL_US);
+    }
+    bool ok = r.replied && ((r.data >> 8) & 0x0Fu) == ADB_KEYBOARD_ADDR &&
+              (r.data & 0xFFu) == ADB_KEYBOARD_HANDLER;
+    r = talk(TALK(ADB_MOUSE_ADDR, 3));
+    ok = ok && r.replied && (r.data & 0xFFu) == ADB_MOUSE_HANDLER;
+
+    // Move the mouse the way address resolution does, and check it answers
+    // only at the new address.
+    uint16_t move = (uint16_t)((ADB_MOUSE_MOVED_ADDR << 8) | 0xFEu);
+    for (uint32_t tries = 0; tries < ADB_RETRIES; tries++) {
+        transact(LISTEN(ADB_MOUSE_ADDR, 3), &move);
+        r = talk(TALK(ADB_MOUSE_MOVED_ADDR, 3));
+        if (r.replied) {
+            break;
+        }
+    }
+    ok = ok && r.replied && ((r.data >> 8) & 0x0Fu) == ADB_MOUSE_MOVED_ADDR;
+    r = transact(TALK(ADB_MOUSE_ADDR, 3), NULL);
+    ok = ok && !r.replied;
+
+    // LED state round trip through the keyboard's register 2.
+    uint16_t leds = 0xFF05u;
+    for (uint32_t tries = 0; tries < ADB_RETRIES; tries++) {
+        transact(LISTEN(ADB_KEYBOARD_ADDR, 2), &leds);
+        r = talk(TALK(ADB_KEYBOARD_ADDR, 2));
+        if (r.replied && (r.data & 0xFFu) == 0x05u) {
+            break;
+        }
+    }
+    ok = ok && r.replied && (r.data & 0xFFu) == 0x05u;
+    return ok;
+}
+
+static void *adb_main(void *arg) {
+    (void)arg;
+    bool ok = probe();
+    pthread_mutex_lock(&adb_lock);
+    report.probe_ok = ok;
+    pthread_mutex_unlock(&adb_lock);
+
+    uint8_t active = ADB_MOUSE_MOVED_ADDR;
+    while (!__atomic_load_n(&adb_stop, __ATOMIC_ACQUIRE)) {
+        uint64_t slot = sim_time_us() + ADB_POLL_US;
+        adb_txn_t r = transact(TALK(active, 0), NULL);
+        if (r.replied) {
+            if (active == ADB_KEYBOARD_ADDR) {
+                decode_keys(r.data);
+            } else {
+                decode_mouse(r.data);
+            }
+        } else {
+            pthread_mutex_lock(&adb_lock);
+            report.empty++;
+            pthread_mutex_unlock(&adb_lock);
+        }
+        // Two devices: a service request always comes from the other one.
+        if (r.srq) {
+            active = active == ADB_KEYBOARD_ADDR ? ADB_MOUSE_MOVED_ADDR : ADB_KEYBOARD_ADDR;
+        }
+        sleep_until_us(slot);
+    }
+    return NULL;
+}
+
+void sim_adb_start(void) {
+    if (pthread_create(&adb_thread, NULL, adb_main, NULL) != 0) {
+        fprintf(stderr, "[sim] failed to start ADB host thread\n");
+        exit(1);
+    }
+}
+
+void sim_adb_stop(sim_adb_report_t *out) {
+    __atomic_store_n(&adb_stop, true, __ATOMIC_RELEASE);
+    pthread_join(adb_thread, NULL);
+    pthread_mutex_lock(&adb_lock);
+    *out = report;
+    pthread_mutex_unlock(&adb_lock);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simulated Mac ADB host for EBD_IPKVM_ADB builds: probes the keyboard and
+// mouse the way the ADB Manager does at boot, then polls Talk R0 every 11 ms,
+// following SRQs to the other device. Talk R0 replies are decoded and handed
+// to sim_input.c.
+
+typedef struct sim_adb_report {
+    uint32_t commands;
+    uint32_t replies;     // decoded replies with 16 data bits
+    uint32_t srqs;
+    uint32_t empty;       // Talk R0 polls with no reply (nothing pending)
+    uint32_t late;        // reply started after the command's stop bit
+    uint32_t timing_bad;  // Tlt outside 140..260 us or a bit cell outside 90..110 us
+    uint32_t tlt_min_us;
+    uint32_t tlt_max_us;
+    bool probe_ok;        // Talk R3, Listen R3 (mouse move) and Listen/Talk R2 as expected
+} sim_adb_report_t;
+
+void sim_adb_start(void);
+void sim_adb_stop(sim_adb_report_t *out);
@@ -0,0 +1,238 @@
+#include "sim_host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "stream_protocol.h"
+
+#define READ_CHUNK 4096u
+#define PARSE_BUF_BYTES (64u * 1024u)
+#define MAX_PAYLOAD 512u
+#define MAX_LATENCIES (1u << 16)
+
+static pthread_t host_thread;
+static volatile bool host_stop = false;
+static sim_host_report_t report;
+static uint16_t roi_first = 0;
+static uint16_t roi_count = SIM_ACTIVE_LINES;
+static bool check_content = true;
+
+static uint8_t frame_lines[SIM_ACTIVE_LINES][SIM_LINE_BYTES];
+static uint8_t line_seen[SIM_ACTIVE_LINES];
+static uint16_t cur_frame_id = 0;
+static bool cur_frame_valid = false;
+static uint16_t cur_lines = 0;
+static uint32_t cur_crc = 0xFFFFFFFFu;
+static bool have_last_end = false;
+static uint16_t last_end_id = 0;
+static uint32_t *latencies = NULL;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc;
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void begin_frame(uint16_t frame_id) {
+    cur_frame_id = frame_id;
+    cur_frame_valid = true;
+    cur_lines = 0;
+    cur_crc = 0xFFFFFFFFu;
+    memset(line_seen, 0, sizeof(line_seen));
+}
+
+static bool decode_line(const uint8_t *payload, uint16_t len, bool rle, uint8_t out[SIM_LINE_BYTES]) {
+    if (!rle) {
+        if (len != SIM_LINE_BYTES) {
+            return false;
+        }
+        memcpy(out, payload, SIM_LINE_BYTES);
+        return true;
+    }
+    size_t pos = 0;
+    for (uint16_t i = 0; i + 1u < len; i += 2) {
+        uint8_t run = payload[i];
+        if (pos + run > SIM_LINE_BYTES) {
+            return false;
+        }
+        memset(&out[pos], payload[i + 1u], run);
+        pos += run;
+    }
+    return pos == SIM_LINE_BYTES && (len & 1u) == 0;
+}
+
+static void handle_line(uint16_t frame_id, uint16_t line_id, const uint8_t *payload, uint16_t len,
+                        bool rle) {
+    if (line_id >= SIM_ACTIVE_LINES) {
+        report.bad_packets++;
+        return;
+    }
+    if (!cur_frame_valid || frame_id != cur_frame_id) {
+        begin_frame(frame_id);
+    }
+    uint8_t line[SIM_LINE_BYTES];
+    if (!decode_line(payload, len, rle, line)) {
+        report.bad_packets++;
+        return;
+    }
+    memcpy(frame_lines[line_id], line, SIM_LINE_BYTES);
+    if (!line_seen[line_id]) {
+        line_seen[line_id] = 1;
+        cur_lines++;
+    }
+    cur_crc = crc32_update(cur_crc, line, SIM_LINE_BYTES);
+    report.lines++;
+    if (rle) {
+        report.lines_rle++;
+    }
+}
+
+static void handle_frame_end(uint16_t frame_id, const uint8_t *payload, uint16_t len) {
+    uint64_t now = sim_time_us();
+    if (len < STREAM_FRAME_END_BYTES) {
+        report.bad_packets++;
+        return;
+    }
+    report.frames++;
+    if (have_last_end && (uint16_t)(frame_id - last_end_id) > 1u) {
+        report.frame_id_gaps += (uint16_t)(frame_id - last_end_id) - 1u;
+    }
+    have_last_end = true;
+    last_end_id = frame_id;
+
+    uint32_t vsync_us = read_le32(&payload[0]);
+    uint32_t crc = read_le32(&payload[12]);
+    if (!cur_frame_valid || frame_id != cur_frame_id) {
+        begin_frame(frame_id);
+    }
+    if (cur_lines == roi_count) {
+        report.frames_complete++;
+    }
+    if (~cur_crc != crc) {
+        report.frames_crc_bad++;
+    }
+
+    // Same clock on both sides, so the device timestamp doubles as the truth
+    // for which source frame was captured.
+    uint64_t frame = sim_source_frame_at(vsync_us);
+    bool match = true;
+    uint8_t expect[SIM_LINE_BYTES];
+    for (uint16_t y = roi_first; check_content && y < (uint16_t)(roi_first + roi_count) && match; y++) {
+        if (!line_seen[y]) {
+            continue;
+        }
+        sim_source_line(frame * SIM_FRAME_LINES + SIM_YOFF_LINES + y, expect);
+        match = memcmp(expect, frame_lines[y], SIM_LINE_BYTES) == 0;
+    }
+    if (!match) {
+        report.frames_content_bad++;
+    }
+
+    uint32_t latency = (uint32_t)now - vsync_us;
+    if (report.latency_count < MAX_LATENCIES) {
+        latencies[report.latency_count++] = latency;
+    }
+    cur_frame_valid = false;
+}
+
+// Parse whole packets from buf; returns the bytes consumed.
+static size_t parse(const uint8_t *buf, size_t len) {
+    size_t pos = 0;
+    while (len - pos >= STREAM_HEADER_BYTES) {
+        const uint8_t *p = &buf[pos];
+        if (p[0] != STREAM_MAGIC0 || p[1] != STREAM_MAGIC1) {
+            report.bad_packets++;
+            pos++;
+            continue;
+        }
+        uint16_t frame_id = (uint16_t)(p[2] | (p[3] << 8));
+        uint16_t line_id = (uint16_t)(p[4] | (p[5] << 8));
+        uint16_t flags = (uint16_t)(p[6] | (p[7] << 8));
+        uint16_t plen = flags & STREAM_LEN_MASK;
+        if (plen > MAX_PAYLOAD) {
+            report.bad_packets++;
+            pos++;
+            continue;
+        }
+        if (len - pos < STREAM_HEADER_BYTES + (size_t)plen) {
+            break;
+        }
+        const uint8_t *payload = &p[STREAM_HEADER_BYTES];
+        if (line_id == STREAM_LINE_FRAME_END) {
+            handle_frame_end(frame_id, payload, plen);
+        } else if (line_id == STREAM_LINE_TELEMETRY) {
+            report.telemetry++;
+        } else {
+            handle_line(frame_id, line_id, payload, plen, (flags & STREAM_FLAG_RLE) != 0);
+        }
+        pos += STREAM_HEADER_BYTES + plen;
+    }
+    return pos;
+}
+
+static void *host_main(void *arg) {
+    (void)arg;
+    static uint8_t buf[PARSE_BUF_BYTES];
+    size_t have = 0;
+    while (!__atomic_load_n(&host_stop, __ATOMIC_ACQUIRE)) {
+        size_t room = sizeof(buf) - have;
+        size_t n = sim_usb_bulk_read(&buf[have], room < READ_CHUNK ? room : READ_CHUNK, 20);
+        if (n == 0) {
+            continue;
+        }
+        report.bytes += n;
+        have += n;
+        size_t used = parse(buf, have);
+        memmove(buf, &buf[used], have - used);
+        have -= used;
+    }
+    return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void sim_host_start(uint16_t first, uint16_t count, bool content) {
+    roi_first = first;
+    roi_count = count;
+    check_content = content;
+    latencies = calloc(MAX_LATENCIES, sizeof(*latencies));
+    if (!latencies || pthread_create(&host_thread, NULL, host_main, NULL) != 0) {
+        fprintf(stderr, "[sim] failed to start host thread\n");
+        exit(1);
+    }
+}
+
+void sim_host_stop(sim_host_report_t *out) {
+    __atomic_store_n(&host_stop, true, __ATOMIC_RELEASE);
+    pthread_join(host_thread, NULL);
+
+    if (report.latency_count > 0) {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < report.latency_count; i++) {
+            sum += latencies[i];
+        }
+        qsort(latencies, report.latency_count, sizeof(*latencies), cmp_u32);
+        report.latency_avg_us = (double)sum / report.latency_count;
+        report.latency_p50_us = latencies[report.latency_count / 2u];
+        report.latency_p99_us = latencies[(report.latency_count * 99u) / 100u];
+        report.latency_max_us = latencies[report.latency_count - 1u];
+    }
+    free(latencies);
+    latencies = NULL;
+    *out = report;
+}
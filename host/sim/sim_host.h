@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Simulated USB host: reads the vendor bulk stream, reassembles frames and
+// checks each against its frame end CRC and the source image it came from.
+
+typedef struct sim_host_report {
+    uint64_t bytes;
+    uint32_t frames;            // frame end packets seen
+    uint32_t frames_complete;   // ... with every ROI line present
+    uint32_t frames_crc_bad;
+    uint32_t frames_content_bad;
+    uint32_t frame_id_gaps;     // frames skipped between consecutive frame ends
+    uint32_t lines;
+    uint32_t lines_rle;
+    uint32_t telemetry;
+    uint32_t bad_packets;       // resync bytes or undecodable payloads
+    uint32_t latency_count;
+    double latency_avg_us;      // VSYNC -> frame end packet at the host
+    uint32_t latency_p50_us;
+    uint32_t latency_p99_us;
+    uint32_t latency_max_us;
+} sim_host_report_t;
+
+// check_content: compare frames against the simulated source (off for
+// benchmark frames, which do not come from it).
+void sim_host_start(uint16_t roi_first, uint16_t roi_count, bool check_content);
+void sim_host_stop(sim_host_report_t *out);
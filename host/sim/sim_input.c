@@ -0,0 +1,247 @@
+#include "sim_input.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb_device.h"
+#include "input_uart.h"
+#include "sim.h"
+
+#define ADB_UART 1u
+#define DRAIN_MS 500u
+// The controller's key queue, emptied two keys per Talk R0 every 11 ms.
+#define CTRL_KEY_QUEUE 32u
+#define CTRL_KEY_POLL_US 11000u
+
+static pthread_t input_thread;
+static volatile bool input_stop = false;
+static volatile bool input_writing = true;
+static uint32_t input_hz = 0;
+static sim_input_report_t report;
+
+static pthread_mutex_t seen_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t key_sent_us[128];
+static uint64_t key_latency_sum = 0;
+
+static uint8_t rx_buf[INPUT_LINK_FRAME_MAX];
+static size_t rx_len = 0;
+static int8_t last_down = 0;
+static bool have_seq = false;
+static uint8_t last_seq = 0;
+static uint32_t ctrl_keys = 0;
+static uint64_t ctrl_drain_us = 0;
+
+static void sleep_host_us(uint32_t us) {
+    struct timespec ts = {us / 1000000u, (long)(us % 1000000u) * 1000L};
+    nanosleep(&ts, NULL);
+}
+
+static void write_record(const uint8_t rec[INPUT_EVENT_BYTES]) {
+    size_t done = 0;
+    while (done < INPUT_EVENT_BYTES && !__atomic_load_n(&input_stop, __ATOMIC_ACQUIRE)) {
+        done += sim_usb_bulk_write(&rec[done], INPUT_EVENT_BYTES - done);
+        if (done < INPUT_EVENT_BYTES) {
+            sleep_host_us(100);
+        }
+    }
+}
+
+static void seen_key(uint8_t code) {
+    report.keys_seen++;
+    uint64_t sent = key_sent_us[code & 0x7Fu];
+    if (sent != 0) {
+        uint32_t lat = (uint32_t)(sim_time_us() - sent);
+        key_latency_sum += lat;
+        report.key_latency_count++;
+        if (lat > report.key_latency_max_us) {
+            report.key_latency_max_us = lat;
+        }
+    }
+}
+
+static void handle_event(const uint8_t *ev) {
+    if (ev[0] == INPUT_EV_MOUSE) {
+        int8_t down = (int8_t)(ev[1] & 0x01u);
+        report.dx_seen += (int8_t)ev[2];
+        report.dy_seen += (int8_t)ev[3];
+        if (down != last_down) {
+            report.button_changes_seen++;
+            last_down = down;
+        }
+    } else if (ev[0] == INPUT_EV_KEY) {
+        if (ctrl_keys >= CTRL_KEY_QUEUE) {
+            report.key_overruns++;
+        } else {
+            ctrl_keys++;
+        }
+        seen_key(ev[1]);
+    } else {
+        report.bad_frames++;
+    }
+}
+
+static void send_ack(uint8_t seq) {
+    uint8_t ack[INPUT_LINK_ACK_BYTES] = {INPUT_LINK_ACK_SYNC, seq,
+                                         (uint8_t)(CTRL_KEY_QUEUE - ctrl_keys)};
+    uint16_t crc = 0xFFFFu;
+    crc = input_link_crc(crc, ack[1]);
+    crc = input_link_crc(crc, ack[2]);
+    ack[3] = (uint8_t)crc;
+    ack[4] = (uint8_t)(crc >> 8);
+    sim_uart_write(ADB_UART, ack, sizeof(ack));
+}
+
+// rx_buf holds a whole frame: check it, apply it unless it repeats the last
+// one (its ack was lost or late), and acknowledge it either way.
+static void handle_frame(void) {
+    uint8_t len = rx_buf[1];
+    uint8_t seq = rx_buf[2];
+    uint16_t crc = 0xFFFFu;
+    for (size_t i = 1; i < 3u + len; i++) {
+        crc = input_link_crc(crc, rx_buf[i]);
+    }
+    if (rx_buf[3u + len] != (uint8_t)crc || rx_buf[4u + len] != (uint8_t)(crc >> 8)) {
+        report.bad_frames++;
+        return;
+    }
+    if (have_seq && seq == last_seq) {
+        report.repeats++;
+    } else {
+        report.frames++;
+        for (uint8_t i = 0; i < len; i += INPUT_EVENT_BYTES) {
+            handle_event(&rx_buf[3u + i]);
+        }
+        have_seq = true;
+        last_seq = seq;
+    }
+    send_ack(seq);
+}
+
+void sim_input_seen_mouse(int dx, int dy, bool down) {
+    pthread_mutex_lock(&seen_lock);
+    report.frames++;
+    report.dx_seen += dx;
+    report.dy_seen += dy;
+    if ((down ? 1 : 0) != last_down) {
+        report.button_changes_seen++;
+        last_down = down ? 1 : 0;
+    }
+    pthread_mutex_unlock(&seen_lock);
+}
+
+void sim_input_seen_key(uint8_t code, bool up) {
+    (void)up;
+    pthread_mutex_lock(&seen_lock);
+    report.frames++;
+    seen_key(code);
+    pthread_mutex_unlock(&seen_lock);
+}
+
+static void take_byte(uint8_t byte) {
+    if (rx_len == 0 && byte != INPUT_LINK_SYNC) {
+        report.bad_frames++;
+        return;
+    }
+    rx_buf[rx_len++] = byte;
+    if (rx_len == 2 && (byte % INPUT_EVENT_BYTES != 0 ||
+                        byte > INPUT_LINK_EVENTS_MAX * INPUT_EVENT_BYTES)) {
+        report.bad_frames++;
+        rx_len = 0;
+        return;
+    }
+    if (rx_len >= 3 && rx_len == 5u + rx_buf[1]) {
+        handle_frame();
+        rx_len = 0;
+    }
+}
+
+static void poll_uart(void) {
+    if (EBD_IPKVM_ADB) {
+        return;
+    }
+    pthread_mutex_lock(&seen_lock);
+    uint64_t now = sim_time_us();
+    if (ctrl_drain_us == 0) {
+        ctrl_drain_us = now;
+    }
+    while (now - ctrl_drain_us >= CTRL_KEY_POLL_US) {
+        ctrl_drain_us += CTRL_KEY_POLL_US;
+        ctrl_keys = ctrl_keys > 2u ? ctrl_keys - 2u : 0u;
+    }
+    pthread_mutex_unlock(&seen_lock);
+    uint8_t buf[256];
+    size_t n;
+    while ((n = sim_uart_read(ADB_UART, buf, sizeof(buf))) > 0) {
+        pthread_mutex_lock(&seen_lock);
+        for (size_t i = 0; i < n; i++) {
+            take_byte(buf[i]);
+        }
+        pthread_mutex_unlock(&seen_lock);
+    }
+}
+
+static void *input_main(void *arg) {
+    (void)arg;
+    uint64_t period_us = input_hz ? 1000000u / input_hz : 0;
+    uint64_t next_us = sim_time_us();
+    uint32_t seq = 0;
+    bool down = false;
+    while (!__atomic_load_n(&input_stop, __ATOMIC_ACQUIRE)) {
+        uint64_t now = sim_time_us();
+        if (period_us && __atomic_load_n(&input_writing, __ATOMIC_ACQUIRE) && now >= next_us) {
+            next_us += period_us;
+            seq++;
+            if (seq % 100u == 0) {
+                down = !down;
+                report.button_changes_sent++;
+            }
+            // Mostly small moves with the occasional one past the 7-bit range.
+            int8_t dx = (int8_t)((seq % 50u == 0) ? 100 : (int)(seq % 7u) - 2);
+            int8_t dy = (int8_t)((seq % 3u) == 0 ? -1 : 2);
+            uint8_t rec[INPUT_EVENT_BYTES] = {INPUT_EV_MOUSE, down ? 1 : 0, (uint8_t)dx, (uint8_t)dy};
+            write_record(rec);
+            report.mouse_events++;
+            report.dx_sent += dx;
+            report.dy_sent += dy;
+            if (seq % 25u == 0) {
+                // 0x7F is left out: released it would read as 0xFF, ADB's
+                // "no key".
+                uint8_t code = (uint8_t)((seq / 25u) % 0x7Fu);
+                uint8_t key[INPUT_EVENT_BYTES] = {INPUT_EV_KEY, code, (uint8_t)((seq / 25u) & 1u), 0};
+                pthread_mutex_lock(&seen_lock);
+                key_sent_us[code] = sim_time_us();
+                pthread_mutex_unlock(&seen_lock);
+                write_record(key);
+                report.key_events++;
+            }
+        }
+        poll_uart();
+        sleep_host_us(200);
+    }
+    poll_uart();
+    return NULL;
+}
+
+void sim_input_start(uint32_t hz) {
+    input_hz = hz;
+    if (pthread_create(&input_thread, NULL, input_main, NULL) != 0) {
+        fprintf(stderr, "[sim] failed to start input thread\n");
+        exit(1);
+    }
+}
+
+void sim_input_stop(sim_input_report_t *out) {
+    __atomic_store_n(&input_writing, false, __ATOMIC_RELEASE);
+    sleep_host_us(DRAIN_MS * 1000u);
+    __atomic_store_n(&input_stop, true, __ATOMIC_RELEASE);
+    pthread_join(input_thread, NULL);
+    pthread_mutex_lock(&seen_lock);
+    if (report.key_latency_count > 0) {
+        report.key_latency_avg_us = (double)key_latency_sum / report.key_latency_count;
+    }
+    *out = report;
+    pthread_mutex_unlock(&seen_lock);
+}
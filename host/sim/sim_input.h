@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simulated keyboard/mouse source and ADB controller: writes input records to
+// the vendor OUT endpoint and takes the link frames the firmware sends on
+// UART1, acknowledging each with the room left in a key queue that drains as
+// the Mac's polls would, and checking that coalescing loses no motion. In EBD_IPKVM_ADB builds
+// the Mac's ADB polls (sim_adb.c) report what arrives instead.
+
+typedef struct sim_input_report {
+    uint32_t mouse_events;
+    uint32_t key_events;
+    uint32_t frames;          // link frames taken from UART1 / Talk R0 replies
+    uint32_t bad_frames;      // bad sync, length, CRC or event type
+    uint32_t repeats;         // frames sent again after a lost or late ack
+    uint32_t key_overruns;    // keys sent with the controller's queue full
+    int64_t dx_sent, dy_sent;
+    int64_t dx_seen, dy_seen;
+    uint32_t keys_seen;
+    uint32_t button_changes_sent;
+    uint32_t button_changes_seen;
+    uint32_t key_latency_count;
+    double key_latency_avg_us; // key record written -> frame / reply on the wire
+    uint32_t key_latency_max_us;
+} sim_input_report_t;
+
+// Mouse records at hz, with a key press or release every 25th record and the
+// button toggled every 100th.
+void sim_input_start(uint32_t hz);
+// Stop writing, let the firmware drain its queue, then report.
+void sim_input_stop(sim_input_report_t *out);
+
+// ADB builds: Talk R0 replies decoded by the simulated Mac.
+void sim_input_seen_mouse(int dx, int dy, bool down);
+void sim_input_seen_key(uint8_t code, bool up);
@@ -0,0 +1,390 @@
+// ebd_ipkvm_sim: the unmodified firmware core on two host threads, fed by a
+// simulated Mac Classic and drained by a simulated USB host. See host/README.md.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "adb_device.h"
+#include "bench_frames.h"
+#include "sim.h"
+#include "sim_adb.h"
+#include "sim_host.h"
+#include "sim_input.h"
+#include "usb_control.h"
+
+// src/main.c, compiled with -Dmain=ebd_firmware_main.
+int ebd_firmware_main(void);
+
+#define EP0_OUT 0x41 // Host-to-Device | Vendor | Interface
+#define EP0_IN 0xC1  // Device-to-Host | Vendor | Interface
+#define EP0_TIMEOUT_MS 2000
+
+typedef struct sim_options {
+    double seconds;
+    uint16_t codec;
+    uint16_t mode;
+    uint16_t divisor;
+    uint16_t telemetry_ms;
+    uint16_t roi_first;
+    uint16_t roi_count;
+    bool strict;
+    int bench_screen;         // -1 = capture the simulated source
+    uint32_t bench_period_us;
+    const char *bench_upload;
+    uint32_t input_hz;
+} sim_options_t;
+
+static const char *const bench_screen_names[BENCH_SCREEN_COUNT] = {
+    "upload", "desktop", "text", "dither", "white", "noise",
+};
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --seconds=N        capture time (default 5)\n"
+            "  --codec=raw|rle    line codec (default rle)\n"
+            "  --mode=cont60|test30\n"
+            "  --divisor=N        take every Nth VSYNC (default 1)\n"
+            "  --roi=FIRST:COUNT  active line range (default 0:342)\n"
+            "  --telemetry-ms=N   bulk telemetry interval (default 0 = off)\n"
+            "  --usb-bps=N        vendor IN bus rate in bytes/s (default 1216000, 0 = unlimited)\n"
+            "  --pattern=desktop|noise|blank\n"
+            "  --pbm=FILE         replay a 512x342 P4 image instead of a pattern\n"
+            "  --no-cursor        keep the desktop pattern static\n"
+            "  --glitch-every=N   make one line of every Nth frame out of spec\n"
+            "  --cdc              show the CDC status text on stderr\n"
+            "  --strict           also fail on frames whose content does not match the source\n"
+            "  --bench=SCREEN     feed benchmark frames instead of capturing (EBD_IPKVM_BENCH builds):\n"
+            "                     upload|desktop|text|dither|white|noise\n"
+            "  --bench-period=US  benchmark tick (default %u)\n"
+            "  --bench-upload=FILE  upload a 512x342 P4 image and bench it\n"
+            "  --input-hz=N       write mouse records to vendor OUT at N Hz, with keys and\n"
+            "                     clicks, and check what reaches UART1, or the ADB bus in\n"
+            "                     EBD_IPKVM_ADB builds (default 0 = off)\n",
+            argv0, BENCH_DEFAULT_PERIOD_US);
+}
+
+static void sleep_host_ms(uint32_t ms) {
+    struct timespec ts = {ms / 1000u, (long)(ms % 1000u) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static bool ep0_out(uint8_t request, uint16_t value, void *data, uint16_t len) {
+    if (sim_usb_control(EP0_OUT, request, value, 0, data, len, EP0_TIMEOUT_MS) < 0) {
+        fprintf(stderr, "[sim] EP0 request 0x%02x failed\n", request);
+        return false;
+    }
+    return true;
+}
+
+// Send a 512x342 P4 image as display-order lines, 16 per request.
+static bool upload_screen(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[sim] cannot open %s\n", path);
+        return false;
+    }
+    unsigned w = 0, h = 0;
+    static uint8_t image[SIM_ACTIVE_LINES][SIM_LINE_BYTES];
+    bool ok = fscanf(f, "P4 %u %u", &w, &h) == 2 && w == 512u && h == SIM_ACTIVE_LINES;
+    if (ok) {
+        fgetc(f);
+        ok = fread(image, 1, sizeof(image), f) == sizeof(image);
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "[sim] %s: expected a 512x342 P4 (binary PBM) image\n", path);
+        return false;
+    }
+    for (unsigned y = 0; y < SIM_ACTIVE_LINES; y++) {
+        for (unsigned i = 0; i < SIM_LINE_BYTES; i++) {
+            image[y][i] = (uint8_t)~image[y][i]; // PBM uses 1 = black
+        }
+    }
+    const unsigned chunk = BENCH_UPLOAD_MAX_BYTES / SIM_LINE_BYTES;
+    for (unsigned y = 0; y < SIM_ACTIVE_LINES; y += chunk) {
+        unsigned n = (SIM_ACTIVE_LINES - y < chunk) ? SIM_ACTIVE_LINES - y : chunk;
+        if (!ep0_out(USB_CTRL_REQ_BENCH_UPLOAD, (uint16_t)y, image[y], (uint16_t)(n * SIM_LINE_BYTES))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_bench(void) {
+    bench_report_t b;
+    memset(&b, 0, sizeof(b));
+    if (sim_usb_control(EP0_IN, USB_CTRL_REQ_GET_BENCH, 0, 0, &b, sizeof(b), EP0_TIMEOUT_MS) <
+        (int)sizeof(b)) {
+        printf("bench:  GET_BENCH failed\n");
+        return;
+    }
+    double secs = b.elapsed_us / 1e6;
+    double cyc_per_line = b.lines ? (double)b.line_cycles / b.lines : 0.0;
+    printf("bench:  screen=%s codec=%s frames=%u/%u skipped=%u\n",
+           b.screen < BENCH_SCREEN_COUNT ? bench_screen_names[b.screen] : "?",
+           b.codec ? "rle" : "raw", b.frames_sent, b.ticks, b.ticks_skipped);
+    printf("bench:  cycles/line avg=%.0f max=%u  bytes/frame=%.0f  usb=%.1f KB/s\n", cyc_per_line,
+           b.line_cycles_max, b.frames_sent ? (double)b.packet_bytes / b.frames_sent : 0.0,
+           secs > 0.0 ? (double)b.usb_bytes / secs / 1000.0 : 0.0);
+    printf("bench:  postprocess max=%u us  submit->frame end queued avg=%.0f max=%u us\n",
+           b.postprocess_us_max, b.frames_sent ? (double)b.frame_tx_us_sum / b.frames_sent : 0.0,
+           b.frame_tx_us_max);
+}
+
+int main(int argc, char **argv) {
+    sim_options_t opt = {
+        .seconds = 5.0,
+        .codec = USB_CTRL_CODEC_RLE,
+        .mode = 1,
+        .divisor = 1,
+        .roi_count = SIM_ACTIVE_LINES,
+        .bench_screen = -1,
+    };
+    sim_source_config_t src = {.pattern = SIM_PATTERN_DESKTOP, .cursor = true};
+    sim_usb_config_t usb = {.bulk_bytes_per_s = 1216000u};
+
+    static const struct option long_opts[] = {
+        {"seconds", required_argument, NULL, 's'},
+        {"codec", required_argument, NULL, 'c'},
+        {"mode", required_argument, NULL, 'm'},
+        {"divisor", required_argument, NULL, 'd'},
+        {"roi", required_argument, NULL, 'r'},
+        {"telemetry-ms", required_argument, NULL, 't'},
+        {"usb-bps", required_argument, NULL, 'u'},
+        {"pattern", required_argument, NULL, 'p'},
+        {"pbm", required_argument, NULL, 'f'},
+        {"no-cursor", no_argument, NULL, 'n'},
+        {"glitch-every", required_argument, NULL, 'g'},
+        {"cdc", no_argument, NULL, 'C'},
+        {"strict", no_argument, NULL, 'S'},
+        {"bench", required_argument, NULL, 'b'},
+        {"bench-period", required_argument, NULL, 'P'},
+        {"bench-upload", required_argument, NULL, 'U'},
+        {"input-hz", required_argument, NULL, 'i'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int ch;
+    while ((ch = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (ch) {
+        case 's':
+            opt.seconds = atof(optarg);
+            break;
+        case 'c':
+            if (strcmp(optarg, "raw") == 0) {
+                opt.codec = USB_CTRL_CODEC_RAW;
+            } else if (strcmp(optarg, "rle") == 0) {
+                opt.codec = USB_CTRL_CODEC_RLE;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'm':
+            opt.mode = (strcmp(optarg, "test30") == 0) ? 0 : 1;
+            break;
+        case 'd':
+            opt.divisor = (uint16_t)atoi(optarg);
+            break;
+        case 'r': {
+            unsigned first = 0, count = 0;
+            if (sscanf(optarg, "%u:%u", &first, &count) != 2 || first >= SIM_ACTIVE_LINES ||
+                count == 0 || first + count > SIM_ACTIVE_LINES) {
+                fprintf(stderr, "invalid --roi value: %s\n", optarg);
+                return 2;
+            }
+            opt.roi_first = (uint16_t)first;
+            opt.roi_count = (uint16_t)count;
+            break;
+        }
+        case 't':
+            opt.telemetry_ms = (uint16_t)atoi(optarg);
+            break;
+        case 'u':
+            usb.bulk_bytes_per_s = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            if (strcmp(optarg, "desktop") == 0) {
+                src.pattern = SIM_PATTERN_DESKTOP;
+            } else if (strcmp(optarg, "noise") == 0) {
+                src.pattern = SIM_PATTERN_NOISE;
+            } else if (strcmp(optarg, "blank") == 0) {
+                src.pattern = SIM_PATTERN_BLANK;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'f':
+            src.pattern = SIM_PATTERN_FILE;
+            src.pbm_path = optarg;
+            break;
+        case 'n':
+            src.cursor = false;
+            break;
+        case 'g':
+            src.glitch_every = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'C':
+            usb.cdc_connected = true;
+            usb.cdc_echo = true;
+            break;
+        case 'S':
+            opt.strict = true;
+            break;
+        case 'b':
+            opt.bench_screen = -1;
+            for (int i = 0; i < BENCH_SCREEN_COUNT; i++) {
+                if (strcmp(optarg, bench_screen_names[i]) == 0) {
+                    opt.bench_screen = i;
+                }
+            }
+            if (opt.bench_screen < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'P':
+            opt.bench_period_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'U':
+            opt.bench_upload = optarg;
+            opt.bench_screen = BENCH_SCREEN_UPLOAD;
+            break;
+        case 'i':
+            opt.input_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return ch == 'h' ? 0 : 2;
+        }
+    }
+
+    if (!sim_source_init(&src)) {
+        return 2;
+    }
+    sim_usb_init(&usb);
+    bool bench = opt.bench_screen >= 0;
+    sim_host_start(opt.roi_first, opt.roi_count, !bench);
+    sim_start_firmware(ebd_firmware_main);
+
+    usb_ctrl_roi_t roi = {.first_line_le = opt.roi_first, .line_count_le = opt.roi_count};
+    bool ok = ep0_out(USB_CTRL_REQ_SET_CAPTURE_MODE, opt.mode, NULL, 0) &&
+              ep0_out(USB_CTRL_REQ_SET_FRAME_DIVISOR, opt.divisor, NULL, 0) &&
+              ep0_out(USB_CTRL_REQ_SET_CODEC, opt.codec, NULL, 0) &&
+              ep0_out(USB_CTRL_REQ_SET_ROI, 0, &roi, sizeof(roi)) &&
+              ep0_out(USB_CTRL_REQ_SET_TELEMETRY, opt.telemetry_ms, NULL, 0) &&
+              ep0_out(USB_CTRL_REQ_RESET_COUNTERS, 0, NULL, 0);
+    if (ok && bench) {
+        usb_ctrl_bench_start_t start = {
+            .screen = (uint8_t)opt.bench_screen,
+            .period_us_le = opt.bench_period_us,
+        };
+        ok = (!opt.bench_upload || upload_screen(opt.bench_upload)) &&
+             ep0_out(USB_CTRL_REQ_BENCH_START, 0, &start, sizeof(start));
+    } else if (ok) {
+        ok = ep0_out(USB_CTRL_REQ_CAPTURE_START, 0, NULL, 0);
+    }
+    if (!ok) {
+        sim_stop_firmware();
+        return 1;
+    }
+
+    // The firmware has answered EP0, so adb_device_init() has run.
+    if (EBD_IPKVM_ADB) {
+        sim_adb_start();
+    }
+    if (opt.input_hz) {
+        sim_input_start(opt.input_hz);
+    }
+    sleep_host_ms((uint32_t)(opt.seconds * 1000.0));
+    sim_input_report_t in;
+    memset(&in, 0, sizeof(in));
+    if (opt.input_hz) {
+        sim_input_stop(&in);
+    }
+    sim_adb_report_t adb;
+    memset(&adb, 0, sizeof(adb));
+    if (EBD_IPKVM_ADB) {
+        sim_adb_stop(&adb);
+    }
+
+    usb_ctrl_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    int got = sim_usb_control(EP0_IN, USB_CTRL_REQ_GET_STATS, 0, 0, &stats, sizeof(stats),
+                              EP0_TIMEOUT_MS);
+    if (bench) {
+        print_bench();
+    }
+    ep0_out(USB_CTRL_REQ_CAPTURE_STOP, 0, NULL, 0);
+    sleep_host_ms(100);
+
+    sim_host_report_t rep;
+    sim_host_stop(&rep);
+    sim_stop_firmware();
+
+    double secs = opt.seconds > 0.0 ? opt.seconds : 1.0;
+    printf("host:   frames=%u complete=%u crc_bad=%u content_bad=%u id_gaps=%u bad_pkts=%u telemetry=%u\n",
+           rep.frames, rep.frames_complete, rep.frames_crc_bad, rep.frames_content_bad,
+           rep.frame_id_gaps, rep.bad_packets, rep.telemetry);
+    printf("rate:   %.2f fps  %.1f KB/s  lines=%u (rle %u)\n", rep.frames / secs,
+           (double)rep.bytes / secs / 1000.0, rep.lines, rep.lines_rle);
+    printf("latency vsync->host frame end: avg=%.2f ms p50=%.2f p99=%.2f max=%.2f (n=%u)\n",
+           rep.latency_avg_us / 1000.0, rep.latency_p50_us / 1000.0, rep.latency_p99_us / 1000.0,
+           rep.latency_max_us / 1000.0, rep.latency_count);
+    if (got >= (int)sizeof(stats)) {
+        printf("device: frames_done=%u lines_drop=%u overrun=%u short=%u usb_drops=%u vsync=%u "
+               "core0=%u%% core1=%u%% oos=%u/%u rxs=%u\n",
+               stats.frames_done, stats.lines_drop, stats.frame_overrun, stats.frame_short,
+               stats.usb_drops, stats.vsync_total, stats.core0_pct, stats.core1_pct,
+               stats.frames_out_of_spec, stats.lines_out_of_spec, stats.capture_rx_stalls);
+    } else {
+        printf("device: GET_STATS failed\n");
+    }
+    const char *link = EBD_IPKVM_ADB ? "adb" : "uart";
+    bool input_bad = false;
+    if (EBD_IPKVM_ADB) {
+        printf("adb:    probe=%s cmds=%u replies=%u srqs=%u empty=%u late=%u timing_bad=%u "
+               "tlt=%u..%u us\n",
+               adb.probe_ok ? "ok" : "FAIL", adb.commands, adb.replies, adb.srqs, adb.empty,
+               adb.late, adb.timing_bad, adb.tlt_min_us, adb.tlt_max_us);
+        adb_device_counters_t dev;
+        adb_device_get_bus_counters(&dev);
+        printf("adb device: cmds=%u replies=%u srqs=%u late=%u resets=%u\n", dev.commands,
+               dev.replies, dev.srqs, dev.late, dev.resets);
+        input_bad = !adb.probe_ok || adb.timing_bad != 0;
+    }
+    if (opt.input_hz) {
+        printf("input:  mouse=%u keys=%u -> %s frames=%u bad=%u repeats=%u overruns=%u "
+               "dx=%lld/%lld dy=%lld/%lld keys=%u clicks=%u/%u\n",
+               in.mouse_events, in.key_events, link, in.frames, in.bad_frames, in.repeats,
+               in.key_overruns,
+               (long long)in.dx_seen, (long long)in.dx_sent, (long long)in.dy_seen,
+               (long long)in.dy_sent, in.keys_seen, in.button_changes_seen,
+               in.button_changes_sent);
+        printf("input latency key record -> %s: avg=%.2f ms max=%.2f (n=%u)", link,
+               in.key_latency_avg_us / 1000.0, in.key_latency_max_us / 1000.0,
+               in.key_latency_count);
+        if (got >= (int)sizeof(stats)) {
+            printf("  device: events=%u coalesced=%u sent=%u dropped=%u bad=%u",
+                   stats.input_events, stats.input_coalesced, stats.input_sent,
+                   stats.input_dropped, stats.input_bad);
+        }
+        printf("\n");
+        // A Talk R0 reply the Mac missed (late) takes its motion with it, as
+        // on a real bus; only check totals when every reply arrived.
+        bool exact = !EBD_IPKVM_ADB || adb.late == 0;
+        input_bad = input_bad || in.bad_frames != 0 || in.key_overruns != 0 ||
+                    (exact && (in.dx_seen != in.dx_sent || in.dy_seen != in.dy_sent ||
+                               in.keys_seen != in.key_events ||
+                               in.button_changes_seen != in.button_changes_sent));
+    }
+
+    bool fail = rep.frames == 0 || rep.frames_crc_bad != 0 || rep.bad_packets != 0 ||
+                (opt.strict && rep.frames_content_bad != 0) || input_bad;
+    return fail ? 1 : 0;
+}
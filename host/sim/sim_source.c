@@ -0,0 +1,278 @@
+// Simulated Mac Classic video output.
+//
+// Everything is a pure function of the simulated clock: frame F's VSYNC falls
+// at F * frame_ns, and global line L = F * 370 + row starts half a line later
+// at (L + 0.5) * line_ns, so a VSYNC IRQ serviced within ~22 us still starts
+// the capture on the frame's first line. Pixel bytes follow the capture
+// format: MSB = leftmost pixel, 1 = white.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/gpio.h"
+
+#include "sim.h"
+
+#define W 512u
+#define H SIM_ACTIVE_LINES
+#define CURSOR_SIZE 16u
+
+static sim_source_config_t src_cfg;
+static double line_ns = 0.0;
+static double frame_ns = 0.0;
+static uint8_t static_image[H][SIM_LINE_BYTES];
+
+// VIDEO rate estimate, cached per frame.
+static pthread_mutex_t video_rate_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t video_rate_frame = UINT64_MAX;
+static double video_rate_hz = 0.0;
+static double video_rate_duty = 0.0;
+
+// 1 = black, from the classic arrow cursor.
+static const uint16_t cursor_mask[CURSOR_SIZE] = {
+    0x0000, 0x4000, 0x6000, 0x7000, 0x7800, 0x7C00, 0x7E00, 0x7F00,
+    0x7F80, 0x7C00, 0x6C00, 0x4600, 0x0600, 0x0300, 0x0300, 0x0000,
+};
+
+static void put_pixel(uint8_t row[SIM_LINE_BYTES], uint x, bool white) {
+    uint8_t bit = (uint8_t)(0x80u >> (x & 7u));
+    if (white) {
+        row[x >> 3] |= bit;
+    } else {
+        row[x >> 3] &= (uint8_t)~bit;
+    }
+}
+
+static void draw_desktop(void) {
+    for (uint y = 0; y < H; y++) {
+        uint8_t *row = static_image[y];
+        if (y < 19) {
+            memset(row, 0xFF, SIM_LINE_BYTES);  // menu bar
+        } else if (y == 19) {
+            memset(row, 0x00, SIM_LINE_BYTES);
+        } else {
+            memset(row, (y & 1u) ? 0xAA : 0x55, SIM_LINE_BYTES);  // 50% gray
+        }
+    }
+    // One window: black frame, white interior, title bar stripes.
+    const uint x0 = 64, x1 = 400, y0 = 60, y1 = 280;
+    for (uint y = y0; y <= y1; y++) {
+        for (uint x = x0; x <= x1; x++) {
+            bool edge = (y == y0 || y == y1 || x == x0 || x == x1);
+            bool title = (y > y0 && y < y0 + 19 && ((y - y0) & 1u) == 0);
+            put_pixel(static_image[y], x, !(edge || title));
+        }
+    }
+}
+
+static bool load_pbm(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[sim] cannot open %s\n", path);
+        return false;
+    }
+    unsigned w = 0, h = 0;
+    if (fscanf(f, "P4 %u %u", &w, &h) != 2 || w != W || h != H) {
+        fprintf(stderr, "[sim] %s: expected a %ux%u P4 (binary PBM) image\n", path, W, H);
+        fclose(f);
+        return false;
+    }
+    fgetc(f);  // single whitespace before the raster
+    bool ok = fread(static_image, 1, sizeof(static_image), f) == sizeof(static_image);
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "[sim] %s: short raster\n", path);
+        return false;
+    }
+    // PBM uses 1 = black.
+    for (uint y = 0; y < H; y++) {
+        for (uint i = 0; i < SIM_LINE_BYTES; i++) {
+            static_image[y][i] = (uint8_t)~static_image[y][i];
+        }
+    }
+    return true;
+}
+
+bool sim_source_init(const sim_source_config_t *cfg) {
+    src_cfg = *cfg;
+    line_ns = (double)SIM_LINE_PIXCLK / SIM_PIXCLK_HZ * 1e9;
+    frame_ns = line_ns * SIM_FRAME_LINES;
+    switch (cfg->pattern) {
+    case SIM_PATTERN_DESKTOP:
+        draw_desktop();
+        return true;
+    case SIM_PATTERN_FILE:
+        return load_pbm(cfg->pbm_path);
+    default:
+        memset(static_image, 0, sizeof(static_image));
+        return true;
+    }
+}
+
+double sim_source_line_ns(void) {
+    return line_ns;
+}
+
+double sim_source_frame_ns(void) {
+    return frame_ns;
+}
+
+uint64_t sim_source_frame_at(uint64_t t_us) {
+    return (uint64_t)floor((double)t_us * 1000.0 / frame_ns);
+}
+
+void sim_source_line_span(uint64_t from_us, uint64_t to_us, uint64_t *out_first, uint32_t *out_count) {
+    double from = (double)from_us * 1000.0 / line_ns - 0.5;
+    double to = (double)to_us * 1000.0 / line_ns - 0.5;
+    uint64_t first = from <= 0.0 ? 0u : (uint64_t)ceil(from);
+    uint64_t done = to <= 0.0 ? 0u : (uint64_t)floor(to);
+    *out_first = first;
+    *out_count = (done > first) ? (uint32_t)(done - first) : 0u;
+}
+
+static uint32_t noise_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void sim_source_line(uint64_t line, uint8_t out[SIM_LINE_BYTES]) {
+    uint64_t frame = line / SIM_FRAME_LINES;
+    uint row = (uint)(line % SIM_FRAME_LINES);
+    if (row < SIM_YOFF_LINES || src_cfg.pattern == SIM_PATTERN_BLANK) {
+        memset(out, 0x00, SIM_LINE_BYTES);
+        return;
+    }
+    uint y = row - SIM_YOFF_LINES;
+
+    if (src_cfg.pattern == SIM_PATTERN_NOISE) {
+        uint32_t state = (uint32_t)(frame * 2654435761u) ^ (y * 40503u) ^ 0x9E3779B9u;
+        for (uint i = 0; i < SIM_LINE_BYTES; i += 4) {
+            uint32_t v = noise_next(&state);
+            memcpy(&out[i], &v, sizeof(v));
+        }
+        return;
+    }
+
+    memcpy(out, static_image[y], SIM_LINE_BYTES);
+    if (!src_cfg.cursor) {
+        return;
+    }
+    // Bounce the cursor across the screen, one step per frame.
+    uint span_x = W - CURSOR_SIZE;
+    uint span_y = H - CURSOR_SIZE;
+    uint px = (uint)((frame * 3u) % (2u * span_x));
+    uint py = (uint)((frame * 2u) % (2u * span_y));
+    uint cx = px < span_x ? px : 2u * span_x - px;
+    uint cy = py < span_y ? py : 2u * span_y - py;
+    if (y < cy || y >= cy + CURSOR_SIZE) {
+        return;
+    }
+    uint16_t mask = cursor_mask[y - cy];
+    for (uint i = 0; i < CURSOR_SIZE; i++) {
+        if (mask & (0x8000u >> i)) {
+            put_pixel(out, cx + i, false);
+        }
+    }
+}
+
+// Position within the current frame, in lines.
+static double frame_phase_lines(uint64_t t_us) {
+    double t = fmod((double)t_us * 1000.0, frame_ns);
+    return t / line_ns;
+}
+
+uint32_t sim_source_edges(unsigned pin, uint64_t from_us, uint64_t to_us) {
+    if (pin != SIM_PIN_VSYNC || to_us <= from_us) {
+        return 0;
+    }
+    // VSYNC is active-low for the first SIM_VSYNC_LINES of each frame.
+    double rise_us = line_ns * SIM_VSYNC_LINES / 1000.0;
+    double frame_us = frame_ns / 1000.0;
+    uint32_t edges = 0;
+    if (floor((double)to_us / frame_us) > floor((double)from_us / frame_us)) {
+        edges |= GPIO_IRQ_EDGE_FALL;
+    }
+    if (floor(((double)to_us - rise_us) / frame_us) > floor(((double)from_us - rise_us) / frame_us)) {
+        edges |= GPIO_IRQ_EDGE_RISE;
+    }
+    return edges;
+}
+
+bool sim_source_level(unsigned pin, uint64_t t_us) {
+    double phase = frame_phase_lines(t_us);
+    double line_phase = phase - floor(phase);
+    switch (pin) {
+    case SIM_PIN_VSYNC:
+        return phase >= SIM_VSYNC_LINES;
+    case SIM_PIN_HSYNC:
+        return line_phase * SIM_LINE_PIXCLK >= SIM_HSYNC_PIXCLK;
+    case SIM_PIN_PIXCLK:
+        return ((t_us * 1000u) % 64u) < 32u;
+    default:
+        return false;
+    }
+}
+
+// Rising edges and high fraction of VIDEO over frame's active area.
+static void video_rate(uint64_t frame, double *out_hz, double *out_duty) {
+    pthread_mutex_lock(&video_rate_lock);
+    if (frame != video_rate_frame) {
+        uint64_t rises = 0;
+        uint64_t high = 0;
+        uint8_t line[SIM_LINE_BYTES];
+        for (uint row = SIM_YOFF_LINES; row < SIM_FRAME_LINES; row++) {
+            sim_source_line(frame * SIM_FRAME_LINES + row, line);
+            bool prev = false;  // blanking is low
+            for (uint x = 0; x < W; x++) {
+                bool bit = (line[x >> 3] >> (7u - (x & 7u))) & 1u;
+                rises += (bit && !prev);
+                high += bit;
+                prev = bit;
+            }
+        }
+        video_rate_frame = frame;
+        video_rate_hz = (double)rises * 1e9 / frame_ns;
+        video_rate_duty = (double)high / ((double)SIM_FRAME_LINES * SIM_LINE_PIXCLK);
+    }
+    *out_hz = video_rate_hz;
+    *out_duty = video_rate_duty;
+    pthread_mutex_unlock(&video_rate_lock);
+}
+
+void sim_source_signal(unsigned pin, double *out_hz, double *out_duty) {
+    switch (pin) {
+    case SIM_PIN_PIXCLK:
+        *out_hz = SIM_PIXCLK_HZ;
+        *out_duty = 0.5;
+        break;
+    case SIM_PIN_VSYNC:
+        *out_hz = 1e9 / frame_ns;
+        *out_duty = 1.0 - (double)SIM_VSYNC_LINES / SIM_FRAME_LINES;
+        break;
+    case SIM_PIN_HSYNC:
+        *out_hz = 1e9 / line_ns;
+        *out_duty = 1.0 - (double)SIM_HSYNC_PIXCLK / SIM_LINE_PIXCLK;
+        break;
+    case SIM_PIN_VIDEO:
+        video_rate(sim_source_frame_at(sim_time_us()), out_hz, out_duty);
+        break;
+    default:
+        *out_hz = 0.0;
+        *out_duty = 0.0;
+        break;
+    }
+}
+
+int32_t sim_source_glitch(uint64_t frame) {
+    if (src_cfg.glitch_every == 0 || (frame % src_cfg.glitch_every) != src_cfg.glitch_every - 1u) {
+        return 0;
+    }
+    return 3;  // one line three PIXCLKs long
+}
@@ -0,0 +1,167 @@
+// Replays ADB bus edge timings through the ATmega's command decoder
+// (Arduino/src/adb_rx.cpp) and checks the commands, SRQs and reply choices it
+// makes. The ATmega firmware runs the decoder from INT0 with Timer1 at 0.5 us
+// per tick; here the edges come from tables instead.
+
+#include "adb_rx.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// One edge: the line level after it and the microseconds since the previous
+// edge.
+struct Edge {
+    uint8_t level;
+    uint16_t us;
+};
+
+typedef std::vector<Edge> Trace;
+
+// What the firmware would do for one command.
+struct Decision {
+    uint8_t cmd;
+    bool srq;
+    uint8_t reply;
+};
+
+// Talk R0 to the mouse (0x3C) as a Mac SE sends it: 800 us attention, sync,
+// eight bits, stop bit, with a few us of jitter.
+const Trace kTalkMouseR0 = {
+    {0, 0},   {1, 803}, {0, 66},                       // attention, sync
+    {1, 63}, {0, 37}, {1, 66}, {0, 35},                // 0 0
+    {1, 34}, {0, 64}, {1, 36}, {0, 65},                // 1 1
+    {1, 35}, {0, 66}, {1, 33}, {0, 67},                // 1 1
+    {1, 64}, {0, 36}, {1, 65}, {0, 34},                // 0 0
+    {1, 66},                                           // stop bit
+};
+
+// Eight command bits, MSB first, each a low of 35 (1) or 65 (0) us in a
+// 100 us cell, plus jitter of +-j us alternating; then the stop bit.
+Trace command(uint8_t cmd, int j = 0) {
+    Trace t = {{0, 0}, {1, 800}, {0, 65}};
+    for (int i = 7; i >= 0; i--) {
+        int s = (i & 1) ? j : -j;
+        bool one = (cmd >> i) & 1;
+        uint16_t low = (uint16_t)((one ? 35 : 65) + s);
+        t.push_back({1, low});
+        t.push_back({0, (uint16_t)(100 - low)});
+    }
+    t.push_back({1, 65});
+    return t;
+}
+
+// Replay a trace. Timer1 starts just short of its wrap so intervals cross it.
+// After an SRQ the firmware masks INT0 and drives the line itself, so the
+// stop bit's rising edge is not fed in.
+std::vector<Decision> replay(const Trace &trace, uint8_t pending) {
+    adb_rx_t rx = {};
+    std::vector<Decision> out;
+    uint16_t now = 0xFF00;
+    bool masked = false;
+    for (const Edge &e : trace) {
+        now = (uint16_t)(now + ADB_TICKS(e.us));
+        if (masked) {
+            masked = false;
+            continue;
+        }
+        switch (adb_rx_edge(&rx, e.level, now, pending)) {
+        case ADB_EDGE_SRQ:
+            out.push_back({rx.cmd, true, adb_reply_for(rx.cmd, pending)});
+            masked = true;
+            break;
+        case ADB_EDGE_COMMAND:
+            out.push_back({rx.cmd, false, adb_reply_for(rx.cmd, pending)});
+            break;
+        default:
+            break;
+        }
+    }
+    return out;
+}
+
+Trace join(const Trace &a, const Trace &b) {
+    Trace t = a;
+    Trace tail = b;
+    tail[0].us = 200; // idle gap before the second attention
+    t.insert(t.end(), tail.begin(), tail.end());
+    return t;
+}
+
+int failed = 0;
+
+void expect(const char *name, const Trace &trace, uint8_t pending,
+            const std::vector<Decision> &want) {
+    std::vector<Decision> got = replay(trace, pending);
+    bool ok = got.size() == want.size();
+    for (size_t i = 0; ok && i < got.size(); i++) {
+        ok = got[i].cmd == want[i].cmd && got[i].srq == want[i].srq &&
+             got[i].reply == want[i].reply;
+    }
+    if (ok) {
+        std::printf("ok   %s\n", name);
+        return;
+    }
+    failed++;
+    std::printf("FAIL %s: got", name);
+    for (const Decision &d : got) {
+        std::printf(" {0x%02X srq=%d reply=%u}", d.cmd, d.srq ? 1 : 0, d.reply);
+    }
+    std::printf(", want");
+    for (const Decision &d : want) {
+        std::printf(" {0x%02X srq=%d reply=%u}", d.cmd, d.srq ? 1 : 0, d.reply);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main() {
+    const uint8_t M = ADB_PENDING_MOUSE;
+    const uint8_t K = ADB_PENDING_KBD;
+
+    expect("mouse talk r0, idle", kTalkMouseR0, 0, {{0x3C, false, ADB_REPLY_NONE}});
+    expect("mouse talk r0, motion", kTalkMouseR0, M, {{0x3C, false, ADB_REPLY_MOUSE}});
+    expect("mouse talk r0, keys wait: srq", kTalkMouseR0, K, {{0x3C, true, ADB_REPLY_NONE}});
+    expect("mouse talk r0, both", kTalkMouseR0, M | K, {{0x3C, true, ADB_REPLY_MOUSE}});
+    expect("kbd talk r0, keys", command(0x2C, 4), K, {{0x2C, false, ADB_REPLY_KBD}});
+    expect("kbd talk r0, motion waits: srq", command(0x2C, 4), M, {{0x2C, true, ADB_REPLY_NONE}});
+    expect("kbd talk r2", command(0x2E), 0, {{0x2E, false, ADB_REPLY_KBD_REG2}});
+    expect("kbd talk r1", command(0x2D), 0, {{0x2D, false, ADB_REPLY_NONE}});
+    expect("kbd talk r3", command(0x2F), 0, {{0x2F, false, ADB_REPLY_NONE}});
+    expect("kbd listen r2", command(0x2A), 0, {{0x2A, false, ADB_REPLY_UNKNOWN}});
+    expect("mouse talk r1", command(0x3D), 0, {{0x3D, false, ADB_REPLY_UNKNOWN}});
+    expect("other address, keys wait: srq", command(0x7C, 8), K, {{0x7C, true, ADB_REPLY_NONE}});
+    expect("other address, idle", command(0x7C, 8), 0, {{0x7C, false, ADB_REPLY_NONE}});
+    expect("flush all", command(0x00), 0, {{0x00, false, ADB_REPLY_NONE}});
+    expect("two commands", join(command(0x2C), kTalkMouseR0), K | M,
+           {{0x2C, true, ADB_REPLY_KBD}, {0x3C, true, ADB_REPLY_MOUSE}});
+
+    // A bit low longer than ADB_BIT_MAX_US drops the command.
+    Trace stretched = command(0x3C);
+    stretched[5].us = 140;
+    expect("bit too long", stretched, M, {});
+
+    // A global reset (3 ms low) ends a command in flight; nothing is answered.
+    Trace reset = command(0x3C);
+    reset.resize(9);
+    reset.push_back({1, 3000});
+    reset.push_back({0, 100});
+    reset.push_back({1, 65});
+    expect("reset mid command", reset, M, {});
+
+    // Edges before any attention are ignored.
+    Trace noise = {{0, 0}, {1, 40}, {0, 60}, {1, 70}, {0, 30}};
+    Trace after = command(0x3C);
+    after[0].us = 200;
+    noise.insert(noise.end(), after.begin(), after.end());
+    expect("noise then command", noise, M, {{0x3C, false, ADB_REPLY_MOUSE}});
+
+    if (failed) {
+        std::printf("%d failed\n", failed);
+        return 1;
+    }
+    std::printf("all passed\n");
+    return 0;
+}
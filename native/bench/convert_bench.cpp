@@ -0,0 +1,83 @@
+// Times the 1 bpp conversion kernels on one frame, for every kernel set this
+// CPU runs, and checks each against the scalar one.
+//
+//   ebd_convert_bench [iterations]
+
+#include "ebd_ipkvm_host.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+typedef void (*ConvertFn)(const uint8_t *src, size_t n, uint8_t *dst);
+
+struct Kernel {
+    const char *name;
+    ConvertFn fn;
+    size_t out_per_byte;
+};
+
+const Kernel kKernels[] = {
+    {"gray8", ebd_convert_gray8, 8},
+    {"rgba", ebd_convert_rgba, 32},
+    {"pbm", ebd_convert_pbm, 1},
+};
+
+double time_us(const Kernel &k, const std::vector<uint8_t> &src, std::vector<uint8_t> &dst,
+               int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        k.fn(src.data(), src.size(), dst.data());
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+    if (iterations <= 0) {
+        std::fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    // A frame of noise, plus a few bytes so every kernel runs its scalar tail.
+    std::vector<uint8_t> src(EBD_FRAME_BYTES + 3);
+    uint32_t x = 0x12345678u;
+    for (uint8_t &b : src) {
+        x = x * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(x >> 24);
+    }
+
+    std::vector<std::vector<uint8_t>> want;
+    ebd_convert_select("scalar");
+    for (const Kernel &k : kKernels) {
+        want.emplace_back(src.size() * k.out_per_byte);
+        k.fn(src.data(), src.size(), want.back().data());
+    }
+
+    std::printf("%u bytes per frame, %d iterations\n", (unsigned)src.size(), iterations);
+    std::printf("%-8s %10s %10s %10s\n", "impl", "gray8 us", "rgba us", "pbm us");
+    int failed = 0;
+    for (unsigned i = 0; const char *impl = ebd_convert_impl_name(i); i++) {
+        ebd_convert_select(impl);
+        std::printf("%-8s", impl);
+        for (size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++) {
+            std::vector<uint8_t> dst(want[k].size());
+            double us = time_us(kKernels[k], src, dst, iterations);
+            bool ok = std::memcmp(dst.data(), want[k].data(), dst.size()) == 0;
+            failed += !ok;
+            std::printf(" %10.2f%s", us, ok ? "" : "!");
+        }
+        std::printf("\n");
+    }
+    if (failed) {
+        std::printf("! output differs from scalar\n");
+    }
+    return failed ? 1 : 0;
+}
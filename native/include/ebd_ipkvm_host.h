@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Native host library for the vendor bulk stream (native/README.md). C ABI so
+// the Python hosts can load it with ctypes (native/python/ebd_ipkvm_host.py).
+
+#ifdef EBD_HOST_EXPORT
+#define EBD_HOST_API __attribute__((visibility("default")))
+#else
+#define EBD_HOST_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EBD_HOST_OK 0
+#define EBD_HOST_ERR_UNSUPPORTED (-1) // built without libusb
+#define EBD_HOST_ERR_NOT_FOUND (-2)   // no device with that VID/PID, or no vendor interface
+#define EBD_HOST_ERR_USB (-3)         // other libusb failure
+#define EBD_HOST_ERR_ARG (-4)
+#define EBD_HOST_ERR_TIMEOUT (-5)
+#define EBD_HOST_ERR_ACCESS (-6)      // no permission to open the device (udev rules)
+#define EBD_HOST_ERR_BUSY (-7)        // interface claimed by another program
+#define EBD_HOST_ERR_GONE (-8)        // device unplugged while open
+
+// Short text for an EBD_HOST_ERR_* code.
+EBD_HOST_API const char *ebd_host_strerror(int err);
+
+// ---- Bulk IN ingest (ingest.cpp) ----
+//
+// Opens the device's vendor interface and keeps `transfers` bulk IN transfers
+// of `transfer_bytes` each in flight on a libusb event thread, so the bus never
+// idles waiting for the reader. Each completed transfer is copied whole into a
+// single-producer/single-consumer byte ring, or dropped whole (and counted) if
+// the ring has no room, so the reader never sees part of a USB transfer.
+
+typedef struct ebd_ingest ebd_ingest_t;
+
+typedef struct ebd_ingest_config {
+    uint32_t transfers;      // bulk IN transfers kept in flight (0 = 8)
+    uint32_t transfer_bytes; // bytes per transfer, rounded up to 64 (0 = 16384)
+    uint32_t ring_bytes;     // ring size, rounded up to a power of two (0 = 1 MiB)
+} ebd_ingest_config_t;
+
+typedef struct ebd_ingest_counters {
+    uint64_t bytes;          // bytes placed in the ring
+    uint64_t transfers;      // transfers completed with data
+    uint64_t empty;          // transfers completed with no data
+    uint64_t stalls;         // endpoint halts cleared
+    uint64_t errors;         // transfers failed otherwise
+    uint64_t dropped;        // transfers dropped with the ring full
+    uint64_t dropped_bytes;
+    uint32_t ring_used;      // bytes waiting for the reader
+    uint32_t ring_high;      // most bytes ever waiting
+} ebd_ingest_counters_t;
+
+// Open vid:pid, claim its vendor (class 0xFF) interface and start streaming.
+// cfg may be NULL for the defaults.
+EBD_HOST_API int ebd_ingest_open(uint16_t vid, uint16_t pid, const ebd_ingest_config_t *cfg,
+                                 ebd_ingest_t **out);
+// Cancel the transfers, stop the event thread, release the interface.
+EBD_HOST_API void ebd_ingest_close(ebd_ingest_t *ing);
+// Copy up to cap bytes out of the ring, waiting up to timeout_ms for the first
+// one. Returns the byte count, 0 on timeout, or a negative error once the
+// device is gone and the ring is empty.
+EBD_HOST_API long ebd_ingest_read(ebd_ingest_t *ing, uint8_t *dst, size_t cap,
+                                  uint32_t timeout_ms);
+// Bulk OUT on the same interface (input records, src/input_events.h). Returns
+// the bytes written or a negative error. A timeout_ms of 0 is taken as 1 ms.
+EBD_HOST_API long ebd_ingest_write(ebd_ingest_t *ing, const uint8_t *src, size_t len,
+                                   uint32_t timeout_ms);
+EBD_HOST_API void ebd_ingest_get_counters(const ebd_ingest_t *ing, ebd_ingest_counters_t *out);
+
+// ---- Packet parser and frame assembler (assembler.cpp) ----
+//
+// Takes the bulk IN byte stream in chunks of any size, splits it into packets
+// in place and decodes raw and RLE lines straight into preallocated frame
+// slots. Two frames assemble at once, so a late line for the previous frame
+// still lands; a frame is emitted at its frame end packet, when a third frame
+// needs its slot, or after `timeout_ms` without a packet for it. Lines a
+// frame never got are copied from the last frame emitted, so every frame is a
+// whole image; line_seen says which lines are new. Memory is fixed at open.
+// Not thread safe: feed and take from one thread.
+
+#define EBD_FRAME_LINES 342
+#define EBD_FRAME_LINE_BYTES 64
+#define EBD_FRAME_BYTES (EBD_FRAME_LINES * EBD_FRAME_LINE_BYTES)
+#define EBD_AUX_PAYLOAD_MAX 256
+
+#define EBD_FRAME_COMPLETE 0x01   // every line arrived
+#define EBD_FRAME_END 0x02        // frame end packet seen: timestamps and end_rx_us valid
+#define EBD_FRAME_DEVICE_CRC 0x04 // ... and it carried device_crc
+#define EBD_FRAME_CRC_OK 0x08     // complete and host_crc == device_crc
+#define EBD_FRAME_CRC_BAD 0x10    // complete and host_crc != device_crc
+#define EBD_FRAME_EVICTED 0x20    // emitted early: a newer frame needed the slot
+#define EBD_FRAME_TIMED_OUT 0x40  // emitted early: no packet for timeout_ms
+
+typedef struct ebd_assembler ebd_assembler_t;
+
+typedef struct ebd_assembler_config {
+    uint32_t slots;      // frame buffers: two assembling, one handed out, the rest
+                         // queued for the taker (0 = 4, min 4)
+    uint32_t timeout_ms; // emit a frame after this long without a packet for it (0 = 50)
+} ebd_assembler_config_t;
+
+typedef struct ebd_frame {
+    const uint8_t *bits;      // EBD_FRAME_BYTES: lines of 64 bytes, MSB first, 1 = white
+    const uint8_t *line_seen; // EBD_FRAME_LINES bytes, 1 where the line arrived for this frame
+    uint32_t frame_id;
+    uint32_t flags;           // EBD_FRAME_*
+    uint32_t lines;           // lines that arrived
+    uint32_t payload_bytes;   // line payload bytes on the wire
+    uint32_t rle_lines;
+    uint32_t vsync_us;        // from the frame end packet, device time_us_32()
+    uint32_t first_line_us;
+    uint32_t last_line_us;
+    uint32_t device_crc;
+    uint32_t host_crc;        // CRC-32 of bits, when complete
+    uint64_t end_rx_us;       // now_us passed with the chunk holding the frame end packet
+} ebd_frame_t;
+
+// Out-of-band packets other than frame end (telemetry), copied out.
+typedef struct ebd_aux_packet {
+    uint16_t frame_id;
+    uint16_t line_id;
+    uint16_t length_flags;
+    uint16_t len;
+    uint8_t payload[EBD_AUX_PAYLOAD_MAX];
+} ebd_aux_packet_t;
+
+typedef struct ebd_assembler_counters {
+    uint64_t bytes;           // bytes fed
+    uint64_t packets;
+    uint64_t skipped_bytes;   // bytes outside any packet
+    uint64_t bad_headers;     // magic followed by an impossible header
+    uint64_t bad_lines;       // RLE payload that does not decode to 64 bytes
+    uint64_t dup_lines;       // line already seen in its frame
+    uint64_t late_lines;      // line for a frame already emitted
+    uint64_t frames_complete;
+    uint64_t frames_partial;
+    uint64_t frames_dropped;  // emitted but overwritten before being taken
+    uint64_t aux_dropped;     // out-of-band packets overwritten before being taken
+    uint64_t crc_ok;
+    uint64_t crc_bad;
+    uint64_t crc_incomplete;  // frame end for a frame that was not complete
+} ebd_assembler_counters_t;
+
+EBD_HOST_API int ebd_assembler_open(const ebd_assembler_config_t *cfg, ebd_assembler_t **out);
+EBD_HOST_API void ebd_assembler_close(ebd_assembler_t *a);
+// Parse len bytes of stream; now_us is the caller's clock (for timeouts and
+// end_rx_us). len may be 0 to just run the timeouts.
+EBD_HOST_API void ebd_assembler_feed(ebd_assembler_t *a, const uint8_t *data, size_t len,
+                                     uint64_t now_us);
+// Emit every frame still assembling (at the end of a capture).
+EBD_HOST_API void ebd_assembler_flush(ebd_assembler_t *a);
+// Take the oldest emitted frame: 1 if out was filled, 0 if none. out's
+// buffers stay valid until the next call.
+EBD_HOST_API int ebd_assembler_next(ebd_assembler_t *a, ebd_frame_t *out);
+EBD_HOST_API int ebd_assembler_next_aux(ebd_assembler_t *a, ebd_aux_packet_t *out);
+EBD_HOST_API void ebd_assembler_get_counters(const ebd_assembler_t *a,
+                                             ebd_assembler_counters_t *out);
+
+// ---- 1 bpp conversion (convert.cpp) ----
+//
+// Expand n bytes of packed pixels (MSB first, 1 = white, e.g. a whole
+// ebd_frame_t.bits) in one call. SSE2/AVX2/NEON kernels with a scalar
+// fallback; the best one the CPU runs is picked on first use, or the one
+// named in $EBD_CONVERT_IMPL. Output must not overlap the input.
+
+// 8 bytes per input byte: 0x00 black, 0xFF white (ffmpeg gray, PGM P5).
+EBD_HOST_API void ebd_convert_gray8(const uint8_t *src, size_t n, uint8_t *dst);
+// 32 bytes per input byte: R, G, B, A per pixel, A = 0xFF (canvas ImageData).
+EBD_HOST_API void ebd_convert_rgba(const uint8_t *src, size_t n, uint8_t *dst);
+// 1 byte per input byte, inverted: PBM P4 and ffmpeg monow use 1 = black.
+EBD_HOST_API void ebd_convert_pbm(const uint8_t *src, size_t n, uint8_t *dst);
+// Kernel set in use: "avx2", "sse2", "neon" or "scalar".
+EBD_HOST_API const char *ebd_convert_impl(void);
+// The index'th kernel set this CPU runs, best first; NULL past the end.
+EBD_HOST_API const char *ebd_convert_impl_name(unsigned index);
+// Switch kernel sets (NULL = best). EBD_HOST_ERR_UNSUPPORTED if this build or
+// CPU lacks it. Not thread safe against conversions running at the time.
+EBD_HOST_API int ebd_convert_select(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
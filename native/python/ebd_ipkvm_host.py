@@ -0,0 +1,382 @@
+"""ctypes bindings for the native host library (native/README.md).
+
+Both Python hosts import this module when it is on the path and the shared
+library can be found; they fall back to pyusb and their own packet parsing
+otherwise. The library is looked up in $EBD_IPKVM_HOST_LIB, then native/build/
+next to this file.
+"""
+
+from __future__ import annotations
+
+import ctypes
+import os
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterator, Optional, Tuple
+
+ERR_UNSUPPORTED = -1
+ERR_NOT_FOUND = -2
+ERR_TIMEOUT = -5
+ERR_GONE = -8
+
+FRAME_LINES = 342
+FRAME_LINE_BYTES = 64
+FRAME_BYTES = FRAME_LINES * FRAME_LINE_BYTES
+AUX_PAYLOAD_MAX = 256
+
+FRAME_COMPLETE = 0x01
+FRAME_END = 0x02
+FRAME_DEVICE_CRC = 0x04
+FRAME_CRC_OK = 0x08
+FRAME_CRC_BAD = 0x10
+FRAME_EVICTED = 0x20
+FRAME_TIMED_OUT = 0x40
+
+_NATIVE_DIR = Path(__file__).resolve().parent.parent
+_LIB_NAMES = ("libebd_ipkvm_host.so", "libebd_ipkvm_host.dylib")
+
+
+class IngestConfig(ctypes.Structure):
+    _fields_ = [
+        ("transfers", ctypes.c_uint32),
+        ("transfer_bytes", ctypes.c_uint32),
+        ("ring_bytes", ctypes.c_uint32),
+    ]
+
+
+class IngestCounters(ctypes.Structure):
+    _fields_ = [
+        ("bytes", ctypes.c_uint64),
+        ("transfers", ctypes.c_uint64),
+        ("empty", ctypes.c_uint64),
+        ("stalls", ctypes.c_uint64),
+        ("errors", ctypes.c_uint64),
+        ("dropped", ctypes.c_uint64),
+        ("dropped_bytes", ctypes.c_uint64),
+        ("ring_used", ctypes.c_uint32),
+        ("ring_high", ctypes.c_uint32),
+    ]
+
+
+class AssemblerConfig(ctypes.Structure):
+    _fields_ = [
+        ("slots", ctypes.c_uint32),
+        ("timeout_ms", ctypes.c_uint32),
+    ]
+
+
+class FrameInfo(ctypes.Structure):
+    _fields_ = [
+        ("bits", ctypes.c_void_p),
+        ("line_seen", ctypes.c_void_p),
+        ("frame_id", ctypes.c_uint32),
+        ("flags", ctypes.c_uint32),
+        ("lines", ctypes.c_uint32),
+        ("payload_bytes", ctypes.c_uint32),
+        ("rle_lines", ctypes.c_uint32),
+        ("vsync_us", ctypes.c_uint32),
+        ("first_line_us", ctypes.c_uint32),
+        ("last_line_us", ctypes.c_uint32),
+        ("device_crc", ctypes.c_uint32),
+        ("host_crc", ctypes.c_uint32),
+        ("end_rx_us", ctypes.c_uint64),
+    ]
+
+
+class AuxPacket(ctypes.Structure):
+    _fields_ = [
+        ("frame_id", ctypes.c_uint16),
+        ("line_id", ctypes.c_uint16),
+        ("length_flags", ctypes.c_uint16),
+        ("len", ctypes.c_uint16),
+        ("payload", ctypes.c_uint8 * AUX_PAYLOAD_MAX),
+    ]
+
+
+class AssemblerCounters(ctypes.Structure):
+    _fields_ = [
+        (name, ctypes.c_uint64)
+        for name in (
+            "bytes", "packets", "skipped_bytes", "bad_headers", "bad_lines", "dup_lines",
+            "late_lines", "frames_complete", "frames_partial", "frames_dropped",
+            "aux_dropped", "crc_ok", "crc_bad", "crc_incomplete",
+        )
+    ]
+
+
+class NativeError(RuntimeError):
+    def __init__(self, code: int) -> None:
+        super().__init__(strerror(code))
+        self.code = code
+
+
+def _find_library() -> Optional[Path]:
+    env = os.environ.get("EBD_IPKVM_HOST_LIB")
+    if env:
+        return Path(env)
+    for name in _LIB_NAMES:
+        path = _NATIVE_DIR / "build" / name
+        if path.exists():
+            return path
+    return None
+
+
+def _load() -> Optional[ctypes.CDLL]:
+    path = _find_library()
+    if path is None:
+        return None
+    try:
+        lib = ctypes.CDLL(str(path))
+    except OSError:
+        return None
+    vp = ctypes.c_void_p
+    lib.ebd_host_strerror.argtypes = [ctypes.c_int]
+    lib.ebd_host_strerror.restype = ctypes.c_char_p
+    lib.ebd_ingest_open.argtypes = [
+        ctypes.c_uint16, ctypes.c_uint16, ctypes.POINTER(IngestConfig), ctypes.POINTER(vp)
+    ]
+    lib.ebd_ingest_open.restype = ctypes.c_int
+    lib.ebd_ingest_close.argtypes = [vp]
+    lib.ebd_ingest_close.restype = None
+    lib.ebd_ingest_read.argtypes = [vp, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_uint32]
+    lib.ebd_ingest_read.restype = ctypes.c_long
+    lib.ebd_ingest_write.argtypes = [vp, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint32]
+    lib.ebd_ingest_write.restype = ctypes.c_long
+    lib.ebd_ingest_get_counters.argtypes = [vp, ctypes.POINTER(IngestCounters)]
+    lib.ebd_ingest_get_counters.restype = None
+    lib.ebd_assembler_open.argtypes = [ctypes.POINTER(AssemblerConfig), ctypes.POINTER(vp)]
+    lib.ebd_assembler_open.restype = ctypes.c_int
+    lib.ebd_assembler_close.argtypes = [vp]
+    lib.ebd_assembler_close.restype = None
+    lib.ebd_assembler_feed.argtypes = [vp, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint64]
+    lib.ebd_assembler_feed.restype = None
+    lib.ebd_assembler_flush.argtypes = [vp]
+    lib.ebd_assembler_flush.restype = None
+    lib.ebd_assembler_next.argtypes = [vp, ctypes.POINTER(FrameInfo)]
+    lib.ebd_assembler_next.restype = ctypes.c_int
+    lib.ebd_assembler_next_aux.argtypes = [vp, ctypes.POINTER(AuxPacket)]
+    lib.ebd_assembler_next_aux.restype = ctypes.c_int
+    lib.ebd_assembler_get_counters.argtypes = [vp, ctypes.POINTER(AssemblerCounters)]
+    lib.ebd_assembler_get_counters.restype = None
+    for name in ("ebd_convert_gray8", "ebd_convert_rgba", "ebd_convert_pbm"):
+        fn = getattr(lib, name)
+        fn.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_void_p]
+        fn.restype = None
+    lib.ebd_convert_impl.argtypes = []
+    lib.ebd_convert_impl.restype = ctypes.c_char_p
+    return lib
+
+
+_lib = _load()
+
+
+def available() -> bool:
+    return _lib is not None
+
+
+def library_path() -> Optional[Path]:
+    return _find_library() if _lib is not None else None
+
+
+def strerror(code: int) -> str:
+    if _lib is None:
+        return f"native library not loaded (error {code})"
+    return _lib.ebd_host_strerror(code).decode("ascii", errors="replace")
+
+
+class BulkIngest:
+    """Bulk IN stream kept busy by libusb async transfers on a native thread.
+
+    read() has the same contract as the pyusb read helpers: bytes, empty on
+    timeout. It raises NativeError once the device is gone.
+    """
+
+    def __init__(
+        self,
+        vid: int,
+        pid: int,
+        *,
+        transfers: int = 0,
+        transfer_bytes: int = 0,
+        ring_bytes: int = 0,
+        read_bytes: int = 65536,
+    ) -> None:
+        if _lib is None:
+            raise NativeError(ERR_UNSUPPORTED)
+        cfg = IngestConfig(transfers, transfer_bytes, ring_bytes)
+        handle = ctypes.c_void_p()
+        rc = _lib.ebd_ingest_open(vid, pid, ctypes.byref(cfg), ctypes.byref(handle))
+        if rc != 0:
+            raise NativeError(rc)
+        self._handle: Optional[ctypes.c_void_p] = handle
+        self._buf = ctypes.create_string_buffer(read_bytes)
+
+    def read(self, timeout_s: float) -> bytes:
+        if self._handle is None:
+            return b""
+        n = _lib.ebd_ingest_read(
+            self._handle, self._buf, len(self._buf), max(0, int(timeout_s * 1000))
+        )
+        if n < 0:
+            raise NativeError(n)
+        return ctypes.string_at(self._buf, n)
+
+    def write(self, data: bytes, timeout_s: float = 0.1) -> int:
+        if self._handle is None:
+            return ERR_GONE
+        return _lib.ebd_ingest_write(self._handle, data, len(data), int(timeout_s * 1000))
+
+    def counters(self) -> Dict[str, int]:
+        c = IngestCounters()
+        if self._handle is not None:
+            _lib.ebd_ingest_get_counters(self._handle, ctypes.byref(c))
+        return {name: getattr(c, name) for name, _ in IngestCounters._fields_}
+
+    def close(self) -> None:
+        if self._handle is not None:
+            _lib.ebd_ingest_close(self._handle)
+            self._handle = None
+
+    def __enter__(self) -> "BulkIngest":
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.close()
+
+
+@dataclass
+class Frame:
+    """One emitted frame: bits is 342 lines of 64 bytes (1 = white), whole
+    even when partial, with the missing lines carried from the previous frame.
+    """
+
+    frame_id: int
+    flags: int
+    lines: int
+    payload_bytes: int
+    rle_lines: int
+    vsync_us: int
+    first_line_us: int
+    last_line_us: int
+    device_crc: int
+    host_crc: int
+    end_rx_us: int
+    bits: bytes
+    line_seen: bytes
+
+    @property
+    def complete(self) -> bool:
+        return bool(self.flags & FRAME_COMPLETE)
+
+    @property
+    def has_end(self) -> bool:
+        return bool(self.flags & FRAME_END)
+
+    @property
+    def crc_bad(self) -> bool:
+        return bool(self.flags & FRAME_CRC_BAD)
+
+    def row(self, line: int) -> bytes:
+        return self.bits[line * FRAME_LINE_BYTES:(line + 1) * FRAME_LINE_BYTES]
+
+
+class FrameAssembler:
+    """Packet parser and frame assembler over the raw bulk IN byte stream.
+
+    feed() takes chunks of any size; frames() and aux() drain what they
+    completed. Memory is fixed however lossy the stream is.
+    """
+
+    def __init__(self, *, slots: int = 0, timeout_ms: int = 0) -> None:
+        if _lib is None:
+            raise NativeError(ERR_UNSUPPORTED)
+        cfg = AssemblerConfig(slots, timeout_ms)
+        handle = ctypes.c_void_p()
+        rc = _lib.ebd_assembler_open(ctypes.byref(cfg), ctypes.byref(handle))
+        if rc != 0:
+            raise NativeError(rc)
+        self._handle: Optional[ctypes.c_void_p] = handle
+        self._info = FrameInfo()
+        self._aux = AuxPacket()
+
+    def feed(self, data: bytes, now_us: int) -> None:
+        if self._handle is not None:
+            _lib.ebd_assembler_feed(self._handle, data, len(data), now_us)
+
+    def flush(self) -> None:
+        if self._handle is not None:
+            _lib.ebd_assembler_flush(self._handle)
+
+    def frames(self) -> Iterator[Frame]:
+        info = self._info
+        while self._handle is not None and _lib.ebd_assembler_next(self._handle, ctypes.byref(info)):
+            yield Frame(
+                frame_id=info.frame_id,
+                flags=info.flags,
+                lines=info.lines,
+                payload_bytes=info.payload_bytes,
+                rle_lines=info.rle_lines,
+                vsync_us=info.vsync_us,
+                first_line_us=info.first_line_us,
+                last_line_us=info.last_line_us,
+                device_crc=info.device_crc,
+                host_crc=info.host_crc,
+                end_rx_us=info.end_rx_us,
+                bits=ctypes.string_at(info.bits, FRAME_BYTES),
+                line_seen=ctypes.string_at(info.line_seen, FRAME_LINES),
+            )
+
+    def aux(self) -> Iterator[Tuple[int, int, int, bytes]]:
+        """Out-of-band packets other than frame end: (frame_id, line_id, length_flags, payload)."""
+        pkt = self._aux
+        while self._handle is not None and _lib.ebd_assembler_next_aux(self._handle, ctypes.byref(pkt)):
+            payload = ctypes.string_at(ctypes.addressof(pkt.payload), pkt.len)
+            yield pkt.frame_id, pkt.line_id, pkt.length_flags, payload
+
+    def counters(self) -> Dict[str, int]:
+        c = AssemblerCounters()
+        if self._handle is not None:
+            _lib.ebd_assembler_get_counters(self._handle, ctypes.byref(c))
+        return {name: getattr(c, name) for name, _ in AssemblerCounters._fields_}
+
+    def close(self) -> None:
+        if self._handle is not None:
+            _lib.ebd_assembler_close(self._handle)
+            self._handle = None
+
+    def __enter__(self) -> "FrameAssembler":
+        return self
+
+    def __exit__(self, *exc: object) -> None:
+        self.close()
+
+
+def _convert(name: str, bits: bytes, out_per_byte: int) -> bytearray:
+    if _lib is None:
+        raise NativeError(ERR_UNSUPPORTED)
+    out = bytearray(len(bits) * out_per_byte)
+    if bits:
+        getattr(_lib, name)(bits, len(bits), (ctypes.c_char * len(out)).from_buffer(out))
+    return out
+
+
+def convert_impl() -> str:
+    """Conversion kernel set in use: "avx2", "sse2", "neon" or "scalar"."""
+    if _lib is None:
+        raise NativeError(ERR_UNSUPPORTED)
+    return _lib.ebd_convert_impl().decode("ascii")
+
+
+def expand_gray8(bits: bytes) -> bytearray:
+    """Packed 1 bpp (1 = white) to one byte per pixel, 0x00 or 0xFF."""
+    return _convert("ebd_convert_gray8", bits, 8)
+
+
+def expand_rgba(bits: bytes) -> bytearray:
+    """Packed 1 bpp (1 = white) to RGBA, four bytes per pixel, opaque."""
+    return _convert("ebd_convert_rgba", bits, 32)
+
+
+def invert_pbm(bits: bytes) -> bytearray:
+    """Packed 1 bpp (1 = white) to PBM/monow order (1 = black)."""
+    return _convert("ebd_convert_pbm", bits, 1)
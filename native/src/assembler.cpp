@@ -0,0 +1,400 @@
+#include "ebd_ipkvm_host.h"
+
+#include "stream_parser.h"
+
+#include <array>
+#include <memory>
+#include <new>
+#include <vector>
+
+#define ASSEMBLER_SLOTS_DEFAULT 4u
+#define ASSEMBLER_SLOTS_MIN 4u
+#define ASSEMBLER_TIMEOUT_MS_DEFAULT 50u
+#define ASSEMBLER_ASSEMBLING 2u // frames open at once
+#define ASSEMBLER_RECENT 8u     // emitted frame_ids remembered, to spot late lines
+#define ASSEMBLER_AUX_QUEUE 8u
+
+static_assert(EBD_FRAME_LINES == ebd::kLines, "frame height");
+static_assert(EBD_FRAME_LINE_BYTES == ebd::kLineBytes, "line size");
+static_assert(EBD_AUX_PAYLOAD_MAX == ebd::kAuxPayloadMax, "aux payload size");
+
+namespace {
+
+uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+// zlib/IEEE CRC-32, as the device's DMA sniffer computes it, eight bytes per
+// step (slicing-by-8): a whole frame every time one completes.
+struct Crc32Table {
+    uint32_t t[8][256];
+    constexpr Crc32Table() : t() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+constexpr Crc32Table kCrc32;
+
+uint32_t crc32(const uint8_t *p, size_t n) {
+    const auto &t = kCrc32.t;
+    uint32_t c = 0xFFFFFFFFu;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint32_t lo = c ^ le32(p);
+        uint32_t hi = le32(p + 4);
+        c = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; n > 0; p++, n--) {
+        c = t[0][(c ^ *p) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+// RLE line payload: (count, byte) pairs, count 1..255, exactly 64 bytes out.
+bool decode_rle(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t out = 0;
+    for (size_t i = 0; i < len; i += 2) {
+        uint8_t count = src[i];
+        if (count == 0 || out + count > ebd::kLineBytes) {
+            return false;
+        }
+        std::memset(dst + out, src[i + 1], count);
+        out += count;
+    }
+    return out == ebd::kLineBytes;
+}
+
+enum class SlotState { Free, Assembling, Ready, Out };
+
+struct Slot {
+    std::unique_ptr<uint8_t[]> bits{new uint8_t[ebd::kFrameBytes]};
+    uint8_t seen[ebd::kLines];
+    SlotState state = SlotState::Free;
+    uint64_t opened = 0; // order frames were opened in
+    uint64_t last_rx_us = 0;
+    ebd_frame_t info{};
+};
+
+} // namespace
+
+struct ebd_assembler {
+    ebd_assembler(uint32_t nslots, uint32_t timeout_ms)
+        : slots(nslots), ready(nslots), timeout_us((uint64_t)timeout_ms * 1000) {}
+
+    ebd::StreamParser parser;
+    std::vector<Slot> slots;
+    // Emitted frames waiting to be taken, oldest first (indices into slots).
+    std::vector<uint32_t> ready;
+    uint32_t ready_head = 0;
+    uint32_t ready_count = 0;
+    int out = -1; // slot handed out by the last ebd_assembler_next()
+    uint64_t timeout_us;
+    uint64_t opened = 0;
+
+    // Last image emitted, for the lines a partial frame never got.
+    std::array<uint8_t, ebd::kFrameBytes> screen{};
+    std::array<uint16_t, ASSEMBLER_RECENT> recent{};
+    uint32_t recent_count = 0;
+    uint32_t recent_next = 0;
+
+    std::array<ebd_aux_packet_t, ASSEMBLER_AUX_QUEUE> aux{};
+    uint32_t aux_head = 0;
+    uint32_t aux_count = 0;
+
+    ebd_assembler_counters_t c{};
+
+    bool recently_emitted(uint16_t frame_id) const {
+        for (uint32_t i = 0; i < recent_count; i++) {
+            if (recent[i] == frame_id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Slot *assembling(uint16_t frame_id) {
+        for (Slot &s : slots) {
+            if (s.state == SlotState::Assembling && s.info.frame_id == frame_id) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    Slot *oldest_assembling(unsigned *count) {
+        Slot *oldest = nullptr;
+        *count = 0;
+        for (Slot &s : slots) {
+            if (s.state == SlotState::Assembling) {
+                (*count)++;
+                if (!oldest || s.opened < oldest->opened) {
+                    oldest = &s;
+                }
+            }
+        }
+        return oldest;
+    }
+
+    void drop_oldest_ready() {
+        Slot &s = slots[ready[ready_head]];
+        s.state = SlotState::Free;
+        ready_head = (ready_head + 1) % ready.size();
+        ready_count--;
+        c.frames_dropped++;
+    }
+
+    void emit(Slot &s, uint32_t why) {
+        ebd_frame_t &f = s.info;
+        f.flags |= why;
+        if (f.lines == ebd::kLines) {
+            f.flags |= EBD_FRAME_COMPLETE;
+            f.host_crc = crc32(s.bits.get(), ebd::kFrameBytes);
+            if (f.flags & EBD_FRAME_DEVICE_CRC) {
+                f.flags |= f.host_crc == f.device_crc ? EBD_FRAME_CRC_OK : EBD_FRAME_CRC_BAD;
+                if (f.flags & EBD_FRAME_CRC_OK) {
+                    c.crc_ok++;
+                } else {
+                    c.crc_bad++;
+                }
+            }
+            c.frames_complete++;
+        } else {
+            for (unsigned line = 0; line < ebd::kLines; line++) {
+                if (!s.seen[line]) {
+                    std::memcpy(&s.bits[line * ebd::kLineBytes],
+                                &screen[line * ebd::kLineBytes], ebd::kLineBytes);
+                }
+            }
+            if (f.flags & EBD_FRAME_DEVICE_CRC) {
+                c.crc_incomplete++;
+            }
+            c.frames_partial++;
+        }
+        std::memcpy(screen.data(), s.bits.get(), ebd::kFrameBytes);
+
+        recent[recent_next] = (uint16_t)f.frame_id;
+        recent_next = (recent_next + 1) % ASSEMBLER_RECENT;
+        if (recent_count < ASSEMBLER_RECENT) {
+            recent_count++;
+        }
+
+        if (ready_count == ready.size()) {
+            drop_oldest_ready();
+        }
+        ready[(ready_head + ready_count) % ready.size()] = (uint32_t)(&s - slots.data());
+        ready_count++;
+        s.state = SlotState::Ready;
+    }
+
+    Slot *open_frame(uint16_t frame_id, uint64_t now_us) {
+        unsigned count;
+        oldest_assembling(&count);
+        // A frame that already has every line only waits for its frame end,
+        // which is not coming once the next frame has started.
+        for (Slot &s : slots) {
+            if (s.state == SlotState::Assembling && s.info.lines == ebd::kLines) {
+                emit(s, 0);
+                count--;
+            }
+        }
+        if (count >= ASSEMBLER_ASSEMBLING) {
+            emit(*oldest_assembling(&count), EBD_FRAME_EVICTED);
+        }
+        Slot *free = nullptr;
+        for (Slot &s : slots) {
+            if (s.state == SlotState::Free) {
+                free = &s;
+                break;
+            }
+        }
+        if (!free) {
+            // Nobody is taking frames: recycle the oldest one waiting.
+            uint32_t idx = ready[ready_head];
+            drop_oldest_ready();
+            free = &slots[idx];
+        }
+        free->state = SlotState::Assembling;
+        free->opened = ++opened;
+        free->last_rx_us = now_us;
+        std::memset(free->seen, 0, sizeof(free->seen));
+        free->info = ebd_frame_t{};
+        free->info.frame_id = frame_id;
+        return free;
+    }
+
+    void on_line(const ebd::Packet &p, uint64_t now_us) {
+        Slot *s = assembling(p.frame_id);
+        if (!s) {
+            if (recently_emitted(p.frame_id)) {
+                c.late_lines++;
+                return;
+            }
+            s = open_frame(p.frame_id, now_us);
+        }
+        s->last_rx_us = now_us;
+        if (s->seen[p.line_id]) {
+            c.dup_lines++;
+            return;
+        }
+        uint8_t *dst = &s->bits[p.line_id * ebd::kLineBytes];
+        bool rle = p.length_flags & ebd::kFlagRle;
+        if (rle) {
+            if (!decode_rle(p.payload, p.len, dst)) {
+                c.bad_lines++;
+                return;
+            }
+            s->info.rle_lines++;
+        } else {
+            std::memcpy(dst, p.payload, ebd::kLineBytes);
+        }
+        s->seen[p.line_id] = 1;
+        s->info.lines++;
+        s->info.payload_bytes += p.len;
+    }
+
+    void on_frame_end(const ebd::Packet &p, uint64_t now_us) {
+        Slot *s = assembling(p.frame_id);
+        if (!s) {
+            c.crc_incomplete++; // no line of it arrived, or it was emitted early
+            return;
+        }
+        ebd_frame_t &f = s->info;
+        if (p.len >= 12) {
+            f.vsync_us = le32(p.payload);
+            f.first_line_us = le32(p.payload + 4);
+            f.last_line_us = le32(p.payload + 8);
+            f.end_rx_us = now_us;
+            f.flags |= EBD_FRAME_END;
+        }
+        if (p.len >= 16) {
+            f.device_crc = le32(p.payload + 12);
+            f.flags |= EBD_FRAME_DEVICE_CRC;
+        }
+        emit(*s, 0);
+    }
+
+    void on_aux(const ebd::Packet &p) {
+        if (aux_count == aux.size()) {
+            aux_head = (aux_head + 1) % aux.size();
+            aux_count--;
+            c.aux_dropped++;
+        }
+        ebd_aux_packet_t &a = aux[(aux_head + aux_count) % aux.size()];
+        a.frame_id = p.frame_id;
+        a.line_id = p.line_id;
+        a.length_flags = p.length_flags;
+        a.len = p.len;
+        std::memcpy(a.payload, p.payload, p.len);
+        aux_count++;
+    }
+
+    void expire(uint64_t now_us) {
+        for (Slot &s : slots) {
+            if (s.state == SlotState::Assembling && now_us > s.last_rx_us + timeout_us) {
+                emit(s, EBD_FRAME_TIMED_OUT);
+            }
+        }
+    }
+};
+
+extern "C" int ebd_assembler_open(const ebd_assembler_config_t *cfg, ebd_assembler_t **out) {
+    if (!out) {
+        return EBD_HOST_ERR_ARG;
+    }
+    *out = nullptr;
+    uint32_t slots = cfg && cfg->slots ? cfg->slots : ASSEMBLER_SLOTS_DEFAULT;
+    if (slots < ASSEMBLER_SLOTS_MIN) {
+        slots = ASSEMBLER_SLOTS_MIN;
+    }
+    uint32_t timeout_ms = cfg && cfg->timeout_ms ? cfg->timeout_ms : ASSEMBLER_TIMEOUT_MS_DEFAULT;
+    *out = new (std::nothrow) ebd_assembler(slots, timeout_ms);
+    return *out ? EBD_HOST_OK : EBD_HOST_ERR_ARG;
+}
+
+extern "C" void ebd_assembler_close(ebd_assembler_t *a) {
+    delete a;
+}
+
+extern "C" void ebd_assembler_feed(ebd_assembler_t *a, const uint8_t *data, size_t len,
+                                   uint64_t now_us) {
+    if (!a || (!data && len)) {
+        return;
+    }
+    a->c.bytes += len;
+    a->parser.feed(data, len, [a, now_us](const ebd::Packet &p) {
+        if (p.line_id < ebd::kLines) {
+            a->on_line(p, now_us);
+        } else if (p.line_id == ebd::kLineFrameEnd) {
+            a->on_frame_end(p, now_us);
+        } else {
+            a->on_aux(p);
+        }
+    });
+    a->expire(now_us);
+}
+
+extern "C" void ebd_assembler_flush(ebd_assembler_t *a) {
+    if (!a) {
+        return;
+    }
+    unsigned count;
+    while (Slot *s = a->oldest_assembling(&count)) {
+        a->emit(*s, EBD_FRAME_TIMED_OUT);
+    }
+    a->parser.reset();
+}
+
+extern "C" int ebd_assembler_next(ebd_assembler_t *a, ebd_frame_t *out) {
+    if (!a || !out) {
+        return 0;
+    }
+    if (a->out >= 0) {
+        a->slots[a->out].state = SlotState::Free;
+        a->out = -1;
+    }
+    if (a->ready_count == 0) {
+        return 0;
+    }
+    uint32_t idx = a->ready[a->ready_head];
+    a->ready_head = (a->ready_head + 1) % a->ready.size();
+    a->ready_count--;
+    Slot &s = a->slots[idx];
+    s.state = SlotState::Out;
+    a->out = (int)idx;
+    *out = s.info;
+    out->bits = s.bits.get();
+    out->line_seen = s.seen;
+    return 1;
+}
+
+extern "C" int ebd_assembler_next_aux(ebd_assembler_t *a, ebd_aux_packet_t *out) {
+    if (!a || !out || a->aux_count == 0) {
+        return 0;
+    }
+    *out = a->aux[a->aux_head];
+    a->aux_head = (a->aux_head + 1) % a->aux.size();
+    a->aux_count--;
+    return 1;
+}
+
+extern "C" void ebd_assembler_get_counters(const ebd_assembler_t *a,
+                                           ebd_assembler_counters_t *out) {
+    if (!a || !out) {
+        return;
+    }
+    *out = a->c;
+    out->packets = a->parser.packets;
+    out->skipped_bytes = a->parser.skipped_bytes;
+    out->bad_headers = a->parser.bad_headers;
+}
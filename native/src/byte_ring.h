@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ebd {
+
+// Single-producer/single-consumer byte ring. The producer only moves head and
+// the consumer only moves tail, so neither side takes a lock; sizes are powers
+// of two and the indices run free.
+class ByteRing {
+public:
+    explicit ByteRing(size_t size) : buf_(new uint8_t[size]), size_(size), mask_(size - 1) {}
+
+    size_t size() const { return size_; }
+
+    size_t used() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Producer: all of src or nothing.
+    bool push(const uint8_t *src, size_t n) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        size_t t = tail_.load(std::memory_order_acquire);
+        if (size_ - (h - t) < n) {
+            return false;
+        }
+        size_t at = h & mask_;
+        size_t first = n < size_ - at ? n : size_ - at;
+        std::memcpy(&buf_[at], src, first);
+        std::memcpy(&buf_[0], src + first, n - first);
+        head_.store(h + n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: up to cap bytes.
+    size_t pop(uint8_t *dst, size_t cap) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t h = head_.load(std::memory_order_acquire);
+        size_t n = h - t < cap ? h - t : cap;
+        size_t at = t & mask_;
+        size_t first = n < size_ - at ? n : size_ - at;
+        std::memcpy(dst, &buf_[at], first);
+        std::memcpy(dst + first, &buf_[0], n - first);
+        tail_.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> buf_;
+    size_t size_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+inline size_t round_up_pow2(size_t v) {
+    size_t p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace ebd
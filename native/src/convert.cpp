@@ -0,0 +1,319 @@
+#include "ebd_ipkvm_host.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONVERT_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Packed 1 bpp (MSB first, 1 = white) to display formats. Pixels are only
+// ever 0 or 255, so each kernel turns a bit into a byte mask: broadcast the
+// source byte across a vector, AND it with one bit per lane, and compare.
+
+namespace {
+
+typedef void (*ConvertFn)(const uint8_t *src, size_t n, uint8_t *dst);
+
+struct Impl {
+    const char *name;
+    ConvertFn gray8;
+    ConvertFn rgba;
+    ConvertFn pbm;
+};
+
+// ---- scalar ----
+
+void gray8_scalar(const uint8_t *src, size_t n, uint8_t *dst) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = src[i];
+        for (int bit = 0; bit < 8; bit++) {
+            dst[i * 8 + bit] = (b & (0x80 >> bit)) ? 0xFF : 0x00;
+        }
+    }
+}
+
+void rgba_scalar(const uint8_t *src, size_t n, uint8_t *dst) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = src[i];
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t v = (b & (0x80 >> bit)) ? 0xFF : 0x00;
+            uint8_t *px = &dst[(i * 8 + bit) * 4];
+            px[0] = v;
+            px[1] = v;
+            px[2] = v;
+            px[3] = 0xFF;
+        }
+    }
+}
+
+// PBM (P4) stores 1 = black.
+void pbm_scalar(const uint8_t *src, size_t n, uint8_t *dst) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (uint8_t)~src[i];
+    }
+}
+
+const Impl kScalar = {"scalar", gray8_scalar, rgba_scalar, pbm_scalar};
+
+#if CONVERT_X86
+
+// ---- SSE2 (baseline on x86-64) ----
+
+// Pixels 16k..16k+15 of 16 source bytes as 0x00/0xFF, k = 0..7. SSE2 has no
+// byte shuffle, so each byte is widened to 8 lanes by unpacking with itself.
+inline void gray8_sse2_16(__m128i x, uint8_t *dst) {
+    const __m128i bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1,
+                                       (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    __m128i b2[2] = {_mm_unpacklo_epi8(x, x), _mm_unpackhi_epi8(x, x)};
+    for (int h = 0; h < 2; h++) {
+        __m128i b4[2] = {_mm_unpacklo_epi16(b2[h], b2[h]), _mm_unpackhi_epi16(b2[h], b2[h])};
+        for (int q = 0; q < 2; q++) {
+            __m128i b8[2] = {_mm_unpacklo_epi32(b4[q], b4[q]), _mm_unpackhi_epi32(b4[q], b4[q])};
+            for (int e = 0; e < 2; e++) {
+                __m128i v = _mm_cmpeq_epi8(_mm_and_si128(b8[e], bits), bits);
+                _mm_storeu_si128((__m128i *)(dst + (h * 4 + q * 2 + e) * 16), v);
+            }
+        }
+    }
+}
+
+void gray8_sse2(const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        gray8_sse2_16(_mm_loadu_si128((const __m128i *)(src + i)), dst + i * 8);
+    }
+    gray8_scalar(src + i, n - i, dst + i * 8);
+}
+
+// 16 gray pixels to 64 RGBA bytes: (g, g, g, 0xFF) per pixel.
+inline void rgba_sse2_16(__m128i g, uint8_t *dst) {
+    const __m128i ff = _mm_set1_epi8((char)0xFF);
+    __m128i gg_lo = _mm_unpacklo_epi8(g, g);
+    __m128i gg_hi = _mm_unpackhi_epi8(g, g);
+    __m128i ga_lo = _mm_unpacklo_epi8(g, ff);
+    __m128i ga_hi = _mm_unpackhi_epi8(g, ff);
+    _mm_storeu_si128((__m128i *)(dst + 0), _mm_unpacklo_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(gg_hi, ga_hi));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(gg_hi, ga_hi));
+}
+
+void rgba_sse2(const uint8_t *src, size_t n, uint8_t *dst) {
+    alignas(16) uint8_t gray[128];
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        gray8_sse2_16(_mm_loadu_si128((const __m128i *)(src + i)), gray);
+        for (int k = 0; k < 8; k++) {
+            rgba_sse2_16(_mm_load_si128((const __m128i *)(gray + k * 16)), dst + (i * 8 + k * 16) * 4);
+        }
+    }
+    rgba_scalar(src + i, n - i, dst + i * 32);
+}
+
+void pbm_sse2(const uint8_t *src, size_t n, uint8_t *dst) {
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, ones));
+    }
+    pbm_scalar(src + i, n - i, dst + i);
+}
+
+const Impl kSse2 = {"sse2", gray8_sse2, rgba_sse2, pbm_sse2};
+
+// ---- AVX2 (picked at run time) ----
+
+#define AVX2 __attribute__((target("avx2")))
+
+// 32 pixels from 4 source bytes: both lanes hold the 4 bytes, and the
+// in-lane shuffle spreads bytes 0-1 over the low lane and 2-3 over the high.
+AVX2 inline __m256i gray8_avx2_4(uint32_t four) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bits = _mm256_setr_epi8(
+        (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1, (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1,
+        (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1, (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)four), spread);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+}
+
+AVX2 void gray8_avx2(const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t four;
+        std::memcpy(&four, src + i, 4);
+        _mm256_storeu_si256((__m256i *)(dst + i * 8), gray8_avx2_4(four));
+    }
+    gray8_scalar(src + i, n - i, dst + i * 8);
+}
+
+// Unpacks stay within 128-bit lanes, so the four results hold pixels
+// (0-3 | 16-19), (4-7 | 20-23), ... and are put back in order on store.
+AVX2 void rgba_avx2(const uint8_t *src, size_t n, uint8_t *dst) {
+    const __m256i ff = _mm256_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t four;
+        std::memcpy(&four, src + i, 4);
+        __m256i g = gray8_avx2_4(four);
+        __m256i gg_lo = _mm256_unpacklo_epi8(g, g);
+        __m256i gg_hi = _mm256_unpackhi_epi8(g, g);
+        __m256i ga_lo = _mm256_unpacklo_epi8(g, ff);
+        __m256i ga_hi = _mm256_unpackhi_epi8(g, ff);
+        __m256i o0 = _mm256_unpacklo_epi16(gg_lo, ga_lo);
+        __m256i o1 = _mm256_unpackhi_epi16(gg_lo, ga_lo);
+        __m256i o2 = _mm256_unpacklo_epi16(gg_hi, ga_hi);
+        __m256i o3 = _mm256_unpackhi_epi16(gg_hi, ga_hi);
+        uint8_t *out = dst + i * 32;
+        _mm256_storeu_si256((__m256i *)(out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 32), _mm256_permute2x128_si256(o2, o3, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 64), _mm256_permute2x128_si256(o0, o1, 0x31));
+        _mm256_storeu_si256((__m256i *)(out + 96), _mm256_permute2x128_si256(o2, o3, 0x31));
+    }
+    rgba_scalar(src + i, n - i, dst + i * 32);
+}
+
+AVX2 void pbm_avx2(const uint8_t *src, size_t n, uint8_t *dst) {
+    const __m256i ones = _mm256_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, ones));
+    }
+    pbm_scalar(src + i, n - i, dst + i);
+}
+
+const Impl kAvx2 = {"avx2", gray8_avx2, rgba_avx2, pbm_avx2};
+
+#endif // CONVERT_X86
+
+#if CONVERT_NEON
+
+// ---- NEON ----
+
+// 16 pixels from 2 source bytes: vtst sets a lane to 0xFF where its bit is set.
+inline uint8x16_t gray8_neon_2(uint8_t b0, uint8_t b1) {
+    static const uint8_t kBits[16] = {0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1,
+                                      0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1};
+    uint8x16_t v = vcombine_u8(vdup_n_u8(b0), vdup_n_u8(b1));
+    return vtstq_u8(v, vld1q_u8(kBits));
+}
+
+void gray8_neon(const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        vst1q_u8(dst + i * 8, gray8_neon_2(src[i], src[i + 1]));
+    }
+    gray8_scalar(src + i, n - i, dst + i * 8);
+}
+
+void rgba_neon(const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint8x16_t g = gray8_neon_2(src[i], src[i + 1]);
+        uint8x16x4_t px = {{g, g, g, vdupq_n_u8(0xFF)}};
+        vst4q_u8(dst + i * 32, px);
+    }
+    rgba_scalar(src + i, n - i, dst + i * 32);
+}
+
+void pbm_neon(const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(dst + i, vmvnq_u8(vld1q_u8(src + i)));
+    }
+    pbm_scalar(src + i, n - i, dst + i);
+}
+
+const Impl kNeon = {"neon", gray8_neon, rgba_neon, pbm_neon};
+
+#endif // CONVERT_NEON
+
+bool impl_supported(const Impl &impl) {
+#if CONVERT_X86
+    if (&impl == &kAvx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)impl;
+    return true;
+}
+
+// Best first.
+const Impl *const kImpls[] = {
+#if CONVERT_X86
+    &kAvx2,
+    &kSse2,
+#endif
+#if CONVERT_NEON
+    &kNeon,
+#endif
+    &kScalar,
+};
+
+const Impl *pick(const char *name) {
+    for (const Impl *impl : kImpls) {
+        if ((!name || std::strcmp(name, impl->name) == 0) && impl_supported(*impl)) {
+            return impl;
+        }
+    }
+    return nullptr;
+}
+
+// $EBD_CONVERT_IMPL forces one (for comparing them); otherwise the best the
+// CPU runs.
+const Impl *g_impl = nullptr;
+
+const Impl *impl() {
+    if (!g_impl) {
+        const char *forced = std::getenv("EBD_CONVERT_IMPL");
+        g_impl = forced ? pick(forced) : nullptr;
+        if (!g_impl) {
+            g_impl = pick(nullptr);
+        }
+    }
+    return g_impl;
+}
+
+} // namespace
+
+extern "C" void ebd_convert_gray8(const uint8_t *src, size_t n, uint8_t *dst) {
+    impl()->gray8(src, n, dst);
+}
+
+extern "C" void ebd_convert_rgba(const uint8_t *src, size_t n, uint8_t *dst) {
+    impl()->rgba(src, n, dst);
+}
+
+extern "C" void ebd_convert_pbm(const uint8_t *src, size_t n, uint8_t *dst) {
+    impl()->pbm(src, n, dst);
+}
+
+extern "C" const char *ebd_convert_impl(void) {
+    return impl()->name;
+}
+
+extern "C" int ebd_convert_select(const char *name) {
+    const Impl *chosen = pick(name);
+    if (!chosen) {
+        return EBD_HOST_ERR_UNSUPPORTED;
+    }
+    g_impl = chosen;
+    return EBD_HOST_OK;
+}
+
+extern "C" const char *ebd_convert_impl_name(unsigned index) {
+    unsigned n = 0;
+    for (const Impl *impl : kImpls) {
+        if (impl_supported(*impl) && n++ == index) {
+            return impl->name;
+        }
+    }
+    return nullptr;
+}
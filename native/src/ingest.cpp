@@ -0,0 +1,488 @@
+#include "ebd_ipkvm_host.h"
+
+#include "byte_ring.h"
+
+#if EBD_HOST_LIBUSB
+
+#include <libusb.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define INGEST_TRANSFERS_DEFAULT 8u
+#define INGEST_TRANSFER_BYTES_DEFAULT 16384u
+#define INGEST_RING_BYTES_DEFAULT (1u << 20)
+#define INGEST_PACKET_BYTES 64u // full speed bulk max packet
+#define INGEST_EVENT_POLL_MS 100
+#define INGEST_OUT_BACKSTOP_MS 1000 // past the libusb timeout, then cancel
+
+namespace {
+
+// Heap owned: a writer that gives up on its callback leaves this to on_out.
+struct OutWait {
+    ebd_ingest *ing = nullptr;
+    std::vector<uint8_t> data;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool done = false;
+    bool abandoned = false;
+    libusb_transfer_status status = LIBUSB_TRANSFER_ERROR;
+    int actual = 0;
+};
+
+int map_usb_error(int err) {
+    switch (err) {
+    case LIBUSB_SUCCESS:
+        return EBD_HOST_OK;
+    case LIBUSB_ERROR_ACCESS:
+        return EBD_HOST_ERR_ACCESS;
+    case LIBUSB_ERROR_BUSY:
+        return EBD_HOST_ERR_BUSY;
+    case LIBUSB_ERROR_NO_DEVICE:
+        return EBD_HOST_ERR_GONE;
+    case LIBUSB_ERROR_NOT_FOUND:
+        return EBD_HOST_ERR_NOT_FOUND;
+    case LIBUSB_ERROR_TIMEOUT:
+        return EBD_HOST_ERR_TIMEOUT;
+    default:
+        return EBD_HOST_ERR_USB;
+    }
+}
+
+} // namespace
+
+struct ebd_ingest {
+    explicit ebd_ingest(size_t ring_bytes) : ring(ring_bytes) {}
+
+    libusb_context *ctx = nullptr;
+    libusb_device_handle *handle = nullptr;
+    int intf = -1;
+    uint8_t ep_in = 0;
+    uint8_t ep_out = 0;
+
+    std::vector<libusb_transfer *> xfers;
+    std::vector<std::unique_ptr<uint8_t[]>> bufs;
+    std::vector<libusb_transfer *> halted; // IN transfers parked by a stall
+    ebd::ByteRing ring;
+
+    // Callbacks run only on the event thread: OUT writes are submitted as
+    // async transfers too, so no caller ever handles events itself. in_flight
+    // counts both directions; the thread pumps events until it drops to zero.
+    std::thread events;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> gone{false};
+    std::atomic<int> in_flight{0};
+    std::mutex out_lock;                  // submit/cancel vs. out_xfer
+    libusb_transfer *out_xfer = nullptr; // the write in flight, if any
+
+    std::mutex wait_lock;
+    std::condition_variable wait_cv;
+    std::atomic<bool> reader_waiting{false};
+    std::mutex write_lock;
+
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> transfers{0};
+    std::atomic<uint64_t> empty{0};
+    std::atomic<uint64_t> stalls{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> dropped_bytes{0};
+    std::atomic<uint32_t> ring_high{0};
+};
+
+namespace {
+
+void wake_reader(ebd_ingest *ing) {
+    if (ing->reader_waiting.load()) {
+        { std::lock_guard<std::mutex> hold(ing->wait_lock); }
+        ing->wait_cv.notify_one();
+    }
+}
+
+void LIBUSB_CALL on_in(libusb_transfer *xfer) {
+    auto *ing = static_cast<ebd_ingest *>(xfer->user_data);
+    switch (xfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+        if (xfer->actual_length == 0) {
+            ing->empty.fetch_add(1, std::memory_order_relaxed);
+        } else if (ing->ring.push(xfer->buffer, (size_t)xfer->actual_length)) {
+            ing->bytes.fetch_add((uint64_t)xfer->actual_length, std::memory_order_relaxed);
+            ing->transfers.fetch_add(1, std::memory_order_relaxed);
+            uint32_t used = (uint32_t)ing->ring.used();
+            if (used > ing->ring_high.load(std::memory_order_relaxed)) {
+                ing->ring_high.store(used, std::memory_order_relaxed);
+            }
+            wake_reader(ing);
+        } else {
+            ing->dropped.fetch_add(1, std::memory_order_relaxed);
+            ing->dropped_bytes.fetch_add((uint64_t)xfer->actual_length, std::memory_order_relaxed);
+        }
+        break;
+    case LIBUSB_TRANSFER_STALL:
+        // Cleared (synchronously) from the event loop, not from here.
+        ing->in_flight--;
+        ing->halted.push_back(xfer);
+        return;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        ing->in_flight--;
+        ing->gone.store(true);
+        { std::lock_guard<std::mutex> hold(ing->wait_lock); }
+        ing->wait_cv.notify_all();
+        return;
+    case LIBUSB_TRANSFER_CANCELLED:
+        ing->in_flight--;
+        return;
+    default:
+        ing->errors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    if (ing->stopping.load() || libusb_submit_transfer(xfer) != LIBUSB_SUCCESS) {
+        ing->in_flight--;
+    }
+}
+
+void LIBUSB_CALL on_out(libusb_transfer *xfer) {
+    auto *w = static_cast<OutWait *>(xfer->user_data);
+    ebd_ingest *ing = w->ing; // w may be gone once done is set
+    {
+        std::lock_guard<std::mutex> hold(ing->out_lock);
+        ing->out_xfer = nullptr;
+    }
+    bool abandoned;
+    {
+        std::lock_guard<std::mutex> hold(w->lock);
+        w->status = xfer->status;
+        w->actual = xfer->actual_length;
+        w->done = true;
+        abandoned = w->abandoned;
+        w->cv.notify_one();
+    }
+    if (abandoned) {
+        libusb_free_transfer(xfer);
+        delete w;
+    }
+    ing->in_flight--;
+}
+
+void event_loop(ebd_ingest *ing) {
+    bool cancelled = false;
+    while (ing->in_flight > 0 || !ing->stopping.load()) {
+        timeval tv = {0, INGEST_EVENT_POLL_MS * 1000};
+        libusb_handle_events_timeout_completed(ing->ctx, &tv, nullptr);
+        if (ing->stopping.load() && !cancelled) {
+            for (libusb_transfer *x : ing->xfers) {
+                libusb_cancel_transfer(x); // NOT_FOUND for ones not in flight
+            }
+            // No write is submitted after stopping; see ebd_ingest_write.
+            std::lock_guard<std::mutex> hold(ing->out_lock);
+            if (ing->out_xfer) {
+                libusb_cancel_transfer(ing->out_xfer);
+            }
+            cancelled = true;
+        }
+        if (!ing->halted.empty() && !ing->stopping.load() && !ing->gone.load()) {
+            ing->stalls.fetch_add(1, std::memory_order_relaxed);
+            libusb_clear_halt(ing->handle, ing->ep_in);
+            for (libusb_transfer *x : ing->halted) {
+                if (libusb_submit_transfer(x) == LIBUSB_SUCCESS) {
+                    ing->in_flight++;
+                }
+            }
+            ing->halted.clear();
+        }
+        if (ing->gone.load() && ing->in_flight == 0 && !ing->stopping.load()) {
+            // Nothing left to deliver; idle until close() or a racing write.
+            std::this_thread::sleep_for(std::chrono::milliseconds(INGEST_EVENT_POLL_MS));
+        }
+    }
+}
+
+// Vendor (class 0xFF) interface and its bulk endpoints.
+int find_interface(ebd_ingest *ing) {
+    libusb_config_descriptor *cfg = nullptr;
+    int rc = libusb_get_active_config_descriptor(libusb_get_device(ing->handle), &cfg);
+    if (rc != LIBUSB_SUCCESS) {
+        return map_usb_error(rc);
+    }
+    for (uint8_t i = 0; i < cfg->bNumInterfaces && ing->intf < 0; i++) {
+        if (cfg->interface[i].num_altsetting < 1) {
+            continue;
+        }
+        const libusb_interface_descriptor *alt = &cfg->interface[i].altsetting[0];
+        if (alt->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC) {
+            continue;
+        }
+        ing->intf = alt->bInterfaceNumber;
+        for (uint8_t e = 0; e < alt->bNumEndpoints; e++) {
+            const libusb_endpoint_descriptor *ep = &alt->endpoint[e];
+            if ((ep->bmAttributes & 0x03u) != LIBUSB_TRANSFER_TYPE_BULK) {
+                continue;
+            }
+            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                ing->ep_in = ep->bEndpointAddress;
+            } else {
+                ing->ep_out = ep->bEndpointAddress;
+            }
+        }
+    }
+    libusb_free_config_descriptor(cfg);
+    return ing->intf >= 0 && ing->ep_in ? EBD_HOST_OK : EBD_HOST_ERR_NOT_FOUND;
+}
+
+void teardown(ebd_ingest *ing) {
+    for (libusb_transfer *x : ing->xfers) {
+        libusb_free_transfer(x);
+    }
+    if (ing->handle) {
+        if (ing->intf >= 0) {
+            libusb_release_interface(ing->handle, ing->intf);
+        }
+        libusb_close(ing->handle);
+    }
+    if (ing->ctx) {
+        libusb_exit(ing->ctx);
+    }
+    delete ing;
+}
+
+} // namespace
+
+extern "C" int ebd_ingest_open(uint16_t vid, uint16_t pid, const ebd_ingest_config_t *cfg,
+                               ebd_ingest_t **out) {
+    if (!out) {
+        return EBD_HOST_ERR_ARG;
+    }
+    *out = nullptr;
+    uint32_t count = cfg && cfg->transfers ? cfg->transfers : INGEST_TRANSFERS_DEFAULT;
+    uint32_t size = cfg && cfg->transfer_bytes ? cfg->transfer_bytes : INGEST_TRANSFER_BYTES_DEFAULT;
+    size = (size + INGEST_PACKET_BYTES - 1u) / INGEST_PACKET_BYTES * INGEST_PACKET_BYTES;
+    size_t ring_bytes = ebd::round_up_pow2(cfg && cfg->ring_bytes ? cfg->ring_bytes
+                                                                  : INGEST_RING_BYTES_DEFAULT);
+    if (ring_bytes < size) {
+        return EBD_HOST_ERR_ARG; // no transfer would ever fit
+    }
+
+    auto *ing = new ebd_ingest(ring_bytes);
+    int rc = libusb_init(&ing->ctx);
+    if (rc != LIBUSB_SUCCESS) {
+        ing->ctx = nullptr;
+        teardown(ing);
+        return map_usb_error(rc);
+    }
+    ing->handle = libusb_open_device_with_vid_pid(ing->ctx, vid, pid);
+    if (!ing->handle) {
+        teardown(ing);
+        return EBD_HOST_ERR_NOT_FOUND;
+    }
+    rc = find_interface(ing);
+    if (rc != EBD_HOST_OK) {
+        ing->intf = -1;
+        teardown(ing);
+        return rc;
+    }
+    libusb_set_auto_detach_kernel_driver(ing->handle, 1);
+    rc = libusb_claim_interface(ing->handle, ing->intf);
+    if (rc != LIBUSB_SUCCESS) {
+        ing->intf = -1;
+        teardown(ing);
+        return map_usb_error(rc);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        libusb_transfer *x = libusb_alloc_transfer(0);
+        ing->bufs.emplace_back(new uint8_t[size]);
+        libusb_fill_bulk_transfer(x, ing->handle, ing->ep_in, ing->bufs.back().get(), (int)size,
+                                  on_in, ing, 0);
+        ing->xfers.push_back(x);
+    }
+    for (libusb_transfer *x : ing->xfers) {
+        rc = libusb_submit_transfer(x);
+        if (rc != LIBUSB_SUCCESS) {
+            break;
+        }
+        ing->in_flight++;
+    }
+    if (rc != LIBUSB_SUCCESS) {
+        // Let the ones already submitted come back cancelled.
+        ing->stopping.store(true);
+        event_loop(ing);
+        teardown(ing);
+        return map_usb_error(rc);
+    }
+    ing->events = std::thread(event_loop, ing);
+    *out = ing;
+    return EBD_HOST_OK;
+}
+
+extern "C" void ebd_ingest_close(ebd_ingest_t *ing) {
+    if (!ing) {
+        return;
+    }
+    ing->stopping.store(true);
+    ing->events.join();
+    { std::lock_guard<std::mutex> hold(ing->write_lock); } // let a writer return
+    teardown(ing);
+}
+
+extern "C" long ebd_ingest_read(ebd_ingest_t *ing, uint8_t *dst, size_t cap, uint32_t timeout_ms) {
+    if (!ing || !dst) {
+        return EBD_HOST_ERR_ARG;
+    }
+    size_t n = ing->ring.pop(dst, cap);
+    if (n > 0 || cap == 0) {
+        return (long)n;
+    }
+    if (ing->gone.load()) {
+        return EBD_HOST_ERR_GONE;
+    }
+    {
+        std::unique_lock<std::mutex> hold(ing->wait_lock);
+        ing->reader_waiting.store(true);
+        ing->wait_cv.wait_for(hold, std::chrono::milliseconds(timeout_ms), [ing] {
+            return ing->ring.used() > 0 || ing->gone.load();
+        });
+        ing->reader_waiting.store(false);
+    }
+    n = ing->ring.pop(dst, cap);
+    if (n == 0 && ing->gone.load()) {
+        return EBD_HOST_ERR_GONE;
+    }
+    return (long)n;
+}
+
+extern "C" long ebd_ingest_write(ebd_ingest_t *ing, const uint8_t *src, size_t len,
+                                 uint32_t timeout_ms) {
+    if (!ing || (!src && len)) {
+        return EBD_HOST_ERR_ARG;
+    }
+    if (!ing->ep_out) {
+        return EBD_HOST_ERR_UNSUPPORTED; // firmware without the input endpoint
+    }
+    if (ing->gone.load()) {
+        return EBD_HOST_ERR_GONE;
+    }
+    if (timeout_ms == 0) {
+        timeout_ms = 1; // libusb takes 0 as no timeout at all
+    }
+    std::lock_guard<std::mutex> one_at_a_time(ing->write_lock);
+    auto *w = new OutWait;
+    w->ing = ing;
+    w->data.assign(src, src + len);
+    libusb_transfer *x = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(x, ing->handle, ing->ep_out, w->data.data(), (int)len, on_out, w,
+                              timeout_ms);
+    {
+        std::lock_guard<std::mutex> hold(ing->out_lock);
+        int rc = ing->stopping.load() ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_SUCCESS;
+        if (rc == LIBUSB_SUCCESS) {
+            ing->in_flight++;
+            rc = libusb_submit_transfer(x);
+            if (rc != LIBUSB_SUCCESS) {
+                ing->in_flight--;
+            }
+        }
+        if (rc != LIBUSB_SUCCESS) {
+            libusb_free_transfer(x);
+            delete w;
+            return map_usb_error(rc);
+        }
+        ing->out_xfer = x;
+    }
+    libusb_transfer_status status;
+    int actual;
+    {
+        // libusb enforces timeout_ms; the backstop covers a callback that
+        // never comes, cancelling and then leaving the cleanup to on_out.
+        auto done = [w] { return w->done; };
+        std::unique_lock<std::mutex> hold(w->lock);
+        auto backstop = std::chrono::milliseconds(INGEST_OUT_BACKSTOP_MS);
+        if (!w->cv.wait_for(hold, std::chrono::milliseconds(timeout_ms) + backstop, done)) {
+            hold.unlock();
+            libusb_cancel_transfer(x);
+            hold.lock();
+            if (!w->cv.wait_for(hold, backstop, done)) {
+                w->abandoned = true;
+                return EBD_HOST_ERR_TIMEOUT;
+            }
+        }
+        status = w->status;
+        actual = w->actual;
+    }
+    libusb_free_transfer(x);
+    delete w;
+    switch (status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+        return actual;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+        return actual > 0 ? actual : EBD_HOST_ERR_TIMEOUT;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        return EBD_HOST_ERR_GONE;
+    default:
+        return EBD_HOST_ERR_USB;
+    }
+}
+
+extern "C" void ebd_ingest_get_counters(const ebd_ingest_t *ing, ebd_ingest_counters_t *out) {
+    out->bytes = ing->bytes.load(std::memory_order_relaxed);
+    out->transfers = ing->transfers.load(std::memory_order_relaxed);
+    out->empty = ing->empty.load(std::memory_order_relaxed);
+    out->stalls = ing->stalls.load(std::memory_order_relaxed);
+    out->errors = ing->errors.load(std::memory_order_relaxed);
+    out->dropped = ing->dropped.load(std::memory_order_relaxed);
+    out->dropped_bytes = ing->dropped_bytes.load(std::memory_order_relaxed);
+    out->ring_used = (uint32_t)ing->ring.used();
+    out->ring_high = ing->ring_high.load(std::memory_order_relaxed);
+}
+
+#else // !EBD_HOST_LIBUSB
+
+extern "C" int ebd_ingest_open(uint16_t, uint16_t, const ebd_ingest_config_t *, ebd_ingest_t **out) {
+    if (out) {
+        *out = nullptr;
+    }
+    return EBD_HOST_ERR_UNSUPPORTED;
+}
+
+extern "C" void ebd_ingest_close(ebd_ingest_t *) {}
+
+extern "C" long ebd_ingest_read(ebd_ingest_t *, uint8_t *, size_t, uint32_t) {
+    return EBD_HOST_ERR_UNSUPPORTED;
+}
+
+extern "C" long ebd_ingest_write(ebd_ingest_t *, const uint8_t *, size_t, uint32_t) {
+    return EBD_HOST_ERR_UNSUPPORTED;
+}
+
+extern "C" void ebd_ingest_get_counters(const ebd_ingest_t *, ebd_ingest_counters_t *out) {
+    *out = ebd_ingest_counters_t{};
+}
+
+#endif // EBD_HOST_LIBUSB
+
+extern "C" const char *ebd_host_strerror(int err) {
+    switch (err) {
+    case EBD_HOST_OK:
+        return "ok";
+    case EBD_HOST_ERR_UNSUPPORTED:
+        return "not supported by this build";
+    case EBD_HOST_ERR_NOT_FOUND:
+        return "device or vendor interface not found";
+    case EBD_HOST_ERR_USB:
+        return "USB error";
+    case EBD_HOST_ERR_ARG:
+        return "invalid argument";
+    case EBD_HOST_ERR_TIMEOUT:
+        return "timed out";
+    case EBD_HOST_ERR_ACCESS:
+        return "permission denied (udev rules?)";
+    case EBD_HOST_ERR_BUSY:
+        return "interface claimed by another program";
+    case EBD_HOST_ERR_GONE:
+        return "device disconnected";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ebd {
+
+// Vendor bulk stream geometry (src/stream_protocol.h, docs/protocol/usb_cdc_stream.md).
+constexpr uint8_t kMagic0 = 0xEB;
+constexpr uint8_t kMagic1 = 0xD1;
+constexpr size_t kHeaderBytes = 8;
+constexpr uint16_t kFlagRle = 0x8000;
+constexpr uint16_t kLenMask = 0x7FFF;
+constexpr uint16_t kLineFrameEnd = 0xFFF0;
+constexpr uint16_t kLineTelemetry = 0xFFF1;
+constexpr unsigned kLines = 342;
+constexpr size_t kLineBytes = 64;
+constexpr size_t kFrameBytes = kLines * kLineBytes;
+constexpr size_t kLinePayloadMax = kLineBytes * 2; // RLE worst case
+constexpr size_t kAuxPayloadMax = 256;             // frame end, telemetry
+constexpr size_t kPacketMax = kHeaderBytes + kAuxPayloadMax;
+
+struct Packet {
+    uint16_t frame_id;
+    uint16_t line_id;
+    uint16_t length_flags;
+    uint16_t len;
+    const uint8_t *payload; // valid only during the callback
+};
+
+// Splits the stream into packets where the bytes already are: each fed chunk
+// is scanned in place, and only a packet cut off at the end of a chunk is
+// carried (at most one packet) to be completed by the next. Garbage is
+// skipped with memchr, never by moving the buffer.
+class StreamParser {
+public:
+    uint64_t packets = 0;
+    uint64_t skipped_bytes = 0; // bytes outside any packet
+    uint64_t bad_headers = 0;   // magic followed by an impossible header
+
+    template <typename F> void feed(const uint8_t *data, size_t n, F &&on) {
+        if (carry_len_ > 0) {
+            size_t old = carry_len_;
+            size_t take = n < sizeof(carry_) - old ? n : sizeof(carry_) - old;
+            std::memcpy(carry_ + old, data, take);
+            size_t used = scan(carry_, old + take, on);
+            if (used <= old) {
+                // Still short of a whole packet, so take was all of data.
+                std::memmove(carry_, carry_ + used, old + take - used);
+                carry_len_ = old + take - used;
+                return;
+            }
+            carry_len_ = 0;
+            data += used - old;
+            n -= used - old;
+        }
+        size_t used = scan(data, n, on);
+        carry_len_ = n - used;
+        std::memcpy(carry_, data + used, carry_len_);
+    }
+
+    void reset() { carry_len_ = 0; }
+
+private:
+    static bool header_ok(uint16_t line_id, uint16_t length_flags) {
+        uint16_t len = length_flags & kLenMask;
+        if (len == 0) {
+            return false;
+        }
+        if (line_id >= kLineFrameEnd) {
+            return !(length_flags & kFlagRle) && len <= kAuxPayloadMax;
+        }
+        if (line_id >= kLines) {
+            return false;
+        }
+        if (length_flags & kFlagRle) {
+            return len % 2 == 0 && len <= kLinePayloadMax;
+        }
+        return len == kLineBytes;
+    }
+
+    // Emits every whole packet in p and returns how many bytes it used; the
+    // rest is the start of a packet (or a trailing 0xEB) still to come.
+    template <typename F> size_t scan(const uint8_t *p, size_t n, F &on) {
+        size_t i = 0;
+        for (;;) {
+            const void *m = i < n ? std::memchr(p + i, kMagic0, n - i) : nullptr;
+            if (!m) {
+                skipped_bytes += n - i;
+                return n;
+            }
+            size_t at = static_cast<const uint8_t *>(m) - p;
+            skipped_bytes += at - i;
+            i = at;
+            if (n - i < 2) {
+                return i;
+            }
+            if (p[i + 1] != kMagic1) {
+                i++;
+                skipped_bytes++;
+                continue;
+            }
+            if (n - i < kHeaderBytes) {
+                return i;
+            }
+            Packet pkt;
+            pkt.frame_id = static_cast<uint16_t>(p[i + 2] | (p[i + 3] << 8));
+            pkt.line_id = static_cast<uint16_t>(p[i + 4] | (p[i + 5] << 8));
+            pkt.length_flags = static_cast<uint16_t>(p[i + 6] | (p[i + 7] << 8));
+            if (!header_ok(pkt.line_id, pkt.length_flags)) {
+                bad_headers++;
+                skipped_bytes += 2;
+                i += 2;
+                continue;
+            }
+            pkt.len = pkt.length_flags & kLenMask;
+            if (n - i < kHeaderBytes + pkt.len) {
+                return i;
+            }
+            pkt.payload = p + i + kHeaderBytes;
+            packets++;
+            on(pkt);
+            i += kHeaderBytes + pkt.len;
+        }
+    }
+
+    // Twice the largest packet: the carried part is always shorter than one,
+    // so topping it up always finishes it, or uses all of a short chunk.
+    uint8_t carry_[2 * kPacketMax];
+    size_t carry_len_ = 0;
+};
+
+} // namespace ebd
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+import time
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+CTRL_REQ_CAPTURE_STOP = 0x02
+CTRL_REQ_RESET_COUNTERS = 0x03
+CTRL_REQ_SET_CODEC = 0x12
+CTRL_REQ_BENCH_UPLOAD = 0x16
+CTRL_REQ_BENCH_START = 0x17
+CTRL_REQ_GET_BENCH = 0x84
+
+WIDTH = 512
+HEIGHT = 342
+LINE_BYTES = WIDTH // 8
+UPLOAD_LINES = 16  # BENCH_UPLOAD_MAX_BYTES / 64
+
+CODECS = {"raw": 0, "rle": 1}
+# bench_screen_t in src/bench_frames.h; 0 is the uploaded screen.
+SCREENS = {"desktop": 1, "text": 2, "dither": 3, "white": 4, "noise": 5}
+
+# Must match bench_report_t in src/bench_frames.h (little-endian, packed).
+REPORT_FORMAT = "<HH4B3I4IIQIIQQII"
+REPORT_FIELDS = (
+    "version", "size", "running", "screen", "codec", "reserved",
+    "period_us", "clk_sys_hz", "elapsed_us",
+    "ticks", "ticks_skipped", "frames_submitted", "frames_sent",
+    "lines", "line_cycles", "line_cycles_max", "postprocess_us_max",
+    "packet_bytes", "usb_bytes", "frame_tx_us_sum", "frame_tx_us_max",
+)
+REPORT_BYTES = struct.calcsize(REPORT_FORMAT)
+
+
+def open_device():
+    try:
+        import usb.core
+        import usb.util
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    try:
+        cfg = dev.get_active_configuration()
+    except usb.core.USBError:
+        dev.set_configuration()
+        cfg = dev.get_active_configuration()
+    intf = usb.util.find_descriptor(cfg, bInterfaceClass=0xFF)
+    if intf is None:
+        raise SystemExit("bulk stream interface not found.")
+    if dev.is_kernel_driver_active(intf.bInterfaceNumber):
+        dev.detach_kernel_driver(intf.bInterfaceNumber)
+    usb.util.claim_interface(dev, intf.bInterfaceNumber)
+    ep_in = usb.util.find_descriptor(
+        intf,
+        custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN
+    )
+    if ep_in is None:
+        raise SystemExit("bulk IN endpoint not found.")
+    return dev, ep_in
+
+
+def ctrl_out(dev, req: int, value: int = 0, data: bytes = None) -> None:
+    # 0x41 = Host-to-Device | Vendor | Interface recipient (see host_recv_frames.py)
+    dev.ctrl_transfer(0x41, req, value, 0, data)
+
+
+def read_report(dev) -> dict:
+    # 0xC1 = Device-to-Host | Vendor | Interface recipient
+    try:
+        raw = bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_BENCH, 0, 0, REPORT_BYTES))
+    except Exception as exc:
+        raise SystemExit(f"bench report request failed ({exc}); "
+                         "is the firmware built with -DEBD_IPKVM_BENCH=ON?")
+    if len(raw) < REPORT_BYTES:
+        raise SystemExit(f"short bench report: {len(raw)} bytes (expected {REPORT_BYTES})")
+    return dict(zip(REPORT_FIELDS, struct.unpack(REPORT_FORMAT, raw[:REPORT_BYTES])))
+
+
+def load_pbm(path: str) -> bytes:
+    with open(path, "rb") as f:
+        data = f.read()
+    # P4 header: magic, width, height, then one whitespace byte.
+    fields = []
+    pos = 0
+    while len(fields) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos) + 1
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b"P4" or int(fields[1]) != WIDTH or int(fields[2]) != HEIGHT:
+        raise SystemExit(f"{path}: expected a {WIDTH}x{HEIGHT} P4 (binary PBM) image")
+    raster = data[pos + 1:pos + 1 + LINE_BYTES * HEIGHT]
+    if len(raster) != LINE_BYTES * HEIGHT:
+        raise SystemExit(f"{path}: short raster")
+    # PBM uses 1 = black; the stream uses 1 = white.
+    return bytes(b ^ 0xFF for b in raster)
+
+
+def upload_screen(dev, image: bytes) -> None:
+    for first in range(0, HEIGHT, UPLOAD_LINES):
+        lines = min(UPLOAD_LINES, HEIGHT - first)
+        ctrl_out(dev, CTRL_REQ_BENCH_UPLOAD, first,
+                 image[first * LINE_BYTES:(first + lines) * LINE_BYTES])
+
+
+def drain(ep_in, seconds: float) -> int:
+    # The benchmark only measures USB throughput if the host keeps reading.
+    total = 0
+    deadline = time.monotonic() + seconds
+    while time.monotonic() < deadline:
+        try:
+            total += len(ep_in.read(16384, timeout=50))
+        except Exception:
+            pass
+    return total
+
+
+def run_one(dev, ep_in, screen: int, codec: str, seconds: float, period_us: int) -> dict:
+    ctrl_out(dev, CTRL_REQ_SET_CODEC, CODECS[codec])
+    ctrl_out(dev, CTRL_REQ_RESET_COUNTERS)
+    ctrl_out(dev, CTRL_REQ_BENCH_START, 0, struct.pack("<B3xI", screen, period_us))
+    host_bytes = drain(ep_in, seconds)
+    rep = read_report(dev)
+    ctrl_out(dev, CTRL_REQ_CAPTURE_STOP)
+    drain(ep_in, 0.2)
+    rep["host_bytes"] = host_bytes
+    return rep
+
+
+def print_row(name: str, codec: str, r: dict) -> None:
+    secs = r["elapsed_us"] / 1e6 if r["elapsed_us"] else 1.0
+    cyc = r["line_cycles"] / r["lines"] if r["lines"] else 0.0
+    bpf = r["packet_bytes"] / r["frames_sent"] if r["frames_sent"] else 0.0
+    fps = r["frames_sent"] / secs
+    tx_us = r["frame_tx_us_sum"] / r["frames_sent"] if r["frames_sent"] else 0.0
+    print(f"{name:10s} {codec:4s} {fps:7.2f} {r['ticks_skipped']:6d} {cyc:9.0f} "
+          f"{r['line_cycles_max']:9d} {bpf:9.0f} {r['usb_bytes'] / secs / 1000.0:9.1f} "
+          f"{tx_us / 1000.0:8.2f} {r['frame_tx_us_max'] / 1000.0:8.2f}")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        description="Run the on-device codec/pipeline benchmark (EBD_IPKVM_BENCH firmware).")
+    parser.add_argument("--screens", default=",".join(SCREENS),
+                        help=f"Comma-separated built-in screens ({', '.join(SCREENS)}).")
+    parser.add_argument("--pbm", action="append", default=[],
+                        help="Also upload and bench a 512x342 P4 image (repeatable).")
+    parser.add_argument("--codecs", default="raw,rle", help="Comma-separated codecs (raw, rle).")
+    parser.add_argument("--seconds", type=float, default=5.0, help="Run time per case.")
+    parser.add_argument("--period-us", type=int, default=0,
+                        help="Tick period in us (default 0 = 16625, 60.15 Hz).")
+    args = parser.parse_args()
+
+    cases = []
+    for name in filter(None, args.screens.split(",")):
+        if name not in SCREENS:
+            raise SystemExit(f"unknown screen: {name}")
+        cases.append((name, SCREENS[name], None))
+    for path in args.pbm:
+        cases.append((path.rsplit("/", 1)[-1][:10], 0, load_pbm(path)))
+    codecs = [c for c in args.codecs.split(",") if c]
+    for c in codecs:
+        if c not in CODECS:
+            raise SystemExit(f"unknown codec: {c}")
+
+    dev, ep_in = open_device()
+    ctrl_out(dev, CTRL_REQ_CAPTURE_STOP)
+    drain(ep_in, 0.2)
+
+    print(f"{'screen':10s} {'cdc':4s} {'fps':>7s} {'skip':>6s} {'cyc/line':>9s} {'max':>9s} "
+          f"{'B/frame':>9s} {'usb KB/s':>9s} {'tx ms':>8s} {'tx max':>8s}")
+    clk_hz = 0
+    for name, screen, image in cases:
+        if image is not None:
+            upload_screen(dev, image)
+        for codec in codecs:
+            rep = run_one(dev, ep_in, screen, codec, args.seconds, args.period_us)
+            clk_hz = rep["clk_sys_hz"]
+            print_row(name, codec, rep)
+            sys.stdout.flush()
+    print(f"clk_sys={clk_hz} Hz; cyc/line = RLE encode + TX enqueue on core1, "
+          "tx = tick to frame end queued")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+import time
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+CTRL_REQ_SET_CAPTURE_MODE = 0x10
+CTRL_REQ_SET_FRAME_DIVISOR = 0x11
+CTRL_REQ_SET_CODEC = 0x12
+CTRL_REQ_SET_ROI = 0x13
+CTRL_REQ_SET_VSYNC_EDGE = 0x14
+CTRL_REQ_SET_TELEMETRY = 0x15
+CTRL_REQ_GET_STATS = 0x80
+
+# Must match usb_ctrl_stats_t in src/usb_control.h (little-endian, packed).
+# Version 1 firmware stops after txq_w, version 2 after tx_payload_bytes,
+# version 3 after last_pixclk_delta, version 4 after the signal counters.
+STATS_FORMAT_V1 = "<HH8BHH7I2I2BHH"
+STATS_FORMAT_V2 = STATS_FORMAT_V1 + "4I"
+STATS_FORMAT_V3 = STATS_FORMAT_V2 + "4IHh"
+STATS_FORMAT_V4 = STATS_FORMAT_V3 + "4I4H"
+STATS_FORMAT = STATS_FORMAT_V4 + "5I"
+STATS_FIELDS = (
+    "version", "size",
+    "armed", "capture_enabled", "test_frame_active", "ps_on",
+    "capture_mode", "vsync_fall_edge", "codec", "frame_divisor",
+    "roi_first_line", "roi_line_count",
+    "frames_done", "lines_ok", "lines_drop", "frame_overrun", "frame_short",
+    "usb_drops", "vsync_total",
+    "lines_per_s", "vsync_per_s", "core0_pct", "core1_pct",
+    "txq_r", "txq_w",
+    "time_us", "tx_lines", "tx_lines_rle", "tx_payload_bytes",
+    "lines_out_of_spec", "frames_out_of_spec", "capture_rx_stalls", "monitor_rx_stalls",
+    "last_frame_lines_oos", "last_pixclk_delta",
+    "pixclk_hz", "vsync_hz", "hsync_hz", "video_hz",
+    "pixclk_duty_bp", "vsync_duty_bp", "hsync_duty_bp", "video_duty_bp",
+    "input_events", "input_bad", "input_coalesced", "input_sent", "input_dropped",
+)
+STATS_BYTES = struct.calcsize(STATS_FORMAT)
+STATS_BYTES_V4 = struct.calcsize(STATS_FORMAT_V4)
+STATS_BYTES_V3 = struct.calcsize(STATS_FORMAT_V3)
+STATS_BYTES_V2 = struct.calcsize(STATS_FORMAT_V2)
+STATS_BYTES_V1 = struct.calcsize(STATS_FORMAT_V1)
+
+CODECS = {"raw": 0, "rle": 1}
+MODES = {"test30": 0, "cont60": 1}
+EDGES = {"rise": 0, "fall": 1}
+
+
+def open_device():
+    try:
+        import usb.core
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    return dev
+
+
+def ctrl_out(dev, req: int, value: int = 0, data: bytes = None) -> None:
+    # 0x41 = Host-to-Device | Vendor | Interface recipient (see host_recv_frames.py)
+    dev.ctrl_transfer(0x41, req, value, 0, data)
+
+
+def parse_stats(raw: bytes) -> dict:
+    # Shared with the bulk telemetry packet payload.
+    if len(raw) >= STATS_BYTES:
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT, raw[:STATS_BYTES])))
+    if len(raw) >= STATS_BYTES_V4:
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT_V4, raw[:STATS_BYTES_V4])))
+    if len(raw) >= STATS_BYTES_V3:
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT_V3, raw[:STATS_BYTES_V3])))
+    if len(raw) >= STATS_BYTES_V2:
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT_V2, raw[:STATS_BYTES_V2])))
+    if len(raw) >= STATS_BYTES_V1:
+        return dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT_V1, raw[:STATS_BYTES_V1])))
+    raise SystemExit(f"short stats reply: {len(raw)} bytes (expected {STATS_BYTES})")
+
+
+def read_stats(dev) -> dict:
+    # 0xC1 = Device-to-Host | Vendor | Interface recipient
+    return parse_stats(bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_STATS, 0, 0, STATS_BYTES)))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Configure the capture pipeline and read stats over EP0.")
+    parser.add_argument("--mode", choices=sorted(MODES), help="Capture cadence.")
+    parser.add_argument("--divisor", type=int, help="Take every Nth VSYNC in continuous mode (1..255).")
+    parser.add_argument("--codec", choices=sorted(CODECS), help="Line payload codec.")
+    parser.add_argument("--roi", metavar="FIRST:COUNT", help="Active line range to stream, e.g. 0:342.")
+    parser.add_argument("--vsync-edge", choices=sorted(EDGES), help="VSYNC edge (stops capture).")
+    parser.add_argument("--telemetry-ms", type=int,
+                        help="Bulk-stream telemetry interval in ms (0 = off).")
+    parser.add_argument("--stats", action="store_true", help="Read and print the binary stats block.")
+    parser.add_argument("--watch", type=float, default=0.0,
+                        help="Poll stats every N seconds until interrupted.")
+    args = parser.parse_args()
+
+    dev = open_device()
+    if args.mode:
+        ctrl_out(dev, CTRL_REQ_SET_CAPTURE_MODE, MODES[args.mode])
+    if args.divisor is not None:
+        if not 1 <= args.divisor <= 255:
+            raise SystemExit("--divisor must be 1..255")
+        ctrl_out(dev, CTRL_REQ_SET_FRAME_DIVISOR, args.divisor)
+    if args.codec:
+        ctrl_out(dev, CTRL_REQ_SET_CODEC, CODECS[args.codec])
+    if args.roi:
+        try:
+            first, count = (int(v) for v in args.roi.split(":", 1))
+        except ValueError:
+            raise SystemExit(f"invalid --roi value: {args.roi}")
+        ctrl_out(dev, CTRL_REQ_SET_ROI, 0, struct.pack("<HH", first, count))
+    if args.vsync_edge:
+        ctrl_out(dev, CTRL_REQ_SET_VSYNC_EDGE, EDGES[args.vsync_edge])
+    if args.telemetry_ms is not None:
+        if not 0 <= args.telemetry_ms <= 0xFFFF:
+            raise SystemExit("--telemetry-ms must be 0..65535")
+        ctrl_out(dev, CTRL_REQ_SET_TELEMETRY, args.telemetry_ms)
+
+    if args.stats or args.watch > 0:
+        try:
+            while True:
+                stats = read_stats(dev)
+                print(" ".join(f"{k}={v}" for k, v in stats.items()))
+                if args.watch <= 0:
+                    break
+                time.sleep(args.watch)
+        except KeyboardInterrupt:
+            pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,429 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+import time
+import zlib
+from collections import deque
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+CTRL_REQ_CAPTURE_START = 0x01
+CTRL_REQ_CAPTURE_STOP = 0x02
+CTRL_REQ_RESET_COUNTERS = 0x03
+CTRL_REQ_SET_CAPTURE_MODE = 0x10
+CTRL_REQ_SET_CODEC = 0x12
+CTRL_REQ_GET_TIME = 0x81
+
+WIDTH = 512
+HEIGHT = 342
+LINE_BYTES = WIDTH // 8
+HEADER_BYTES = 8
+# Line payloads are at most 128 bytes; telemetry packets are longer.
+MAX_PACKET_PAYLOAD = 256
+RLE_FLAG = 0x8000
+LEN_MASK = 0x7FFF
+MAGIC = b"\xEB\xD1"
+FRAME_END_LINE_ID = 0xFFF0
+FRAME_END_TS_BYTES = 12
+
+# Mac Classic scan timing: 704 PIXCLKs per line at 15.6672 MHz, first active
+# line 28 lines after the VSYNC fall (src/video_core.c).
+LINE_US = 704 / 15.6672
+YOFF_LINES = 28
+
+CODECS = {"raw": 0, "rle": 1}
+CAPTURE_MODE_CONT60 = 1
+
+# Vendor bulk OUT input records (src/input_events.h).
+INPUT_EV_MOUSE = 0x01
+INPUT_EV_KEY = 0x02
+
+
+def open_device():
+    try:
+        import usb.core
+        import usb.util
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    try:
+        cfg = dev.get_active_configuration()
+    except usb.core.USBError:
+        dev.set_configuration()
+        cfg = dev.get_active_configuration()
+    intf = usb.util.find_descriptor(cfg, bInterfaceClass=0xFF)
+    if intf is None:
+        raise SystemExit("bulk stream interface not found.")
+    if dev.is_kernel_driver_active(intf.bInterfaceNumber):
+        dev.detach_kernel_driver(intf.bInterfaceNumber)
+    # The claim is exclusive: stop host_recv_frames.py or the web bridge first.
+    usb.util.claim_interface(dev, intf.bInterfaceNumber)
+
+    def find_ep(direction):
+        return usb.util.find_descriptor(
+            intf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == direction)
+
+    ep_in = find_ep(usb.util.ENDPOINT_IN)
+    ep_out = find_ep(usb.util.ENDPOINT_OUT)
+    if ep_in is None or ep_out is None:
+        raise SystemExit("bulk IN/OUT endpoints not found.")
+    return dev, ep_in, ep_out
+
+
+def ctrl_out(dev, req: int, value: int = 0) -> None:
+    # 0x41 = Host-to-Device | Vendor | Interface recipient (see host_recv_frames.py)
+    dev.ctrl_transfer(0x41, req, value, 0, None)
+
+
+def host_now_us() -> int:
+    return time.monotonic_ns() // 1000
+
+
+def sync_device_clock(dev, samples: int = 8):
+    # Same as host_recv_frames.py: keep the device clock read with the
+    # shortest round trip. Returns (device_us_64, host_us, rtt_us).
+    best = None
+    for _ in range(samples):
+        t0 = host_now_us()
+        # 0xC1 = Device-to-Host | Vendor | Interface recipient
+        raw = bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_TIME, 0, 0, 8))
+        t1 = host_now_us()
+        if len(raw) < 8:
+            raise SystemExit("device clock read returned a short reply")
+        rtt = t1 - t0
+        if best is None or rtt < best[2]:
+            best = (struct.unpack("<Q", raw)[0], (t0 + t1) // 2, rtt)
+    return best
+
+
+def device_to_host_us(clock, dev_us32: int) -> int:
+    dev64, host_us, _ = clock
+    delta = ((dev_us32 - (dev64 & 0xFFFFFFFF) + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+    return host_us + delta
+
+
+def decode_rle_line(b: bytes):
+    if len(b) % 2:
+        return None
+    out = bytearray()
+    for i in range(0, len(b), 2):
+        if b[i] == 0:
+            return None
+        out += bytes((b[i + 1],)) * b[i]
+        if len(out) > LINE_BYTES:
+            return None
+    return bytes(out) if len(out) == LINE_BYTES else None
+
+
+class StreamReader:
+    """Splits the bulk stream into line and frame end events, stamped with
+    the host time of the USB read that completed them."""
+
+    def __init__(self, ep_in):
+        self.ep_in = ep_in
+        self.buf = bytearray()
+
+    def read(self, timeout_ms: int):
+        try:
+            chunk = bytes(self.ep_in.read(16384, timeout=timeout_ms))
+        except Exception:
+            return []
+        rx_us = host_now_us()
+        self.buf += chunk
+        events = []
+        while True:
+            i = self.buf.find(MAGIC)
+            if i < 0:
+                del self.buf[:-1]
+                break
+            del self.buf[:i]
+            if len(self.buf) < HEADER_BYTES:
+                break
+            frame_id, line_id, plen = struct.unpack_from("<HHH", self.buf, 2)
+            payload_len = plen & LEN_MASK
+            if payload_len == 0 or payload_len > MAX_PACKET_PAYLOAD:
+                del self.buf[:2]
+                continue
+            if len(self.buf) < HEADER_BYTES + payload_len:
+                break
+            payload = bytes(self.buf[HEADER_BYTES:HEADER_BYTES + payload_len])
+            del self.buf[:HEADER_BYTES + payload_len]
+            if line_id == FRAME_END_LINE_ID:
+                if payload_len >= FRAME_END_TS_BYTES and not plen & RLE_FLAG:
+                    vsync_us = struct.unpack_from("<I", payload)[0]
+                    events.append(("end", frame_id, vsync_us, rx_us))
+                continue
+            if line_id >= HEIGHT:
+                continue
+            line = decode_rle_line(payload) if plen & RLE_FLAG else payload
+            if line is None or len(line) != LINE_BYTES:
+                continue
+            events.append(("line", frame_id, line_id, line, rx_us))
+        return events
+
+
+class Region:
+    def __init__(self, spec: str):
+        self.y0, self.y1, self.x0, self.x1 = 0, HEIGHT, 0, WIDTH
+        if spec:
+            try:
+                parts = spec.split(",")
+                self.y0, self.y1 = (int(v) for v in parts[0].split(":"))
+                if len(parts) > 1:
+                    self.x0, self.x1 = (int(v) for v in parts[1].split(":"))
+            except ValueError:
+                raise SystemExit(f"invalid --region value: {spec}")
+        if not (0 <= self.y0 < self.y1 <= HEIGHT and 0 <= self.x0 < self.x1 <= WIDTH):
+            raise SystemExit(f"--region out of range: {spec}")
+        # Hash whole bytes covering the column range.
+        self.b0 = self.x0 // 8
+        self.b1 = (self.x1 + 7) // 8
+
+    def lines(self) -> int:
+        return self.y1 - self.y0
+
+    def hash(self, line_id: int, line: bytes):
+        if not self.y0 <= line_id < self.y1:
+            return None
+        return zlib.crc32(line[self.b0:self.b1])
+
+
+def percentile(sorted_vals, pct: float) -> float:
+    if not sorted_vals:
+        return 0.0
+    idx = min(len(sorted_vals) - 1, int(round(pct / 100.0 * (len(sorted_vals) - 1))))
+    return sorted_vals[idx]
+
+
+def summary(name: str, samples_us) -> str:
+    vals = sorted(samples_us)
+    if not vals:
+        return f"{name:8s} n=0"
+    mean = sum(vals) / len(vals)
+    return (f"{name:8s} n={len(vals)} min={vals[0] / 1000:.2f} p50={percentile(vals, 50) / 1000:.2f} "
+            f"p90={percentile(vals, 90) / 1000:.2f} p99={percentile(vals, 99) / 1000:.2f} "
+            f"max={vals[-1] / 1000:.2f} mean={mean / 1000:.2f} ms")
+
+
+def histogram(samples_us, bucket_ms: float) -> str:
+    if not samples_us:
+        return ""
+    buckets = {}
+    for v in samples_us:
+        b = int(v / 1000 / bucket_ms)
+        buckets[b] = buckets.get(b, 0) + 1
+    peak = max(buckets.values())
+    rows = []
+    for b in range(min(buckets), max(buckets) + 1):
+        n = buckets.get(b, 0)
+        bar = "#" * max(1 if n else 0, round(40 * n / peak))
+        rows.append(f"  {b * bucket_ms:6.1f}-{(b + 1) * bucket_ms:<6.1f} ms {n:5d} {bar}")
+    return "\n".join(rows)
+
+
+class Probe:
+    """One injection: waits for a settled region, sends the stimulus and
+    looks for the first region line that differs from the settled frame."""
+
+    def __init__(self, reader, region: Region, settle: int):
+        self.reader = reader
+        self.region = region
+        self.settle = settle
+        self.pending = deque()  # events read but not yet looked at
+        self.vsync = {}  # frame_id -> device VSYNC time_us_32
+
+    def _next(self, timeout_ms: int):
+        if not self.pending:
+            self.pending.extend(self.reader.read(timeout_ms))
+        return self.pending.popleft() if self.pending else None
+
+    def _note_end(self, ev):
+        self.vsync[ev[1]] = ev[2]
+        while len(self.vsync) > 64:
+            del self.vsync[next(iter(self.vsync))]
+
+    def wait_settled(self, deadline_us: int):
+        # Complete frames only: a frame is done when its frame end arrives.
+        last = None
+        same = 0
+        cur_id = None
+        cur = {}
+        while host_now_us() < deadline_us:
+            ev = self._next(20)
+            if ev is None:
+                continue
+            if ev[0] == "end":
+                self._note_end(ev)
+                if ev[1] == cur_id and len(cur) == self.region.lines():
+                    same = same + 1 if cur == last else 1
+                    last = cur
+                    if same >= self.settle:
+                        return last
+                cur_id, cur = None, {}
+                continue
+            _, frame_id, line_id, line, _ = ev
+            if frame_id != cur_id:
+                cur_id, cur = frame_id, {}
+            h = self.region.hash(line_id, line)
+            if h is not None:
+                cur[line_id] = h
+        return None
+
+    def wait_change(self, baseline, deadline_us: int):
+        # Returns (frame_id, line_id, host rx time) of the first changed line.
+        while host_now_us() < deadline_us:
+            ev = self._next(5)
+            if ev is None:
+                continue
+            if ev[0] == "end":
+                self._note_end(ev)
+                continue
+            _, frame_id, line_id, line, rx_us = ev
+            h = self.region.hash(line_id, line)
+            if h is not None and h != baseline.get(line_id):
+                return frame_id, line_id, rx_us
+        return None
+
+    def wait_vsync(self, frame_id: int, deadline_us: int):
+        while frame_id not in self.vsync and host_now_us() < deadline_us:
+            ev = self._next(5)
+            if ev is not None and ev[0] == "end":
+                self._note_end(ev)
+        return self.vsync.get(frame_id)
+
+
+def mouse_records(dx: int, dy: int) -> bytes:
+    out = bytearray()
+    while True:
+        sx = max(-128, min(127, dx))
+        sy = max(-128, min(127, dy))
+        out += struct.pack("<BBbb", INPUT_EV_MOUSE, 0, sx, sy)
+        dx -= sx
+        dy -= sy
+        if dx == 0 and dy == 0:
+            return bytes(out)
+
+
+def key_records(code: int) -> bytes:
+    return (struct.pack("<BBBB", INPUT_EV_KEY, code & 0x7F, 0, 0) +
+            struct.pack("<BBBB", INPUT_EV_KEY, code & 0x7F, 1, 0))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        description="Measure input-to-photon latency: inject a mouse move or key over the vendor "
+                    "bulk OUT endpoint and time the first changed line in the captured video.")
+    parser.add_argument("--iterations", type=int, default=100, help="Injections to time.")
+    parser.add_argument("--move", metavar="DX,DY", default="8,0",
+                        help="Mouse move per injection; alternates sign so the cursor returns (default 8,0).")
+    parser.add_argument("--key", type=lambda v: int(v, 0),
+                        help="Press and release this ADB key code instead of moving (aim the region "
+                             "at a text field).")
+    parser.add_argument("--region", default="",
+                        help="Lines (and columns) to watch, Y0:Y1[,X0:X1]; default the whole screen.")
+    parser.add_argument("--settle", type=int, default=2,
+                        help="Identical frames required in the region before each injection.")
+    parser.add_argument("--timeout", type=float, default=1.0,
+                        help="Seconds to wait for a change before counting a miss.")
+    parser.add_argument("--interval", type=float, default=0.05,
+                        help="Extra seconds between injections.")
+    parser.add_argument("--codec", choices=sorted(CODECS), default="rle")
+    parser.add_argument("--bucket-ms", type=float, default=2.0, help="Histogram bucket width.")
+    parser.add_argument("--csv", help="Write one row per injection to this file.")
+    args = parser.parse_args()
+
+    if args.key is not None:
+        stimuli = [key_records(args.key)]
+        what = f"key 0x{args.key:02X}"
+    else:
+        try:
+            dx, dy = (int(v) for v in args.move.split(",", 1))
+        except ValueError:
+            raise SystemExit(f"invalid --move value: {args.move}")
+        stimuli = [mouse_records(dx, dy), mouse_records(-dx, -dy)]
+        what = f"move {dx:+d},{dy:+d}"
+    region = Region(args.region)
+
+    dev, ep_in, ep_out = open_device()
+    ctrl_out(dev, CTRL_REQ_CAPTURE_STOP)
+    ctrl_out(dev, CTRL_REQ_RESET_COUNTERS)
+    ctrl_out(dev, CTRL_REQ_SET_CAPTURE_MODE, CAPTURE_MODE_CONT60)
+    ctrl_out(dev, CTRL_REQ_SET_CODEC, CODECS[args.codec])
+    clock = sync_device_clock(dev)
+    ctrl_out(dev, CTRL_REQ_CAPTURE_START)
+    reader = StreamReader(ep_in)
+    probe = Probe(reader, region, args.settle)
+
+    csv = open(args.csv, "w") if args.csv else None
+    if csv:
+        csv.write("iteration,host_us,scan_us,frame_id,line_id\n")
+    lat_host = []
+    lat_scan = []
+    misses = 0
+    unsettled = 0
+    early = 0
+    print(f"[latency] {what}, region lines {region.y0}:{region.y1} cols {region.x0}:{region.x1}, "
+          f"{args.iterations} iterations (clock rtt {clock[2]} us)", file=sys.stderr)
+    try:
+        for i in range(args.iterations):
+            baseline = probe.wait_settled(host_now_us() + int(max(2.0, args.timeout) * 1e6))
+            if baseline is None:
+                unsettled += 1
+                continue
+            t0 = host_now_us()
+            ep_out.write(stimuli[i % len(stimuli)], timeout=1000)
+            hit = probe.wait_change(baseline, t0 + int(args.timeout * 1e6))
+            if hit is None:
+                misses += 1
+                if csv:
+                    csv.write(f"{i},,,,\n")
+                continue
+            frame_id, line_id, rx_us = hit
+            host_us = rx_us - t0
+            scan_us = None
+            vsync_us = probe.wait_vsync(frame_id, host_now_us() + 200000)
+            if vsync_us is not None:
+                # When the Mac finished scanning the changed line.
+                scan_at = device_to_host_us(clock, vsync_us) + (YOFF_LINES + line_id + 1) * LINE_US
+                scan_us = int(scan_at - t0)
+            if scan_us is not None and scan_us < 0:
+                # The line changed before the input could reach the Mac: the
+                # region was not as settled as it looked.
+                early += 1
+                continue
+            lat_host.append(host_us)
+            if scan_us is not None:
+                lat_scan.append(scan_us)
+            if csv:
+                csv.write(f"{i},{host_us},{'' if scan_us is None else scan_us},{frame_id},{line_id}\n")
+            if args.interval > 0:
+                time.sleep(args.interval)
+            # Re-sync now and then; the crystals drift a few ppm apart.
+            if i % 50 == 49:
+                clock = sync_device_clock(dev)
+    except KeyboardInterrupt:
+        print("[latency] interrupted", file=sys.stderr)
+    finally:
+        ctrl_out(dev, CTRL_REQ_CAPTURE_STOP)
+        if csv:
+            csv.close()
+
+    print(f"injections={len(lat_host) + misses + early} timed={len(lat_host)} misses={misses} "
+          f"early={early} unsettled={unsettled}")
+    print(summary("->host", lat_host))
+    print(summary("->scan", lat_scan))
+    print("input written -> first changed line received (host), and -> that line's scanout "
+          "on the Mac (device VSYNC stamp + line offset)")
+    hist = histogram(lat_host, args.bucket_ms)
+    if hist:
+        print("->host histogram:")
+        print(hist)
+    return 0 if lat_host else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
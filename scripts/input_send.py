@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+import time
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+# Vendor bulk OUT input records (src/input_events.h): 4 bytes each.
+INPUT_EV_MOUSE = 0x01  # buttons (bit 0 = down), dx (i8), dy (i8, + = down)
+INPUT_EV_KEY = 0x02    # ADB key code, flags (bit 0 = key up), modifier byte
+
+
+def mouse_records(dx: int, dy: int, down: bool) -> bytes:
+    # Split large moves into int8 steps; the firmware coalesces them again.
+    out = bytearray()
+    while True:
+        sx = max(-128, min(127, dx))
+        sy = max(-128, min(127, dy))
+        out += struct.pack("<BBbb", INPUT_EV_MOUSE, 1 if down else 0, sx, sy)
+        dx -= sx
+        dy -= sy
+        if dx == 0 and dy == 0:
+            return bytes(out)
+
+
+def key_record(code: int, up: bool, modifiers: int = 0) -> bytes:
+    return struct.pack("<BBBB", INPUT_EV_KEY, code & 0x7F, 1 if up else 0, modifiers & 0xFF)
+
+
+def open_device():
+    try:
+        import usb.core
+        import usb.util
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    try:
+        cfg = dev.get_active_configuration()
+    except usb.core.USBError:
+        dev.set_configuration()
+        cfg = dev.get_active_configuration()
+    intf = usb.util.find_descriptor(cfg, bInterfaceClass=0xFF)
+    if intf is None:
+        raise SystemExit("bulk stream interface not found.")
+    if dev.is_kernel_driver_active(intf.bInterfaceNumber):
+        dev.detach_kernel_driver(intf.bInterfaceNumber)
+    # The claim is exclusive: stop host_recv_frames.py or the web bridge first.
+    usb.util.claim_interface(dev, intf.bInterfaceNumber)
+    ep_out = usb.util.find_descriptor(
+        intf,
+        custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT
+    )
+    if ep_out is None:
+        raise SystemExit("bulk OUT endpoint not found.")
+    return dev, ep_out
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        description="Send keyboard/mouse input to the ADB controller (or the Pico's own ADB device) over the vendor bulk OUT endpoint.")
+    parser.add_argument("--move", metavar="DX,DY", help="Relative mouse move (+y = down).")
+    parser.add_argument("--click", action="store_true", help="Press and release the mouse button.")
+    parser.add_argument("--key", type=lambda v: int(v, 0), action="append", default=[],
+                        help="ADB key code to press and release (repeatable).")
+    parser.add_argument("--modifiers", type=lambda v: int(v, 0), default=0,
+                        help="Modifier byte sent with each key record.")
+    parser.add_argument("--repeat", type=int, default=1, help="Send the sequence N times.")
+    parser.add_argument("--interval", type=float, default=0.0, help="Seconds between repeats.")
+    args = parser.parse_args()
+
+    seq = bytearray()
+    if args.move:
+        try:
+            dx, dy = (int(v) for v in args.move.split(",", 1))
+        except ValueError:
+            raise SystemExit(f"invalid --move value: {args.move}")
+        seq += mouse_records(dx, dy, False)
+    if args.click:
+        seq += mouse_records(0, 0, True) + mouse_records(0, 0, False)
+    for code in args.key:
+        seq += key_record(code, False, args.modifiers) + key_record(code, True, args.modifiers)
+    if not seq:
+        parser.error("nothing to send")
+
+    _dev, ep_out = open_device()
+    for i in range(args.repeat):
+        ep_out.write(bytes(seq), timeout=1000)
+        if args.interval > 0 and i + 1 < args.repeat:
+            time.sleep(args.interval)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
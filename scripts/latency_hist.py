@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+import time
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+CTRL_REQ_GET_LATENCY_HIST = 0x83
+HIST_READ_MAX = 1024
+
+# Must match lat_hist_header_t / lat_hist_stage_t in src/latency_hist.h.
+HEADER_FORMAT = "<HHHHI"
+HEADER_BYTES = struct.calcsize(HEADER_FORMAT)
+
+STAGES = ("vsync_irq", "finalize", "postprocess_wait", "line_encode",
+          "enqueue", "service_txq", "tud_task")
+
+
+def open_device():
+    try:
+        import usb.core
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    return dev
+
+
+def read_hist(dev, reset: bool) -> bytes:
+    # 0xC1 = Device-to-Host | Vendor | Interface recipient
+    try:
+        return bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_LATENCY_HIST, 1 if reset else 0, 0,
+                                       HIST_READ_MAX))
+    except Exception as exc:
+        raise SystemExit(f"histogram request failed ({exc}); "
+                         "is the firmware built with -DEBD_IPKVM_LATENCY_HIST=ON?")
+
+
+def parse_hist(raw: bytes):
+    if len(raw) < HEADER_BYTES:
+        raise SystemExit(f"short histogram reply: {len(raw)} bytes")
+    version, stage_count, buckets, _, clk_hz = struct.unpack(HEADER_FORMAT, raw[:HEADER_BYTES])
+    if version != 1:
+        raise SystemExit(f"unsupported histogram version {version}")
+    stage_fmt = f"<I{buckets}I"
+    stage_bytes = struct.calcsize(stage_fmt)
+    stages = []
+    for i in range(stage_count):
+        off = HEADER_BYTES + i * stage_bytes
+        if off + stage_bytes > len(raw):
+            break
+        vals = struct.unpack(stage_fmt, raw[off:off + stage_bytes])
+        stages.append((vals[0], list(vals[1:])))
+    return clk_hz, stages
+
+
+def bucket_percentile(counts, pct: float) -> int:
+    # Upper bound (in cycles) of the bucket holding the pct-th sample.
+    total = sum(counts)
+    if total == 0:
+        return 0
+    target = total * pct / 100.0
+    seen = 0
+    for b, n in enumerate(counts):
+        seen += n
+        if seen >= target:
+            return 0 if b == 0 else (1 << b) - 1
+    return (1 << (len(counts) - 1)) - 1
+
+
+def print_hist(clk_hz: int, stages) -> None:
+    cyc_per_us = clk_hz / 1e6 if clk_hz else 125.0
+    print(f"clk_sys={clk_hz} Hz; percentiles are log2 bucket upper bounds")
+    print(f"{'stage':18s} {'samples':>9s} {'p50':>10s} {'p90':>10s} {'p99':>10s} {'max':>10s}  (us)")
+    for i, (max_cycles, counts) in enumerate(stages):
+        name = STAGES[i] if i < len(STAGES) else f"stage{i}"
+        total = sum(counts)
+        cols = [min(bucket_percentile(counts, p), max_cycles) / cyc_per_us for p in (50, 90, 99)]
+        cols.append(max_cycles / cyc_per_us)
+        print(f"{name:18s} {total:9d} " + " ".join(f"{v:10.2f}" for v in cols))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Read per-stage SysTick latency histograms over EP0.")
+    parser.add_argument("--reset", action="store_true", help="Clear the device histograms after reading.")
+    parser.add_argument("--watch", type=float, default=0.0,
+                        help="Read-and-reset every N seconds until interrupted.")
+    args = parser.parse_args()
+
+    dev = open_device()
+    try:
+        while True:
+            clk_hz, stages = parse_hist(read_hist(dev, args.reset or args.watch > 0))
+            print_hist(clk_hz, stages)
+            if args.watch <= 0:
+                break
+            print()
+            time.sleep(args.watch)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
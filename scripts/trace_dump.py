@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+import argparse
+import struct
+import sys
+
+USB_VID = 0x2E8A
+USB_PID = 0x000A
+
+CTRL_REQ_GET_TRACE = 0x82
+TRACE_READ_MAX = 4096
+
+# Must match frame_trace_header_t / frame_trace_entry_t in src/frame_trace.h.
+HEADER_FORMAT = "<HHHHI"
+ENTRY_FORMAT = "<IHBBI"
+HEADER_BYTES = struct.calcsize(HEADER_FORMAT)
+
+EVENTS = {
+    1: "vsync",
+    2: "vsync_ignored",
+    3: "capture_start",
+    4: "dma_done",
+    5: "postprocess_done",
+    6: "first_line_enq",
+    7: "last_line_enq",
+    8: "usb_last_byte",
+    9: "overrun",
+    10: "frame_short",
+    11: "line_drop",
+    12: "out_of_spec",
+}
+OOS_RX_STALL = 0x80000000
+IGNORE_REASONS = {1: "debounce", 2: "diag", 3: "capturing", 4: "idle", 5: "tx_busy", 6: "cadence",
+                  7: "bench"}
+
+# Columns of the per-frame timeline, in pipeline order.
+STAGES = ("capture_start", "dma_done", "postprocess_done",
+          "first_line_enq", "last_line_enq", "usb_last_byte")
+NOTE_KEYS = ("overrun", "frame_short", "line_drop", "oos", "rx_stall")
+
+
+def open_device():
+    try:
+        import usb.core
+    except ImportError as exc:
+        raise SystemExit(f"pyusb not available: {exc}. Install python3-usb or pyusb.")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        raise SystemExit("USB device not found (VID/PID 0x2E8A:0x000A).")
+    return dev
+
+
+def read_trace(dev) -> bytes:
+    # 0xC1 = Device-to-Host | Vendor | Interface recipient
+    return bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_TRACE, 0, 0, TRACE_READ_MAX))
+
+
+def parse_trace(raw: bytes) -> list:
+    if len(raw) < HEADER_BYTES:
+        raise SystemExit(f"short trace reply: {len(raw)} bytes")
+    version, entry_bytes, depth, _, head = struct.unpack(HEADER_FORMAT, raw[:HEADER_BYTES])
+    if version != 1 or entry_bytes != struct.calcsize(ENTRY_FORMAT):
+        raise SystemExit(f"unsupported trace layout (version={version}, entry_bytes={entry_bytes})")
+    entries = []
+    for i in range(depth):
+        off = HEADER_BYTES + i * entry_bytes
+        if off + entry_bytes > len(raw):
+            break
+        entries.append(struct.unpack(ENTRY_FORMAT, raw[off:off + entry_bytes]))
+    # Rotate into recording order: oldest entry sits at head % depth once wrapped.
+    count = min(head, len(entries))
+    start = head % depth if head >= depth else 0
+    ordered = [entries[(start + i) % depth] for i in range(count)]
+    return [e for e in ordered if e[2] in EVENTS]
+
+
+def unwrap_times(entries: list) -> list:
+    out = []
+    base = None
+    last = 0
+    offset = 0
+    for t_us, frame_id, event, core, value in entries:
+        if base is None:
+            base = t_us
+        rel = ((t_us - base) & 0xFFFFFFFF) + offset
+        # Cross-core records may land slightly out of order; only treat large
+        # backwards steps as a 32-bit wrap.
+        if rel + 0x80000000 < last:
+            offset += 1 << 32
+            rel += 1 << 32
+        last = max(last, rel)
+        out.append((rel, frame_id, EVENTS[event], core, value))
+    return out
+
+
+def print_events(events: list) -> None:
+    for rel, frame_id, name, core, value in events:
+        note = ""
+        if name == "vsync_ignored":
+            note = IGNORE_REASONS.get(value, str(value))
+        elif name == "out_of_spec":
+            note = f"lines={value & ~OOS_RX_STALL}" + (" rx_stall" if value & OOS_RX_STALL else "")
+        elif value:
+            note = str(value)
+        print(f"{rel / 1000:10.3f} ms  core{core}  frame={frame_id:5d}  {name:16s} {note}".rstrip())
+
+
+def print_timeline(events: list) -> None:
+    frames = {}
+    order = []
+    for rel, frame_id, name, _, value in events:
+        if name in ("vsync_ignored",):
+            continue
+        if frame_id not in frames:
+            frames[frame_id] = {}
+            order.append(frame_id)
+        stage = frames[frame_id]
+        if name in ("overrun", "frame_short", "line_drop"):
+            stage[name] = stage.get(name, 0) + 1
+        elif name == "out_of_spec":
+            stage["oos"] = value & ~OOS_RX_STALL
+            if value & OOS_RX_STALL:
+                stage["rx_stall"] = 1
+        else:
+            stage.setdefault(name, rel)
+
+    header = "frame   " + " ".join(f"{s:>16s}" for s in STAGES) + "  notes"
+    print(header)
+    for frame_id in order:
+        stage = frames[frame_id]
+        t0 = stage.get("vsync", stage.get("capture_start"))
+        cols = []
+        for name in STAGES:
+            if name in stage and t0 is not None:
+                cols.append(f"{(stage[name] - t0) / 1000:+16.3f}")
+            else:
+                cols.append(f"{'-':>16s}")
+        notes = " ".join(f"{k}={stage[k]}" for k in NOTE_KEYS if k in stage)
+        print((f"{frame_id:5d}   " + " ".join(cols) + f"  {notes}").rstrip())
+    print("(ms relative to the accepted VSYNC of each frame; '-' = stage not reached or evicted)")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Dump the device frame pipeline trace ring over EP0.")
+    parser.add_argument("--events", action="store_true", help="List every event instead of a per-frame timeline.")
+    parser.add_argument("--save", metavar="PATH", help="Also write the raw dump to PATH.")
+    parser.add_argument("--load", metavar="PATH", help="Render a previously saved dump instead of reading the device.")
+    args = parser.parse_args()
+
+    if args.load:
+        with open(args.load, "rb") as f:
+            raw = f.read()
+    else:
+        raw = read_trace(open_device())
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(raw)
+
+    events = unwrap_times(parse_trace(raw))
+    if not events:
+        print("trace is empty")
+        return 0
+    if args.events:
+        print_events(events)
+    else:
+        print_timeline(events)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
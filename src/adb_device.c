@@ -0,0 +1,450 @@
+#include "adb_device.h"
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "adb_device.pio.h"
+
+#define ADB_KEY_QUEUE_LEN 16u
+#define ADB_KEY_QUEUE_MASK (ADB_KEY_QUEUE_LEN - 1u)
+#define ADB_MOUSE_QUEUE_LEN 8u
+#define ADB_MOUSE_QUEUE_MASK (ADB_MOUSE_QUEUE_LEN - 1u)
+#define ADB_MOUSE_DELTA_MIN (-64)
+#define ADB_MOUSE_DELTA_MAX 63
+#define ADB_MOUSE_ACC_MAX 4096
+
+// Command byte: address in the high nibble, then command and register.
+#define ADB_CMD_RESET 0x00u
+#define ADB_CMD_FLUSH 0x01u
+#define ADB_CMD_LISTEN 0x08u
+#define ADB_CMD_TALK 0x0Cu
+
+// Listen R3 handler IDs with a fixed meaning.
+#define ADB_HANDLER_SET_ADDR_SRQ 0x00u
+#define ADB_HANDLER_SET_ADDR 0xFEu
+
+// Loop overhead of one reply word (adb_device.pio, 2 cycles per us): the line
+// is released for Y + 3 us and held low for X + 1.5 us.
+#define ADB_TX_HIGH_OVERHEAD_US 3u
+#define ADB_TX_LOW_OVERHEAD_US 2u
+// SRQ + start bit + 16 data bits + stop bit + end word.
+#define ADB_REPLY_WORDS_MAX 20u
+
+typedef enum {
+    ADB_RX_IDLE = 0, // ignore everything until the next attention pulse
+    ADB_RX_CMD,      // command bits
+    ADB_RX_LISTEN,   // command stop bit, start bit, 16 data bits
+} adb_rx_state_t;
+
+typedef struct adb_dev {
+    uint8_t addr;
+    uint8_t handler;
+    bool srq_enable;
+} adb_dev_t;
+
+// Motion with one button state; the head is reported first.
+typedef struct adb_mouse_seg {
+    bool down;
+    bool reported; // the button state has gone out at least once
+    int16_t dx;
+    int16_t dy;
+} adb_mouse_seg_t;
+
+static PIO adb_pio;
+static uint adb_sm;
+static uint adb_offset;
+static int reply_dma_chan = -1;
+static dma_channel_config reply_dma_cfg;
+static uint32_t reply_words[ADB_REPLY_WORDS_MAX];
+
+static adb_dev_t kbd;
+static adb_dev_t mouse;
+static uint8_t kbd_modifiers = 0xFF; // Talk R2 byte 0, as of the last key reported
+static uint8_t kbd_leds = 0xFF;      // Talk R2 byte 1, set by Listen R2
+
+// Shared between adb_device_feed() and the IRQ; writers outside the IRQ mask
+// interrupts.
+static uint8_t key_queue[ADB_KEY_QUEUE_LEN];
+static uint8_t key_mods[ADB_KEY_QUEUE_LEN]; // modifiers the host sent with each key
+static uint8_t key_r = 0;
+static uint8_t key_w = 0;
+static adb_mouse_seg_t mouse_queue[ADB_MOUSE_QUEUE_LEN];
+static uint8_t mouse_r = 0;
+static uint8_t mouse_w = 0;
+
+// IRQ only.
+static uint32_t last_x = 0;
+static adb_rx_state_t rx_state = ADB_RX_IDLE;
+static uint8_t rx_bits = 0;
+static uint16_t rx_data = 0;
+static adb_dev_t *listen_dev = NULL;
+static uint8_t listen_reg = 0;
+
+static input_event_reader_t reader;
+static input_counters_t counters;
+static adb_device_counters_t bus_counters;
+
+static inline uint8_t key_count(void) {
+    return (uint8_t)((key_w - key_r) & 0xFFu);
+}
+
+static inline uint8_t mouse_count(void) {
+    return (uint8_t)((mouse_w - mouse_r) & 0xFFu);
+}
+
+static inline int clamp(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void reset_devices(void) {
+    kbd = (adb_dev_t){.addr = ADB_KEYBOARD_ADDR, .handler = ADB_KEYBOARD_HANDLER, .srq_enable = true};
+    mouse = (adb_dev_t){.addr = ADB_MOUSE_ADDR, .handler = ADB_MOUSE_HANDLER, .srq_enable = true};
+    kbd_leds = 0xFF;
+    key_r = key_w;
+    mouse_r = mouse_w;
+}
+
+static void queue_mouse(bool down, int dx, int dy) {
+    uint32_t irq = save_and_disable_interrupts();
+    // Merge into the tail while the button state matches, so motion never
+    // moves past a click. A reported tail stays queued to merge into.
+    adb_mouse_seg_t *tail = mouse_count() ? &mouse_queue[(mouse_w - 1u) & ADB_MOUSE_QUEUE_MASK] : NULL;
+    if (tail && tail->down == down) {
+        tail->dx = (int16_t)clamp(tail->dx + dx, -ADB_MOUSE_ACC_MAX, ADB_MOUSE_ACC_MAX);
+        tail->dy = (int16_t)clamp(tail->dy + dy, -ADB_MOUSE_ACC_MAX, ADB_MOUSE_ACC_MAX);
+        counters.coalesced++;
+    } else if (mouse_count() >= ADB_MOUSE_QUEUE_LEN) {
+        counters.dropped++;
+    } else {
+        mouse_queue[mouse_w & ADB_MOUSE_QUEUE_MASK] = (adb_mouse_seg_t){
+            .down = down,
+            .dx = (int16_t)dx,
+            .dy = (int16_t)dy,
+        };
+        mouse_w++;
+    }
+    restore_interrupts(irq);
+}
+
+static void queue_key(uint8_t code, bool up, uint8_t modifiers) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (key_count() >= ADB_KEY_QUEUE_LEN) {
+        counters.dropped++;
+    } else {
+        key_queue[key_w & ADB_KEY_QUEUE_MASK] = (uint8_t)((code & 0x7Fu) | (up ? 0x80u : 0u));
+        key_mods[key_w & ADB_KEY_QUEUE_MASK] = modifiers;
+        key_w++;
+    }
+    restore_interrupts(irq);
+}
+
+static void handle_record(const uint8_t *rec) {
+    switch (rec[0]) {
+    case INPUT_EV_MOUSE:
+        counters.events++;
+        queue_mouse((rec[1] & 0x01u) != 0, (int8_t)rec[2], (int8_t)rec[3]);
+        break;
+    case INPUT_EV_KEY:
+        counters.events++;
+        queue_key(rec[1], (rec[2] & 0x01u) != 0, rec[3]);
+        break;
+    default:
+        counters.bad++;
+        break;
+    }
+}
+
+// Talk R0 payloads. Both run in the IRQ. Talk R2 reports the modifiers of the
+// last key taken, so it never runs ahead of keys still queued.
+static bool take_keys(uint16_t *out) {
+    if (key_count() == 0) {
+        return false;
+    }
+    uint8_t first = key_queue[key_r & ADB_KEY_QUEUE_MASK];
+    kbd_modifiers = key_mods[key_r & ADB_KEY_QUEUE_MASK];
+    key_r++;
+    uint8_t second = 0xFF;
+    if (key_count() > 0) {
+        second = key_queue[key_r & ADB_KEY_QUEUE_MASK];
+        kbd_modifiers = key_mods[key_r & ADB_KEY_QUEUE_MASK];
+        key_r++;
+    }
+    *out = (uint16_t)((first << 8) | second);
+    return true;
+}
+
+static inline bool seg_done(const adb_mouse_seg_t *seg) {
+    return seg->reported && seg->dx == 0 && seg->dy == 0;
+}
+
+// Drop fully reported segments ahead of the tail. True if the head still has
+// something for Talk R0.
+static bool mouse_pending(void) {
+    while (mouse_count() > 1 && seg_done(&mouse_queue[mouse_r & ADB_MOUSE_QUEUE_MASK])) {
+        mouse_r++;
+    }
+    return mouse_count() > 0 && !seg_done(&mouse_queue[mouse_r & ADB_MOUSE_QUEUE_MASK]);
+}
+
+static bool take_mouse(uint16_t *out) {
+    if (!mouse_pending()) {
+        return false;
+    }
+    adb_mouse_seg_t *seg = &mouse_queue[mouse_r & ADB_MOUSE_QUEUE_MASK];
+    int dx = clamp(seg->dx, ADB_MOUSE_DELTA_MIN, ADB_MOUSE_DELTA_MAX);
+    int dy = clamp(seg->dy, ADB_MOUSE_DELTA_MIN, ADB_MOUSE_DELTA_MAX);
+    seg->dx = (int16_t)(seg->dx - dx);
+    seg->dy = (int16_t)(seg->dy - dy);
+    seg->reported = true;
+    // Button bits are active low; bit 7 of the low byte is the (absent)
+    // second button.
+    *out = (uint16_t)((((seg->down ? 0u : 0x80u) | ((uint8_t)dy & 0x7Fu)) << 8) |
+                      0x80u | ((uint8_t)dx & 0x7Fu));
+    return true;
+}
+
+static inline uint32_t reply_word(uint32_t high_us, uint32_t low_us) {
+    uint32_t y = high_us > ADB_TX_HIGH_OVERHEAD_US ? high_us - ADB_TX_HIGH_OVERHEAD_US : 0u;
+    uint32_t x = low_us > ADB_TX_LOW_OVERHEAD_US + 1u ? low_us - ADB_TX_LOW_OVERHEAD_US : 1u;
+    return y | (x << 16);
+}
+
+// The stop bit already ended (pushed behind the eighth bit): too late to
+// stretch it, and a reply now would land in the next command.
+static bool reply_window_open(void) {
+    if (!pio_sm_is_rx_fifo_empty(adb_pio, adb_sm) || dma_channel_is_busy((uint)reply_dma_chan)) {
+        bus_counters.late++;
+        return false;
+    }
+    return true;
+}
+
+// Start the reply at the command's stop bit: an optional SRQ, then optional
+// data, then the end word that puts the SM back on rx. Callers check
+// reply_window_open() first.
+static void start_reply(bool srq, const uint16_t *data) {
+    uint n = 0;
+    uint32_t high = ADB_BIT0_LOW_US + ADB_TLT_US; // from the stop bit's falling edge
+    if (srq) {
+        reply_words[n++] = reply_word(0, ADB_SRQ_US);
+        high = ADB_TLT_US;
+        bus_counters.srqs++;
+    }
+    if (data) {
+        uint32_t prev_low = ADB_BIT1_LOW_US;
+        reply_words[n++] = reply_word(high, prev_low); // start bit (1)
+        for (int bit = 15; bit >= 0; bit--) {
+            uint32_t low = ((*data >> bit) & 1u) ? ADB_BIT1_LOW_US : ADB_BIT0_LOW_US;
+            reply_words[n++] = reply_word(ADB_BIT_CELL_US - prev_low, low);
+            prev_low = low;
+        }
+        reply_words[n++] = reply_word(ADB_BIT_CELL_US - prev_low, ADB_BIT0_LOW_US); // stop bit (0)
+        bus_counters.replies++;
+    }
+    reply_words[n++] = 0;
+
+    dma_channel_configure((uint)reply_dma_chan, &reply_dma_cfg,
+                          &adb_pio->txf[adb_sm],
+                          reply_words,
+                          n,
+                          true);
+    pio_sm_exec(adb_pio, adb_sm, pio_encode_jmp(adb_offset + adb_device_offset_reply));
+    // The end word leaves X at 0 when rx resumes. A stop bit that ended
+    // between reply_window_open() and the jmp was pushed with the old X and
+    // would read as a reset against that; drop it.
+    last_x = 0;
+    while (!pio_sm_is_rx_fifo_empty(adb_pio, adb_sm)) {
+        (void)pio_sm_get(adb_pio, adb_sm);
+        bus_counters.late++;
+    }
+}
+
+static void listen_done(void) {
+    uint8_t hi = (uint8_t)(rx_data >> 8);
+    uint8_t lo = (uint8_t)rx_data;
+    if (listen_reg == 2 && listen_dev == &kbd) {
+        kbd_leds = lo;
+    } else if (listen_reg == 3) {
+        if (lo == ADB_HANDLER_SET_ADDR_SRQ) {
+            listen_dev->addr = hi & 0x0Fu;
+            listen_dev->srq_enable = (hi & 0x20u) != 0;
+        } else if (lo == ADB_HANDLER_SET_ADDR) {
+            listen_dev->addr = hi & 0x0Fu;
+        } else if (listen_dev == &kbd ? (lo >= 1u && lo <= 3u) : (lo >= 1u && lo <= 2u)) {
+            listen_dev->handler = lo;
+        }
+    }
+}
+
+static void handle_command(uint8_t cmd) {
+    bus_counters.commands++;
+    uint8_t addr = cmd >> 4;
+    uint8_t code = cmd & 0x0Fu;
+    if (code == ADB_CMD_RESET) {
+        bus_counters.resets++;
+        reset_devices();
+        return;
+    }
+    adb_dev_t *dev = addr == kbd.addr ? &kbd : (addr == mouse.addr ? &mouse : NULL);
+
+    // SRQ from whichever device has input the command is not asking for.
+    bool srq = (key_count() > 0 && kbd.srq_enable && dev != &kbd) ||
+               (mouse_pending() && mouse.srq_enable && dev != &mouse);
+
+    if (code == ADB_CMD_FLUSH) {
+        if (dev == &kbd) {
+            key_r = key_w;
+        } else if (dev == &mouse) {
+            mouse_r = mouse_w;
+        }
+    } else if (dev && (code & 0x0Cu) == ADB_CMD_LISTEN) {
+        // The host drives the data bits; no SRQ on our own Listen.
+        listen_dev = dev;
+        listen_reg = code & 0x03u;
+        rx_state = ADB_RX_LISTEN;
+        rx_bits = 0;
+        rx_data = 0;
+        return;
+    } else if (dev && (code & 0x0Cu) == ADB_CMD_TALK) {
+        // Check before taking input so a missed reply keeps its data.
+        if (!reply_window_open()) {
+            return;
+        }
+        uint16_t data = 0;
+        bool have = false;
+        switch (code & 0x03u) {
+        case 0:
+            have = (dev == &kbd) ? take_keys(&data) : take_mouse(&data);
+            if (have) {
+                counters.sent++;
+            }
+            break;
+        case 2:
+            if (dev == &kbd) {
+                data = (uint16_t)((kbd_modifiers << 8) | kbd_leds);
+                have = true;
+            }
+            break;
+        case 3:
+            data = (uint16_t)(((0x40u | (dev->srq_enable ? 0x20u : 0u) | dev->addr) << 8) | dev->handler);
+            have = true;
+            break;
+        default:
+            break;
+        }
+        if (have || srq) {
+            start_reply(srq, have ? &data : NULL);
+        }
+        return;
+    }
+    if (srq && reply_window_open()) {
+        start_reply(true, NULL);
+    }
+}
+
+static void handle_pulse(uint32_t low_us) {
+    if (low_us < ADB_GLITCH_US) {
+        return;
+    }
+    if (low_us >= ADB_RESET_MIN_US) {
+        bus_counters.resets++;
+        reset_devices();
+        rx_state = ADB_RX_IDLE;
+        return;
+    }
+    if (low_us >= ADB_ATTN_MIN_US) {
+        rx_state = ADB_RX_CMD;
+        rx_bits = 0;
+        rx_data = 0;
+        return;
+    }
+    switch (rx_state) {
+    case ADB_RX_CMD:
+        if (low_us > ADB_BIT_MAX_US) {
+            rx_state = ADB_RX_IDLE;
+            return;
+        }
+        rx_data = (uint16_t)((rx_data << 1) | (low_us < ADB_BIT_THRESHOLD_US ? 1u : 0u));
+        if (++rx_bits == 8) {
+            rx_state = ADB_RX_IDLE;
+            handle_command((uint8_t)rx_data);
+        }
+        break;
+    case ADB_RX_LISTEN:
+        // Pulse 0 is the command stop bit (maybe stretched by another
+        // device's SRQ), pulse 1 the start bit.
+        if (rx_bits++ < 2) {
+            return;
+        }
+        if (low_us > ADB_BIT_MAX_US) {
+            rx_state = ADB_RX_IDLE;
+            return;
+        }
+        rx_data = (uint16_t)((rx_data << 1) | (low_us < ADB_BIT_THRESHOLD_US ? 1u : 0u));
+        if (rx_bits == 18) {
+            rx_state = ADB_RX_IDLE;
+            listen_done();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void adb_pio_irq_handler(void) {
+    while (!pio_sm_is_rx_fifo_empty(adb_pio, adb_sm)) {
+        uint32_t x = pio_sm_get(adb_pio, adb_sm);
+        uint32_t low_us = last_x - x;
+        last_x = x;
+        handle_pulse(low_us);
+    }
+}
+
+void adb_device_init(PIO pio, uint sm, uint offset, uint pin) {
+    adb_pio = pio;
+    adb_sm = sm;
+    adb_offset = offset;
+    reset_devices();
+
+    reply_dma_chan = dma_claim_unused_channel(true);
+    reply_dma_cfg = dma_channel_get_default_config((uint)reply_dma_chan);
+    channel_config_set_transfer_data_size(&reply_dma_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&reply_dma_cfg, true);
+    channel_config_set_write_increment(&reply_dma_cfg, false);
+    channel_config_set_dreq(&reply_dma_cfg, pio_get_dreq(pio, sm, true));
+
+    adb_device_program_init(pio, sm, offset, pin);
+
+    // Commands must be decoded within one bit cell of the eighth bit, so the
+    // handler runs above USB (0x40 preempts the default 0x80 that the USB IRQ
+    // keeps) and never shares a line with capture (PIO0, core1).
+    uint irq = pio_get_index(pio) ? PIO1_IRQ_0 : PIO0_IRQ_0;
+    pio_set_irq0_source_enabled(pio, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + sm), true);
+    irq_set_exclusive_handler(irq, adb_pio_irq_handler);
+    irq_set_priority(irq, 0x40);
+    irq_set_enabled(irq, true);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+void adb_device_feed(const uint8_t *data, uint32_t len) {
+    input_event_reader_feed(&reader, data, len, handle_record);
+}
+
+void adb_device_get_counters(input_counters_t *out) {
+    *out = counters;
+}
+
+void adb_device_get_bus_counters(adb_device_counters_t *out) {
+    *out = bus_counters;
+}
+
+void adb_device_reset_counters(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    memset(&counters, 0, sizeof(counters));
+    memset(&bus_counters, 0, sizeof(bus_counters));
+    restore_interrupts(irq);
+}
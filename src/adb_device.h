@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+#include "input_events.h"
+
+// Build-time switch (CMake option EBD_IPKVM_ADB). When on, the firmware is
+// the ADB keyboard and mouse itself: a PIO1 state machine (adb_device.pio)
+// measures the bus and plays replies fed by DMA, and a PIO1 IRQ on core0
+// decodes commands. The vendor bulk OUT records go here instead of to the
+// external controller on UART1 (input_uart.c), which is not compiled in.
+#ifndef EBD_IPKVM_ADB
+#define EBD_IPKVM_ADB 0
+#endif
+
+// Power-on addresses and handler IDs.
+#define ADB_KEYBOARD_ADDR 2
+#define ADB_MOUSE_ADDR 3
+#define ADB_KEYBOARD_HANDLER 2 // Apple Extended Keyboard
+#define ADB_MOUSE_HANDLER 1    // 100 cpi mouse
+
+// Bus timing in us (Inside Macintosh / Guide to the Macintosh Family Hardware).
+#define ADB_BIT_CELL_US 100u
+#define ADB_BIT1_LOW_US 35u
+#define ADB_BIT0_LOW_US 65u
+#define ADB_BIT_THRESHOLD_US 50u // shorter low = 1
+#define ADB_BIT_MAX_US 90u
+#define ADB_GLITCH_US 10u        // shorter lows are noise (and the rx restart)
+#define ADB_ATTN_MIN_US 560u     // attention is 800 us nominal
+#define ADB_RESET_MIN_US 2800u   // global reset is >= 3 ms
+#define ADB_TLT_US 180u          // stop bit to reply start bit; Arduino/src/adb.cpp
+#define ADB_SRQ_US 300u          // stop bit stretched by a service request
+
+typedef struct adb_device_counters {
+    uint32_t commands; // commands decoded (any address)
+    uint32_t replies;  // Talk replies played
+    uint32_t srqs;     // service requests asserted
+    uint32_t late;     // replies/SRQs skipped because the stop bit had passed
+    uint32_t resets;   // SendReset commands and reset pulses
+} adb_device_counters_t;
+
+// core0: start the state machine, claim the reply DMA channel and enable the
+// PIO IRQ. Call after pio_add_program(pio, &adb_device_program).
+void adb_device_init(PIO pio, uint sm, uint offset, uint pin);
+// core0: feed bytes read from the OUT endpoint; records may span calls.
+void adb_device_feed(const uint8_t *data, uint32_t len);
+
+// sent counts Talk R0 replies that carried input.
+void adb_device_get_counters(input_counters_t *out);
+void adb_device_get_bus_counters(adb_device_counters_t *out);
+void adb_device_reset_counters(void);
@@ -10,9 +10,17 @@
 #include "hardware/watchdog.h"
 #include "tusb.h"
 
+#include "adb_device.h"
+#include "bench_frames.h"
 #include "core_bridge.h"
+#include "frame_trace.h"
+#include "input_uart.h"
+#include "latency_hist.h"
+#include "line_monitor.h"
+#include "signal_counter.h"
 #include "stream_protocol.h"
 #include "usb_control.h"
+#include "uvc_stream.h"
 #include "video_capture.h"
 #include "video_core.h"
 
@@ -22,6 +30,39 @@
 
 #define CDC_CTRL 0
 
+// One full-speed bulk OUT packet.
+#define INPUT_RX_CHUNK 64u
+
+// Input path: the on-chip ADB device, or the external controller on UART1.
+#if EBD_IPKVM_ADB
+static inline void input_feed(const uint8_t *data, uint32_t len) {
+    adb_device_feed(data, len);
+}
+static inline bool input_service(uint32_t now_us) {
+    (void)now_us;
+    return false; // the PIO1 IRQ answers the Mac's polls
+}
+static inline void input_get_counters(input_counters_t *out) {
+    adb_device_get_counters(out);
+}
+static inline void input_reset_counters(void) {
+    adb_device_reset_counters();
+}
+#else
+static inline void input_feed(const uint8_t *data, uint32_t len) {
+    input_uart_feed(data, len);
+}
+static inline bool input_service(uint32_t now_us) {
+    return input_uart_service(now_us);
+}
+static inline void input_get_counters(input_counters_t *out) {
+    input_uart_get_counters(out);
+}
+static inline void input_reset_counters(void) {
+    input_uart_reset_counters();
+}
+#endif
+
 #define CDC_CTRL_RING_SIZE 1024u
 #define CDC_CTRL_RING_MASK (CDC_CTRL_RING_SIZE - 1u)
 
@@ -30,29 +71,69 @@ static app_core_config_t app_cfg;
 static volatile bool ps_on_state = false;
 static uint32_t usb_drops = 0;
 static uint16_t txq_offset = 0;
+static uint16_t txq_hold_seq = CORE_BRIDGE_SEQ_NONE;
 
 static uint8_t probe_buf[APP_PKT_MAX_BYTES];
+
+// In-band telemetry: a usb_ctrl_stats_t snapshot sent on the bulk endpoint
+// between video packets.
+#define TELEMETRY_PKT_BYTES (STREAM_HEADER_BYTES + sizeof(usb_ctrl_stats_t))
+static uint8_t telemetry_buf[TELEMETRY_PKT_BYTES];
+static uint16_t telemetry_len = 0;
+static uint16_t telemetry_offset = 0;
+static uint16_t telemetry_seq = 0;
+static uint16_t telemetry_interval_ms = 0;
+static uint32_t telemetry_due_us = 0;
 static volatile uint8_t probe_pending = 0;
 static uint16_t probe_offset = 0;
 static volatile bool debug_requested = false;
 static uint32_t core0_busy_us = 0;
 static uint32_t core0_total_us = 0;
-static volatile uint8_t ep0_cmd_queue[8];
+static usb_ctrl_cmd_t ep0_cmd_queue[8];
 static volatile uint8_t ep0_cmd_r = 0;
 static volatile uint8_t ep0_cmd_w = 0;
 
-static volatile uint32_t diag_pixclk_edges = 0;
-static volatile uint32_t diag_hsync_edges = 0;
-static volatile uint32_t diag_vsync_edges = 0;
-static volatile uint32_t diag_video_edges = 0;
-
 static uint8_t cdc_ctrl_ring[CDC_CTRL_RING_SIZE];
 static uint16_t cdc_ctrl_ring_r = 0;
 static uint16_t cdc_ctrl_ring_w = 0;
 static bool cdc_ctrl_connected = false;
 
+#define ACK_NOTE_SLOTS 4
+
+typedef struct ack_note {
+    uint16_t seq;
+    const char *text;      // printed once core1 acks CORE_BRIDGE_RESULT_OK
+    const char *fail_text; // printed for any other result (NULL: text)
+} ack_note_t;
+
+static ack_note_t ack_notes[ACK_NOTE_SLOTS];
+
+// Commands for core1 that found the bridge ring full. They are sent in order
+// from service_core_acks as core1 drains the ring, and hold the TX queue while
+// they wait, since one of them may be STOP_CAPTURE.
+#define CORE_CMD_DEFER_SLOTS 4
+
+typedef struct core_cmd {
+    core_bridge_cmd_t code;
+    uint32_t args[CORE_BRIDGE_MAX_ARGS];
+    uint8_t nargs;
+    bool hold_txq;
+    const char *text;
+    const char *fail_text;
+} core_cmd_t;
+
+static core_cmd_t core_cmd_defer[CORE_CMD_DEFER_SLOTS];
+static uint8_t core_cmd_defer_r = 0;
+static uint8_t core_cmd_defer_n = 0;
+static uint16_t core_cmd_last_seq = CORE_BRIDGE_SEQ_NONE;
+static uint32_t core_cmd_dropped = 0;
+
 static absolute_time_t status_next;
 static uint32_t status_last_lines = 0;
+static uint32_t status_lines_per_s = 0;
+static uint32_t status_vsync_per_s = 0;
+static uint8_t status_core0_pct = 0;
+static uint8_t status_core1_pct = 0;
 
 #if (CDC_CTRL_RING_SIZE & (CDC_CTRL_RING_SIZE - 1u)) != 0
 #error "CDC_CTRL_RING_SIZE must be power-of-two"
@@ -67,13 +148,6 @@ static inline bool can_emit_text(void) {
     return tud_cdc_n_connected(CDC_CTRL);
 }
 
-static inline void reset_diag_counts(void) {
-    diag_pixclk_edges = 0;
-    diag_hsync_edges = 0;
-    diag_vsync_edges = 0;
-    diag_video_edges = 0;
-}
-
 static inline void take_core0_utilization(uint32_t *busy_us, uint32_t *total_us) {
     if (busy_us) {
         *busy_us = core0_busy_us;
@@ -94,14 +168,16 @@ static inline uint16_t cdc_ctrl_ring_space(void) {
     return (uint16_t)((cdc_ctrl_ring_r - cdc_ctrl_ring_w - 1u) & CDC_CTRL_RING_MASK);
 }
 
-bool app_core_enqueue_ep0_command(uint8_t cmd) {
+#define EP0_CMD_QUEUE_LEN ((uint8_t)(sizeof(ep0_cmd_queue) / sizeof(ep0_cmd_queue[0])))
+
+bool app_core_enqueue_ep0_command(const usb_ctrl_cmd_t *cmd) {
     uint8_t w = __atomic_load_n(&ep0_cmd_w, __ATOMIC_ACQUIRE);
     uint8_t r = __atomic_load_n(&ep0_cmd_r, __ATOMIC_ACQUIRE);
-    uint8_t next = (uint8_t)((w + 1u) % (uint8_t)sizeof(ep0_cmd_queue));
+    uint8_t next = (uint8_t)((w + 1u) % EP0_CMD_QUEUE_LEN);
     if (next == r) {
         return false;
     }
-    ep0_cmd_queue[w] = cmd;
+    ep0_cmd_queue[w] = *cmd;
     __atomic_store_n(&ep0_cmd_w, next, __ATOMIC_RELEASE);
     return true;
 }
@@ -211,71 +287,37 @@ static bool cdc_ctrl_ring_drain(void) {
     return wrote_any;
 }
 
-static inline void diag_accumulate_edges(bool pixclk, bool hsync, bool vsync, bool video,
-                                         bool *prev_pixclk, bool *prev_hsync,
-                                         bool *prev_vsync, bool *prev_video) {
-    if (pixclk != *prev_pixclk) diag_pixclk_edges++;
-    if (hsync != *prev_hsync) diag_hsync_edges++;
-    if (vsync != *prev_vsync) diag_vsync_edges++;
-    if (video != *prev_video) diag_video_edges++;
-    *prev_pixclk = pixclk;
-    *prev_hsync = hsync;
-    *prev_vsync = vsync;
-    *prev_video = video;
-}
-
-static void run_gpio_diag(void) {
-    const uint32_t diag_ms = 500;
-
-    gpio_set_function(app_cfg.pin_pixclk, GPIO_FUNC_SIO);
-    gpio_set_function(app_cfg.pin_hsync, GPIO_FUNC_SIO);
-    gpio_set_function(app_cfg.pin_video, GPIO_FUNC_SIO);
-
-    reset_diag_counts();
-
-    bool prev_pixclk = gpio_get(app_cfg.pin_pixclk);
-    bool prev_hsync = gpio_get(app_cfg.pin_hsync);
-    bool prev_vsync = gpio_get(app_cfg.pin_vsync);
-    bool prev_video = gpio_get(app_cfg.pin_video);
-
-    absolute_time_t end = make_timeout_time_ms(diag_ms);
-    while (absolute_time_diff_us(get_absolute_time(), end) > 0) {
-        tud_task();
-        bool pixclk = gpio_get(app_cfg.pin_pixclk);
-        bool hsync = gpio_get(app_cfg.pin_hsync);
-        bool vsync = gpio_get(app_cfg.pin_vsync);
-        bool video = gpio_get(app_cfg.pin_video);
-        diag_accumulate_edges(pixclk, hsync, vsync, video,
-                              &prev_pixclk, &prev_hsync, &prev_vsync, &prev_video);
-        sleep_us(2);
-        tight_loop_contents();
+static void emit_signal_line(void) {
+    char line[160];
+    int len = snprintf(line, sizeof(line), "[EBD_IPKVM] sig");
+    for (uint i = 0; i < SIGNAL_COUNT && len > 0 && len < (int)sizeof(line); i++) {
+        signal_rate_t rate;
+        signal_counter_get((signal_id_t)i, &rate);
+        len += snprintf(&line[len], sizeof(line) - (size_t)len, " %s=%luHz@%u.%02u%%",
+                        signal_counter_name((signal_id_t)i),
+                        (unsigned long)rate.hz,
+                        (unsigned)(rate.duty_bp / 100u),
+                        (unsigned)(rate.duty_bp % 100u));
     }
+    cdc_ctrl_printf("%s\n", line);
+}
 
-    bool pixclk = gpio_get(app_cfg.pin_pixclk);
-    bool hsync = gpio_get(app_cfg.pin_hsync);
-    bool vsync = gpio_get(app_cfg.pin_vsync);
-    bool video = gpio_get(app_cfg.pin_video);
-
-    gpio_set_function(app_cfg.pin_pixclk, GPIO_FUNC_PIO0);
-    gpio_set_function(app_cfg.pin_hsync, GPIO_FUNC_PIO0);
-    gpio_set_function(app_cfg.pin_video, GPIO_FUNC_PIO0);
-
-    cdc_ctrl_printf("[EBD_IPKVM] gpio diag: pixclk=%d hsync=%d vsync=%d video=%d edges/%.2fs pixclk=%lu hsync=%lu vsync=%lu video=%lu\n",
-                    pixclk ? 1 : 0,
-                    hsync ? 1 : 0,
-                    vsync ? 1 : 0,
-                    video ? 1 : 0,
-                    diag_ms / 1000.0,
-                    (unsigned long)diag_pixclk_edges,
-                    (unsigned long)diag_hsync_edges,
-                    (unsigned long)diag_vsync_edges,
-                    (unsigned long)diag_video_edges);
+// Instant pin levels plus the counters from the last 1 s window. Capture keeps running.
+static void emit_gpio_diag(void) {
+    cdc_ctrl_printf("[EBD_IPKVM] gpio diag: pixclk=%d hsync=%d vsync=%d video=%d\n",
+                    gpio_get(app_cfg.pin_pixclk) ? 1 : 0,
+                    gpio_get(app_cfg.pin_hsync) ? 1 : 0,
+                    gpio_get(app_cfg.pin_vsync) ? 1 : 0,
+                    gpio_get(app_cfg.pin_video) ? 1 : 0);
+    emit_signal_line();
 }
 
+// Starts only on a packet boundary of both the video and the telemetry stream.
 static bool try_send_probe_packet(void) {
     if (!stream_ready()) return false;
 
     if (probe_offset == 0) {
+        if (telemetry_len != 0 || txq_offset != 0) return false;
         stream_write_header(probe_buf, 0x55AAu, 0x1234u, CAP_BYTES_PER_LINE);
         memset(&probe_buf[STREAM_HEADER_BYTES], 0xA5, CAP_BYTES_PER_LINE);
     }
@@ -293,12 +335,13 @@ static bool try_send_probe_packet(void) {
         probe_offset = (uint16_t)(probe_offset + wrote);
     }
 
+    probe_offset = 0;
     stream_flush();
     return true;
 }
 
+// A probe already on its way is finished, not restarted.
 static inline void request_probe_packet(void) {
-    probe_offset = 0;
     probe_pending = 1;
 }
 
@@ -315,6 +358,10 @@ static void emit_debug_state(void) {
                     video_core_test_frame_active() ? 1 : 0,
                     __atomic_load_n(&probe_pending, __ATOMIC_ACQUIRE) ? 1 : 0,
                     video_core_get_vsync_edge() ? "fall" : "rise");
+    cdc_ctrl_printf("[EBD_IPKVM] dbg bridge defer=%u cmd_drop=%lu ack_ov=%lu\n",
+                    (unsigned)core_cmd_defer_n,
+                    (unsigned long)core_cmd_dropped,
+                    (unsigned long)core_bridge_get_ack_overflows());
     cdc_ctrl_printf("[EBD_IPKVM] dbg txq=%u/%u av=%d fr=%lu ln=%lu dr=%lu ov=%lu sh=%lu\n",
                     (unsigned)txq_r,
                     (unsigned)txq_w,
@@ -326,6 +373,271 @@ static void emit_debug_state(void) {
                     (unsigned long)video_core_get_frame_short());
 }
 
+static void update_status_snapshot(void) {
+    uint32_t l = video_core_get_lines_ok();
+    status_lines_per_s = l - status_last_lines;
+    status_last_lines = l;
+    status_vsync_per_s = video_core_take_vsync_edges();
+
+    uint32_t core1_busy = 0;
+    uint32_t core1_total = 0;
+    uint32_t core0_busy = 0;
+    uint32_t core0_total = 0;
+    video_core_take_core1_utilization(&core1_busy, &core1_total);
+    take_core0_utilization(&core0_busy, &core0_total);
+    status_core1_pct = (uint8_t)(core1_total ? (core1_busy * 100u) / core1_total : 0);
+    status_core0_pct = (uint8_t)(core0_total ? (core0_busy * 100u) / core0_total : 0);
+}
+
+#if EBD_IPKVM_BENCH
+static void emit_bench_line(void) {
+    const bench_report_t *b = bench_frames_snapshot();
+    uint32_t cyc_per_line = b->lines ? (uint32_t)(b->line_cycles / b->lines) : 0;
+    uint32_t bytes_per_frame = b->frames_sent ? (uint32_t)(b->packet_bytes / b->frames_sent) : 0;
+    uint32_t secs_ms = b->elapsed_us / 1000u;
+    uint32_t usb_bps = secs_ms ? (uint32_t)((b->usb_bytes * 1000u) / secs_ms) : 0;
+    cdc_ctrl_printf("[EBD_IPKVM] bench scr=%u fr=%lu/%lu skip=%lu cyc/line=%lu max=%lu B/fr=%lu usb=%luB/s\n",
+                    (unsigned)b->screen,
+                    (unsigned long)b->frames_sent,
+                    (unsigned long)b->ticks,
+                    (unsigned long)b->ticks_skipped,
+                    (unsigned long)cyc_per_line,
+                    (unsigned long)b->line_cycles_max,
+                    (unsigned long)bytes_per_frame,
+                    (unsigned long)usb_bps);
+}
+#endif
+
+static void emit_status_lines(void) {
+    line_monitor_counters_t mon;
+    line_monitor_get_counters(&mon);
+    input_counters_t in;
+    input_get_counters(&in);
+    cdc_ctrl_printf("[EBD_IPKVM] a=%d c=%d ps=%d l/s=%lu tot=%lu fr=%lu\n",
+                    video_core_is_armed() ? 1 : 0,
+                    video_core_capture_enabled() ? 1 : 0,
+                    ps_on_state ? 1 : 0,
+                    (unsigned long)status_lines_per_s,
+                    (unsigned long)status_last_lines,
+                    (unsigned long)video_core_get_frames_done());
+    cdc_ctrl_printf("[EBD_IPKVM] dr=%lu usb=%lu ov=%lu vs/s=%lu c0=%lu%% c1=%lu%% oos=%lu/%lu rxs=%lu in=%lu/%lu\n",
+                    (unsigned long)video_core_get_lines_drop(),
+                    (unsigned long)usb_drops,
+                    (unsigned long)video_core_get_frame_overrun(),
+                    (unsigned long)status_vsync_per_s,
+                    (unsigned long)status_core0_pct,
+                    (unsigned long)status_core1_pct,
+                    (unsigned long)mon.lines_out_of_spec,
+                    (unsigned long)mon.frames_out_of_spec,
+                    (unsigned long)mon.capture_rx_stalls,
+                    (unsigned long)in.sent,
+                    (unsigned long)in.events);
+#if EBD_IPKVM_ADB
+    adb_device_counters_t adb;
+    adb_device_get_bus_counters(&adb);
+    cdc_ctrl_printf("[EBD_IPKVM] adb cmd=%lu rep=%lu srq=%lu late=%lu rst=%lu\n",
+                    (unsigned long)adb.commands,
+                    (unsigned long)adb.replies,
+                    (unsigned long)adb.srqs,
+                    (unsigned long)adb.late,
+                    (unsigned long)adb.resets);
+#endif
+#if EBD_IPKVM_BENCH
+    if (bench_frames_running()) {
+        emit_bench_line();
+    }
+#endif
+}
+
+void app_core_fill_stats(usb_ctrl_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->version = USB_CTRL_STATS_VERSION;
+    out->size = (uint16_t)sizeof(*out);
+
+    out->armed = video_core_is_armed() ? 1 : 0;
+    out->capture_enabled = video_core_capture_enabled() ? 1 : 0;
+    out->test_frame_active = video_core_test_frame_active() ? 1 : 0;
+    out->ps_on = ps_on_state ? 1 : 0;
+    out->capture_mode = (uint8_t)video_core_get_capture_mode();
+    out->vsync_fall_edge = video_core_get_vsync_edge() ? 1 : 0;
+    out->codec = video_core_get_tx_rle_enabled() ? USB_CTRL_CODEC_RLE : USB_CTRL_CODEC_RAW;
+    out->frame_divisor = video_core_get_frame_divisor();
+    uint16_t roi_first = 0;
+    uint16_t roi_count = 0;
+    video_core_get_roi(&roi_first, &roi_count);
+    out->roi_first_line = roi_first;
+    out->roi_line_count = roi_count;
+
+    out->frames_done = video_core_get_frames_done();
+    out->lines_ok = video_core_get_lines_ok();
+    out->lines_drop = video_core_get_lines_drop();
+    out->frame_overrun = video_core_get_frame_overrun();
+    out->frame_short = video_core_get_frame_short();
+    out->usb_drops = usb_drops;
+    out->vsync_total = video_core_get_vsync_total();
+
+    out->lines_per_s = status_lines_per_s;
+    out->vsync_per_s = status_vsync_per_s;
+    out->core0_pct = status_core0_pct;
+    out->core1_pct = status_core1_pct;
+    uint16_t txq_r = 0;
+    uint16_t txq_w = 0;
+    video_core_get_txq_indices(&txq_r, &txq_w);
+    out->txq_r = txq_r;
+    out->txq_w = txq_w;
+
+    out->time_us = time_us_32();
+    uint32_t tx_lines = 0;
+    uint32_t tx_lines_rle = 0;
+    uint32_t tx_payload_bytes = 0;
+    video_core_get_codec_counters(&tx_lines, &tx_lines_rle, &tx_payload_bytes);
+    out->tx_lines = tx_lines;
+    out->tx_lines_rle = tx_lines_rle;
+    out->tx_payload_bytes = tx_payload_bytes;
+
+    line_monitor_counters_t mon;
+    line_monitor_get_counters(&mon);
+    out->lines_out_of_spec = mon.lines_out_of_spec;
+    out->frames_out_of_spec = mon.frames_out_of_spec;
+    out->capture_rx_stalls = mon.capture_rx_stalls;
+    out->monitor_rx_stalls = mon.monitor_rx_stalls;
+    out->last_frame_lines_oos = mon.last_frame_lines;
+    out->last_pixclk_delta = mon.last_pixclk_delta;
+
+    for (uint i = 0; i < SIGNAL_COUNT; i++) {
+        signal_rate_t rate;
+        signal_counter_get((signal_id_t)i, &rate);
+        out->signal_hz[i] = rate.hz;
+        out->signal_duty_bp[i] = rate.duty_bp;
+    }
+
+    input_counters_t in;
+    input_get_counters(&in);
+    out->input_events = in.events;
+    out->input_bad = in.bad;
+    out->input_coalesced = in.coalesced;
+    out->input_sent = in.sent;
+    out->input_dropped = in.dropped;
+}
+
+// Print text (or fail_text) on CDC once core1 acknowledges seq, without
+// waiting in the caller.
+static void note_on_ack(uint16_t seq, const char *text, const char *fail_text) {
+    if (!can_emit_text()) {
+        return;
+    }
+    for (size_t i = 0; i < ACK_NOTE_SLOTS; i++) {
+        if (ack_notes[i].text == NULL) {
+            ack_notes[i].seq = seq;
+            ack_notes[i].text = text;
+            ack_notes[i].fail_text = fail_text;
+            return;
+        }
+    }
+    cdc_ctrl_printf("%s", text);
+}
+
+static void finish_ack_note(ack_note_t *note, uint32_t result) {
+    if (can_emit_text()) {
+        bool failed = result != CORE_BRIDGE_RESULT_OK && note->fail_text;
+        cdc_ctrl_printf("%s", failed ? note->fail_text : note->text);
+    }
+    note->text = NULL;
+}
+
+// Hand a command to core1. False when the bridge ring is full.
+static bool core_cmd_issue(const core_cmd_t *cmd) {
+    uint16_t seq = core_bridge_send_msg(cmd->code, cmd->args, cmd->nargs);
+    if (seq == CORE_BRIDGE_SEQ_NONE) {
+        return false;
+    }
+    core_cmd_last_seq = seq;
+    if (cmd->hold_txq) {
+        txq_hold_seq = seq;
+    }
+    if (cmd->text) {
+        note_on_ack(seq, cmd->text, cmd->fail_text);
+    }
+    return true;
+}
+
+static void core_cmd_send_deferred(void) {
+    while (core_cmd_defer_n != 0 && core_cmd_issue(&core_cmd_defer[core_cmd_defer_r])) {
+        core_cmd_defer_r = (uint8_t)((core_cmd_defer_r + 1u) % CORE_CMD_DEFER_SLOTS);
+        core_cmd_defer_n--;
+    }
+}
+
+// Send a command to core1, behind any still waiting for room in the ring.
+// hold_txq stops service_txq until core1 has applied it; text is printed on
+// CDC then (fail_text instead when core1 refuses it). A command that finds
+// the deferred slots full as well is dropped and reported.
+static void core_cmd_send(core_bridge_cmd_t code, const uint32_t *args, uint8_t nargs,
+                          bool hold_txq, const char *text, const char *fail_text) {
+    core_cmd_t cmd = {.code = code, .nargs = nargs, .hold_txq = hold_txq,
+                      .text = text, .fail_text = fail_text};
+    for (uint8_t i = 0; i < nargs && i < CORE_BRIDGE_MAX_ARGS; i++) {
+        cmd.args[i] = args[i];
+    }
+    if (core_cmd_defer_n == 0 && core_cmd_issue(&cmd)) {
+        return;
+    }
+    if (core_cmd_defer_n == CORE_CMD_DEFER_SLOTS) {
+        core_cmd_dropped++;
+        if (can_emit_text()) {
+            cdc_ctrl_printf("[EBD_IPKVM][cmd] core1 busy, dropped cmd=%u\n", (unsigned)code);
+        }
+        return;
+    }
+    core_cmd_defer[(core_cmd_defer_r + core_cmd_defer_n) % CORE_CMD_DEFER_SLOTS] = cmd;
+    core_cmd_defer_n++;
+}
+
+// Spin (without servicing USB) until every command sent so far has been
+// applied or timeout_us elapses.
+static bool core_cmd_flush(uint32_t timeout_us) {
+    uint32_t start = time_us_32();
+    while (core_cmd_defer_n != 0) {
+        core_cmd_send_deferred();
+        if ((uint32_t)(time_us_32() - start) >= timeout_us) {
+            return false;
+        }
+        tight_loop_contents();
+    }
+    uint32_t spent = time_us_32() - start;
+    return core_bridge_wait(core_cmd_last_seq, spent < timeout_us ? timeout_us - spent : 0);
+}
+
+static void service_core_acks(void) {
+    // A note already done before the drain whose ack is not in the ring lost
+    // it to an ack overflow; it is reported as applied.
+    bool done_before[ACK_NOTE_SLOTS];
+    for (size_t i = 0; i < ACK_NOTE_SLOTS; i++) {
+        done_before[i] = ack_notes[i].text && core_bridge_is_done(ack_notes[i].seq);
+    }
+    core_bridge_ack_t ack;
+    while (core_bridge_try_pop_ack(&ack)) {
+        for (size_t i = 0; i < ACK_NOTE_SLOTS; i++) {
+            if (ack_notes[i].text && ack_notes[i].seq == ack.seq) {
+                finish_ack_note(&ack_notes[i], ack.result);
+            }
+        }
+    }
+    for (size_t i = 0; i < ACK_NOTE_SLOTS; i++) {
+        if (done_before[i] && ack_notes[i].text) {
+            finish_ack_note(&ack_notes[i], CORE_BRIDGE_RESULT_OK);
+        }
+    }
+    core_cmd_send_deferred();
+}
+
+// Stop capture on core1. service_txq holds off until core1 has reset the queue
+// so a half-sent stale packet is never resumed.
+static void send_stop_capture(const char *text) {
+    txq_offset = 0;
+    core_cmd_send(CORE_BRIDGE_CMD_STOP_CAPTURE, NULL, 0, true, text, NULL);
+}
+
 static void handle_capture_start(void) {
     video_core_set_armed(true);
 }
@@ -333,18 +645,13 @@ static void handle_capture_start(void) {
 static void handle_capture_stop(void) {
     video_core_set_armed(false);
     video_core_set_want_frame(false);
-    txq_offset = 0;
-    core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-    if (can_emit_text()) {
-        cdc_ctrl_printf("[EBD_IPKVM][cmd] armed=0 (stop)\n");
-    }
+    send_stop_capture("[EBD_IPKVM][cmd] armed=0 (stop)\n");
 }
 
 static void handle_capture_park(void) {
     video_core_set_armed(false);
     video_core_set_want_frame(false);
-    txq_offset = 0;
-    core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
+    send_stop_capture(NULL);
     if (can_emit_text()) {
         cdc_ctrl_printf("[EBD_IPKVM][cmd] parked\n");
     }
@@ -353,14 +660,12 @@ static void handle_capture_park(void) {
 
 static void handle_reset_counters(void) {
     usb_drops = 0;
+    input_reset_counters();
     video_core_set_take_toggle(false);
     video_core_set_want_frame(false);
-    txq_offset = 0;
-    core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-    core_bridge_send(CORE_BRIDGE_CMD_RESET_COUNTERS, 0);
-    if (can_emit_text()) {
-        cdc_ctrl_printf("[EBD_IPKVM][cmd] reset counters\n");
-    }
+    send_stop_capture(NULL);
+    core_cmd_send(CORE_BRIDGE_CMD_RESET_COUNTERS, NULL, 0, false,
+                  "[EBD_IPKVM][cmd] reset counters\n", NULL);
 }
 
 static void handle_probe_packet(void) {
@@ -381,6 +686,89 @@ static void handle_rle_off(void) {
     }
 }
 
+static void handle_set_codec(uint16_t codec) {
+    if (codec == USB_CTRL_CODEC_RLE) {
+        handle_rle_on();
+    } else if (codec == USB_CTRL_CODEC_RAW) {
+        handle_rle_off();
+    }
+}
+
+static void handle_set_capture_mode(capture_mode_t mode) {
+    if (mode != CAPTURE_MODE_TEST_30FPS && mode != CAPTURE_MODE_CONTINUOUS_60FPS) {
+        return;
+    }
+    video_core_set_capture_mode(mode);
+    video_core_set_want_frame(false);
+    video_core_set_take_toggle(false);
+    send_stop_capture(NULL);
+    if (can_emit_text()) {
+        cdc_ctrl_printf("[EBD_IPKVM] mode=%s\n",
+                        mode == CAPTURE_MODE_CONTINUOUS_60FPS ? "60fps-continuous"
+                                                             : "30fps-test");
+    }
+}
+
+static void handle_set_vsync_edge(bool fall_edge) {
+    video_core_set_vsync_edge(fall_edge);
+    video_core_set_armed(false);
+    video_core_set_want_frame(false);
+    send_stop_capture(NULL);
+    core_cmd_send(CORE_BRIDGE_CMD_CONFIG_VSYNC, NULL, 0, false, NULL, NULL);
+    if (can_emit_text()) {
+        cdc_ctrl_printf("[EBD_IPKVM] vsync_edge=%s\n", fall_edge ? "fall" : "rise");
+    }
+}
+
+static void handle_set_frame_divisor(uint16_t divisor) {
+    if (divisor == 0 || divisor > 0xFFu) {
+        return;
+    }
+    video_core_set_frame_divisor((uint8_t)divisor);
+    if (can_emit_text()) {
+        cdc_ctrl_printf("[EBD_IPKVM] frame_div=%u\n", (unsigned)divisor);
+    }
+}
+
+static void handle_set_roi(const uint8_t *data, uint8_t len) {
+    if (len < sizeof(usb_ctrl_roi_t)) {
+        return;
+    }
+    uint16_t first = (uint16_t)(data[0] | (data[1] << 8));
+    uint16_t count = (uint16_t)(data[2] | (data[3] << 8));
+    video_core_set_roi(first, count);
+    video_core_get_roi(&first, &count);
+    if (can_emit_text()) {
+        cdc_ctrl_printf("[EBD_IPKVM] roi=%u+%u\n", (unsigned)first, (unsigned)count);
+    }
+}
+
+static void handle_set_telemetry(uint16_t interval_ms) {
+    telemetry_interval_ms = interval_ms;
+    telemetry_due_us = time_us_32();
+    if (can_emit_text()) {
+        cdc_ctrl_printf("[EBD_IPKVM] telemetry=%ums\n", (unsigned)interval_ms);
+    }
+}
+
+#if EBD_IPKVM_BENCH
+static void handle_bench_start(const uint8_t *data, uint8_t len) {
+    if (len < sizeof(usb_ctrl_bench_start_t)) {
+        return;
+    }
+    uint32_t args[2] = {
+        data[0],
+        (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) |
+            ((uint32_t)data[7] << 24),
+    };
+    video_core_set_armed(false);
+    video_core_set_want_frame(false);
+    txq_offset = 0;
+    core_cmd_send(CORE_BRIDGE_CMD_START_BENCH, args, 2, true, "[EBD_IPKVM][cmd] bench start\n",
+                  "[EBD_IPKVM][cmd] bench start failed (unknown screen)\n");
+}
+#endif
+
 static void handle_ps_on(bool on) {
     set_ps_on(on);
     if (can_emit_text()) {
@@ -391,24 +779,22 @@ static void handle_ps_on(bool on) {
 static void handle_bootsel(void) {
     video_core_set_armed(false);
     video_core_set_want_frame(false);
-    txq_offset = 0;
-    core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-    sleep_ms(10);
+    send_stop_capture(NULL);
+    (void)core_cmd_flush(10000);
     reset_usb_boot(0, 0);
 }
 
 static void handle_reboot(void) {
     video_core_set_armed(false);
     video_core_set_want_frame(false);
-    txq_offset = 0;
-    core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-    sleep_ms(10);
+    send_stop_capture(NULL);
+    (void)core_cmd_flush(10000);
     watchdog_reboot(0, 0, 0);
     while (true) { tight_loop_contents(); }
 }
 
-static void handle_ep0_command(uint8_t cmd) {
-    switch (cmd) {
+static void handle_ep0_command(const usb_ctrl_cmd_t *cmd) {
+    switch (cmd->request) {
     case USB_CTRL_REQ_CAPTURE_START:
         handle_capture_start();
         break;
@@ -442,6 +828,29 @@ static void handle_ep0_command(uint8_t cmd) {
     case USB_CTRL_REQ_REBOOT:
         handle_reboot();
         break;
+    case USB_CTRL_REQ_SET_CAPTURE_MODE:
+        handle_set_capture_mode((capture_mode_t)cmd->value);
+        break;
+    case USB_CTRL_REQ_SET_FRAME_DIVISOR:
+        handle_set_frame_divisor(cmd->value);
+        break;
+    case USB_CTRL_REQ_SET_CODEC:
+        handle_set_codec(cmd->value);
+        break;
+    case USB_CTRL_REQ_SET_ROI:
+        handle_set_roi(cmd->data, cmd->data_len);
+        break;
+    case USB_CTRL_REQ_SET_VSYNC_EDGE:
+        handle_set_vsync_edge(cmd->value != 0);
+        break;
+    case USB_CTRL_REQ_SET_TELEMETRY:
+        handle_set_telemetry(cmd->value);
+        break;
+#if EBD_IPKVM_BENCH
+    case USB_CTRL_REQ_BENCH_START:
+        handle_bench_start(cmd->data, cmd->data_len);
+        break;
+#endif
     default:
         break;
     }
@@ -454,10 +863,10 @@ static void service_ep0_commands(void) {
         if (r == w) {
             break;
         }
-        uint8_t cmd = ep0_cmd_queue[r];
-        uint8_t next = (uint8_t)((r + 1u) % (uint8_t)sizeof(ep0_cmd_queue));
+        usb_ctrl_cmd_t cmd = ep0_cmd_queue[r];
+        uint8_t next = (uint8_t)((r + 1u) % EP0_CMD_QUEUE_LEN);
         __atomic_store_n(&ep0_cmd_r, next, __ATOMIC_RELEASE);
-        handle_ep0_command(cmd);
+        handle_ep0_command(&cmd);
     }
 }
 
@@ -480,12 +889,12 @@ static bool poll_cdc_commands(void) {
         } else if (ch == 'Z' || ch == 'z') {
             handle_reboot();
         } else if (ch == 'F' || ch == 'f') {
-            core_bridge_send(CORE_BRIDGE_CMD_SINGLE_FRAME, 0);
+            core_cmd_send(CORE_BRIDGE_CMD_SINGLE_FRAME, NULL, 0, false, NULL, NULL);
         } else if (ch == 'T' || ch == 't') {
             video_core_set_armed(false);
             video_core_set_want_frame(false);
             txq_offset = 0;
-            core_bridge_send(CORE_BRIDGE_CMD_START_TEST, 0);
+            core_cmd_send(CORE_BRIDGE_CMD_START_TEST, NULL, 0, true, NULL, NULL);
             request_probe_packet();
         } else if (ch == 'U' || ch == 'u') {
             request_probe_packet();
@@ -503,43 +912,97 @@ static bool poll_cdc_commands(void) {
             }
         } else if (ch == 'G' || ch == 'g') {
             if (can_emit_text()) {
-                core_bridge_send(CORE_BRIDGE_CMD_DIAG_PREP, 0);
-                run_gpio_diag();
-                core_bridge_send(CORE_BRIDGE_CMD_DIAG_DONE, 0);
+                emit_gpio_diag();
             }
         } else if (ch == 'V' || ch == 'v') {
-            bool new_edge = !video_core_get_vsync_edge();
-            video_core_set_vsync_edge(new_edge);
-            video_core_set_armed(false);
-            video_core_set_want_frame(false);
-            txq_offset = 0;
-            core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-            core_bridge_send(CORE_BRIDGE_CMD_CONFIG_VSYNC, 0);
-            if (can_emit_text()) {
-                cdc_ctrl_printf("[EBD_IPKVM] vsync_edge=%s\n", new_edge ? "fall" : "rise");
-            }
+            handle_set_vsync_edge(!video_core_get_vsync_edge());
         } else if (ch == 'M' || ch == 'm') {
             capture_mode_t mode = video_core_get_capture_mode();
-            capture_mode_t next_mode = (mode == CAPTURE_MODE_TEST_30FPS)
-                                           ? CAPTURE_MODE_CONTINUOUS_60FPS
-                                           : CAPTURE_MODE_TEST_30FPS;
-            video_core_set_capture_mode(next_mode);
-            video_core_set_want_frame(false);
-            video_core_set_take_toggle(false);
-            txq_offset = 0;
-            core_bridge_send(CORE_BRIDGE_CMD_STOP_CAPTURE, 0);
-            if (can_emit_text()) {
-                cdc_ctrl_printf("[EBD_IPKVM] mode=%s\n",
-                                next_mode == CAPTURE_MODE_CONTINUOUS_60FPS ? "60fps-continuous"
-                                                                          : "30fps-test");
-            }
+            handle_set_capture_mode((mode == CAPTURE_MODE_TEST_30FPS)
+                                        ? CAPTURE_MODE_CONTINUOUS_60FPS
+                                        : CAPTURE_MODE_TEST_30FPS);
+        }
+    }
+    return did_work;
+}
+
+// Low priority: a snapshot is started only on a video or probe packet boundary,
+// and only while the TX queue is empty unless it is a full interval overdue.
+static bool service_telemetry(void) {
+    if (!stream_ready()) return false;
+
+    if (telemetry_len == 0) {
+        if (telemetry_interval_ms == 0 || txq_offset != 0 || probe_offset != 0) return false;
+        uint32_t now = time_us_32();
+        int32_t late_us = (int32_t)(now - telemetry_due_us);
+        if (late_us < 0) return false;
+        if (!video_core_txq_is_empty() && late_us < (int32_t)telemetry_interval_ms * 1000) {
+            return false;
+        }
+
+        usb_ctrl_stats_t stats;
+        app_core_fill_stats(&stats);
+        stream_write_header(telemetry_buf, telemetry_seq++, STREAM_LINE_TELEMETRY,
+                            (uint16_t)sizeof(stats));
+        memcpy(&telemetry_buf[STREAM_HEADER_BYTES], &stats, sizeof(stats));
+        telemetry_len = (uint16_t)TELEMETRY_PKT_BYTES;
+        telemetry_offset = 0;
+        telemetry_due_us = now + (uint32_t)telemetry_interval_ms * 1000u;
+    }
+
+    bool wrote_any = false;
+    while (telemetry_offset < telemetry_len) {
+        int avail = stream_write_available();
+        if (avail <= 0) break;
+        uint32_t to_write = (uint32_t)avail;
+        uint32_t remain = (uint32_t)(telemetry_len - telemetry_offset);
+        if (to_write > remain) {
+            to_write = remain;
+        }
+        uint32_t wrote = stream_write(&telemetry_buf[telemetry_offset], to_write);
+        if (wrote == 0) break;
+        telemetry_offset = (uint16_t)(telemetry_offset + wrote);
+        wrote_any = true;
+    }
+
+    if (telemetry_offset >= telemetry_len) {
+        telemetry_len = 0;
+        telemetry_offset = 0;
+    }
+    if (wrote_any) {
+        stream_flush();
+    }
+    return wrote_any;
+}
+
+// Host input on the vendor OUT endpoint. Runs before anything else in the
+// loop so a keystroke never waits behind a frame's worth of video packets.
+static bool service_input(void) {
+    bool did_work = false;
+    uint8_t buf[INPUT_RX_CHUNK];
+    while (tud_vendor_available() > 0) {
+        uint32_t n = tud_vendor_read(buf, sizeof(buf));
+        if (n == 0) {
+            break;
         }
+        input_feed(buf, n);
+        did_work = true;
+    }
+    if (input_service(time_us_32())) {
+        did_work = true;
     }
     return did_work;
 }
 
 static inline bool service_txq(void) {
     if (!stream_ready()) return false;
+    if (core_cmd_defer_n != 0) return false; // may hold a STOP_CAPTURE not yet sent
+    if (txq_hold_seq != CORE_BRIDGE_SEQ_NONE) {
+        if (!core_bridge_is_done(txq_hold_seq)) return false;
+        txq_hold_seq = CORE_BRIDGE_SEQ_NONE;
+    }
+    if (telemetry_len != 0) return false; // finish the telemetry packet first
+    if (probe_offset != 0) return false;  // and a half-sent probe
 
     bool wrote_any = false;
 
@@ -572,9 +1035,16 @@ static inline bool service_txq(void) {
         }
 
         txq_offset = (uint16_t)(txq_offset + n);
+        bench_frames_add_usb_bytes(n);
         wrote_any = true;
 
         if (txq_offset >= pkt_len) {
+            // The frame end packet trails the last line of every frame.
+            if (data[4] == (STREAM_LINE_FRAME_END & 0xFFu) &&
+                data[5] == (STREAM_LINE_FRAME_END >> 8)) {
+                frame_trace_record(FRAME_TRACE_USB_LAST_BYTE,
+                                   (uint16_t)(data[2] | (data[3] << 8)), 0);
+            }
             txq_offset = 0;
             video_core_txq_consume();
         }
@@ -588,6 +1058,10 @@ static inline bool service_txq(void) {
 
 void app_core_init(const app_core_config_t *cfg) {
     app_cfg = *cfg;
+    latency_hist_core_init();
+#if !EBD_IPKVM_ADB
+    input_uart_init(uart1, cfg->pin_input_tx, cfg->pin_input_rx);
+#endif
 
     cdc_ctrl_printf("\n[EBD_IPKVM] USB packet stream @ ~60fps (continuous mode)\n");
     cdc_ctrl_printf("[EBD_IPKVM] BULK0=video stream, CDC0=control/status\n");
@@ -602,14 +1076,21 @@ void app_core_init(const app_core_config_t *cfg) {
 void app_core_poll(void) {
     uint32_t loop_start = time_us_32();
     uint32_t active_us = 0;
+    lat_stamp_t lat_start = latency_hist_stamp();
     tud_task();
+    latency_hist_record(LAT_STAGE_TUD_TASK, lat_start);
+    uint32_t active_start = time_us_32();
+    if (service_input()) {
+        active_us += (uint32_t)(time_us_32() - active_start);
+    }
     bool cdc_now = tud_cdc_n_connected(CDC_CTRL);
     if (!cdc_now && cdc_ctrl_connected) {
         cdc_ctrl_ring_reset();
     }
     cdc_ctrl_connected = cdc_now;
     service_ep0_commands();
-    uint32_t active_start = time_us_32();
+    service_core_acks();
+    active_start = time_us_32();
     bool did_work = poll_cdc_commands();
     if (did_work) {
         active_us += (uint32_t)(time_us_32() - active_start);
@@ -622,38 +1103,13 @@ void app_core_poll(void) {
         active_us += (uint32_t)(time_us_32() - active_start);
     }
 
-    if (can_emit_text()) {
-        if (absolute_time_diff_us(get_absolute_time(), status_next) <= 0) {
-            status_next = delayed_by_ms(status_next, 1000);
-
-            uint32_t l = video_core_get_lines_ok();
-            uint32_t per_s = l - status_last_lines;
-            status_last_lines = l;
-
-            uint32_t ve = video_core_take_vsync_edges();
-            uint32_t core1_busy = 0;
-            uint32_t core1_total = 0;
-            uint32_t core0_busy = 0;
-            uint32_t core0_total = 0;
-            video_core_take_core1_utilization(&core1_busy, &core1_total);
-            take_core0_utilization(&core0_busy, &core0_total);
-            uint32_t core1_pct = core1_total ? (uint32_t)((core1_busy * 100u) / core1_total) : 0;
-            uint32_t core0_pct = core0_total ? (uint32_t)((core0_busy * 100u) / core0_total) : 0;
-
-            cdc_ctrl_printf("[EBD_IPKVM] a=%d c=%d ps=%d l/s=%lu tot=%lu fr=%lu\n",
-                            video_core_is_armed() ? 1 : 0,
-                            video_core_capture_enabled() ? 1 : 0,
-                            ps_on_state ? 1 : 0,
-                            (unsigned long)per_s,
-                            (unsigned long)l,
-                            (unsigned long)video_core_get_frames_done());
-            cdc_ctrl_printf("[EBD_IPKVM] dr=%lu usb=%lu ov=%lu vs/s=%lu c0=%lu%% c1=%lu%%\n",
-                            (unsigned long)video_core_get_lines_drop(),
-                            (unsigned long)usb_drops,
-                            (unsigned long)video_core_get_frame_overrun(),
-                            (unsigned long)ve,
-                            (unsigned long)core0_pct,
-                            (unsigned long)core1_pct);
+    if (absolute_time_diff_us(get_absolute_time(), status_next) <= 0) {
+        status_next = delayed_by_ms(status_next, 1000);
+        update_status_snapshot();
+        signal_counter_sample();
+        if (can_emit_text()) {
+            emit_status_lines();
+            emit_signal_line();
         }
     }
 
@@ -671,10 +1127,22 @@ void app_core_poll(void) {
     }
 
     active_start = time_us_32();
+    if (service_telemetry()) {
+        active_us += (uint32_t)(time_us_32() - active_start);
+    }
+
+    active_start = time_us_32();
+    lat_start = latency_hist_stamp();
     if (service_txq()) {
+        // Idle passes are not sampled, matching the utilization accounting.
+        latency_hist_record(LAT_STAGE_SERVICE_TXQ, lat_start);
         active_us += (uint32_t)(time_us_32() - active_start);
     }
 
+#if EBD_IPKVM_UVC
+    uvc_stream_service();
+#endif
+
     tight_loop_contents();
     uint32_t loop_end = time_us_32();
     core0_busy_us += active_us;
@@ -4,14 +4,19 @@
 
 #include "pico/stdlib.h"
 
+#include "usb_control.h"
+
 typedef struct app_core_config {
     uint pin_pixclk;
     uint pin_vsync;
     uint pin_hsync;
     uint pin_video;
     uint pin_ps_on;
+    uint pin_input_tx; // UART1 to the ADB controller
+    uint pin_input_rx;
 } app_core_config_t;
 
 void app_core_init(const app_core_config_t *cfg);
 void app_core_poll(void);
-bool app_core_enqueue_ep0_command(uint8_t cmd);
+bool app_core_enqueue_ep0_command(const usb_ctrl_cmd_t *cmd);
+void app_core_fill_stats(usb_ctrl_stats_t *out);
@@ -0,0 +1,309 @@
+#include "bench_frames.h"
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+#define SYSTICK_CSR_ENABLE_PROCCLK 0x5u // ENABLE | CLKSOURCE=processor, no IRQ
+#define SYSTICK_RELOAD_MAX 0x00FFFFFFu
+
+#define SCREEN_W 512u
+#define MENU_BAR_LINES 20u
+
+// The screen is kept in capture word order (bytes reversed within each 32-bit
+// word), so the postprocess bswap DMA has the same work to do as for a
+// captured frame.
+static uint32_t screen[CAP_ACTIVE_H][CAP_WORDS_PER_LINE];
+
+static bench_report_t report;
+static volatile bool running = false;
+static uint32_t start_us = 0;
+static uint32_t stop_us = 0;
+static uint32_t next_tick_us = 0;
+static uint32_t last_submit_us = 0;
+static uint32_t frame_bytes = 0; // packets queued for the frame in flight
+
+// 5x7 glyphs, one byte per row, bit 4 = leftmost pixel.
+static const uint8_t glyphs[][7] = {
+    {0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}, // e
+    {0x04, 0x0E, 0x04, 0x04, 0x04, 0x03, 0x00}, // t
+    {0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00}, // a
+    {0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00}, // o
+    {0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00}, // n
+    {0x04, 0x00, 0x0C, 0x04, 0x04, 0x0E, 0x00}, // i
+    {0x00, 0x0F, 0x10, 0x0E, 0x01, 0x1E, 0x00}, // s
+    {0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00}, // r
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x00}, // h
+    {0x01, 0x01, 0x0D, 0x13, 0x11, 0x0F, 0x00}, // d
+    {0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00}, // l
+    {0x0E, 0x11, 0x10, 0x10, 0x11, 0x0E, 0x00}, // C
+};
+#define GLYPH_COUNT (sizeof(glyphs) / sizeof(glyphs[0]))
+
+static const uint8_t bayer4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+static inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline void put_pixel(uint8_t *row, uint x, bool white) {
+    uint8_t bit = (uint8_t)(0x80u >> (x & 7u));
+    if (white) {
+        row[x >> 3] |= bit;
+    } else {
+        row[x >> 3] &= (uint8_t)~bit;
+    }
+}
+
+// Store one display-order line (MSB = leftmost pixel, 1 = white).
+static void store_line(uint y, const uint8_t *row) {
+    for (uint w = 0; w < CAP_WORDS_PER_LINE; w++) {
+        const uint8_t *b = &row[w * 4u];
+        screen[y][w] = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+                       ((uint32_t)b[2] << 8) | b[3];
+    }
+}
+
+static void draw_window(uint8_t *row, uint y, uint x0, uint y0, uint x1, uint y1) {
+    if (y < y0 || y > y1) {
+        return;
+    }
+    bool title = (y > y0 && y < y0 + 19u);
+    for (uint x = x0; x <= x1; x++) {
+        bool edge = (y == y0 || y == y1 || x == x0 || x == x1 || y == y0 + 19u);
+        bool stripe = title && ((y - y0) & 1u) == 0 && x > x0 + 2u && x < x1 - 2u;
+        put_pixel(row, x, !(edge || stripe));
+    }
+}
+
+static void render_desktop(uint y, uint8_t *row) {
+    if (y < MENU_BAR_LINES - 1u) {
+        memset(row, 0xFF, CAP_BYTES_PER_LINE);
+    } else if (y == MENU_BAR_LINES - 1u) {
+        memset(row, 0x00, CAP_BYTES_PER_LINE);
+    } else {
+        memset(row, (y & 1u) ? 0xAA : 0x55, CAP_BYTES_PER_LINE);
+    }
+    draw_window(row, y, 40, 50, 330, 260);
+    draw_window(row, y, 220, 120, 480, 320);
+}
+
+static void render_text(uint y, uint8_t *row) {
+    render_desktop(y, row);
+    if (y < MENU_BAR_LINES) {
+        return;
+    }
+    // One document window covering the desktop, filled with ragged lines of text.
+    draw_window(row, y, 2, MENU_BAR_LINES + 2u, SCREEN_W - 3u, CAP_ACTIVE_H - 3u);
+    const uint top = MENU_BAR_LINES + 26u;
+    if (y < top || y >= CAP_ACTIVE_H - 6u) {
+        return;
+    }
+    uint text_line = (y - top) / 9u;
+    uint gy = (y - top) % 9u;
+    if (gy >= 7u) {
+        return;
+    }
+    uint cols = 70u + (hash32(text_line) % 11u);
+    for (uint c = 0; c < cols; c++) {
+        uint32_t h = hash32((text_line << 8) ^ c);
+        if ((h & 7u) == 0) {
+            continue; // word break
+        }
+        uint8_t bits = glyphs[(h >> 3) % GLYPH_COUNT][gy];
+        uint x = 10u + c * 6u;
+        for (uint i = 0; i < 5u; i++) {
+            if (bits & (0x10u >> i)) {
+                put_pixel(row, x + i, false);
+            }
+        }
+    }
+}
+
+static void render_dither(uint y, uint8_t *row) {
+    // Radial gradient, 17 levels through a 4x4 Bayer matrix.
+    int dy = (int)y - (int)(CAP_ACTIVE_H / 2u);
+    for (uint x = 0; x < SCREEN_W; x++) {
+        int dx = (int)x - (int)(SCREEN_W / 2u);
+        uint32_t d2 = (uint32_t)(dx * dx + dy * dy);
+        uint level = (uint)((d2 * 17u) / 95000u);
+        if (level > 16u) {
+            level = 16u;
+        }
+        put_pixel(row, x, level > bayer4[y & 3u][x & 3u]);
+    }
+}
+
+static void render_noise(uint y, uint8_t *row) {
+    uint32_t state = hash32(y + 1u);
+    for (uint i = 0; i < CAP_BYTES_PER_LINE; i += 4) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(&row[i], &state, sizeof(state));
+    }
+}
+
+static bool render_screen(uint8_t id) {
+    uint8_t row[CAP_BYTES_PER_LINE];
+    for (uint y = 0; y < CAP_ACTIVE_H; y++) {
+        switch (id) {
+        case BENCH_SCREEN_DESKTOP:
+            render_desktop(y, row);
+            break;
+        case BENCH_SCREEN_TEXT:
+            render_text(y, row);
+            break;
+        case BENCH_SCREEN_DITHER:
+            render_dither(y, row);
+            break;
+        case BENCH_SCREEN_WHITE:
+            memset(row, 0xFF, sizeof(row));
+            break;
+        case BENCH_SCREEN_NOISE:
+            render_noise(y, row);
+            break;
+        default:
+            return false;
+        }
+        store_line(y, row);
+    }
+    return true;
+}
+
+void bench_frames_core_init(void) {
+    systick_hw->csr = 0;
+    systick_hw->rvr = SYSTICK_RELOAD_MAX;
+    systick_hw->cvr = 0;
+    systick_hw->csr = SYSTICK_CSR_ENABLE_PROCCLK;
+    memset(screen, 0, sizeof(screen));
+}
+
+bool bench_frames_start(uint8_t id, uint32_t period_us, uint8_t codec) {
+    if (id >= BENCH_SCREEN_COUNT) {
+        return false;
+    }
+    if (id != BENCH_SCREEN_UPLOAD && !render_screen(id)) {
+        return false;
+    }
+    memset(&report, 0, sizeof(report));
+    report.screen = id;
+    report.codec = codec;
+    report.period_us = period_us ? period_us : BENCH_DEFAULT_PERIOD_US;
+    start_us = time_us_32();
+    next_tick_us = start_us;
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void bench_frames_stop(void) {
+    if (__atomic_exchange_n(&running, false, __ATOMIC_ACQ_REL)) {
+        stop_us = time_us_32();
+    }
+}
+
+bool bench_frames_running(void) {
+    return __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+}
+
+bool bench_frames_tick_due(uint32_t now_us) {
+    if (!bench_frames_running() || (int32_t)(now_us - next_tick_us) < 0) {
+        return false;
+    }
+    next_tick_us += report.period_us;
+    if ((int32_t)(now_us - next_tick_us) >= 0) {
+        // More than a whole period late (core1 was held up): resync rather
+        // than firing a burst of catch-up ticks.
+        next_tick_us = now_us + report.period_us;
+    }
+    report.ticks++;
+    return true;
+}
+
+void bench_frames_note_skip(void) {
+    report.ticks_skipped++;
+}
+
+void bench_frames_fill(uint32_t (*buf)[CAP_WORDS_PER_LINE]) {
+    memset(buf, 0, (size_t)CAP_YOFF_LINES * CAP_BYTES_PER_LINE);
+    memcpy(buf[CAP_YOFF_LINES], screen, sizeof(screen));
+}
+
+void bench_frames_note_submit(uint32_t now_us) {
+    last_submit_us = now_us;
+    frame_bytes = 0;
+    report.frames_submitted++;
+}
+
+void bench_frames_note_postprocess_done(uint32_t now_us) {
+    uint32_t us = now_us - last_submit_us;
+    if (us > report.postprocess_us_max) {
+        report.postprocess_us_max = us;
+    }
+}
+
+void bench_frames_add_line(uint32_t cycles, uint16_t packet_bytes) {
+    report.lines++;
+    report.line_cycles += cycles;
+    if (cycles > report.line_cycles_max) {
+        report.line_cycles_max = cycles;
+    }
+    frame_bytes += packet_bytes;
+}
+
+void bench_frames_note_frame_sent(uint32_t submit_us, uint16_t packet_bytes) {
+    uint32_t us = time_us_32() - submit_us;
+    report.frames_sent++;
+    report.packet_bytes += frame_bytes + packet_bytes;
+    frame_bytes = 0;
+    report.frame_tx_us_sum += us;
+    if (us > report.frame_tx_us_max) {
+        report.frame_tx_us_max = us;
+    }
+}
+
+uint8_t *bench_frames_upload_target(uint16_t first_line, uint16_t len) {
+    if (len == 0 || len > BENCH_UPLOAD_MAX_BYTES || (len % CAP_BYTES_PER_LINE) != 0 ||
+        first_line >= CAP_ACTIVE_H ||
+        (uint32_t)first_line + len / CAP_BYTES_PER_LINE > CAP_ACTIVE_H) {
+        return NULL;
+    }
+    return (uint8_t *)screen[first_line];
+}
+
+void bench_frames_upload_done(uint16_t first_line, uint16_t len) {
+    // The data stage landed in display byte order; convert in place.
+    uint8_t row[CAP_BYTES_PER_LINE];
+    for (uint y = first_line; y < (uint)first_line + len / CAP_BYTES_PER_LINE; y++) {
+        memcpy(row, screen[y], sizeof(row));
+        store_line(y, row);
+    }
+}
+
+void bench_frames_add_usb_bytes(uint32_t bytes) {
+    if (bench_frames_running()) {
+        report.usb_bytes += bytes;
+    }
+}
+
+const bench_report_t *bench_frames_snapshot(void) {
+    static bench_report_t snap;
+    snap = report;
+    snap.version = BENCH_REPORT_VERSION;
+    snap.size = (uint16_t)sizeof(snap);
+    snap.running = bench_frames_running() ? 1 : 0;
+    snap.clk_sys_hz = clock_get_hz(clk_sys);
+    snap.elapsed_us = (snap.running ? time_us_32() : stop_us) - start_us;
+    return &snap;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "video_capture.h"
+
+// Codec/pipeline benchmark (EBD_IPKVM_BENCH build option). core1 feeds a fixed
+// 512x342 screen through the same postprocess DMA, line encode, TX queue and
+// vendor bulk path as a captured frame, on a timer instead of VSYNC, and
+// records what each stage cost. Screens are either generated on the device or
+// uploaded over EP0 (USB_CTRL_REQ_BENCH_UPLOAD). With the option off every
+// call compiles away.
+typedef enum {
+    BENCH_SCREEN_UPLOAD = 0,  // whatever the host last uploaded
+    BENCH_SCREEN_DESKTOP = 1, // menu bar, gray desktop, two windows
+    BENCH_SCREEN_TEXT = 2,    // full-screen document window of 6x9 text
+    BENCH_SCREEN_DITHER = 3,  // ordered-dither gradient (scanned photo)
+    BENCH_SCREEN_WHITE = 4,   // best case for RLE
+    BENCH_SCREEN_NOISE = 5,   // worst case for RLE
+    BENCH_SCREEN_COUNT
+} bench_screen_t;
+
+// Default tick: the Classic's 60.15 Hz frame rate.
+#define BENCH_DEFAULT_PERIOD_US 16625u
+#define BENCH_UPLOAD_MAX_BYTES 1024u // per EP0 upload request (16 lines)
+
+#define BENCH_REPORT_VERSION 1
+
+// Returned by USB_CTRL_REQ_GET_BENCH. All fields little-endian. Cycle counts
+// are core1 SysTick at clk_sys.
+typedef struct __attribute__((packed)) bench_report {
+    uint16_t version;
+    uint16_t size;
+    uint8_t running;
+    uint8_t screen;           // bench_screen_t
+    uint8_t codec;            // usb_ctrl_codec at start
+    uint8_t reserved;
+    uint32_t period_us;
+    uint32_t clk_sys_hz;
+    uint32_t elapsed_us;      // start to snapshot (or to stop)
+
+    uint32_t ticks;           // timer ticks since start
+    uint32_t ticks_skipped;   // ... where the previous frame was still in flight
+    uint32_t frames_submitted;
+    uint32_t frames_sent;     // frame end packet queued
+
+    uint32_t lines;           // line packets queued
+    uint64_t line_cycles;     // encode + enqueue, summed over lines
+    uint32_t line_cycles_max;
+    uint32_t postprocess_us_max; // bswap DMA armed -> frame ready
+    uint64_t packet_bytes;    // packets of the frames sent, headers included
+    uint64_t usb_bytes;       // written to the vendor endpoint by core0
+    uint32_t frame_tx_us_sum; // submit -> frame end queued
+    uint32_t frame_tx_us_max;
+} bench_report_t;
+
+#if EBD_IPKVM_BENCH
+
+#include "hardware/structs/systick.h"
+
+// core1: start SysTick and clear the screen buffer.
+void bench_frames_core_init(void);
+
+// core1: render screen (BENCH_SCREEN_UPLOAD keeps the uploaded one) and start
+// ticking every period_us. Returns false for an unknown screen.
+bool bench_frames_start(uint8_t screen, uint32_t period_us, uint8_t codec);
+void bench_frames_stop(void);
+bool bench_frames_running(void);
+// core1: true once per tick while running; skipped ticks are counted by the caller.
+bool bench_frames_tick_due(uint32_t now_us);
+void bench_frames_note_skip(void);
+// core1: copy the screen into a capture buffer, in capture word order.
+void bench_frames_fill(uint32_t (*buf)[CAP_WORDS_PER_LINE]);
+void bench_frames_note_submit(uint32_t now_us);
+void bench_frames_note_postprocess_done(uint32_t now_us);
+void bench_frames_add_line(uint32_t cycles, uint16_t packet_bytes);
+void bench_frames_note_frame_sent(uint32_t submit_us, uint16_t packet_bytes);
+
+// core0: EP0 upload of display-order lines [first_line, first_line + len / 64).
+uint8_t *bench_frames_upload_target(uint16_t first_line, uint16_t len);
+void bench_frames_upload_done(uint16_t first_line, uint16_t len);
+// core0: bytes handed to the vendor endpoint.
+void bench_frames_add_usb_bytes(uint32_t bytes);
+const bench_report_t *bench_frames_snapshot(void);
+
+static inline uint32_t bench_frames_stamp(void) {
+    return systick_hw->cvr;
+}
+
+static inline uint32_t bench_frames_cycles_since(uint32_t start) {
+    // SysTick counts down through 24 bits.
+    return (start - systick_hw->cvr) & 0x00FFFFFFu;
+}
+
+#else
+
+static inline bool bench_frames_running(void) { return false; }
+static inline void bench_frames_add_usb_bytes(uint32_t bytes) { (void)bytes; }
+
+#endif
@@ -1,27 +1,124 @@
 #include "core_bridge.h"
 
-#include "pico/multicore.h"
+#include "pico/stdlib.h"
 
-uint32_t core_bridge_pack(core_bridge_cmd_t code, uint16_t param) {
-    return (((uint32_t)code) << 16) | ((uint32_t)param & 0xFFFFu);
+#define CORE_BRIDGE_CMD_DEPTH 16
+#define CORE_BRIDGE_CMD_MASK (CORE_BRIDGE_CMD_DEPTH - 1)
+#define CORE_BRIDGE_ACK_DEPTH 16
+#define CORE_BRIDGE_ACK_MASK (CORE_BRIDGE_ACK_DEPTH - 1)
+
+#if (CORE_BRIDGE_CMD_DEPTH & CORE_BRIDGE_CMD_MASK) != 0 || (CORE_BRIDGE_ACK_DEPTH & CORE_BRIDGE_ACK_MASK) != 0
+#error "core bridge ring depths must be power-of-two"
+#endif
+
+// Single-producer/single-consumer rings: core0 writes cmd_w and ack_r, core1
+// writes cmd_r and ack_w. Indices are published with release stores after the
+// slot contents, matching the video TX queue.
+static core_bridge_msg_t cmd_ring[CORE_BRIDGE_CMD_DEPTH];
+static volatile uint16_t cmd_w = 0;
+static volatile uint16_t cmd_r = 0;
+
+static core_bridge_ack_t ack_ring[CORE_BRIDGE_ACK_DEPTH];
+static volatile uint16_t ack_w = 0;
+static volatile uint16_t ack_r = 0;
+static volatile uint16_t done_seq = 0;
+static volatile uint32_t ack_overflows = 0;
+
+static uint16_t next_seq = 0;
+
+static inline uint16_t load_u16(const volatile uint16_t *value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
 }
 
-core_bridge_cmd_t core_bridge_unpack_code(uint32_t packed) {
-    return (core_bridge_cmd_t)((packed >> 16) & 0xFFFFu);
+static inline void store_u16(volatile uint16_t *value, uint16_t data) {
+    __atomic_store_n(value, data, __ATOMIC_RELEASE);
 }
 
-uint16_t core_bridge_unpack_param(uint32_t packed) {
-    return (uint16_t)(packed & 0xFFFFu);
+uint16_t core_bridge_send_msg(core_bridge_cmd_t code, const uint32_t *args, uint8_t nargs) {
+    uint16_t w = load_u16(&cmd_w);
+    uint16_t next = (uint16_t)((w + 1u) & CORE_BRIDGE_CMD_MASK);
+    if (next == load_u16(&cmd_r)) {
+        return CORE_BRIDGE_SEQ_NONE;
+    }
+
+    next_seq++;
+    if (next_seq == CORE_BRIDGE_SEQ_NONE) {
+        next_seq = 1;
+    }
+
+    core_bridge_msg_t *msg = &cmd_ring[w];
+    msg->code = (uint16_t)code;
+    msg->seq = next_seq;
+    for (uint8_t i = 0; i < CORE_BRIDGE_MAX_ARGS; i++) {
+        msg->args[i] = (args && i < nargs) ? args[i] : 0;
+    }
+
+    // core1 polls the ring from its capture loop; no doorbell is needed.
+    store_u16(&cmd_w, next);
+    return next_seq;
 }
 
-void core_bridge_send(core_bridge_cmd_t code, uint16_t param) {
-    multicore_fifo_push_blocking(core_bridge_pack(code, param));
+uint16_t core_bridge_send(core_bridge_cmd_t code, uint32_t param) {
+    return core_bridge_send_msg(code, &param, 1);
 }
 
-bool core_bridge_try_pop(uint32_t *out_cmd) {
-    if (!multicore_fifo_rvalid()) {
+bool core_bridge_try_pop(core_bridge_msg_t *out_msg) {
+    uint16_t r = load_u16(&cmd_r);
+    if (r == load_u16(&cmd_w)) {
         return false;
     }
-    *out_cmd = multicore_fifo_pop_blocking();
+    *out_msg = cmd_ring[r];
+    store_u16(&cmd_r, (uint16_t)((r + 1u) & CORE_BRIDGE_CMD_MASK));
     return true;
 }
+
+void core_bridge_ack(const core_bridge_msg_t *msg, uint32_t result) {
+    uint16_t w = load_u16(&ack_w);
+    uint16_t next = (uint16_t)((w + 1u) & CORE_BRIDGE_ACK_MASK);
+    if (next == load_u16(&ack_r)) {
+        // core0 is not draining acks; done_seq below still reports completion.
+        __atomic_fetch_add(&ack_overflows, 1u, __ATOMIC_RELAXED);
+    } else {
+        ack_ring[w].code = msg->code;
+        ack_ring[w].seq = msg->seq;
+        ack_ring[w].result = result;
+        store_u16(&ack_w, next);
+    }
+    // Published last: once core0 sees seq done, its ack is in the ring or lost.
+    store_u16(&done_seq, msg->seq);
+}
+
+bool core_bridge_try_pop_ack(core_bridge_ack_t *out_ack) {
+    uint16_t r = load_u16(&ack_r);
+    if (r == load_u16(&ack_w)) {
+        return false;
+    }
+    *out_ack = ack_ring[r];
+    store_u16(&ack_r, (uint16_t)((r + 1u) & CORE_BRIDGE_ACK_MASK));
+    return true;
+}
+
+bool core_bridge_is_done(uint16_t seq) {
+    if (seq == CORE_BRIDGE_SEQ_NONE) {
+        return false;
+    }
+    return (int16_t)(load_u16(&done_seq) - seq) >= 0;
+}
+
+bool core_bridge_wait(uint16_t seq, uint32_t timeout_us) {
+    if (seq == CORE_BRIDGE_SEQ_NONE) {
+        return false;
+    }
+    uint32_t start = time_us_32();
+    while (!core_bridge_is_done(seq)) {
+        if ((uint32_t)(time_us_32() - start) >= timeout_us) {
+            return false;
+        }
+        tight_loop_contents();
+    }
+    return true;
+}
+
+uint32_t core_bridge_get_ack_overflows(void) {
+    return __atomic_load_n(&ack_overflows, __ATOMIC_ACQUIRE);
+}
@@ -3,23 +3,57 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-// Commands sent from core0 to core1 over the multicore FIFO.
+// Commands sent from core0 to core1 through the shared-SRAM command ring.
 typedef enum {
     CORE_BRIDGE_CMD_STOP_CAPTURE = 1,
     CORE_BRIDGE_CMD_RESET_COUNTERS = 2,
     CORE_BRIDGE_CMD_SINGLE_FRAME = 3,
     CORE_BRIDGE_CMD_START_TEST = 4,
     CORE_BRIDGE_CMD_CONFIG_VSYNC = 5,
-    CORE_BRIDGE_CMD_DIAG_PREP = 6,
-    CORE_BRIDGE_CMD_DIAG_DONE = 7,
+    CORE_BRIDGE_CMD_START_BENCH = 6, // args: bench_screen_t, period_us; FAILED if it did not start
 } core_bridge_cmd_t;
 
-uint32_t core_bridge_pack(core_bridge_cmd_t code, uint16_t param);
-core_bridge_cmd_t core_bridge_unpack_code(uint32_t packed);
-uint16_t core_bridge_unpack_param(uint32_t packed);
+#define CORE_BRIDGE_MAX_ARGS 3
 
-// Push a command to core1 (blocking).
-void core_bridge_send(core_bridge_cmd_t code, uint16_t param);
+// Sequence number 0 is never assigned: the send calls return it when the ring
+// is full and the command was not queued.
+#define CORE_BRIDGE_SEQ_NONE 0u
 
-// Non-blocking pop on core1. Returns true when a command was read.
-bool core_bridge_try_pop(uint32_t *out_cmd);
+// Ack results. Commands that can refuse say so below; the rest always ack OK.
+#define CORE_BRIDGE_RESULT_OK 0u
+#define CORE_BRIDGE_RESULT_FAILED 1u
+
+typedef struct core_bridge_msg {
+    uint16_t code;
+    uint16_t seq;
+    uint32_t args[CORE_BRIDGE_MAX_ARGS];
+} core_bridge_msg_t;
+
+// Completion posted by core1 once a command has been applied.
+typedef struct core_bridge_ack {
+    uint16_t code;
+    uint16_t seq;
+    uint32_t result;
+} core_bridge_ack_t;
+
+// core0: queue a command without blocking. Returns its sequence number, or
+// CORE_BRIDGE_SEQ_NONE when the ring is full (the command was not queued).
+uint16_t core_bridge_send(core_bridge_cmd_t code, uint32_t param);
+uint16_t core_bridge_send_msg(core_bridge_cmd_t code, const uint32_t *args, uint8_t nargs);
+
+// core0: drain completions. Returns true when an ack was read.
+bool core_bridge_try_pop_ack(core_bridge_ack_t *out_ack);
+// core0: true once core1 has acknowledged seq (or any later command); never
+// for CORE_BRIDGE_SEQ_NONE.
+bool core_bridge_is_done(uint16_t seq);
+// core0: spin (without servicing USB) until seq is acknowledged or timeout_us
+// elapses. False at once for CORE_BRIDGE_SEQ_NONE.
+bool core_bridge_wait(uint16_t seq, uint32_t timeout_us);
+
+// core1: non-blocking pop. Returns true when a command was read.
+bool core_bridge_try_pop(core_bridge_msg_t *out_msg);
+// core1: complete a popped command.
+void core_bridge_ack(const core_bridge_msg_t *msg, uint32_t result);
+// Acks dropped because core0 had not drained the ack ring (the command still
+// reads as done through core_bridge_is_done).
+uint32_t core_bridge_get_ack_overflows(void);
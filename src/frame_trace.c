@@ -0,0 +1,68 @@
+#include "frame_trace.h"
+
+#include "pico/stdlib.h"
+
+#if EBD_IPKVM_UVC
+#define FRAME_TRACE_DEPTH 128
+#else
+#define FRAME_TRACE_DEPTH 256
+#endif
+
+// A dump takes a few ms on EP0; a freeze older than this was abandoned.
+#define FRAME_TRACE_FREEZE_MAX_US 250000u
+
+// Both layouts are naturally packed (no padding), so they go on the wire as-is.
+_Static_assert(sizeof(frame_trace_entry_t) == 12, "frame_trace_entry_t layout");
+_Static_assert(sizeof(frame_trace_header_t) == 12, "frame_trace_header_t layout");
+
+// Header and ring are contiguous so the dump is a single control transfer.
+static struct {
+    frame_trace_header_t header;
+    frame_trace_entry_t entries[FRAME_TRACE_DEPTH];
+} trace = {
+    .header = {
+        .version = FRAME_TRACE_VERSION,
+        .entry_bytes = sizeof(frame_trace_entry_t),
+        .depth = FRAME_TRACE_DEPTH,
+    },
+};
+
+static volatile uint32_t trace_head = 0;
+static volatile bool trace_frozen = false;
+static volatile uint32_t trace_frozen_us = 0;
+
+void frame_trace_record(frame_trace_event_t event, uint16_t frame_id, uint32_t value) {
+    if (__atomic_load_n(&trace_frozen, __ATOMIC_ACQUIRE)) {
+        if ((uint32_t)(time_us_32() - trace_frozen_us) < FRAME_TRACE_FREEZE_MAX_US) {
+            return;
+        }
+        frame_trace_thaw();
+    }
+    // The slot is claimed atomically: both cores and the VSYNC IRQ write here.
+    uint32_t slot = __atomic_fetch_add(&trace_head, 1u, __ATOMIC_ACQ_REL) % FRAME_TRACE_DEPTH;
+    frame_trace_entry_t *e = &trace.entries[slot];
+    e->t_us = time_us_32();
+    e->frame_id = frame_id;
+    e->core = (uint8_t)get_core_num();
+    e->value = value;
+    e->event = (uint8_t)event;
+}
+
+void frame_trace_reset(void) {
+    __atomic_store_n(&trace_head, 0u, __ATOMIC_RELEASE);
+}
+
+void frame_trace_freeze(void) {
+    trace_frozen_us = time_us_32();
+    __atomic_store_n(&trace_frozen, true, __ATOMIC_RELEASE);
+}
+
+void frame_trace_thaw(void) {
+    __atomic_store_n(&trace_frozen, false, __ATOMIC_RELEASE);
+}
+
+const void *frame_trace_dump(uint16_t *out_len) {
+    trace.header.head = __atomic_load_n(&trace_head, __ATOMIC_ACQUIRE);
+    *out_len = (uint16_t)sizeof(trace);
+    return &trace;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-frame pipeline events, recorded from both cores (and the VSYNC IRQ) into
+// one fixed ring and read back over EP0 (USB_CTRL_REQ_GET_TRACE).
+typedef enum {
+    FRAME_TRACE_VSYNC_ACCEPTED = 1,
+    FRAME_TRACE_VSYNC_IGNORED = 2,  // value = frame_trace_ignore_t
+    FRAME_TRACE_CAPTURE_START = 3,
+    FRAME_TRACE_DMA_DONE = 4,       // value = lines captured
+    FRAME_TRACE_POSTPROCESS_DONE = 5,
+    FRAME_TRACE_FIRST_LINE_ENQ = 6, // value = line_id
+    FRAME_TRACE_LAST_LINE_ENQ = 7,  // value = line_id
+    FRAME_TRACE_USB_LAST_BYTE = 8,
+    FRAME_TRACE_OVERRUN = 9,
+    FRAME_TRACE_FRAME_SHORT = 10,   // value = lines available
+    FRAME_TRACE_LINE_DROP = 11,     // value = line_id
+    FRAME_TRACE_OUT_OF_SPEC = 12,   // value = bad lines | FRAME_TRACE_OOS_RX_STALL
+} frame_trace_event_t;
+
+// Set in the FRAME_TRACE_OUT_OF_SPEC value when the capture RX FIFO stalled.
+#define FRAME_TRACE_OOS_RX_STALL 0x80000000u
+
+typedef enum {
+    FRAME_TRACE_IGNORE_DEBOUNCE = 1,
+    // 2 was the blocking GPIO diag, replaced by the PIO signal counters.
+    FRAME_TRACE_IGNORE_CAPTURING = 3,
+    FRAME_TRACE_IGNORE_IDLE = 4,
+    FRAME_TRACE_IGNORE_TX_BUSY = 5,
+    FRAME_TRACE_IGNORE_CADENCE = 6,
+    FRAME_TRACE_IGNORE_BENCH = 7,   // benchmark frames own the pipeline
+} frame_trace_ignore_t;
+
+#define FRAME_TRACE_VERSION 1
+
+typedef struct frame_trace_entry {
+    uint32_t t_us;     // time_us_32()
+    uint16_t frame_id;
+    uint8_t event;     // frame_trace_event_t
+    uint8_t core;
+    uint32_t value;
+} frame_trace_entry_t;
+
+// Dump header; entries follow in ring order, oldest at (head % depth) once the
+// ring has wrapped.
+typedef struct frame_trace_header {
+    uint16_t version;
+    uint16_t entry_bytes;
+    uint16_t depth;
+    uint16_t reserved;
+    uint32_t head;     // total events recorded since reset
+} frame_trace_header_t;
+
+void frame_trace_record(frame_trace_event_t event, uint16_t frame_id, uint32_t value);
+void frame_trace_reset(void);
+
+// Recording pauses while frozen so a dump is not overwritten mid-transfer,
+// for at most 250 ms in case the host never finishes it.
+void frame_trace_freeze(void);
+void frame_trace_thaw(void);
+const void *frame_trace_dump(uint16_t *out_len);
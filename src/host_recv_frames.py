@@ -1,5 +1,7 @@
 #!/usr/bin/env python3
-import os, sys, time, struct, fcntl, termios, select, signal, glob
+import os, sys, time, struct, fcntl, termios, select, signal, glob, zlib
+from collections import deque
+from typing import Optional
 
 # Graceful shutdown flag for Ctrl+C
 interrupted = False
@@ -20,9 +22,14 @@ RLE_MODE = True
 OUTPUT_FORMAT = "pgm"
 STREAM_RAW = False
 STREAM_RAW_PATH = "-"
+STREAM_PIX = "gray"
+STREAM_MKV = False
+STREAM_DEDUPE = False
 QUIET = False
 QUIET_SET = False
 CTRL_DEV = None
+TELEMETRY_MS = 0
+NATIVE = True
 ARGS = []
 for arg in sys.argv[1:]:
     if arg == "--no-reset":
@@ -61,6 +68,15 @@ for arg in sys.argv[1:]:
     elif arg.startswith("--stream-raw="):
         STREAM_RAW = True
         STREAM_RAW_PATH = arg.split("=", 1)[1]
+    elif arg.startswith("--stream-pix="):
+        STREAM_PIX = arg.split("=", 1)[1]
+        if STREAM_PIX not in ("gray", "monob"):
+            print(f"[host] invalid --stream-pix value: {STREAM_PIX} (gray or monob)")
+            sys.exit(2)
+    elif arg == "--stream-mkv":
+        STREAM_MKV = True
+    elif arg == "--stream-dedupe":
+        STREAM_DEDUPE = True
     elif arg == "--quiet":
         QUIET = True
         QUIET_SET = True
@@ -69,8 +85,21 @@ for arg in sys.argv[1:]:
         QUIET_SET = True
     elif arg.startswith("--ctrl-device="):
         CTRL_DEV = arg.split("=", 1)[1]
+    elif arg == "--no-native":
+        NATIVE = False
+    elif arg.startswith("--telemetry-ms="):
+        value = arg.split("=", 1)[1]
+        try:
+            TELEMETRY_MS = int(value)
+        except ValueError:
+            print(f"[host] invalid --telemetry-ms value: {value}")
+            sys.exit(2)
     else:
         ARGS.append(arg)
+if STREAM_DEDUPE and not STREAM_MKV:
+    # Bare rawvideo has no timestamps: skipping a frame would speed playback up.
+    print("[host] --stream-dedupe needs --stream-mkv")
+    sys.exit(2)
 
 W = 512
 H = 342
@@ -83,6 +112,52 @@ LEN_MASK = 0x7FFF
 MAGIC0 = 0xEB
 MAGIC1 = 0xD1
 
+# Out-of-band frame end packet (see stream_protocol.h): timestamps + CRC-32.
+FRAME_END_LINE_ID = 0xFFF0
+FRAME_END_TS_BYTES = 12
+FRAME_END_CRC_BYTES = 16
+CRC_HISTORY = 16
+# In-band telemetry packet; payload is usb_ctrl_stats_t (src/usb_control.h).
+TELEMETRY_LINE_ID = 0xFFF1
+# Out-of-band payloads may exceed a line's (telemetry v5 is 138 bytes).
+AUX_PAYLOAD_MAX = 256
+TELEMETRY_FORMAT_V2 = "<HH8BHH7I2I2BHH4I"
+TELEMETRY_FORMAT_V3 = TELEMETRY_FORMAT_V2 + "4IHh"
+TELEMETRY_FORMAT_V4 = TELEMETRY_FORMAT_V3 + "4I4H"
+TELEMETRY_FORMAT = TELEMETRY_FORMAT_V4 + "5I"
+TELEMETRY_FIELDS = (
+    "version", "size",
+    "armed", "capture_enabled", "test_frame_active", "ps_on",
+    "capture_mode", "vsync_fall_edge", "codec", "frame_divisor",
+    "roi_first_line", "roi_line_count",
+    "frames_done", "lines_ok", "lines_drop", "frame_overrun", "frame_short",
+    "usb_drops", "vsync_total",
+    "lines_per_s", "vsync_per_s", "core0_pct", "core1_pct",
+    "txq_r", "txq_w",
+    "time_us", "tx_lines", "tx_lines_rle", "tx_payload_bytes",
+    "lines_out_of_spec", "frames_out_of_spec", "capture_rx_stalls", "monitor_rx_stalls",
+    "last_frame_lines_oos", "last_pixclk_delta",
+    "pixclk_hz", "vsync_hz", "hsync_hz", "video_hz",
+    "pixclk_duty_bp", "vsync_duty_bp", "hsync_duty_bp", "video_duty_bp",
+    "input_events", "input_bad", "input_coalesced", "input_sent", "input_dropped",
+)
+SIGNAL_NAMES = ("pixclk", "vsync", "hsync", "video")
+# Newest first; older firmware sends a shorter payload.
+TELEMETRY_FORMATS = tuple((fmt, struct.calcsize(fmt))
+                          for fmt in (TELEMETRY_FORMAT, TELEMETRY_FORMAT_V4,
+                                      TELEMETRY_FORMAT_V3, TELEMETRY_FORMAT_V2))
+# Matroska elements for --stream-mkv (V_UNCOMPRESSED, FourCC in ColourSpace).
+MKV_EBML = b"\x1A\x45\xDF\xA3"
+MKV_SEGMENT = b"\x18\x53\x80\x67"
+MKV_INFO = b"\x15\x49\xA9\x66"
+MKV_TRACKS = b"\x16\x54\xAE\x6B"
+MKV_CLUSTER = b"\x1F\x43\xB6\x75"
+MKV_FOURCC = {"gray": b"Y800", "monob": b"B0W1"}
+# An unchanged frame is still streamed this often, so players keep going.
+DEDUPE_REFRESH_US = 1_000_000
+CLOCK_RESYNC_SECS = 10.0
+LATENCY_WINDOW = 600
+
 OUTDIR = ARGS[0] if len(ARGS) > 0 else "frames"
 MAX_FRAMES = None if STREAM_RAW else 100
 
@@ -160,15 +235,21 @@ if CTRL_DEV is None:
         sys.exit(2)
     log(f"[host] auto-detected control CDC device: {CTRL_DEV}")
 
-def bytes_to_row64(b: bytes) -> bytes:
-    # Expand 64 packed bytes to 512 bytes of 0/255
-    row = bytearray(W)
-    i = 0
-    for byte in b:
-        for bit in range(7, -1, -1):
-            row[i] = 255 if (byte >> bit) & 1 else 0
-            i += 1
-    return bytes(row)
+# Pure-Python fallbacks for the native conversion kernels (native/src/convert.cpp).
+GRAY_EXPAND = [bytes(255 if (b >> bit) & 1 else 0 for bit in range(7, -1, -1)) for b in range(256)]
+PBM_INVERT = bytes((~b) & 0xFF for b in range(256))
+
+def frame_to_gray(bits: bytes) -> bytes:
+    # Packed frame (1 = white) to 8-bit gray, 0/255 per pixel, in one call.
+    if native is not None:
+        return native.expand_gray8(bits)
+    return b"".join(GRAY_EXPAND[b] for b in bits)
+
+def frame_to_pbm(bits: bytes) -> bytes:
+    # PBM stores 1 = black.
+    if native is not None:
+        return native.invert_pbm(bits)
+    return bits.translate(PBM_INVERT)
 
 def decode_rle_line(b: bytes):
     if len(b) % 2:
@@ -188,17 +269,49 @@ def decode_rle_line(b: bytes):
         return None
     return bytes(out)
 
-def write_pgm(path: str, rows: list[bytes]) -> None:
+def ebml(eid: bytes, data: bytes) -> bytes:
+    # Sizes are always written as 8-byte vints; simpler, and ffmpeg accepts them.
+    return eid + (len(data) | (1 << 56)).to_bytes(8, "big") + data
+
+def ebml_uint(eid: bytes, value: int) -> bytes:
+    return ebml(eid, value.to_bytes(max(1, (value.bit_length() + 7) // 8), "big"))
+
+def mkv_header(pix: str) -> bytes:
+    # EBML header, then a live (unknown size) segment with one video track.
+    # Timestamps count microseconds.
+    head = ebml(MKV_EBML, b"".join((
+        ebml_uint(b"\x42\x86", 1), ebml_uint(b"\x42\xF7", 1),
+        ebml_uint(b"\x42\xF2", 4), ebml_uint(b"\x42\xF3", 8),
+        ebml(b"\x42\x82", b"matroska"), ebml_uint(b"\x42\x87", 4), ebml_uint(b"\x42\x85", 2),
+    )))
+    info = ebml(MKV_INFO, b"".join((
+        ebml_uint(b"\x2A\xD7\xB1", 1000),
+        ebml(b"\x4D\x80", b"host_recv_frames.py"),
+        ebml(b"\x57\x41", b"host_recv_frames.py"),
+    )))
+    video = ebml(b"\xE0", b"".join((
+        ebml_uint(b"\xB0", W), ebml_uint(b"\xBA", H),
+        ebml(b"\x2E\xB5\x24", MKV_FOURCC[pix]),
+    )))
+    track = ebml(b"\xAE", b"".join((
+        ebml_uint(b"\xD7", 1), ebml_uint(b"\x73\xC5", 1), ebml_uint(b"\x83", 1),
+        ebml_uint(b"\x9C", 0), ebml(b"\x86", b"V_UNCOMPRESSED"), video,
+    )))
+    return head + MKV_SEGMENT + b"\x01\xFF\xFF\xFF\xFF\xFF\xFF\xFF" + info + ebml(MKV_TRACKS, track)
+
+def mkv_cluster(pts_us: int, frame: bytes) -> bytes:
+    # One frame per cluster: track 1, relative time 0, keyframe.
+    return ebml(MKV_CLUSTER, ebml_uint(b"\xE7", pts_us) + ebml(b"\xA3", b"\x81\x00\x00\x80" + frame))
+
+def write_pgm(path: str, gray: bytes) -> None:
     with open(path, "wb") as f:
         f.write(f"P5\n{W} {H}\n255\n".encode("ascii"))
-        for r in rows:
-            f.write(r)
+        f.write(gray)
 
-def write_pbm(path: str, rows: list[bytes]) -> None:
+def write_pbm(path: str, bits: bytes) -> None:
     with open(path, "wb") as f:
         f.write(f"P4\n{W} {H}\n".encode("ascii"))
-        for r in rows:
-            f.write(bytes((~b) & 0xFF for b in r))
+        f.write(frame_to_pbm(bits))
 
 def pop_one_packet(buf: bytearray):
     # find magic
@@ -212,7 +325,9 @@ def pop_one_packet(buf: bytearray):
         return None
     plen = buf[6] | (buf[7] << 8)
     payload_len = plen & LEN_MASK
-    if payload_len == 0 or payload_len > MAX_PAYLOAD:
+    line_id = buf[4] | (buf[5] << 8)
+    max_payload = AUX_PAYLOAD_MAX if line_id >= FRAME_END_LINE_ID else MAX_PAYLOAD
+    if payload_len == 0 or payload_len > max_payload:
         del buf[:2]
         return None
     total_len = HEADER_BYTES + payload_len
@@ -232,6 +347,8 @@ CTRL_REQ_PROBE_PACKET = 0x04
 CTRL_REQ_RLE_ON = 0x05
 CTRL_REQ_RLE_OFF = 0x06
 CTRL_REQ_CAPTURE_PARK = 0x07
+CTRL_REQ_SET_TELEMETRY = 0x15
+CTRL_REQ_GET_TIME = 0x81
 
 def open_usb_stream():
     try:
@@ -296,17 +413,122 @@ def open_usb_device_for_control():
             pass
     return dev
 
-def send_ep0_cmd(dev, req):
+def send_ep0_cmd(dev, req, value=0):
     try:
         # 0x41 = Host-to-Device | Vendor | Interface recipient
         # wIndex=0 targets the vendor bulk interface (ITF_NUM_VENDOR_STREAM).
         # Device-level vendor requests (0x40) may not be routed to
         # tud_vendor_control_xfer_cb by all TinyUSB versions.
-        dev.ctrl_transfer(0x41, req, 0, 0, None)
+        dev.ctrl_transfer(0x41, req, value, 0, None)
     except Exception as exc:
         print(f"[host] EP0 control transfer failed (req=0x{req:02X}): {exc}", file=sys.stderr)
         sys.exit(2)
 
+def host_now_us() -> int:
+    return time.monotonic_ns() // 1000
+
+def sync_device_clock(dev, samples: int = 8):
+    # Bracket each device clock read with host reads and keep the sample with
+    # the shortest round trip; returns (device_us_64, host_us, rtt_us) or None.
+    best = None
+    for _ in range(samples):
+        try:
+            t0 = host_now_us()
+            # 0xC1 = Device-to-Host | Vendor | Interface recipient
+            raw = bytes(dev.ctrl_transfer(0xC1, CTRL_REQ_GET_TIME, 0, 0, 8))
+            t1 = host_now_us()
+        except Exception:
+            return None
+        if len(raw) < 8:
+            return None
+        rtt = t1 - t0
+        if best is None or rtt < best[2]:
+            best = (struct.unpack("<Q", raw)[0], (t0 + t1) // 2, rtt)
+    return best
+
+def device_to_host_us(clock, dev_us32: int) -> int:
+    dev64, host_us, _ = clock
+    delta = ((dev_us32 - (dev64 & 0xFFFFFFFF) + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+    return host_us + delta
+
+def percentile(sorted_vals, pct: float) -> float:
+    if not sorted_vals:
+        return 0.0
+    idx = min(len(sorted_vals) - 1, int(round(pct / 100.0 * (len(sorted_vals) - 1))))
+    return sorted_vals[idx]
+
+def format_telemetry(t: dict) -> str:
+    txq_depth = (t["txq_w"] - t["txq_r"]) & 0xFFFF
+    ratio = 0.0
+    if t["tx_lines"]:
+        ratio = 100.0 * t["tx_payload_bytes"] / (t["tx_lines"] * LINE_BYTES)
+    text = (f"lines/s={t['lines_per_s']} vsync/s={t['vsync_per_s']} frames={t['frames_done']} "
+            f"drop={t['lines_drop']} ov={t['frame_overrun']} sh={t['frame_short']} usb={t['usb_drops']} "
+            f"c0={t['core0_pct']}% c1={t['core1_pct']}% txq={txq_depth} "
+            f"rle={t['tx_lines_rle']}/{t['tx_lines']} ratio={ratio:.1f}%")
+    if "lines_out_of_spec" in t:
+        text += (f" oos={t['lines_out_of_spec']}/{t['frames_out_of_spec']} "
+                 f"rxstall={t['capture_rx_stalls']} last={t['last_frame_lines_oos']}"
+                 f"@{t['last_pixclk_delta']:+d}")
+    if "pixclk_hz" in t:
+        text += "".join(f" {n}={t[n + '_hz']}Hz@{t[n + '_duty_bp'] / 100:.2f}%" for n in SIGNAL_NAMES)
+    return text
+
+def latency_summary(name: str, samples) -> str:
+    vals = sorted(samples)
+    if not vals:
+        return f"{name}=n/a"
+    return (f"{name} p50={percentile(vals, 50) / 1000:.2f} p90={percentile(vals, 90) / 1000:.2f} "
+            f"p99={percentile(vals, 99) / 1000:.2f} max={vals[-1] / 1000:.2f}ms")
+
+def import_native():
+    # ctypes bindings for native/ (see native/README.md), if the library is built.
+    here = os.path.dirname(os.path.abspath(__file__))
+    sys.path.insert(0, os.path.join(here, "..", "native", "python"))
+    try:
+        import ebd_ipkvm_host
+    except ImportError:
+        return None
+    if not ebd_ipkvm_host.available():
+        return None
+    log(f"[host] native library: {ebd_ipkvm_host.library_path()} (convert: {ebd_ipkvm_host.convert_impl()})")
+    return ebd_ipkvm_host
+
+def open_native_ingest(native):
+    # libusb async ingest; needs the library built with libusb.
+    try:
+        return native.BulkIngest(USB_VID, USB_PID)
+    except native.NativeError as exc:
+        log(f"[host] native ingest unavailable ({exc}); using pyusb")
+        return None
+
+def open_native_assembler(native):
+    # Packet parser + frame assembler; replaces pop_one_packet() and the
+    # per-frame line dicts below.
+    try:
+        return native.FrameAssembler()
+    except native.NativeError as exc:
+        log(f"[host] native assembler unavailable ({exc}); parsing in Python")
+        return None
+
+def read_native_stream(ingest, timeout_s: float) -> bytes:
+    global interrupted
+    try:
+        return ingest.read(timeout_s)
+    except RuntimeError as exc:
+        print(f"[host] native ingest stopped: {exc}", file=sys.stderr)
+        interrupted = True
+        return b""
+
+def format_ingest(c: dict) -> str:
+    return (f"ingest bytes={c['bytes']} xfers={c['transfers']} stalls={c['stalls']} "
+            f"errors={c['errors']} dropped={c['dropped']} ring_high={c['ring_high']}")
+
+def format_assembler(c: dict) -> str:
+    return (f"parser packets={c['packets']} skipped={c['skipped_bytes']} "
+            f"bad_hdr={c['bad_headers']} bad_lines={c['bad_lines']} late={c['late_lines']} "
+            f"frames complete={c['frames_complete']} partial={c['frames_partial']}")
+
 def read_usb_stream(ep_in, timeout_s: float) -> bytes:
     timeout_ms = int(timeout_s * 1000)
     try:
@@ -335,10 +557,22 @@ def service_cdc_relay(ready_fds, ctrl_fd, stdin_fd, relay_active):
 usb_dev = None
 usb_intf = None
 usb_ep_in = None
+ingest = None
+assembler = None
 stdin_fd = None
 stdin_attr = None
 relay_active = False
-usb_dev, usb_intf, usb_ep_in = open_usb_stream()
+native = import_native() if NATIVE else None
+if native is not None:
+    ingest = open_native_ingest(native)
+    assembler = open_native_assembler(native)
+if ingest is not None:
+    # The native side owns the interface; vendor EP0 requests need no claim.
+    usb_dev = open_usb_device_for_control()
+    read_stream = lambda timeout_s: read_native_stream(ingest, timeout_s)
+else:
+    usb_dev, usb_intf, usb_ep_in = open_usb_stream()
+    read_stream = lambda timeout_s: read_usb_stream(usb_ep_in, timeout_s)
 ctrl_fd = os.open(CTRL_DEV, os.O_RDWR | os.O_NOCTTY)
 set_raw_and_dtr(ctrl_fd)
 
@@ -396,17 +630,29 @@ if PROBE_ONLY:
     probe_deadline = time.time() + 1.0
     probe_bytes = 0
     while time.time() < probe_deadline:
-        chunk = read_usb_stream(usb_ep_in, 0.25)
+        chunk = read_stream(0.25)
         if chunk:
             probe_bytes += len(chunk)
     print(f"[host] probe bytes received: {probe_bytes}")
     sys.exit(0)
+clock = sync_device_clock(usb_dev)
+if clock is None:
+    log("[host] device clock sync unavailable; latency reporting disabled")
+else:
+    log(f"[host] device clock synced (rtt={clock[2]}us)")
+last_clock_sync = time.time()
+if TELEMETRY_MS > 0:
+    send_ep0_cmd(usb_dev, CTRL_REQ_SET_TELEMETRY, TELEMETRY_MS)
 send_ep0_cmd(usb_dev, CTRL_REQ_CAPTURE_START)
 
 mode_note = "reset+start" if SEND_RESET else "start"
 boot_note = "boot" if SEND_BOOT else "no-boot"
 ext = "pbm" if OUTPUT_FORMAT == "pbm" else "pgm"
-stream_note = f", raw_stream={STREAM_RAW_PATH}" if STREAM_RAW else ""
+stream_note = ""
+if STREAM_RAW:
+    stream_note = f", raw_stream={STREAM_RAW_PATH}, pix={STREAM_PIX}"
+    if STREAM_MKV:
+        stream_note += ", mkv" + (", dedupe" if STREAM_DEDUPE else "")
 if STREAM_RAW:
     log(f"[host] reading usb-bulk, streaming raw frames ({mode_note}, {boot_note}, boot_wait={BOOT_WAIT:.2f}s, diag={DIAG_SECS:.2f}s{stream_note})")
 else:
@@ -419,8 +665,141 @@ if relay_active:
 buf = bytearray()
 frames = {}  # frame_id -> dict(line->row)
 frame_stats = {}  # frame_id -> dict(bytes=payload_bytes, rle_lines=count)
+ASSEMBLING_MAX = 2  # frames assembling at once, as the native assembler
+last_bits = bytes(LINE_BYTES * H)  # last frame emitted, for lines a frame lacks
+emitted_ids = deque(maxlen=4)  # late lines for these are dropped
 done_count = 0
 last_print = time.time()
+# Per-frame latencies in microseconds, over the most recent frames.
+lat_total = deque(maxlen=LATENCY_WINDOW)   # VSYNC -> frame end packet at host
+lat_device = deque(maxlen=LATENCY_WINDOW)  # VSYNC -> last line enqueued
+lat_usb = deque(maxlen=LATENCY_WINDOW)     # last line enqueued -> host
+# CRC-32 of recently completed frames, checked against the device frame end.
+completed_crc = {}
+crc_ok = 0
+crc_bad = 0
+crc_incomplete = 0
+# --stream-raw state: last frame streamed and its timestamp, for dedupe.
+stream_bits = None
+stream_pts = None
+stream_pts0 = None
+stream_skipped = 0
+
+def record_frame_end(vsync_us: int, last_us: int, rx_us: int) -> None:
+    lat_total.append(rx_us - device_to_host_us(clock, vsync_us))
+    lat_device.append((last_us - vsync_us) & 0xFFFFFFFF)
+    lat_usb.append(rx_us - device_to_host_us(clock, last_us))
+
+def log_telemetry(frame_id: int, is_rle: bool, payload: bytes) -> None:
+    t = None
+    for fmt, size in TELEMETRY_FORMATS:
+        if len(payload) >= size and not is_rle:
+            t = dict(zip(TELEMETRY_FIELDS, struct.unpack(fmt, payload[:size])))
+            break
+    if t is not None:
+        log(f"[host][telemetry #{frame_id}] {format_telemetry(t)}")
+
+def stream_frame(bits: bytes, pts_us: int) -> bool:
+    # Returns False when --stream-dedupe skipped the frame.
+    global stream_bits, stream_pts, stream_pts0, stream_skipped
+    if stream_pts0 is None:
+        stream_pts0 = pts_us
+        if STREAM_MKV:
+            raw_stream.write(mkv_header(STREAM_PIX))
+    # Timestamps start at 0 and never step back (clock resyncs, mixed sources).
+    pts = pts_us - stream_pts0
+    if stream_pts is not None and pts <= stream_pts:
+        pts = stream_pts + 1
+    if (STREAM_DEDUPE and bits == stream_bits
+            and pts - stream_pts < DEDUPE_REFRESH_US):
+        stream_skipped += 1
+        return False
+    # monob is the wire format as is: 1 = white, MSB first.
+    frame = bits if STREAM_PIX == "monob" else frame_to_gray(bits)
+    raw_stream.write(mkv_cluster(pts, frame) if STREAM_MKV else frame)
+    stream_bits, stream_pts = bits, pts
+    return True
+
+def write_frame(frame_id: int, bits: bytes, payload_bytes: int, rle_lines: int, lines: int = H,
+                pts_us: Optional[int] = None) -> None:
+    # bits: the whole packed frame, H lines of LINE_BYTES. pts_us: host
+    # microseconds the frame was captured at (default: now).
+    global done_count
+    if STREAM_RAW:
+        if not stream_frame(bits, host_now_us() if pts_us is None else pts_us):
+            log(f"[host] unchanged frame_id={frame_id}, not streamed")
+            return
+    else:
+        out = os.path.join(OUTDIR, f"frame_{done_count:03d}.{ext}")
+        if OUTPUT_FORMAT == "pbm":
+            write_pbm(out, bits)
+        else:
+            write_pgm(out, frame_to_gray(bits))
+    raw_bytes = LINE_BYTES * H
+    ratio = payload_bytes / raw_bytes if raw_bytes else 0.0
+    percent = ratio * 100.0
+    partial = f", partial lines={lines}/{H}" if lines < H else ""
+    if STREAM_RAW:
+        log(
+            f"[host] streamed frame_id={frame_id} "
+            f"(rle_lines={rle_lines}/{H}, "
+            f"payload_bytes={payload_bytes}, raw_bytes={raw_bytes}, "
+            f"ratio={percent:.1f}%{partial})"
+        )
+    else:
+        log(
+            f"[host] wrote {out} (frame_id={frame_id}, "
+            f"rle_lines={rle_lines}/{H}, "
+            f"payload_bytes={payload_bytes}, raw_bytes={raw_bytes}, "
+            f"ratio={percent:.1f}%)"
+        )
+    done_count += 1
+
+def finish_frame(frame_id: int) -> None:
+    # Emit frames[frame_id] and free it. Lines it never got (outside the ROI,
+    # or lost) come from the last frame emitted, as in the native assembler.
+    global last_bits
+    fm = frames.pop(frame_id)
+    stats = frame_stats.pop(frame_id)
+    emitted_ids.append(frame_id)
+    if len(fm) == H:
+        bits = b"".join(fm[i] for i in range(H))
+        completed_crc[frame_id] = zlib.crc32(bits)
+        while len(completed_crc) > CRC_HISTORY:
+            del completed_crc[next(iter(completed_crc))]
+    else:
+        bits = b"".join(fm.get(i) or last_bits[i * LINE_BYTES:(i + 1) * LINE_BYTES]
+                        for i in range(H))
+    last_bits = bits
+    if len(fm) == H or STREAM_RAW:
+        write_frame(frame_id, bits, stats["bytes"], stats["rle_lines"], len(fm))
+    else:
+        log(f"[host] skipped partial frame_id={frame_id} lines={len(fm)}/{H}")
+
+def take_native_frames() -> None:
+    global crc_ok, crc_bad, crc_incomplete
+    for frame_id, line_id, length_flags, payload in assembler.aux():
+        if line_id == TELEMETRY_LINE_ID:
+            log_telemetry(frame_id, bool(length_flags & RLE_FLAG), payload)
+    for fr in assembler.frames():
+        if fr.has_end and clock is not None:
+            record_frame_end(fr.vsync_us, fr.last_line_us, fr.end_rx_us)
+        if fr.crc_bad:
+            log(f"[host] CRC mismatch frame_id={fr.frame_id} "
+                f"device=0x{fr.device_crc:08X} host=0x{fr.host_crc:08X}")
+        # Partial frames carry the missing lines from the previous frame: a
+        # live stream keeps its cadence, files hold only whole frames.
+        if fr.complete or STREAM_RAW:
+            pts_us = None
+            if fr.has_end and clock is not None:
+                pts_us = device_to_host_us(clock, fr.vsync_us)
+            write_frame(fr.frame_id, fr.bits, fr.payload_bytes, fr.rle_lines, fr.lines, pts_us)
+        else:
+            log(f"[host] skipped partial frame_id={fr.frame_id} lines={fr.lines}/{H}")
+        if MAX_FRAMES is not None and done_count >= MAX_FRAMES:
+            break
+    c = assembler.counters()
+    crc_ok, crc_bad, crc_incomplete = c["crc_ok"], c["crc_bad"], c["crc_incomplete"]
 
 # Optional: If nothing arrives for a while, say so.
 last_rx = time.time()
@@ -439,24 +818,26 @@ try:
             relay_fds.append(stdin_fd)
         ready, _, _ = select.select(relay_fds, [], [], 0)
         service_cdc_relay(ready, ctrl_fd, stdin_fd, relay_active)
-        chunk = read_usb_stream(usb_ep_in, stream_timeout)
+        chunk = read_stream(stream_timeout)
         ready, _, _ = select.select(relay_fds, [], [], 0)
         service_cdc_relay(ready, ctrl_fd, stdin_fd, relay_active)
 
+        if assembler is not None:
+            # Also runs the frame timeouts when nothing arrived.
+            assembler.feed(chunk, host_now_us())
+            take_native_frames()
         if not chunk:
             now = time.time()
             if now - last_rx > 2.0:
                 log("[host] no data yet (is Pico armed + Mac running?)")
                 last_rx = now
             continue
-        if not chunk:
-            time.sleep(0.01)
-            continue
 
         last_rx = time.time()
-        buf.extend(chunk)
+        if assembler is None:
+            buf.extend(chunk)
 
-        while True:
+        while assembler is None:
             if interrupted:
                 break
             pkt = pop_one_packet(buf)
@@ -469,6 +850,29 @@ try:
             is_rle   = bool(plen & RLE_FLAG)
             payload_len = plen & LEN_MASK
 
+            if line_id == FRAME_END_LINE_ID:
+                if frame_id in frames:
+                    finish_frame(frame_id)  # partial: an ROI, or lines lost
+                if payload_len >= FRAME_END_TS_BYTES and not is_rle and clock is not None:
+                    vsync_us, first_us, last_us = struct.unpack("<III", pkt[8:8 + FRAME_END_TS_BYTES])
+                    record_frame_end(vsync_us, last_us, host_now_us())
+                if payload_len >= FRAME_END_CRC_BYTES and not is_rle:
+                    (dev_crc,) = struct.unpack("<I", pkt[8 + 12:8 + 16])
+                    host_crc = completed_crc.pop(frame_id, None)
+                    if host_crc is None:
+                        crc_incomplete += 1
+                    elif host_crc == dev_crc:
+                        crc_ok += 1
+                    else:
+                        crc_bad += 1
+                        log(f"[host] CRC mismatch frame_id={frame_id} "
+                            f"device=0x{dev_crc:08X} host=0x{host_crc:08X}")
+                continue
+
+            if line_id == TELEMETRY_LINE_ID:
+                log_telemetry(frame_id, is_rle, pkt[8:8 + payload_len])
+                continue
+
             if payload_len == 0 or payload_len > MAX_PAYLOAD or line_id >= H:
                 continue
 
@@ -483,6 +887,11 @@ try:
                     continue
                 packed = payload
 
+            if frame_id in emitted_ids:
+                continue  # late line for a frame already emitted
+            if frame_id not in frames and len(frames) >= ASSEMBLING_MAX:
+                # The oldest frame's end packet was lost: it ends here.
+                finish_frame(next(iter(frames)))
             fm = frames.setdefault(frame_id, {})
             stats = frame_stats.setdefault(frame_id, {"bytes": 0, "rle_lines": 0})
             if line_id not in fm:
@@ -492,53 +901,30 @@ try:
                     stats["rle_lines"] += 1
 
             if len(fm) == H:
-                rows = [fm[i] for i in range(H)]
-                expanded = None
-                if STREAM_RAW or OUTPUT_FORMAT != "pbm":
-                    expanded = [bytes_to_row64(row) for row in rows]
-                if STREAM_RAW:
-                    frame_bytes = b"".join(expanded)
-                    raw_stream.write(frame_bytes)
-                else:
-                    out = os.path.join(OUTDIR, f"frame_{done_count:03d}.{ext}")
-                    if OUTPUT_FORMAT == "pbm":
-                        write_pbm(out, rows)
-                    else:
-                        write_pgm(out, expanded)
-                raw_bytes = LINE_BYTES * H
-                payload_bytes = stats["bytes"]
-                ratio = payload_bytes / raw_bytes if raw_bytes else 0.0
-                percent = ratio * 100.0
-                rle_lines = stats["rle_lines"]
-                if STREAM_RAW:
-                    log(
-                        f"[host] streamed frame_id={frame_id} "
-                        f"(rle_lines={rle_lines}/{H}, "
-                        f"payload_bytes={payload_bytes}, raw_bytes={raw_bytes}, "
-                        f"ratio={percent:.1f}%)"
-                    )
-                else:
-                    log(
-                        f"[host] wrote {out} (frame_id={frame_id}, "
-                        f"rle_lines={rle_lines}/{H}, "
-                        f"payload_bytes={payload_bytes}, raw_bytes={raw_bytes}, "
-                        f"ratio={percent:.1f}%)"
-                    )
-                done_count += 1
-                # free memory for this frame_id
-                del frames[frame_id]
-                del frame_stats[frame_id]
-                if MAX_FRAMES is not None and done_count >= MAX_FRAMES:
-                    break
+                finish_frame(frame_id)
+            if MAX_FRAMES is not None and done_count >= MAX_FRAMES:
+                break
 
         now = time.time()
+        if clock is not None and now - last_clock_sync > CLOCK_RESYNC_SECS:
+            last_clock_sync = now
+            clock = sync_device_clock(usb_dev) or clock
         if now - last_print > 1.0:
             last_print = now
+            if crc_ok or crc_bad:
+                log(f"[host] crc ok={crc_ok} bad={crc_bad} incomplete={crc_incomplete}")
+            if ingest is not None:
+                log(f"[host] {format_ingest(ingest.counters())}")
+            if assembler is not None:
+                log(f"[host] {format_assembler(assembler.counters())} done={done_count}")
+            if lat_total:
+                log(f"[host] latency {latency_summary('vsync->host', lat_total)} "
+                    f"{latency_summary('device', lat_device)} {latency_summary('usb', lat_usb)}")
             if frames:
                 newest = max(frames.keys())
                 have = len(frames[newest])
                 log(f"[host] newest frame_id={newest} lines={have}/342 done={done_count}/100")
-            else:
+            elif assembler is None:
                 log(f"[host] done={done_count}/100 (waiting for packets)")
 finally:
     if relay_active and stdin_attr is not None:
@@ -548,11 +934,19 @@ finally:
             send_ep0_cmd(usb_dev, CTRL_REQ_CAPTURE_STOP)
         except OSError:
             pass
+    if TELEMETRY_MS > 0:
+        send_ep0_cmd(usb_dev, CTRL_REQ_SET_TELEMETRY, 0)
     try:
         os.write(ctrl_fd, b"p")
     except OSError:
         pass
     os.close(ctrl_fd)
+    if ingest is not None:
+        log(f"[host] {format_ingest(ingest.counters())}")
+        ingest.close()
+    if assembler is not None:
+        log(f"[host] {format_assembler(assembler.counters())}")
+        assembler.close()
     if usb_dev is not None and usb_intf is not None:
         try:
             import usb.util
@@ -563,4 +957,12 @@ finally:
 if raw_stream and raw_stream is not sys.stdout.buffer:
     raw_stream.close()
 
+if STREAM_DEDUPE:
+    log(f"[host] streamed {done_count} frames, {stream_skipped} unchanged skipped")
+if crc_ok or crc_bad or crc_incomplete:
+    log(f"[host] crc ok={crc_ok} bad={crc_bad} incomplete={crc_incomplete}")
+if lat_total:
+    log(f"[host] latency over last {len(lat_total)} frames: "
+        f"{latency_summary('vsync->host', lat_total)} "
+        f"{latency_summary('device', lat_device)} {latency_summary('usb', lat_usb)}")
 log("[host] complete.")
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Keyboard/mouse records the host writes to the vendor bulk OUT endpoint.
+// Fixed 4-byte records; a USB packet may end in the middle of one. Both input
+// paths (input_uart.c to the external controller, adb_device.c on PIO1) take
+// the same records.
+#define INPUT_EVENT_BYTES 4
+#define INPUT_EV_MOUSE 0x01 // buttons (bit 0 = down), dx (i8), dy (i8, + = down)
+#define INPUT_EV_KEY 0x02   // ADB key code, flags (bit 0 = key up), modifier byte
+
+typedef struct input_counters {
+    uint32_t events;    // records accepted from the OUT endpoint
+    uint32_t bad;       // records with an unknown type
+    uint32_t coalesced; // mouse records merged into pending motion
+    uint32_t sent;      // instructions sent / ADB replies carrying input
+    uint32_t dropped;   // records lost to a full queue
+} input_counters_t;
+
+typedef struct input_event_reader {
+    uint8_t partial[INPUT_EVENT_BYTES];
+    uint8_t partial_len;
+} input_event_reader_t;
+
+typedef void (*input_event_handler_t)(const uint8_t *rec);
+
+// Split a chunk read from the endpoint into records, carrying a trailing
+// partial record over to the next call.
+static inline void input_event_reader_feed(input_event_reader_t *r, const uint8_t *data,
+                                           uint32_t len, input_event_handler_t handle) {
+    while (len > 0) {
+        if (r->partial_len == 0 && len >= INPUT_EVENT_BYTES) {
+            handle(data);
+            data += INPUT_EVENT_BYTES;
+            len -= INPUT_EVENT_BYTES;
+            continue;
+        }
+        r->partial[r->partial_len++] = *data++;
+        len--;
+        if (r->partial_len == INPUT_EVENT_BYTES) {
+            handle(r->partial);
+            r->partial_len = 0;
+        }
+    }
+}
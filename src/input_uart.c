@@ -0,0 +1,241 @@
+#include "input_uart.h"
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+
+#define INPUT_QUEUE_LEN 32u
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_LEN - 1u)
+#define INPUT_DELTA_MIN (-128)
+#define INPUT_DELTA_MAX 127
+
+typedef struct input_event {
+    uint8_t b[INPUT_EVENT_BYTES];
+} input_event_t;
+
+static uart_inst_t *input_uart = NULL;
+static int tx_dma_chan = -1;
+static dma_channel_config tx_dma_cfg;
+
+// Records not yet framed; the tail is still open for merging.
+static input_event_t queue[INPUT_QUEUE_LEN];
+static uint8_t queue_r = 0;
+static uint8_t queue_w = 0;
+
+// The frame in flight. The DMA reads from here, and a repeat resends it as is.
+static uint8_t tx_frame[INPUT_LINK_FRAME_MAX];
+static uint8_t tx_len = 0;
+static uint8_t tx_seq = 0;
+static bool in_flight = false;
+static bool sent_any = false;
+static uint32_t tx_sent_us = 0;
+static uint8_t key_credits = INPUT_LINK_CREDITS_INIT;
+
+// Ack parser: bytes collected since the sync byte.
+static uint8_t ack_buf[INPUT_LINK_ACK_BYTES];
+static uint8_t ack_len = 0;
+
+static input_event_reader_t reader;
+
+static input_counters_t counters;
+
+static inline uint8_t queue_count(void) {
+    return (uint8_t)((queue_w - queue_r) & 0xFFu);
+}
+
+static inline input_event_t *queue_tail(void) {
+    return queue_count() ? &queue[(queue_w - 1u) & INPUT_QUEUE_MASK] : NULL;
+}
+
+static input_event_t *queue_append(void) {
+    if (queue_count() >= INPUT_QUEUE_LEN) {
+        counters.dropped++;
+        return NULL;
+    }
+    input_event_t *ev = &queue[queue_w & INPUT_QUEUE_MASK];
+    queue_w++;
+    return ev;
+}
+
+static inline int clamp_delta(int v) {
+    if (v < INPUT_DELTA_MIN) {
+        return INPUT_DELTA_MIN;
+    }
+    if (v > INPUT_DELTA_MAX) {
+        return INPUT_DELTA_MAX;
+    }
+    return v;
+}
+
+static void queue_mouse(const uint8_t *rec) {
+    int dx = (int8_t)rec[2];
+    int dy = (int8_t)rec[3];
+    // Merge into the tail while the button state matches, so motion never
+    // moves past a click or a key.
+    input_event_t *tail = queue_tail();
+    if (tail && tail->b[0] == INPUT_EV_MOUSE && ((tail->b[1] ^ rec[1]) & 0x01u) == 0) {
+        int tx = (int8_t)tail->b[2];
+        int ty = (int8_t)tail->b[3];
+        int mx = clamp_delta(tx + dx);
+        int my = clamp_delta(ty + dy);
+        dx -= mx - tx;
+        dy -= my - ty;
+        tail->b[2] = (uint8_t)(int8_t)mx;
+        tail->b[3] = (uint8_t)(int8_t)my;
+        counters.coalesced++;
+        if (dx == 0 && dy == 0) {
+            return;
+        }
+    }
+    // A button change or motion past the 8-bit range needs new records.
+    do {
+        input_event_t *ev = queue_append();
+        if (!ev) {
+            return;
+        }
+        int mx = clamp_delta(dx);
+        int my = clamp_delta(dy);
+        ev->b[0] = INPUT_EV_MOUSE;
+        ev->b[1] = rec[1] & 0x01u;
+        ev->b[2] = (uint8_t)(int8_t)mx;
+        ev->b[3] = (uint8_t)(int8_t)my;
+        dx -= mx;
+        dy -= my;
+    } while (dx != 0 || dy != 0);
+}
+
+static void handle_record(const uint8_t *rec) {
+    input_event_t *ev;
+    switch (rec[0]) {
+    case INPUT_EV_MOUSE:
+        counters.events++;
+        queue_mouse(rec);
+        break;
+    case INPUT_EV_KEY:
+        counters.events++;
+        ev = queue_append();
+        if (ev) {
+            memcpy(ev->b, rec, INPUT_EVENT_BYTES);
+        }
+        break;
+    default:
+        counters.bad++;
+        break;
+    }
+}
+
+// Frame as many queued records as fit, stopping at a key the controller has
+// no room for yet. With a key waiting for room and nothing else to send, an
+// empty frame asks for a fresh credit count once credit_poll is set. Returns
+// false when nothing can go.
+static bool build_frame(bool credit_poll) {
+    uint8_t n = 0;
+    uint8_t *p = &tx_frame[3];
+    while (n < INPUT_LINK_EVENTS_MAX && queue_count() > 0) {
+        const input_event_t *ev = &queue[queue_r & INPUT_QUEUE_MASK];
+        if (ev->b[0] == INPUT_EV_KEY) {
+            if (key_credits == 0) {
+                break;
+            }
+            key_credits--;
+        }
+        memcpy(p, ev->b, INPUT_EVENT_BYTES);
+        p += INPUT_EVENT_BYTES;
+        queue_r++;
+        n++;
+    }
+    if (n == 0 && (!credit_poll || queue_count() == 0)) {
+        return false;
+    }
+    tx_seq = sent_any ? (uint8_t)(tx_seq == 0xFFu ? 1u : tx_seq + 1u) : 0u;
+    sent_any = true;
+    tx_frame[0] = INPUT_LINK_SYNC;
+    tx_frame[1] = (uint8_t)(n * INPUT_EVENT_BYTES);
+    tx_frame[2] = tx_seq;
+    uint16_t crc = 0xFFFFu;
+    for (uint8_t *q = &tx_frame[1]; q < p; q++) {
+        crc = input_link_crc(crc, *q);
+    }
+    p[0] = (uint8_t)crc;
+    p[1] = (uint8_t)(crc >> 8);
+    tx_len = (uint8_t)(p + 2 - tx_frame);
+    return true;
+}
+
+static void take_ack_byte(uint8_t byte) {
+    if (ack_len == 0 && byte != INPUT_LINK_ACK_SYNC) {
+        return; // not ours: line noise or text from the controller
+    }
+    ack_buf[ack_len++] = byte;
+    if (ack_len < INPUT_LINK_ACK_BYTES) {
+        return;
+    }
+    ack_len = 0;
+    uint16_t crc = 0xFFFFu;
+    crc = input_link_crc(crc, ack_buf[1]);
+    crc = input_link_crc(crc, ack_buf[2]);
+    // A damaged ack is left to the timeout: the repeat gets acked again.
+    bool ok = ack_buf[3] == (uint8_t)crc && ack_buf[4] == (uint8_t)(crc >> 8);
+    if (ok && in_flight && ack_buf[1] == tx_seq) {
+        in_flight = false;
+        key_credits = ack_buf[2];
+    }
+}
+
+void input_uart_init(uart_inst_t *uart, uint pin_tx, uint pin_rx) {
+    input_uart = uart;
+    uart_init(uart, INPUT_UART_BAUD);
+    uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(uart, true);
+    gpio_set_function(pin_tx, GPIO_FUNC_UART);
+    gpio_set_function(pin_rx, GPIO_FUNC_UART);
+
+    tx_dma_chan = dma_claim_unused_channel(true);
+    tx_dma_cfg = dma_channel_get_default_config((uint)tx_dma_chan);
+    channel_config_set_transfer_data_size(&tx_dma_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&tx_dma_cfg, true);
+    channel_config_set_write_increment(&tx_dma_cfg, false);
+    channel_config_set_dreq(&tx_dma_cfg, uart_get_dreq(uart, true));
+}
+
+void input_uart_feed(const uint8_t *data, uint32_t len) {
+    input_event_reader_feed(&reader, data, len, handle_record);
+}
+
+bool input_uart_service(uint32_t now_us) {
+    if (tx_dma_chan < 0) {
+        return false;
+    }
+    while (uart_is_readable(input_uart)) {
+        take_ack_byte((uint8_t)uart_getc(input_uart));
+    }
+    if (dma_channel_is_busy((uint)tx_dma_chan)) {
+        return false;
+    }
+    if (in_flight) {
+        if ((uint32_t)(now_us - tx_sent_us) < INPUT_LINK_ACK_TIMEOUT_US) {
+            return false;
+        }
+    } else if (!build_frame((uint32_t)(now_us - tx_sent_us) >= INPUT_LINK_CREDIT_POLL_US)) {
+        return false;
+    }
+    dma_channel_configure((uint)tx_dma_chan, &tx_dma_cfg,
+                          &uart_get_hw(input_uart)->dr,
+                          tx_frame,
+                          tx_len,
+                          true);
+    in_flight = true;
+    tx_sent_us = now_us;
+    counters.sent++;
+    return true;
+}
+
+void input_uart_get_counters(input_counters_t *out) {
+    *out = counters;
+}
+
+void input_uart_reset_counters(void) {
+    memset(&counters, 0, sizeof(counters));
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/uart.h"
+
+#include "input_events.h"
+
+// Keyboard/mouse input from the host, forwarded to the external ADB controller
+// (ATmega328p, Arduino/) on UART1. core0 queues the vendor bulk OUT records
+// (input_events.h), summing mouse motion into the pending record, and sends
+// them in batches as link frames with DMA. One frame is in flight at a time:
+// the controller acknowledges it once every event in it has been taken, and
+// the acknowledgement carries how many more keys it has room for.
+//
+// Frame, host -> controller (Arduino/include/link.h):
+//   A5 len seq payload[len] crc_lo crc_hi
+// len is a multiple of INPUT_EVENT_BYTES, at most INPUT_LINK_EVENTS_MAX
+// records; an empty frame only asks for an ack with the current credits. seq counts 1..255 and wraps back to 1; 0 marks the first frame
+// after a reset. The controller takes a frame with the seq it took last for a
+// repeat (seq 0 included, so a resent first frame is not applied twice).
+// Ack, controller -> host:
+//   5A seq credits crc_lo crc_hi
+// credits is the number of free slots in the controller's key queue.
+// The CRC is CRC-16/CCITT as avr-libc's _crc_ccitt_update() computes it
+// (reflected 0x8408, initial 0xFFFF) over everything between sync and CRC.
+
+#define INPUT_UART_BAUD 1000000u // Serial.begin() in Arduino/src/main.cpp; exact on both ends
+#define INPUT_LINK_SYNC 0xA5u
+#define INPUT_LINK_ACK_SYNC 0x5Au
+#define INPUT_LINK_EVENTS_MAX 8u
+#define INPUT_LINK_FRAME_MAX (3u + INPUT_LINK_EVENTS_MAX * INPUT_EVENT_BYTES + 2u)
+#define INPUT_LINK_ACK_BYTES 5u
+// Key credits assumed until the first ack; the controller queues 32.
+#define INPUT_LINK_CREDITS_INIT 8u
+// How often an empty frame asks for credits while a key waits for room (the
+// Mac takes two keys per Talk R0, every ~11 ms).
+#define INPUT_LINK_CREDIT_POLL_US 1000u
+// A frame not acknowledged by then is sent again. The controller holds a
+// frame (and its ack) while a click waits for earlier motion to be polled
+// out, so this also paces repeats while the Mac catches up.
+#ifndef INPUT_LINK_ACK_TIMEOUT_US
+#define INPUT_LINK_ACK_TIMEOUT_US 5000u
+#endif
+
+static inline uint16_t input_link_crc(uint16_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 1u) ? (uint16_t)((crc >> 1) ^ 0x8408u) : (uint16_t)(crc >> 1);
+    }
+    return crc;
+}
+
+// core0: configure the UART pins and claim the TX DMA channel.
+void input_uart_init(uart_inst_t *uart, uint pin_tx, uint pin_rx);
+// core0: feed bytes read from the OUT endpoint; records may span calls.
+void input_uart_feed(const uint8_t *data, uint32_t len);
+// core0: take acks from the controller, then send the next frame (or resend
+// the one in flight after INPUT_LINK_ACK_TIMEOUT_US) if the DMA is idle.
+// Returns true when a frame was started.
+bool input_uart_service(uint32_t now_us);
+
+// sent counts frames handed to the UART DMA, repeats included.
+void input_uart_get_counters(input_counters_t *out);
+void input_uart_reset_counters(void);
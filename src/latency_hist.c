@@ -0,0 +1,55 @@
+#include "latency_hist.h"
+
+#include <string.h>
+
+#include "hardware/clocks.h"
+
+#define SYSTICK_CSR_ENABLE_PROCCLK 0x5u // ENABLE | CLKSOURCE=processor, no IRQ
+#define SYSTICK_RELOAD_MAX 0x00FFFFFFu
+
+static lat_hist_stage_t hist[LAT_STAGE_COUNT];
+
+static struct {
+    lat_hist_header_t header;
+    lat_hist_stage_t stages[LAT_STAGE_COUNT];
+} hist_snapshot;
+
+void latency_hist_core_init(void) {
+    systick_hw->csr = 0;
+    systick_hw->rvr = SYSTICK_RELOAD_MAX;
+    systick_hw->cvr = 0;
+    systick_hw->csr = SYSTICK_CSR_ENABLE_PROCCLK;
+}
+
+void latency_hist_add(lat_stage_t stage, uint32_t cycles) {
+    // Each stage has a single writer (one core, or the VSYNC IRQ), so plain
+    // increments are enough.
+    lat_hist_stage_t *h = &hist[stage];
+    uint32_t bucket = cycles ? (uint32_t)(32 - __builtin_clz(cycles)) : 0u;
+    if (bucket >= LAT_HIST_BUCKETS) {
+        bucket = LAT_HIST_BUCKETS - 1;
+    }
+    h->counts[bucket]++;
+    if (cycles > h->max_cycles) {
+        h->max_cycles = cycles;
+    }
+}
+
+void latency_hist_add_us(lat_stage_t stage, uint32_t us) {
+    uint64_t cycles = (uint64_t)us * (clock_get_hz(clk_sys) / 1000000u);
+    latency_hist_add(stage, cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles);
+}
+
+const void *latency_hist_snapshot(bool reset, uint16_t *out_len) {
+    hist_snapshot.header.version = LAT_HIST_VERSION;
+    hist_snapshot.header.stage_count = LAT_STAGE_COUNT;
+    hist_snapshot.header.bucket_count = LAT_HIST_BUCKETS;
+    hist_snapshot.header.reserved = 0;
+    hist_snapshot.header.clk_sys_hz = clock_get_hz(clk_sys);
+    memcpy(hist_snapshot.stages, hist, sizeof(hist));
+    if (reset) {
+        memset(hist, 0, sizeof(hist));
+    }
+    *out_len = (uint16_t)sizeof(hist_snapshot);
+    return &hist_snapshot;
+}
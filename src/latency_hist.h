@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cycle-accurate per-stage latency histograms (EBD_IPKVM_LATENCY_HIST build
+// option). Each stage is timed with the local core's SysTick counter and
+// binned by log2(cycles). SysTick wraps after 2^24 cycles (134 ms at 125 MHz),
+// so stages longer than LAT_HIST_SYSTICK_MAX_US are timed with the
+// microsecond timer instead and land in the top bucket. With the option off
+// every call compiles away.
+typedef enum {
+    LAT_STAGE_VSYNC_IRQ = 0,        // core1 IRQ: VSYNC handler
+    LAT_STAGE_FINALIZE = 1,         // core1: video_capture_finalize_frame
+    LAT_STAGE_POSTPROCESS_WAIT = 2, // core1: bswap DMA armed -> done
+    LAT_STAGE_LINE_ENCODE = 3,      // core1: RLE encode of one line
+    LAT_STAGE_ENQUEUE = 4,          // core1: one TX queue packet write
+    LAT_STAGE_SERVICE_TXQ = 5,      // core0: service_txq
+    LAT_STAGE_TUD_TASK = 6,         // core0: tud_task
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+#define LAT_HIST_BUCKETS 25 // SysTick is 24-bit
+#define LAT_HIST_VERSION 1
+// Below SysTick's wrap at any clk_sys up to 500 MHz.
+#define LAT_HIST_SYSTICK_MAX_US 32000u
+
+typedef struct lat_hist_header {
+    uint16_t version;
+    uint16_t stage_count;
+    uint16_t bucket_count;
+    uint16_t reserved;
+    uint32_t clk_sys_hz;
+} lat_hist_header_t;
+
+// Per stage: bucket b counts samples with 2^(b-1) <= cycles < 2^b (b = 0: zero).
+typedef struct lat_hist_stage {
+    uint32_t max_cycles;
+    uint32_t counts[LAT_HIST_BUCKETS];
+} lat_hist_stage_t;
+
+#if EBD_IPKVM_LATENCY_HIST
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+
+typedef struct lat_stamp {
+    uint32_t cvr; // SysTick, counting down
+    uint32_t us;  // time_us_32, for stages that outlast a SysTick wrap
+} lat_stamp_t;
+
+// Call once on each core before recording; SysTick is per-core.
+void latency_hist_core_init(void);
+void latency_hist_add(lat_stage_t stage, uint32_t cycles);
+// Records us converted to clk_sys cycles (saturating).
+void latency_hist_add_us(lat_stage_t stage, uint32_t us);
+// Copies the histograms into an internal snapshot and returns it; reset clears
+// the live counters afterwards. Counts from the other core that land during the
+// reset may be lost.
+const void *latency_hist_snapshot(bool reset, uint16_t *out_len);
+
+static inline lat_stamp_t latency_hist_stamp(void) {
+    lat_stamp_t stamp = {systick_hw->cvr, time_us_32()};
+    return stamp;
+}
+
+static inline void latency_hist_record(lat_stage_t stage, lat_stamp_t start) {
+    uint32_t cycles = (start.cvr - systick_hw->cvr) & 0x00FFFFFFu; // 24-bit down counter
+    uint32_t us = time_us_32() - start.us;
+    if (us >= LAT_HIST_SYSTICK_MAX_US) {
+        latency_hist_add_us(stage, us); // SysTick may have wrapped
+        return;
+    }
+    latency_hist_add(stage, cycles);
+}
+
+#else
+
+typedef struct lat_stamp {
+    uint8_t unused;
+} lat_stamp_t;
+
+static inline void latency_hist_core_init(void) {}
+static inline lat_stamp_t latency_hist_stamp(void) {
+    lat_stamp_t stamp = {0};
+    return stamp;
+}
+static inline void latency_hist_record(lat_stage_t stage, lat_stamp_t start) {
+    (void)stage;
+    (void)start;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "line_monitor.h"
+
+#include "pico/stdlib.h"
+
+#include "frame_trace.h"
+#include "line_monitor.pio.h"
+#include "pio_fdebug.h"
+
+static PIO mon_pio = NULL;
+static uint mon_sm = 0;
+
+static volatile uint32_t lines_out_of_spec = 0;
+static volatile uint32_t frames_out_of_spec = 0;
+static volatile uint32_t capture_rx_stalls = 0;
+static volatile uint32_t monitor_rx_stalls = 0;
+static volatile uint16_t last_frame_lines = 0;
+static volatile int16_t last_pixclk_delta = 0;
+static uint32_t frame_base = 0;
+
+static inline uint32_t load_u32(const volatile uint32_t *value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_u32(volatile uint32_t *value, uint32_t data) {
+    __atomic_store_n(value, data, __ATOMIC_RELEASE);
+}
+
+void line_monitor_init(PIO pio, uint sm, uint offset, uint pin_hsync, uint32_t expected_pixclk) {
+    mon_pio = pio;
+    mon_sm = sm;
+
+    pio_sm_set_enabled(pio, sm, false);
+    line_monitor_program_init(pio, sm, offset, pin_hsync);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_put(pio, sm, expected_pixclk);
+    pio_fdebug_clear(pio, 1u << (PIO_FDEBUG_RXSTALL_LSB + sm));
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+void line_monitor_poll(void) {
+    if (mon_pio == NULL) {
+        return;
+    }
+
+    uint32_t stall_mask = 1u << (PIO_FDEBUG_RXSTALL_LSB + mon_sm);
+    if (pio_fdebug_test(mon_pio, stall_mask)) {
+        pio_fdebug_clear(mon_pio, stall_mask);
+        __atomic_fetch_add(&monitor_rx_stalls, 1u, __ATOMIC_RELAXED);
+    }
+
+    while (!pio_sm_is_rx_fifo_empty(mon_pio, mon_sm)) {
+        // The SM pushes expected - counted; a good line never reaches the FIFO.
+        int32_t delta = -(int32_t)pio_sm_get(mon_pio, mon_sm);
+        if (delta > INT16_MAX) {
+            delta = INT16_MAX;
+        } else if (delta < INT16_MIN) {
+            delta = INT16_MIN;
+        }
+        __atomic_store_n(&last_pixclk_delta, (int16_t)delta, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&lines_out_of_spec, 1u, __ATOMIC_RELAXED);
+    }
+}
+
+void line_monitor_begin_frame(void) {
+    frame_base = load_u32(&lines_out_of_spec);
+}
+
+bool line_monitor_end_frame(uint16_t frame_id, bool capture_rx_stall) {
+    line_monitor_poll();
+
+    uint32_t bad = load_u32(&lines_out_of_spec) - frame_base;
+    if (bad > UINT16_MAX) {
+        bad = UINT16_MAX;
+    }
+    __atomic_store_n(&last_frame_lines, (uint16_t)bad, __ATOMIC_RELEASE);
+    if (capture_rx_stall) {
+        __atomic_fetch_add(&capture_rx_stalls, 1u, __ATOMIC_RELAXED);
+    }
+    if (bad == 0 && !capture_rx_stall) {
+        return false;
+    }
+
+    __atomic_fetch_add(&frames_out_of_spec, 1u, __ATOMIC_RELAXED);
+    frame_trace_record(FRAME_TRACE_OUT_OF_SPEC, frame_id,
+                       bad | (capture_rx_stall ? FRAME_TRACE_OOS_RX_STALL : 0u));
+    return true;
+}
+
+void line_monitor_reset(void) {
+    store_u32(&lines_out_of_spec, 0);
+    store_u32(&frames_out_of_spec, 0);
+    store_u32(&capture_rx_stalls, 0);
+    store_u32(&monitor_rx_stalls, 0);
+    __atomic_store_n(&last_frame_lines, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&last_pixclk_delta, 0, __ATOMIC_RELEASE);
+    frame_base = 0;
+}
+
+void line_monitor_get_counters(line_monitor_counters_t *out) {
+    out->lines_out_of_spec = load_u32(&lines_out_of_spec);
+    out->frames_out_of_spec = load_u32(&frames_out_of_spec);
+    out->capture_rx_stalls = load_u32(&capture_rx_stalls);
+    out->monitor_rx_stalls = load_u32(&monitor_rx_stalls);
+    out->last_frame_lines = __atomic_load_n(&last_frame_lines, __ATOMIC_ACQUIRE);
+    out->last_pixclk_delta = __atomic_load_n(&last_pixclk_delta, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+// Capture signal integrity counters. A second PIO state machine (line_monitor.pio)
+// counts PIXCLK cycles per HSYNC period for as long as it runs and reports only
+// the lines that differ from the expected count; core1 drains those reports and
+// folds them, together with the capture SM's RX stall flag, into per-frame
+// results. All totals are since boot or the last RESET_COUNTERS.
+typedef struct line_monitor_counters {
+    uint32_t lines_out_of_spec;  // HSYNC periods with an unexpected PIXCLK count
+    uint32_t frames_out_of_spec; // captured frames with a bad line or an RX stall
+    uint32_t capture_rx_stalls;  // captured frames that overflowed the capture RX FIFO
+    uint32_t monitor_rx_stalls;  // monitor reports lost to a full monitor FIFO
+    uint16_t last_frame_lines;   // bad lines seen during the most recent captured frame
+    int16_t last_pixclk_delta;   // counted - expected PIXCLKs for the latest bad line
+} line_monitor_counters_t;
+
+// Load the expected count into the monitor SM and start it.
+void line_monitor_init(PIO pio, uint sm, uint offset, uint pin_hsync, uint32_t expected_pixclk);
+
+// core1: drain pending reports from the monitor FIFO.
+void line_monitor_poll(void);
+// core1: bracket one capture. begin is called from the VSYNC IRQ.
+void line_monitor_begin_frame(void);
+// Returns true when the frame just captured was out of spec.
+bool line_monitor_end_frame(uint16_t frame_id, bool capture_rx_stall);
+void line_monitor_reset(void);
+
+void line_monitor_get_counters(line_monitor_counters_t *out);
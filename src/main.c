@@ -5,15 +5,26 @@
 #include "hardware/irq.h"
 #include "hardware/pio.h"
 
+#include "adb_device.h"
 #include "app_core.h"
+#if EBD_IPKVM_ADB
+#include "adb_device.pio.h"
+#endif
 #include "classic_line.pio.h"
+#include "line_monitor.pio.h"
+#include "signal_counter.h"
+#include "signal_counter.pio.h"
+#include "uvc_stream.h"
 #include "video_core.h"
 
 #define PIN_PIXCLK 0
 #define PIN_VSYNC  1   // active-low
 #define PIN_HSYNC  2   // active-low
 #define PIN_VIDEO  3
+#define PIN_ADB_DATA 6 // ADB data, open drain via a 5V level shifter (EBD_IPKVM_ADB)
 #define PIN_PS_ON  9   // via ULN2803, GPIO high asserts ATX PS_ON
+#define PIN_ADB_TX 20  // UART1 TX to the ADB controller
+#define PIN_ADB_RX 21  // UART1 RX from the ADB controller (via divider)
 
 int main(void) {
     stdio_init_all();
@@ -56,6 +67,7 @@ int main(void) {
 
     PIO pio = pio0;
     uint sm = 0;
+    pio_sm_claim(pio, sm);
 
     pio_sm_set_consecutive_pindirs(pio, sm, PIN_PIXCLK, 1, false);
     pio_sm_set_consecutive_pindirs(pio, sm, PIN_HSYNC,  1, false);
@@ -63,8 +75,37 @@ int main(void) {
 
     uint offset_fall_pixrise = pio_add_program(pio, &classic_line_fall_pixrise_program);
 
+    // PIO0 instruction memory is nearly full with the capture program, so the
+    // HSYNC/PIXCLK monitor lives on PIO1. PIO inputs read the pads regardless
+    // of the pin function, so the pins stay assigned to PIO0.
+    PIO mon_pio = pio1;
+    uint mon_sm = (uint)pio_claim_unused_sm(mon_pio, true);
+    uint offset_line_monitor = pio_add_program(mon_pio, &line_monitor_program);
+
+    // One edge/high-time counter SM per input. VSYNC runs on PIO0 (its four
+    // instructions fill PIO0 exactly); the rest share PIO1 with the monitor.
+    uint offset_counter_pio0 = pio_add_program(pio, &signal_counter_program);
+    uint offset_counter_pio1 = pio_add_program(mon_pio, &signal_counter_program);
+    signal_counter_add(SIGNAL_VSYNC, pio, (uint)pio_claim_unused_sm(pio, true),
+                       offset_counter_pio0, PIN_VSYNC);
+#if EBD_IPKVM_ADB
+    // The ADB device takes the PIXCLK counter's SM and the remaining 12
+    // instruction slots of PIO1. The line monitor still checks PIXCLK per
+    // line; only the PIXCLK rate/duty readout goes to 0.
+    uint offset_adb = pio_add_program(mon_pio, &adb_device_program);
+    uint adb_sm = (uint)pio_claim_unused_sm(mon_pio, true);
+#else
+    signal_counter_add(SIGNAL_PIXCLK, mon_pio, (uint)pio_claim_unused_sm(mon_pio, true),
+                       offset_counter_pio1, PIN_PIXCLK);
+#endif
+    signal_counter_add(SIGNAL_HSYNC, mon_pio, (uint)pio_claim_unused_sm(mon_pio, true),
+                       offset_counter_pio1, PIN_HSYNC);
+    signal_counter_add(SIGNAL_VIDEO, mon_pio, (uint)pio_claim_unused_sm(mon_pio, true),
+                       offset_counter_pio1, PIN_VIDEO);
+
     int dma_chan = dma_claim_unused_channel(true);
     int post_dma_chan = dma_claim_unused_channel(true);
+    int crc_dma_chan = dma_claim_unused_channel(true);
     // Cortex-M0+ uses only bits [7:6] of the priority byte.
     // 0x00 = highest, 0x40, 0x80, 0xC0 = lowest.
     irq_set_priority(USBCTRL_IRQ, 0x00);
@@ -74,11 +115,19 @@ int main(void) {
         .sm = sm,
         .dma_chan = dma_chan,
         .post_dma_chan = post_dma_chan,
+        .crc_dma_chan = crc_dma_chan,
         .offset_fall_pixrise = offset_fall_pixrise,
         .pin_video = PIN_VIDEO,
         .pin_vsync = PIN_VSYNC,
+        .mon_pio = mon_pio,
+        .mon_sm = mon_sm,
+        .offset_line_monitor = offset_line_monitor,
+        .pin_hsync = PIN_HSYNC,
     };
     video_core_init(&video_cfg);
+#if EBD_IPKVM_UVC
+    uvc_stream_init();
+#endif
     video_core_launch();
 
     app_core_config_t app_cfg = {
@@ -87,8 +136,13 @@ int main(void) {
         .pin_hsync = PIN_HSYNC,
         .pin_video = PIN_VIDEO,
         .pin_ps_on = PIN_PS_ON,
+        .pin_input_tx = PIN_ADB_TX,
+        .pin_input_rx = PIN_ADB_RX,
     };
     app_core_init(&app_cfg);
+#if EBD_IPKVM_ADB
+    adb_device_init(mon_pio, adb_sm, offset_adb, PIN_ADB_DATA);
+#endif
 
     while (true) {
         app_core_poll();
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+// FDEBUG flags are sticky and write-1-to-clear. The host simulator (host/)
+// cannot model that with a plain struct field, so it supplies these two.
+#if EBD_IPKVM_SIM
+bool pio_fdebug_test(PIO pio, uint32_t mask);
+void pio_fdebug_clear(PIO pio, uint32_t mask);
+#else
+static inline bool pio_fdebug_test(PIO pio, uint32_t mask) {
+    return (pio->fdebug & mask) != 0;
+}
+
+static inline void pio_fdebug_clear(PIO pio, uint32_t mask) {
+    pio->fdebug = mask;
+}
+#endif
@@ -0,0 +1,98 @@
+#include "signal_counter.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+
+#include "signal_counter.pio.h"
+
+typedef struct signal_channel {
+    PIO pio;
+    uint sm;
+    uint pin;
+    uint32_t last_x;
+    uint32_t last_y;
+    signal_rate_t rate;
+} signal_channel_t;
+
+static signal_channel_t channels[SIGNAL_COUNT];
+static uint32_t window_start_us = 0;
+
+static const char *const signal_names[SIGNAL_COUNT] = {
+    [SIGNAL_PIXCLK] = "pixclk",
+    [SIGNAL_VSYNC] = "vsync",
+    [SIGNAL_HSYNC] = "hsync",
+    [SIGNAL_VIDEO] = "video",
+};
+
+// Copy a scratch register out through the RX FIFO. The program never uses
+// the ISR and never blocks, so injecting here only costs it two cycles.
+static uint32_t read_reg(const signal_channel_t *ch, enum pio_src_dest reg) {
+    pio_sm_exec(ch->pio, ch->sm, pio_encode_mov(pio_isr, reg));
+    pio_sm_exec(ch->pio, ch->sm, pio_encode_push(false, false));
+    return pio_sm_get_blocking(ch->pio, ch->sm);
+}
+
+void signal_counter_add(signal_id_t id, PIO pio, uint sm, uint offset, uint pin) {
+    if ((unsigned)id >= SIGNAL_COUNT) {
+        return;
+    }
+    signal_channel_t *ch = &channels[id];
+    ch->pio = pio;
+    ch->sm = sm;
+    ch->pin = pin;
+    ch->last_x = 0;
+    ch->last_y = 0;
+    ch->rate = (signal_rate_t){0};
+
+    pio_sm_set_enabled(pio, sm, false);
+    signal_counter_program_init(pio, sm, offset, pin);
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_x, pio_null));
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_y, pio_null));
+    pio_sm_set_enabled(pio, sm, true);
+    window_start_us = time_us_32();
+}
+
+void signal_counter_sample(void) {
+    uint32_t now = time_us_32();
+    uint32_t window_us = (uint32_t)(now - window_start_us);
+    window_start_us = now;
+    if (window_us == 0) {
+        return;
+    }
+    uint64_t window_cycles = (uint64_t)window_us * (clock_get_hz(clk_sys) / 1000000u);
+
+    for (uint i = 0; i < SIGNAL_COUNT; i++) {
+        signal_channel_t *ch = &channels[i];
+        if (ch->pio == NULL) {
+            continue;
+        }
+        // Both registers count down from 0, so elapsed counts are last - now.
+        uint32_t y = read_reg(ch, pio_y);
+        uint32_t x = read_reg(ch, pio_x);
+        uint32_t edges = ch->last_y - y;
+        uint32_t high_iters = ch->last_x - x;
+        ch->last_y = y;
+        ch->last_x = x;
+
+        uint64_t high_cycles = (uint64_t)high_iters * 2u + edges;
+        if (high_cycles > window_cycles) {
+            high_cycles = window_cycles;
+        }
+        ch->rate.hz = (uint32_t)(((uint64_t)edges * 1000000u + window_us / 2u) / window_us);
+        ch->rate.duty_bp = window_cycles ? (uint16_t)((high_cycles * 10000u) / window_cycles) : 0;
+        ch->rate.level = gpio_get(ch->pin);
+    }
+}
+
+void signal_counter_get(signal_id_t id, signal_rate_t *out) {
+    if ((unsigned)id >= SIGNAL_COUNT) {
+        *out = (signal_rate_t){0};
+        return;
+    }
+    *out = channels[id].rate;
+}
+
+const char *signal_counter_name(signal_id_t id) {
+    return ((unsigned)id < SIGNAL_COUNT) ? signal_names[id] : "?";
+}
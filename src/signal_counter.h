@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/pio.h"
+
+// Continuous frequency / duty cycle counters for the capture inputs. Each
+// signal gets its own PIO state machine (signal_counter.pio) that counts
+// rising edges and high time without ever stalling, so the counters run
+// alongside capture. core0 samples them once per status tick.
+typedef enum {
+    SIGNAL_PIXCLK = 0,
+    SIGNAL_VSYNC = 1,
+    SIGNAL_HSYNC = 2,
+    SIGNAL_VIDEO = 3,
+    SIGNAL_COUNT
+} signal_id_t;
+
+_Static_assert(SIGNAL_COUNT == 4, "usb_ctrl_stats_t carries four signal slots");
+
+typedef struct signal_rate {
+    uint32_t hz;      // rising edges per second over the last window
+    uint16_t duty_bp; // high time in 0.01 % units (0..10000)
+    bool level;       // pin level when sampled
+} signal_rate_t;
+
+void signal_counter_add(signal_id_t id, PIO pio, uint sm, uint offset, uint pin);
+
+// core0: close the current window and compute rates. Call about once a second.
+void signal_counter_sample(void);
+void signal_counter_get(signal_id_t id, signal_rate_t *out);
+const char *signal_counter_name(signal_id_t id);
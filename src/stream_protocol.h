@@ -9,6 +9,15 @@
 #define STREAM_FLAG_RLE 0x8000u
 #define STREAM_LEN_MASK 0x7FFFu
 
+// Out-of-band packets reuse the line header with a line_id past the frame
+// height, which older hosts already discard.
+// Frame end: trails the last line of every vendor-stream frame.
+#define STREAM_LINE_FRAME_END 0xFFF0u
+#define STREAM_FRAME_END_BYTES 16
+// Telemetry: frame_id is a packet sequence number and the payload is a
+// usb_ctrl_stats_t snapshot (usb_control.h).
+#define STREAM_LINE_TELEMETRY 0xFFF1u
+
 typedef struct __attribute__((packed)) stream_packet_header {
     uint8_t magic[2];
     uint16_t frame_id_le;
@@ -29,3 +38,20 @@ static inline void stream_write_header(uint8_t *dst,
     dst[6] = (uint8_t)(length_flags & 0xFFu);
     dst[7] = (uint8_t)((length_flags >> 8) & 0xFFu);
 }
+
+// Frame end payload for frame_id: device time_us_32() at the VSYNC that
+// started the capture and at the first and last line enqueue, then the CRC-32
+// (zlib/IEEE) of the raw 64-byte lines sent, in line order (all LE u32).
+static inline void stream_write_frame_end(uint8_t *dst,
+                                          uint32_t vsync_us,
+                                          uint32_t first_line_us,
+                                          uint32_t last_line_us,
+                                          uint32_t crc32) {
+    const uint32_t v[4] = {vsync_us, first_line_us, last_line_us, crc32};
+    for (int i = 0; i < 4; i++) {
+        dst[i * 4 + 0] = (uint8_t)(v[i] & 0xFFu);
+        dst[i * 4 + 1] = (uint8_t)((v[i] >> 8) & 0xFFu);
+        dst[i * 4 + 2] = (uint8_t)((v[i] >> 16) & 0xFFu);
+        dst[i * 4 + 3] = (uint8_t)((v[i] >> 24) & 0xFFu);
+    }
+}
@@ -40,4 +40,15 @@
 #define CFG_TUD_VENDOR_TX_BUFSIZE  (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+#ifndef EBD_IPKVM_UVC
+#define EBD_IPKVM_UVC 0
+#endif
+
+#if EBD_IPKVM_UVC
+#define CFG_TUD_VIDEO                       (1)
+#define CFG_TUD_VIDEO_STREAMING             (1)
+#define CFG_TUD_VIDEO_STREAMING_BULK        (1)
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  (64)
+#endif
+
 #endif
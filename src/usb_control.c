@@ -1,27 +1,151 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
 #include "tusb.h"
 
 #include "app_core.h"
+#include "bench_frames.h"
+#include "frame_trace.h"
+#include "latency_hist.h"
 #include "usb_control.h"
 
+static usb_ctrl_cmd_t ep0_pending;
+static usb_ctrl_stats_t ep0_stats;
+static uint8_t ep0_time[8];
+
+static bool handle_in_request(uint8_t rhport, tusb_control_request_t const *request) {
+    if (request->bRequest != USB_CTRL_REQ_GET_TRACE) {
+        frame_trace_thaw(); // the host gave up on a trace dump, if one was running
+    }
+    switch (request->bRequest) {
+    case USB_CTRL_REQ_GET_STATS: {
+        app_core_fill_stats(&ep0_stats);
+        uint16_t len = sizeof(ep0_stats);
+        if (len > request->wLength) {
+            len = request->wLength;
+        }
+        return tud_control_xfer(rhport, request, &ep0_stats, len);
+    }
+    case USB_CTRL_REQ_GET_TIME: {
+        // Sampled in the SETUP callback so the host can bracket it with its
+        // own clock; the low 32 bits match the stream timestamps.
+        uint64_t now = time_us_64();
+        for (int i = 0; i < 8; i++) {
+            ep0_time[i] = (uint8_t)(now >> (8 * i));
+        }
+        uint16_t len = sizeof(ep0_time);
+        if (len > request->wLength) {
+            len = request->wLength;
+        }
+        return tud_control_xfer(rhport, request, ep0_time, len);
+    }
+    case USB_CTRL_REQ_GET_TRACE: {
+        // Held frozen until the status stage so the ring is not rewritten
+        // while EP0 is still sending it.
+        frame_trace_freeze();
+        uint16_t len = 0;
+        const void *dump = frame_trace_dump(&len);
+        if (len > request->wLength) {
+            len = request->wLength;
+        }
+        return tud_control_xfer(rhport, request, (void *)dump, len);
+    }
+#if EBD_IPKVM_LATENCY_HIST
+    case USB_CTRL_REQ_GET_LATENCY_HIST: {
+        uint16_t len = 0;
+        const void *snap = latency_hist_snapshot((request->wValue & 1u) != 0, &len);
+        if (len > request->wLength) {
+            len = request->wLength;
+        }
+        return tud_control_xfer(rhport, request, (void *)snap, len);
+    }
+#endif
+#if EBD_IPKVM_BENCH
+    case USB_CTRL_REQ_GET_BENCH: {
+        const bench_report_t *rep = bench_frames_snapshot();
+        uint16_t len = sizeof(*rep);
+        if (len > request->wLength) {
+            len = request->wLength;
+        }
+        return tud_control_xfer(rhport, request, (void *)rep, len);
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+#if EBD_IPKVM_BENCH
+// Screen uploads bypass the command queue: the data stage lands straight in
+// the benchmark screen buffer.
+static bool handle_bench_upload(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request) {
+    if (stage == CONTROL_STAGE_SETUP) {
+        uint8_t *dst = bench_frames_upload_target(request->wValue, request->wLength);
+        if (dst == NULL) {
+            return false;
+        }
+        return tud_control_xfer(rhport, request, dst, request->wLength);
+    }
+    if (stage == CONTROL_STAGE_DATA) {
+        bench_frames_upload_done(request->wValue, request->wLength);
+    }
+    return true;
+}
+#endif
+
+// Bus reset or unplug: a trace dump in progress will never see its status stage.
+void tud_umount_cb(void) {
+    frame_trace_thaw();
+}
+
 bool tud_vendor_control_xfer_cb(uint8_t rhport,
                                 uint8_t stage,
                                 tusb_control_request_t const *request) {
-    if (stage != CONTROL_STAGE_SETUP) {
-        return true;
-    }
     if (request->bmRequestType_bit.type != TUSB_REQ_TYPE_VENDOR) {
         return false;
     }
-    if (request->bmRequestType_bit.direction != TUSB_DIR_OUT) {
-        return false;
+
+    if (request->bmRequestType_bit.direction == TUSB_DIR_IN) {
+        if (stage != CONTROL_STAGE_SETUP) {
+            if (stage == CONTROL_STAGE_ACK && request->bRequest == USB_CTRL_REQ_GET_TRACE) {
+                frame_trace_thaw();
+            }
+            return true;
+        }
+        return handle_in_request(rhport, request);
     }
-    if (request->wLength != 0) {
-        return false;
+    // An OUT request also ends a trace dump the host abandoned.
+    frame_trace_thaw();
+
+#if EBD_IPKVM_BENCH
+    if (request->bRequest == USB_CTRL_REQ_BENCH_UPLOAD) {
+        return handle_bench_upload(rhport, stage, request);
     }
+#endif
 
-    if (!app_core_enqueue_ep0_command(request->bRequest)) {
-        return false;
+    if (stage == CONTROL_STAGE_SETUP) {
+        if (request->wLength > USB_CTRL_CMD_DATA_MAX) {
+            return false;
+        }
+        memset(&ep0_pending, 0, sizeof(ep0_pending));
+        ep0_pending.request = request->bRequest;
+        ep0_pending.value = request->wValue;
+        ep0_pending.index = request->wIndex;
+        ep0_pending.data_len = (uint8_t)request->wLength;
+
+        if (request->wLength != 0) {
+            // Queue once the data stage has landed in ep0_pending.data.
+            return tud_control_xfer(rhport, request, ep0_pending.data, request->wLength);
+        }
+        if (!app_core_enqueue_ep0_command(&ep0_pending)) {
+            return false;
+        }
+        return tud_control_status(rhport, request);
+    }
+
+    if (stage == CONTROL_STAGE_DATA) {
+        return app_core_enqueue_ep0_command(&ep0_pending);
     }
 
-    return tud_control_status(rhport, request);
+    return true;
 }
@@ -14,4 +14,112 @@ enum usb_ctrl_request {
     USB_CTRL_REQ_PS_OFF = 0x09,
     USB_CTRL_REQ_BOOTSEL = 0x0A,
     USB_CTRL_REQ_REBOOT = 0x0B,
+
+    // Parameterised OUT requests (wValue/wIndex/data stage carry the setting).
+    USB_CTRL_REQ_SET_CAPTURE_MODE = 0x10,  // wValue = capture_mode_t
+    USB_CTRL_REQ_SET_FRAME_DIVISOR = 0x11, // wValue = take every Nth VSYNC (1..255)
+    USB_CTRL_REQ_SET_CODEC = 0x12,         // wValue = usb_ctrl_codec
+    USB_CTRL_REQ_SET_ROI = 0x13,           // data stage = usb_ctrl_roi_t
+    USB_CTRL_REQ_SET_VSYNC_EDGE = 0x14,    // wValue = 1 falling, 0 rising
+    USB_CTRL_REQ_SET_TELEMETRY = 0x15,     // wValue = bulk telemetry interval ms (0 = off)
+    // EBD_IPKVM_BENCH builds only (see bench_frames.h).
+    USB_CTRL_REQ_BENCH_UPLOAD = 0x16,      // wValue = first line, data = whole 64-byte lines
+    USB_CTRL_REQ_BENCH_START = 0x17,       // data stage = usb_ctrl_bench_start_t; stop with 0x02
+
+    // IN requests answered directly from the control callback.
+    USB_CTRL_REQ_GET_STATS = 0x80,         // returns usb_ctrl_stats_t
+    USB_CTRL_REQ_GET_TIME = 0x81,          // returns time_us_64() as LE u64
+    USB_CTRL_REQ_GET_TRACE = 0x82,         // returns frame_trace header + ring
+    USB_CTRL_REQ_GET_LATENCY_HIST = 0x83,  // wValue bit0 = reset after read
+    USB_CTRL_REQ_GET_BENCH = 0x84,         // returns bench_report_t
 };
+
+enum usb_ctrl_codec {
+    USB_CTRL_CODEC_RAW = 0,
+    USB_CTRL_CODEC_RLE = 1,
+};
+
+#define USB_CTRL_CMD_DATA_MAX 8
+
+// One queued EP0 OUT request, handed from the control callback to app_core.
+typedef struct usb_ctrl_cmd {
+    uint8_t request;
+    uint8_t data_len;
+    uint16_t value;
+    uint16_t index;
+    uint8_t data[USB_CTRL_CMD_DATA_MAX];
+} usb_ctrl_cmd_t;
+
+typedef struct __attribute__((packed)) usb_ctrl_roi {
+    uint16_t first_line_le;
+    uint16_t line_count_le;
+} usb_ctrl_roi_t;
+
+typedef struct __attribute__((packed)) usb_ctrl_bench_start {
+    uint8_t screen;           // bench_screen_t
+    uint8_t reserved;
+    uint16_t reserved2;
+    uint32_t period_us_le;    // 0 = BENCH_DEFAULT_PERIOD_US
+} usb_ctrl_bench_start_t;
+
+#define USB_CTRL_STATS_VERSION 5
+
+// Snapshot returned by USB_CTRL_REQ_GET_STATS and carried by the bulk
+// telemetry packet. All fields little-endian. Per-second rates are the values
+// from the most recent 1 s status tick.
+typedef struct __attribute__((packed)) usb_ctrl_stats {
+    uint16_t version;
+    uint16_t size;
+
+    uint8_t armed;
+    uint8_t capture_enabled;
+    uint8_t test_frame_active;
+    uint8_t ps_on;
+    uint8_t capture_mode;
+    uint8_t vsync_fall_edge;
+    uint8_t codec;
+    uint8_t frame_divisor;
+    uint16_t roi_first_line;
+    uint16_t roi_line_count;
+
+    uint32_t frames_done;
+    uint32_t lines_ok;
+    uint32_t lines_drop;
+    uint32_t frame_overrun;
+    uint32_t frame_short;
+    uint32_t usb_drops;
+    uint32_t vsync_total;
+
+    uint32_t lines_per_s;
+    uint32_t vsync_per_s;
+    uint8_t core0_pct;
+    uint8_t core1_pct;
+    uint16_t txq_r;
+    uint16_t txq_w;
+
+    // Version 2
+    uint32_t time_us;          // time_us_32() when the snapshot was taken
+    uint32_t tx_lines;         // line packets queued since reset
+    uint32_t tx_lines_rle;     // ... of which RLE encoded
+    uint32_t tx_payload_bytes; // line payload bytes queued (ratio vs tx_lines * 64)
+
+    // Version 3: capture signal integrity (see line_monitor.h)
+    uint32_t lines_out_of_spec;
+    uint32_t frames_out_of_spec;
+    uint32_t capture_rx_stalls;
+    uint32_t monitor_rx_stalls;
+    uint16_t last_frame_lines_oos;
+    int16_t last_pixclk_delta;
+
+    // Version 4: PIO signal counters over the last 1 s window, indexed by
+    // signal_id_t (pixclk, vsync, hsync, video).
+    uint32_t signal_hz[4];
+    uint16_t signal_duty_bp[4]; // high time, 0.01 % units
+
+    // Version 5: host input forwarded to the ADB controller (see input_uart.h).
+    uint32_t input_events;
+    uint32_t input_bad;
+    uint32_t input_coalesced;
+    uint32_t input_sent;
+    uint32_t input_dropped;
+} usb_ctrl_stats_t;
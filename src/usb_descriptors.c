@@ -1,6 +1,8 @@
 #include "pico/unique_id.h"
 #include "tusb.h"
 
+#include "uvc_stream.h"
+
 #ifndef USBD_VID
 #define USBD_VID (0x2E8A)
 #endif
@@ -21,7 +23,33 @@
 #define USBD_PRODUCT "EBD_IPKVM"
 #endif
 
-#define USBD_DESC_LEN (TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN + TUD_CDC_DESC_LEN)
+#if EBD_IPKVM_UVC
+#define UVC_CLOCK_FREQUENCY 27000000
+#define UVC_ENTITY_CAP_INPUT_TERMINAL 0x01
+#define UVC_ENTITY_CAP_OUTPUT_TERMINAL 0x02
+#define UVC_FRAME_INTERVAL (10000000 / UVC_FRAME_RATE)
+#define UVC_FRAME_BITRATE (UVC_FRAME_BYTES * 8 * UVC_FRAME_RATE)
+
+// 'Y800' (8-bit greyscale); Linux uvcvideo maps it to V4L2_PIX_FMT_GREY.
+#define UVC_GUID_Y800 TUD_VIDEO_GUID(0x59, 0x38, 0x30, 0x30, 0x00, 0x00, 0x10, 0x00, \
+                                     0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71)
+
+#define UVC_DESC_LEN (TUD_VIDEO_DESC_IAD_LEN \
+    + TUD_VIDEO_DESC_STD_VC_LEN \
+    + (TUD_VIDEO_DESC_CS_VC_LEN + 1) \
+    + TUD_VIDEO_DESC_CAMERA_TERM_LEN \
+    + TUD_VIDEO_DESC_OUTPUT_TERM_LEN \
+    + TUD_VIDEO_DESC_STD_VS_LEN \
+    + (TUD_VIDEO_DESC_CS_VS_IN_LEN + 1) \
+    + TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN \
+    + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN \
+    + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN \
+    + 7)
+#else
+#define UVC_DESC_LEN 0
+#endif
+
+#define USBD_DESC_LEN (TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN + TUD_CDC_DESC_LEN + UVC_DESC_LEN)
 #define USBD_CONFIGURATION_DESCRIPTOR_ATTRIBUTE (0)
 #define USBD_MAX_POWER_MA (250)
 
@@ -29,6 +57,10 @@ enum {
     ITF_NUM_VENDOR_STREAM = 0,
     ITF_NUM_CDC_CTRL,
     ITF_NUM_CDC_CTRL_DATA,
+#if EBD_IPKVM_UVC
+    ITF_NUM_VIDEO_CONTROL,
+    ITF_NUM_VIDEO_STREAMING,
+#endif
     ITF_NUM_TOTAL
 };
 
@@ -38,6 +70,7 @@ enum {
 #define USBD_STR_SERIAL (0x03)
 #define USBD_STR_STREAM (0x04)
 #define USBD_STR_CTRL (0x05)
+#define USBD_STR_VIDEO (0x06)
 
 static const tusb_desc_device_t usbd_desc_device = {
     .bLength = sizeof(tusb_desc_device_t),
@@ -62,6 +95,31 @@ static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
 
     TUD_VENDOR_DESCRIPTOR(ITF_NUM_VENDOR_STREAM, USBD_STR_STREAM, 0x81, 0x01, 64),
     TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_CTRL, USBD_STR_CTRL, 0x82, 8, 0x02, 0x83, 64),
+
+#if EBD_IPKVM_UVC
+    // UVC 1.5 camera: one uncompressed Y800 512x342 frame, bulk streaming on 0x84.
+    TUD_VIDEO_DESC_IAD(ITF_NUM_VIDEO_CONTROL, 2, USBD_STR_VIDEO),
+    TUD_VIDEO_DESC_STD_VC(ITF_NUM_VIDEO_CONTROL, 0, USBD_STR_VIDEO),
+    TUD_VIDEO_DESC_CS_VC(0x0150,
+        TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN,
+        UVC_CLOCK_FREQUENCY, ITF_NUM_VIDEO_STREAMING),
+    TUD_VIDEO_DESC_CAMERA_TERM(UVC_ENTITY_CAP_INPUT_TERMINAL, 0, 0, 0, 0, 0, 0),
+    TUD_VIDEO_DESC_OUTPUT_TERM(UVC_ENTITY_CAP_OUTPUT_TERMINAL, VIDEO_TT_STREAMING, 0,
+        UVC_ENTITY_CAP_INPUT_TERMINAL, 0),
+    TUD_VIDEO_DESC_STD_VS(ITF_NUM_VIDEO_STREAMING, 0, 1, USBD_STR_VIDEO),
+    TUD_VIDEO_DESC_CS_VS_INPUT(1,
+        TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN
+        + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN
+        + TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN,
+        0x84, 0, UVC_ENTITY_CAP_OUTPUT_TERMINAL, 0, 0, 0, 0),
+    TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(1, 1, UVC_GUID_Y800, 8, 1, 0, 0, 0, 0),
+    TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(1, 0, UVC_FRAME_WIDTH, UVC_FRAME_HEIGHT,
+        UVC_FRAME_BITRATE, UVC_FRAME_BITRATE, UVC_FRAME_BYTES,
+        UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL, UVC_FRAME_INTERVAL, 0),
+    TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709,
+        VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M),
+    TUD_VIDEO_DESC_EP_BULK(0x84, CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE, 1),
+#endif
 };
 
 static char usbd_serial_str[PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1];
@@ -72,6 +130,7 @@ static const char *const usbd_desc_str[] = {
     [USBD_STR_SERIAL] = usbd_serial_str,
     [USBD_STR_STREAM] = "EBD_IPKVM stream (bulk)",
     [USBD_STR_CTRL] = "EBD_IPKVM control",
+    [USBD_STR_VIDEO] = "EBD_IPKVM video (UVC)",
 };
 
 const uint8_t *tud_descriptor_device_cb(void) {
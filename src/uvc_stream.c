@@ -0,0 +1,113 @@
+#include "uvc_stream.h"
+
+#include "tusb.h"
+
+#define UVC_CTL_IDX 0
+#define UVC_STM_IDX 0
+
+typedef enum {
+    UVC_BUF_FREE = 0,    // nobody owns the buffer
+    UVC_BUF_FILLING = 1, // core1 is expanding lines into it
+    UVC_BUF_READY = 2,   // complete frame waiting for core0
+    UVC_BUF_BUSY = 3,    // TinyUSB is transferring it
+} uvc_buf_state_t;
+
+static uint8_t uvc_frame_buf[UVC_FRAME_BYTES] __attribute__((aligned(4)));
+static volatile uint8_t uvc_buf_state = UVC_BUF_FREE;
+static volatile bool uvc_streaming = false;
+
+// One 32-bit word of four 0x00/0xFF pixels per input nibble (MSB = leftmost).
+static uint32_t nibble_to_gray[16];
+
+static inline uint8_t load_state(void) {
+    return __atomic_load_n(&uvc_buf_state, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_state(uint8_t state) {
+    __atomic_store_n(&uvc_buf_state, state, __ATOMIC_RELEASE);
+}
+
+static inline bool swap_state(uint8_t expected, uint8_t desired) {
+    return __atomic_compare_exchange_n(&uvc_buf_state, &expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void uvc_stream_init(void) {
+    for (uint32_t n = 0; n < 16; n++) {
+        uint32_t v = 0;
+        for (uint32_t px = 0; px < 4; px++) {
+            if (n & (0x8u >> px)) {
+                v |= 0xFFu << (8u * px);
+            }
+        }
+        nibble_to_gray[n] = v;
+    }
+    store_state(UVC_BUF_FREE);
+    __atomic_store_n(&uvc_streaming, false, __ATOMIC_RELEASE);
+}
+
+bool uvc_stream_is_streaming(void) {
+    return __atomic_load_n(&uvc_streaming, __ATOMIC_ACQUIRE);
+}
+
+uint8_t *uvc_stream_acquire_frame(void) {
+    if (!uvc_stream_is_streaming()) {
+        return NULL;
+    }
+    if (!swap_state(UVC_BUF_FREE, UVC_BUF_FILLING)) {
+        return NULL;
+    }
+    return uvc_frame_buf;
+}
+
+void uvc_stream_expand_line(uint8_t *frame, uint16_t line, const uint8_t *packed) {
+    uint32_t *dst = (uint32_t *)&frame[(uint32_t)line * UVC_FRAME_WIDTH];
+    for (uint32_t i = 0; i < CAP_BYTES_PER_LINE; i++) {
+        uint8_t b = packed[i];
+        dst[0] = nibble_to_gray[b >> 4];
+        dst[1] = nibble_to_gray[b & 0x0Fu];
+        dst += 2;
+    }
+}
+
+void uvc_stream_publish_frame(void) {
+    (void)swap_state(UVC_BUF_FILLING, UVC_BUF_READY);
+}
+
+void uvc_stream_abort_frame(void) {
+    (void)swap_state(UVC_BUF_FILLING, UVC_BUF_FREE);
+}
+
+void uvc_stream_service(void) {
+    bool streaming = tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX);
+    if (streaming != uvc_stream_is_streaming()) {
+        __atomic_store_n(&uvc_streaming, streaming, __ATOMIC_RELEASE);
+        if (!streaming) {
+            // core1 never touches READY/BUSY buffers, so core0 can reclaim them.
+            (void)swap_state(UVC_BUF_READY, UVC_BUF_FREE);
+            (void)swap_state(UVC_BUF_BUSY, UVC_BUF_FREE);
+        }
+    }
+    if (!streaming || load_state() != UVC_BUF_READY) {
+        return;
+    }
+    if (tud_video_n_frame_xfer(UVC_CTL_IDX, UVC_STM_IDX, uvc_frame_buf, UVC_FRAME_BYTES)) {
+        store_state(UVC_BUF_BUSY);
+    }
+}
+
+void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx) {
+    (void)ctl_idx;
+    (void)stm_idx;
+    (void)swap_state(UVC_BUF_BUSY, UVC_BUF_FREE);
+}
+
+int tud_video_commit_cb(uint_fast8_t ctl_idx,
+                        uint_fast8_t stm_idx,
+                        video_probe_and_commit_control_t const *parameters) {
+    (void)ctl_idx;
+    (void)stm_idx;
+    (void)parameters;
+    // Single fixed format/frame/interval; nothing to reconfigure.
+    return VIDEO_ERROR_NONE;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "video_capture.h"
+
+// Build-time switch (CMake option EBD_IPKVM_UVC). When off, nothing in this
+// header is referenced and uvc_stream.c is not compiled.
+#ifndef EBD_IPKVM_UVC
+#define EBD_IPKVM_UVC 0
+#endif
+
+#define UVC_FRAME_WIDTH (CAP_BYTES_PER_LINE * 8)
+#define UVC_FRAME_HEIGHT CAP_ACTIVE_H
+#define UVC_FRAME_BYTES (UVC_FRAME_WIDTH * UVC_FRAME_HEIGHT)
+// Nominal rate advertised to the host. One 8-bit frame is 175 KB, and full
+// speed bulk moves about 1.2 MB/s shared with the vendor stream, so the link
+// sustains 6-7 fps at best; frames are sent as fast as it drains them.
+#define UVC_FRAME_RATE 5
+
+void uvc_stream_init(void);
+
+// core0: hand filled frames to TinyUSB and track the host streaming state.
+void uvc_stream_service(void);
+bool uvc_stream_is_streaming(void);
+
+// core1: claim the 8-bit gray frame buffer. Returns NULL while the host is not
+// streaming or the previous frame is still owned by TinyUSB.
+uint8_t *uvc_stream_acquire_frame(void);
+void uvc_stream_expand_line(uint8_t *frame, uint16_t line, const uint8_t *packed);
+void uvc_stream_publish_frame(void);
+void uvc_stream_abort_frame(void);
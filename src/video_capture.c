@@ -2,6 +2,8 @@
 
 #include "hardware/dma.h"
 
+#include "pio_fdebug.h"
+
 static inline void arm_dma(video_capture_t *cap, uint32_t *dst, uint32_t word_count) {
     dma_channel_config c = dma_channel_get_default_config(cap->dma_chan);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
@@ -37,6 +39,10 @@ static inline void arm_postprocess_dma(video_capture_t *cap, uint32_t *dst, uint
     );
 }
 
+static inline uint32_t rx_stall_mask(const video_capture_t *cap) {
+    return 1u << (PIO_FDEBUG_RXSTALL_LSB + cap->sm);
+}
+
 static uint32_t (*select_capture_buffer(video_capture_t *cap))[CAP_WORDS_PER_LINE] {
     if (cap->inflight_buf == cap->framebuf_a) {
         if (cap->ready_buf == cap->framebuf_b) {
@@ -80,6 +86,7 @@ void video_capture_init(video_capture_t *cap,
     cap->capture_enabled = false;
     cap->capture_want_frame = false;
     cap->lines_ok = 0;
+    cap->capture_vsync_us = 0;
     cap->framebuf_a = framebuf_a;
     cap->framebuf_b = framebuf_b;
     cap->capture_buf = framebuf_a;
@@ -90,11 +97,15 @@ void video_capture_init(video_capture_t *cap,
     cap->postprocess_buf = NULL;
     cap->postprocess_frame_id = 0;
     cap->postprocess_lines = 0;
+    cap->postprocess_vsync_us = 0;
     cap->frame_ready = false;
     cap->frame_ready_id = 0;
     cap->frame_ready_lines = 0;
+    cap->frame_ready_vsync_us = 0;
     cap->frame_overrun = 0;
     cap->frame_short = 0;
+    cap->rx_stall = false;
+    cap->last_rx_stall = false;
 }
 
 void video_capture_stop(video_capture_t *cap) {
@@ -112,16 +123,33 @@ void video_capture_stop(video_capture_t *cap) {
     cap->postprocess_buf = NULL;
 }
 
-void video_capture_start(video_capture_t *cap, bool want_frame) {
+void video_capture_start(video_capture_t *cap, bool want_frame, uint32_t vsync_us) {
     cap->capture_want_frame = want_frame;
+    cap->capture_vsync_us = vsync_us;
     cap->capture_buf = select_capture_buffer(cap);
     cap->capture_enabled = true;
+    cap->rx_stall = false;
     pio_sm_clear_fifos(cap->pio, cap->sm);
     pio_sm_restart(cap->pio, cap->sm);
+    pio_fdebug_clear(cap->pio, rx_stall_mask(cap));
     arm_dma(cap, &cap->capture_buf[0][0], CAP_MAX_LINES * CAP_WORDS_PER_LINE);
     pio_sm_set_enabled(cap->pio, cap->sm, true);
 }
 
+void video_capture_poll_rx_stall(video_capture_t *cap) {
+    // Only a stall seen while the DMA still has words to move is an overflow;
+    // once the transfer completes the SM may run into the next frame's first
+    // line and stall harmlessly before finalize stops it.
+    if (!cap->capture_enabled || !dma_channel_is_busy(cap->dma_chan)) {
+        return;
+    }
+    uint32_t mask = rx_stall_mask(cap);
+    if (pio_fdebug_test(cap->pio, mask)) {
+        pio_fdebug_clear(cap->pio, mask);
+        cap->rx_stall = true;
+    }
+}
+
 bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id) {
     bool was_wanted = cap->capture_want_frame;
     uint32_t remaining_words = 0;
@@ -141,6 +169,8 @@ bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id) {
 
     cap->capture_enabled = false;
     cap->capture_want_frame = false;
+    cap->last_rx_stall = cap->rx_stall;
+    cap->rx_stall = false;
 
     words_done = (CAP_MAX_LINES * CAP_WORDS_PER_LINE) - remaining_words;
     lines_captured = (uint16_t)(words_done / CAP_WORDS_PER_LINE);
@@ -160,6 +190,7 @@ bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id) {
         cap->postprocess_buf = cap->capture_buf;
         cap->postprocess_frame_id = frame_id;
         cap->postprocess_lines = lines_captured;
+        cap->postprocess_vsync_us = cap->capture_vsync_us;
     }
 
     if (!cap->postprocess_pending) {
@@ -184,6 +215,7 @@ bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id) {
     cap->ready_buf = cap->capture_buf;
     cap->frame_ready_id = frame_id;
     cap->frame_ready_lines = lines_captured;
+    cap->frame_ready_vsync_us = cap->capture_vsync_us;
     cap->frame_ready = true;
     return true;
 }
@@ -191,7 +223,8 @@ bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id) {
 bool video_capture_take_ready(video_capture_t *cap,
                               uint32_t (**out_buf)[CAP_WORDS_PER_LINE],
                               uint16_t *out_frame_id,
-                              uint16_t *out_lines) {
+                              uint16_t *out_lines,
+                              uint32_t *out_vsync_us) {
     if (!cap->frame_ready || cap->ready_buf == NULL) {
         return false;
     }
@@ -199,6 +232,7 @@ bool video_capture_take_ready(video_capture_t *cap,
     *out_buf = cap->ready_buf;
     *out_frame_id = cap->frame_ready_id;
     *out_lines = cap->frame_ready_lines;
+    *out_vsync_us = cap->frame_ready_vsync_us;
     cap->ready_buf = NULL;
     cap->frame_ready = false;
     return true;
@@ -234,6 +268,7 @@ bool video_capture_service_postprocess(video_capture_t *cap) {
     cap->ready_buf = cap->postprocess_buf;
     cap->frame_ready_id = cap->postprocess_frame_id;
     cap->frame_ready_lines = cap->postprocess_lines;
+    cap->frame_ready_vsync_us = cap->postprocess_vsync_us;
     cap->frame_ready = true;
 
     cap->postprocess_wanted = false;
@@ -242,3 +277,22 @@ bool video_capture_service_postprocess(video_capture_t *cap) {
     cap->postprocess_lines = 0;
     return true;
 }
+
+uint32_t (*video_capture_acquire_buffer(video_capture_t *cap))[CAP_WORDS_PER_LINE] {
+    cap->capture_buf = select_capture_buffer(cap);
+    return cap->capture_buf;
+}
+
+void video_capture_submit_frame(video_capture_t *cap, uint16_t frame_id, uint16_t lines,
+                                uint32_t vsync_us) {
+    if (lines > CAP_MAX_LINES) {
+        lines = CAP_MAX_LINES;
+    }
+    arm_postprocess_dma(cap, &cap->capture_buf[0][0], (uint32_t)lines * CAP_WORDS_PER_LINE);
+    cap->postprocess_pending = true;
+    cap->postprocess_wanted = true;
+    cap->postprocess_buf = cap->capture_buf;
+    cap->postprocess_frame_id = frame_id;
+    cap->postprocess_lines = lines;
+    cap->postprocess_vsync_us = vsync_us;
+}
@@ -11,6 +11,8 @@
 #define CAP_BYTES_PER_LINE 64
 #define CAP_WORDS_PER_LINE (CAP_BYTES_PER_LINE / 4)
 #define CAP_MAX_LINES CAP_FRAME_LINES
+// Full HSYNC period in PIXCLK cycles (512 active + 192 blanking).
+#define CAP_PIXCLK_PER_LINE 704
 
 typedef struct video_capture {
     PIO pio;
@@ -21,6 +23,7 @@ typedef struct video_capture {
     volatile bool capture_enabled;
     volatile bool capture_want_frame;
     volatile uint32_t lines_ok;
+    uint32_t capture_vsync_us;
 
     uint32_t (*framebuf_a)[CAP_WORDS_PER_LINE];
     uint32_t (*framebuf_b)[CAP_WORDS_PER_LINE];
@@ -33,12 +36,18 @@ typedef struct video_capture {
     uint32_t (*postprocess_buf)[CAP_WORDS_PER_LINE];
     uint16_t postprocess_frame_id;
     uint16_t postprocess_lines;
+    uint32_t postprocess_vsync_us;
 
     volatile bool frame_ready;
     uint16_t frame_ready_id;
     uint16_t frame_ready_lines;
+    uint32_t frame_ready_vsync_us;
     uint32_t frame_overrun;
     uint32_t frame_short;
+
+    // Capture SM stalled on a full RX FIFO while the DMA was still running.
+    bool rx_stall;
+    bool last_rx_stall; // result for the most recently finalized capture
 } video_capture_t;
 
 void video_capture_init(video_capture_t *cap,
@@ -48,12 +57,22 @@ void video_capture_init(video_capture_t *cap,
                         int post_dma_chan,
                         uint32_t framebuf_a[CAP_MAX_LINES][CAP_WORDS_PER_LINE],
                         uint32_t framebuf_b[CAP_MAX_LINES][CAP_WORDS_PER_LINE]);
-void video_capture_start(video_capture_t *cap, bool want_frame);
+void video_capture_start(video_capture_t *cap, bool want_frame, uint32_t vsync_us);
 void video_capture_stop(video_capture_t *cap);
+// Latch the capture SM's FDEBUG RXSTALL flag; call while the capture DMA is busy.
+void video_capture_poll_rx_stall(video_capture_t *cap);
 bool video_capture_finalize_frame(video_capture_t *cap, uint16_t frame_id);
 bool video_capture_take_ready(video_capture_t *cap,
                               uint32_t (**out_buf)[CAP_WORDS_PER_LINE],
                               uint16_t *out_frame_id,
-                              uint16_t *out_lines);
+                              uint16_t *out_lines,
+                              uint32_t *out_vsync_us);
 void video_capture_set_inflight(video_capture_t *cap, uint32_t (*buf)[CAP_WORDS_PER_LINE]);
 bool video_capture_service_postprocess(video_capture_t *cap);
+
+// Benchmark source: take the buffer the next capture would use, let the CPU
+// fill it (in capture word order), then hand it to the postprocess path as if
+// the capture DMA had just written `lines` lines.
+uint32_t (*video_capture_acquire_buffer(video_capture_t *cap))[CAP_WORDS_PER_LINE];
+void video_capture_submit_frame(video_capture_t *cap, uint16_t frame_id, uint16_t lines,
+                                uint32_t vsync_us);
@@ -8,10 +8,21 @@
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
 
+#include "bench_frames.h"
 #include "classic_line.pio.h"
 #include "core_bridge.h"
-
+#include "frame_trace.h"
+#include "latency_hist.h"
+#include "line_monitor.h"
+#include "uvc_stream.h"
+
+#if EBD_IPKVM_UVC
+// The 8-bit UVC frame (175 KB) does not fit next to a 512-entry queue.
+#define TXQ_DEPTH 128
+#define UVC_BATCH_LINES 32
+#else
 #define TXQ_DEPTH 512
+#endif
 #define TXQ_MASK  (TXQ_DEPTH - 1)
 #define TXQ_BATCH_LINES 8
 
@@ -27,9 +38,15 @@ static volatile uint16_t frame_id = 0;
 static volatile uint32_t lines_drop = 0;
 
 static volatile uint32_t vsync_edges = 0;
+static volatile uint32_t vsync_total = 0;
+static volatile uint8_t frame_divisor = 1;
+static uint8_t frame_divisor_count = 0;
+static volatile uint32_t roi_packed = CAP_ACTIVE_H; /* first_line << 16 | line_count */
 static volatile uint32_t frames_done = 0;
+static volatile uint32_t tx_lines = 0;
+static volatile uint32_t tx_lines_rle = 0;
+static volatile uint32_t tx_payload_bytes = 0;
 static volatile bool test_frame_active = false;
-static volatile bool diag_active = false;
 static volatile uint32_t last_vsync_us = 0;
 static volatile bool tx_rle_enabled = true;
 static volatile uint32_t core1_busy_us = 0;
@@ -37,6 +54,10 @@ static volatile uint32_t core1_total_us = 0;
 
 static uint16_t test_line = 0;
 static uint8_t test_line_buf[CAP_BYTES_PER_LINE];
+static uint32_t test_start_us = 0;
+static uint32_t test_first_us = 0;
+static uint32_t test_last_us = 0;
+static uint32_t test_crc = 0;
 
 static uint32_t framebuf_a[CAP_MAX_LINES][CAP_WORDS_PER_LINE];
 static uint32_t framebuf_b[CAP_MAX_LINES][CAP_WORDS_PER_LINE];
@@ -46,6 +67,16 @@ static uint16_t frame_tx_id = 0;
 static uint16_t frame_tx_line = 0;
 static uint16_t frame_tx_lines = 0;
 static uint16_t frame_tx_start = 0;
+static uint16_t frame_tx_first = 0;
+static uint16_t frame_tx_end = CAP_ACTIVE_H;
+static uint32_t frame_tx_vsync_us = 0;
+static uint32_t frame_tx_first_us = 0;
+static uint32_t frame_tx_last_us = 0;
+static bool frame_tx_ts_pending = false;
+static int crc_dma_chan = -1;
+static uint32_t crc_dma_sink = 0;
+static uint8_t *frame_tx_gray = NULL;
+static uint16_t frame_tx_gray_line = 0;
 static uint8_t rle_line_buf[PKT_MAX_PAYLOAD];
 
 typedef struct {
@@ -112,16 +143,40 @@ static inline void txq_reset(void) {
     txq_store_r(0);
 }
 
-static inline void reset_frame_tx_state(void) {
+static inline bool uvc_sink_active(void) {
+#if EBD_IPKVM_UVC
+    return uvc_stream_is_streaming();
+#else
+    return false;
+#endif
+}
+
+static inline void release_frame_tx(void) {
+#if EBD_IPKVM_UVC
+    if (frame_tx_gray) {
+        uvc_stream_abort_frame();
+    }
+#endif
+    frame_tx_gray = NULL;
+    frame_tx_gray_line = 0;
     frame_tx_buf = NULL;
+    frame_tx_ts_pending = false;
+    if (crc_dma_chan >= 0) {
+        dma_channel_abort((uint)crc_dma_chan);
+    }
+    video_capture_set_inflight(&capture, NULL);
+}
+
+static inline void reset_frame_tx_state(void) {
+    release_frame_tx();
     frame_tx_line = 0;
     frame_tx_id = 0;
     frame_tx_lines = 0;
     frame_tx_start = 0;
+    frame_tx_end = CAP_ACTIVE_H;
     capture.frame_ready = false;
     capture.frame_ready_lines = 0;
     capture.ready_buf = NULL;
-    video_capture_set_inflight(&capture, NULL);
 }
 
 static inline bool txq_is_empty(void) {
@@ -170,6 +225,7 @@ static inline bool txq_enqueue_payload(uint16_t fid, uint16_t lid, const uint8_t
     if (payload_len > PKT_MAX_PAYLOAD) {
         return false;
     }
+    lat_stamp_t lat_start = latency_hist_stamp();
     uint16_t w = txq_load_w();
     uint16_t next = (uint16_t)((w + 1) & TXQ_MASK);
     if (next == txq_load_r()) {
@@ -189,20 +245,74 @@ static inline bool txq_enqueue_payload(uint16_t fid, uint16_t lid, const uint8_t
 
     /* publish write index last so reader never sees a half-filled packet */
     txq_store_w(next);
+    latency_hist_record(LAT_STAGE_ENQUEUE, lat_start);
     return true;
 }
 
+static inline void count_tx_line(uint16_t payload_len, bool rle) {
+    store_u32(&tx_lines, tx_lines + 1u);
+    if (rle) {
+        store_u32(&tx_lines_rle, tx_lines_rle + 1u);
+    }
+    store_u32(&tx_payload_bytes, tx_payload_bytes + payload_len);
+}
+
 static inline bool txq_enqueue_line(uint16_t fid, uint16_t lid, const uint8_t *data64) {
-    if (!load_bool(&tx_rle_enabled)) {
-        return txq_enqueue_payload(fid, lid, data64, CAP_BYTES_PER_LINE, false);
+    if (load_bool(&tx_rle_enabled)) {
+        lat_stamp_t lat_start = latency_hist_stamp();
+        size_t rle_len = rle_encode_line(data64, CAP_BYTES_PER_LINE, rle_line_buf, sizeof(rle_line_buf));
+        latency_hist_record(LAT_STAGE_LINE_ENCODE, lat_start);
+        if (rle_len > 0 && rle_len < CAP_BYTES_PER_LINE) {
+            if (!txq_enqueue_payload(fid, lid, rle_line_buf, (uint16_t)rle_len, true)) {
+                return false;
+            }
+            count_tx_line((uint16_t)rle_len, true);
+            return true;
+        }
+    }
+
+    if (!txq_enqueue_payload(fid, lid, data64, CAP_BYTES_PER_LINE, false)) {
+        return false;
     }
+    count_tx_line(CAP_BYTES_PER_LINE, false);
+    return true;
+}
+
+static inline bool txq_enqueue_frame_end(uint16_t fid, uint32_t vsync_us,
+                                         uint32_t first_us, uint32_t last_us, uint32_t crc) {
+    uint8_t end[STREAM_FRAME_END_BYTES];
+    stream_write_frame_end(end, vsync_us, first_us, last_us, crc);
+    return txq_enqueue_payload(fid, STREAM_LINE_FRAME_END, end, sizeof(end), false);
+}
 
-    size_t rle_len = rle_encode_line(data64, CAP_BYTES_PER_LINE, rle_line_buf, sizeof(rle_line_buf));
-    if (rle_len > 0 && rle_len < CAP_BYTES_PER_LINE) {
-        return txq_enqueue_payload(fid, lid, rle_line_buf, (uint16_t)rle_len, true);
+// Reflected CRC-32 (zlib) for synthetic test frames; captured frames use the
+// DMA sniffer below. Start from 0xFFFFFFFF and invert the result.
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
     }
+    return crc;
+}
+
+// CRC-32 over the lines about to be sent, computed by a memory-to-sink DMA pass
+// with the sniffer in bit-reversed CRC-32 mode (same result as zlib.crc32 over
+// the little-endian bytes). Runs alongside line enqueue; no CPU cost.
+static void start_frame_crc(const uint32_t *src, uint32_t words) {
+    dma_channel_config c = dma_channel_get_default_config((uint)crc_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    channel_config_set_sniff_enable(&c, true);
 
-    return txq_enqueue_payload(fid, lid, data64, CAP_BYTES_PER_LINE, false);
+    dma_sniffer_enable((uint)crc_dma_chan, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+    dma_sniffer_set_output_reverse_enabled(true);
+    dma_sniffer_set_output_invert_enabled(true);
+    dma_sniffer_set_data_accumulator(0xFFFFFFFFu);
+    dma_channel_configure((uint)crc_dma_chan, &c, &crc_dma_sink, src, words, true);
 }
 
 static void configure_pio_program(void) {
@@ -224,41 +334,69 @@ static void configure_vsync_irq(void) {
     gpio_set_irq_enabled(pin_vsync, edge, true);
 }
 
+// A frame is still on its way from the capture buffer to the TX queue.
+static inline bool frame_path_busy(void) {
+    return (frame_tx_buf != NULL) || capture.frame_ready || !txq_is_empty() ||
+           load_bool(&capture.postprocess_pending);
+}
+
 static void service_vsync(uint32_t now_us) {
+    uint16_t fid = load_u16(&frame_id);
     if ((uint32_t)(now_us - last_vsync_us) < 8000u) {
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, fid, FRAME_TRACE_IGNORE_DEBOUNCE);
         return;
     }
     last_vsync_us = now_us;
 
     vsync_edges++;
+    vsync_total++;
 
-    if (load_bool(&diag_active)) {
+    if (load_bool(&capture.capture_enabled)) {
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, fid, FRAME_TRACE_IGNORE_CAPTURING);
         return;
     }
-    if (load_bool(&capture.capture_enabled)) {
+    if (bench_frames_running()) {
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, fid, FRAME_TRACE_IGNORE_BENCH);
         return;
     }
-    if (!load_bool(&armed)) {
+    if (!load_bool(&armed) && !uvc_sink_active()) {
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, fid, FRAME_TRACE_IGNORE_IDLE);
         return;
     }
 
-    bool tx_busy = (frame_tx_buf != NULL) || capture.frame_ready || !txq_is_empty() ||
-                   load_bool(&capture.postprocess_pending);
+    bool tx_busy = frame_path_busy();
+    bool take = true;
     capture_mode_t mode = __atomic_load_n(&capture_mode, __ATOMIC_ACQUIRE);
     if (mode == CAPTURE_MODE_TEST_30FPS) {
         bool toggle = !load_bool(&take_toggle);          // every other VSYNC => ~30fps
         store_bool(&take_toggle, toggle);
+        take = toggle;
         store_bool(&want_frame, toggle && !tx_busy);
     } else {
-        store_bool(&want_frame, !tx_busy);
+        uint8_t divisor = __atomic_load_n(&frame_divisor, __ATOMIC_ACQUIRE);
+        if (divisor > 1) {
+            frame_divisor_count++;
+            if (frame_divisor_count >= divisor) {
+                frame_divisor_count = 0;
+            }
+            take = (frame_divisor_count == 0);
+        }
+        store_bool(&want_frame, take && !tx_busy);
     }
 
     if (load_bool(&want_frame)) {
-        video_capture_start(&capture, true);
+        frame_trace_record(FRAME_TRACE_VSYNC_ACCEPTED, fid, 0);
+        line_monitor_begin_frame();
+        video_capture_start(&capture, true, now_us);
+        frame_trace_record(FRAME_TRACE_CAPTURE_START, fid, 0);
+    } else {
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, fid,
+                           take ? FRAME_TRACE_IGNORE_TX_BUSY : FRAME_TRACE_IGNORE_CADENCE);
     }
 }
 
 static void vsync_gpio_raw_irq_handler(void) {
+    lat_stamp_t lat_start = latency_hist_stamp();
     uint32_t events = gpio_get_irq_event_mask(pin_vsync);
     if (events == 0) {
         return;
@@ -276,6 +414,7 @@ static void vsync_gpio_raw_irq_handler(void) {
     }
 
     service_vsync(time_us_32());
+    latency_hist_record(LAT_STAGE_VSYNC_IRQ, lat_start);
 }
 
 static bool service_test_frame(void) {
@@ -283,6 +422,19 @@ static bool service_test_frame(void) {
 
     bool did_work = false;
     while (load_bool(&test_frame_active)) {
+        if (test_line >= CAP_ACTIVE_H) {
+            if (!txq_enqueue_frame_end(frame_id, test_start_us, test_first_us, test_last_us,
+                                       ~test_crc)) {
+                break;
+            }
+            did_work = true;
+            store_bool(&test_frame_active, false);
+            test_line = 0;
+            frame_id++;
+            frames_done++;
+            break;
+        }
+
         uint8_t fill = (test_line & 1) ? 0xFF : 0x00;
         memset(test_line_buf, fill, CAP_BYTES_PER_LINE);
         if (!txq_enqueue_line(frame_id, test_line, test_line_buf)) {
@@ -290,34 +442,75 @@ static bool service_test_frame(void) {
         }
 
         did_work = true;
-        test_line++;
-        if (test_line >= CAP_ACTIVE_H) {
-            store_bool(&test_frame_active, false);
-            test_line = 0;
-            frame_id++;
-            frames_done++;
-            break;
+        test_crc = crc32_update(test_crc, test_line_buf, CAP_BYTES_PER_LINE);
+        test_last_us = time_us_32();
+        if (test_line == 0) {
+            test_first_us = test_last_us;
         }
+        test_line++;
     }
     return did_work;
 }
 
+#if EBD_IPKVM_UVC
+static bool service_frame_gray(void) {
+    if (!frame_tx_gray) return false;
+
+    uint16_t batch_limit = UVC_BATCH_LINES;
+    while (frame_tx_gray_line < CAP_ACTIVE_H && batch_limit > 0) {
+        uint16_t src_line = (uint16_t)(frame_tx_gray_line + frame_tx_start);
+        uvc_stream_expand_line(frame_tx_gray,
+                               frame_tx_gray_line,
+                               (const uint8_t *)frame_tx_buf[src_line]);
+        frame_tx_gray_line++;
+        batch_limit--;
+    }
+
+    if (frame_tx_gray_line >= CAP_ACTIVE_H) {
+        uvc_stream_publish_frame();
+        frame_tx_gray = NULL;
+        frame_tx_gray_line = 0;
+    }
+    return true;
+}
+#endif
+
 static bool service_frame_tx(void) {
     bool did_work = false;
     if (!frame_tx_buf) {
         uint32_t (*buf)[CAP_WORDS_PER_LINE] = NULL;
         uint16_t fid = 0;
         uint16_t lines = 0;
-        if (video_capture_take_ready(&capture, &buf, &fid, &lines)) {
+        uint32_t vsync_us = 0;
+        if (video_capture_take_ready(&capture, &buf, &fid, &lines, &vsync_us)) {
             frame_tx_buf = buf;
+            frame_tx_vsync_us = vsync_us;
+            uint32_t roi = load_u32(&roi_packed);
             frame_tx_id = fid;
-            frame_tx_line = 0;
+            frame_tx_line = (uint16_t)(roi >> 16);
+            frame_tx_first = frame_tx_line;
+            frame_tx_end = (uint16_t)(frame_tx_line + (roi & 0xFFFFu));
             frame_tx_lines = lines;
             if (lines >= (CAP_YOFF_LINES + CAP_ACTIVE_H)) {
                 frame_tx_start = CAP_YOFF_LINES;
             } else {
                 frame_tx_start = (lines >= CAP_ACTIVE_H) ? (uint16_t)(lines - CAP_ACTIVE_H) : 0;
             }
+            /* UVC-only sessions leave the vendor queue idle */
+            if (!load_bool(&armed) && uvc_sink_active()) {
+                frame_tx_line = frame_tx_end;
+            }
+            frame_tx_ts_pending = (frame_tx_line < frame_tx_end);
+            if (frame_tx_ts_pending && lines >= CAP_ACTIVE_H) {
+                start_frame_crc(frame_tx_buf[frame_tx_start + frame_tx_line],
+                                (uint32_t)(frame_tx_end - frame_tx_line) * CAP_WORDS_PER_LINE);
+            }
+#if EBD_IPKVM_UVC
+            if (lines >= CAP_ACTIVE_H) {
+                frame_tx_gray = uvc_stream_acquire_frame();
+                frame_tx_gray_line = 0;
+            }
+#endif
             video_capture_set_inflight(&capture, buf);
             did_work = true;
         }
@@ -327,60 +520,104 @@ static bool service_frame_tx(void) {
 
     if (frame_tx_lines < CAP_ACTIVE_H) {
         capture.frame_short++;
-        frame_tx_buf = NULL;
-        video_capture_set_inflight(&capture, NULL);
+        frame_trace_record(FRAME_TRACE_FRAME_SHORT, frame_tx_id, frame_tx_lines);
+        release_frame_tx();
         return true;
     }
 
+#if EBD_IPKVM_UVC
+    if (service_frame_gray()) {
+        did_work = true;
+    }
+#endif
+
     uint16_t batch_limit = TXQ_BATCH_LINES;
     uint16_t space = txq_space();
     if (batch_limit > space) {
         batch_limit = space;
     }
 
-    while (frame_tx_line < CAP_ACTIVE_H && batch_limit > 0) {
+    while (frame_tx_line < frame_tx_end && batch_limit > 0) {
         if (!txq_has_space()) break;
 
         uint16_t src_line = (uint16_t)(frame_tx_line + frame_tx_start);
         if (src_line >= frame_tx_lines) {
             capture.frame_short++;
-            frame_tx_buf = NULL;
-            video_capture_set_inflight(&capture, NULL);
+            frame_trace_record(FRAME_TRACE_FRAME_SHORT, frame_tx_id, frame_tx_lines);
+            release_frame_tx();
             return true;
         }
+#if EBD_IPKVM_BENCH
+        uint32_t bench_start = bench_frames_stamp();
+        uint32_t bench_bytes = tx_payload_bytes;
+#endif
         if (!txq_enqueue_line(frame_tx_id,
                               frame_tx_line,
                               (const uint8_t *)frame_tx_buf[src_line])) {
             lines_drop++;
+            frame_trace_record(FRAME_TRACE_LINE_DROP, frame_tx_id, frame_tx_line);
             break;
         }
+#if EBD_IPKVM_BENCH
+        if (bench_frames_running()) {
+            bench_frames_add_line(bench_frames_cycles_since(bench_start),
+                                  (uint16_t)(STREAM_HEADER_BYTES + tx_payload_bytes - bench_bytes));
+        }
+#endif
 
         did_work = true;
+        frame_tx_last_us = time_us_32();
+        if (frame_tx_line == frame_tx_first) {
+            frame_tx_first_us = frame_tx_last_us;
+            frame_trace_record(FRAME_TRACE_FIRST_LINE_ENQ, frame_tx_id, frame_tx_line);
+        }
+        if ((uint16_t)(frame_tx_line + 1u) == frame_tx_end) {
+            frame_trace_record(FRAME_TRACE_LAST_LINE_ENQ, frame_tx_id, frame_tx_line);
+        }
         frame_tx_line++;
         batch_limit--;
     }
 
-    if (frame_tx_line >= CAP_ACTIVE_H) {
-        frame_tx_buf = NULL;
-        video_capture_set_inflight(&capture, NULL);
+    /* trailing frame end packet; retried next pass if the queue is full or
+       the CRC pass is still running */
+    if (frame_tx_line >= frame_tx_end && frame_tx_ts_pending &&
+        !dma_channel_is_busy((uint)crc_dma_chan) &&
+        txq_enqueue_frame_end(frame_tx_id, frame_tx_vsync_us,
+                              frame_tx_first_us, frame_tx_last_us,
+                              dma_sniffer_get_data_accumulator())) {
+        frame_tx_ts_pending = false;
+        did_work = true;
+#if EBD_IPKVM_BENCH
+        if (bench_frames_running()) {
+            bench_frames_note_frame_sent(frame_tx_vsync_us,
+                                         STREAM_HEADER_BYTES + STREAM_FRAME_END_BYTES);
+        }
+#endif
+    }
+
+    if (frame_tx_line >= frame_tx_end && !frame_tx_ts_pending && !frame_tx_gray) {
+        release_frame_tx();
     }
     return did_work;
 }
 
 static void core1_stop_capture_and_reset(void) {
+#if EBD_IPKVM_BENCH
+    bench_frames_stop();
+#endif
     store_bool(&want_frame, false);
     store_bool(&take_toggle, false);
     store_bool(&test_frame_active, false);
     test_line = 0;
+    frame_divisor_count = 0;
     video_capture_stop(&capture);
     txq_reset();
     reset_frame_tx_state();
 }
 
-static void core1_handle_command(uint32_t cmd) {
-    switch (core_bridge_unpack_code(cmd)) {
+static uint32_t core1_handle_command(const core_bridge_msg_t *msg) {
+    switch (msg->code) {
     case CORE_BRIDGE_CMD_STOP_CAPTURE:
-        store_bool(&diag_active, false);
         core1_stop_capture_and_reset();
         break;
     case CORE_BRIDGE_CMD_RESET_COUNTERS:
@@ -388,6 +625,12 @@ static void core1_handle_command(uint32_t cmd) {
         store_u32(&frames_done, 0);
         store_u32(&lines_drop, 0);
         store_u32(&vsync_edges, 0);
+        store_u32(&vsync_total, 0);
+        store_u32(&tx_lines, 0);
+        store_u32(&tx_lines_rle, 0);
+        store_u32(&tx_payload_bytes, 0);
+        frame_trace_reset();
+        line_monitor_reset();
         store_u32(&capture.lines_ok, 0);
         __atomic_store_n(&capture.frame_overrun, 0, __ATOMIC_RELEASE);
         __atomic_store_n(&capture.frame_short, 0, __ATOMIC_RELEASE);
@@ -395,55 +638,120 @@ static void core1_handle_command(uint32_t cmd) {
     case CORE_BRIDGE_CMD_SINGLE_FRAME:
         if (!capture.capture_enabled) {
             store_bool(&want_frame, true);
-            video_capture_start(&capture, true);
+            line_monitor_begin_frame();
+            video_capture_start(&capture, true, time_us_32());
+            frame_trace_record(FRAME_TRACE_CAPTURE_START, load_u16(&frame_id), 0);
         }
         break;
     case CORE_BRIDGE_CMD_START_TEST:
         store_bool(&armed, false);
-        store_bool(&diag_active, false);
         core1_stop_capture_and_reset();
-        store_bool(&test_frame_active, true);
         test_line = 0;
+        test_start_us = time_us_32();
+        test_first_us = test_start_us;
+        test_last_us = test_start_us;
+        test_crc = 0xFFFFFFFFu;
+        store_bool(&test_frame_active, true);
         break;
     case CORE_BRIDGE_CMD_CONFIG_VSYNC:
         configure_vsync_irq();
         break;
-    case CORE_BRIDGE_CMD_DIAG_PREP:
+#if EBD_IPKVM_BENCH
+    case CORE_BRIDGE_CMD_START_BENCH:
         store_bool(&armed, false);
-        store_bool(&diag_active, true);
         core1_stop_capture_and_reset();
-        break;
-    case CORE_BRIDGE_CMD_DIAG_DONE:
-        store_bool(&diag_active, false);
-        break;
+        return bench_frames_start((uint8_t)msg->args[0], msg->args[1],
+                                  load_bool(&tx_rle_enabled) ? 1u : 0u)
+                   ? CORE_BRIDGE_RESULT_OK
+                   : CORE_BRIDGE_RESULT_FAILED;
+#endif
     default:
         break;
     }
+    return CORE_BRIDGE_RESULT_OK;
 }
 
+#if EBD_IPKVM_BENCH
+// Benchmark tick: stands in for an accepted VSYNC plus a completed capture.
+static bool service_bench(void) {
+    uint32_t now = time_us_32();
+    if (!bench_frames_tick_due(now)) {
+        return false;
+    }
+    if (frame_path_busy()) {
+        bench_frames_note_skip();
+        frame_trace_record(FRAME_TRACE_VSYNC_IGNORED, frame_id, FRAME_TRACE_IGNORE_TX_BUSY);
+        return true;
+    }
+    frame_trace_record(FRAME_TRACE_VSYNC_ACCEPTED, frame_id, 0);
+    bench_frames_fill(video_capture_acquire_buffer(&capture));
+    video_capture_submit_frame(&capture, frame_id, CAP_MAX_LINES, now);
+    bench_frames_note_submit(now);
+    frame_trace_record(FRAME_TRACE_DMA_DONE, frame_id, CAP_MAX_LINES);
+    frame_id++;
+    return true;
+}
+#endif
+
 static void core1_entry(void) {
+    latency_hist_core_init();
+#if EBD_IPKVM_BENCH
+    bench_frames_core_init();
+#endif
     configure_vsync_irq();
+    lat_stamp_t postprocess_start = latency_hist_stamp();
 
     while (true) {
         uint32_t loop_start = time_us_32();
         uint32_t active_us = 0;
-        uint32_t cmd = 0;
-        while (core_bridge_try_pop(&cmd)) {
-            core1_handle_command(cmd);
+        core_bridge_msg_t msg;
+        while (core_bridge_try_pop(&msg)) {
+            core_bridge_ack(&msg, core1_handle_command(&msg));
         }
 
+        line_monitor_poll();
+        video_capture_poll_rx_stall(&capture);
+
+        uint32_t overrun_before = capture.frame_overrun;
         if (capture.capture_enabled && !dma_channel_is_busy(capture.dma_chan)) {
             uint32_t active_start = time_us_32();
-            (void)video_capture_finalize_frame(&capture, frame_id);
+            uint32_t lines_before = capture.lines_ok;
+            lat_stamp_t lat_start = latency_hist_stamp();
+            bool ready = video_capture_finalize_frame(&capture, frame_id);
+            latency_hist_record(LAT_STAGE_FINALIZE, lat_start);
+            postprocess_start = latency_hist_stamp();
+            frame_trace_record(FRAME_TRACE_DMA_DONE, frame_id, capture.lines_ok - lines_before);
+            line_monitor_end_frame(frame_id, capture.last_rx_stall);
+            if (ready) {
+                frame_trace_record(FRAME_TRACE_POSTPROCESS_DONE, frame_id, 0);
+            }
             frame_id++;
             active_us += (uint32_t)(time_us_32() - active_start);
         }
 
         uint32_t active_start = time_us_32();
+#if EBD_IPKVM_BENCH
+        if (service_bench()) {
+            postprocess_start = latency_hist_stamp();
+            active_us += (uint32_t)(time_us_32() - active_start);
+        }
+        active_start = time_us_32();
+#endif
         if (video_capture_service_postprocess(&capture)) {
+            latency_hist_record(LAT_STAGE_POSTPROCESS_WAIT, postprocess_start);
+#if EBD_IPKVM_BENCH
+            if (bench_frames_running()) {
+                bench_frames_note_postprocess_done(time_us_32());
+            }
+#endif
             frames_done++;
+            frame_trace_record(FRAME_TRACE_POSTPROCESS_DONE, capture.frame_ready_id, 0);
             active_us += (uint32_t)(time_us_32() - active_start);
         }
+        if (capture.frame_overrun != overrun_before) {
+            frame_trace_record(FRAME_TRACE_OVERRUN, capture.frame_ready_id,
+                               capture.frame_overrun - overrun_before);
+        }
 
         active_start = time_us_32();
         if (service_test_frame()) {
@@ -477,17 +785,21 @@ void video_core_init(const video_core_config_t *cfg) {
     store_bool(&want_frame, false);
     store_bool(&take_toggle, false);
     store_bool(&test_frame_active, false);
-    store_bool(&diag_active, false);
     store_bool(&tx_rle_enabled, true);
     store_bool(&vsync_irq_ready, false);
     store_u16(&frame_id, 0);
     store_u32(&lines_drop, 0);
     store_u32(&frames_done, 0);
     store_u32(&vsync_edges, 0);
+    store_u32(&vsync_total, 0);
+    __atomic_store_n(&frame_divisor, 1, __ATOMIC_RELEASE);
+    frame_divisor_count = 0;
+    store_u32(&roi_packed, CAP_ACTIVE_H);
     store_u32(&last_vsync_us, 0);
     store_u32(&core1_busy_us, 0);
     store_u32(&core1_total_us, 0);
     test_line = 0;
+    crc_dma_chan = cfg->crc_dma_chan;
 
     configure_pio_program();
     video_capture_init(&capture,
@@ -500,6 +812,9 @@ void video_core_init(const video_core_config_t *cfg) {
     video_capture_stop(&capture);
     txq_reset();
     reset_frame_tx_state();
+
+    line_monitor_init(cfg->mon_pio, cfg->mon_sm, cfg->offset_line_monitor, cfg->pin_hsync,
+                      CAP_PIXCLK_PER_LINE);
 }
 
 void video_core_launch(void) {
@@ -510,7 +825,8 @@ bool video_core_can_emit_text(void) {
     return !load_bool(&capture.capture_enabled)
            && !load_bool(&test_frame_active)
            && txq_is_empty()
-           && !load_bool(&armed);
+           && !load_bool(&armed)
+           && !bench_frames_running();
 }
 
 void video_core_set_armed(bool value) {
@@ -553,6 +869,38 @@ bool video_core_get_tx_rle_enabled(void) {
     return load_bool(&tx_rle_enabled);
 }
 
+void video_core_set_frame_divisor(uint8_t divisor) {
+    if (divisor == 0) {
+        divisor = 1;
+    }
+    __atomic_store_n(&frame_divisor, divisor, __ATOMIC_RELEASE);
+}
+
+uint8_t video_core_get_frame_divisor(void) {
+    return __atomic_load_n(&frame_divisor, __ATOMIC_ACQUIRE);
+}
+
+void video_core_set_roi(uint16_t first_line, uint16_t line_count) {
+    if (first_line >= CAP_ACTIVE_H) {
+        first_line = 0;
+        line_count = CAP_ACTIVE_H;
+    }
+    if (line_count == 0 || line_count > (uint16_t)(CAP_ACTIVE_H - first_line)) {
+        line_count = (uint16_t)(CAP_ACTIVE_H - first_line);
+    }
+    store_u32(&roi_packed, ((uint32_t)first_line << 16) | line_count);
+}
+
+void video_core_get_roi(uint16_t *out_first_line, uint16_t *out_line_count) {
+    uint32_t roi = load_u32(&roi_packed);
+    if (out_first_line) {
+        *out_first_line = (uint16_t)(roi >> 16);
+    }
+    if (out_line_count) {
+        *out_line_count = (uint16_t)(roi & 0xFFFFu);
+    }
+}
+
 bool video_core_capture_enabled(void) {
     return load_bool(&capture.capture_enabled);
 }
@@ -565,6 +913,13 @@ uint32_t video_core_get_lines_drop(void) {
     return load_u32(&lines_drop);
 }
 
+void video_core_get_codec_counters(uint32_t *out_lines, uint32_t *out_rle_lines,
+                                   uint32_t *out_payload_bytes) {
+    *out_lines = load_u32(&tx_lines);
+    *out_rle_lines = load_u32(&tx_lines_rle);
+    *out_payload_bytes = load_u32(&tx_payload_bytes);
+}
+
 uint32_t video_core_get_frames_done(void) {
     return load_u32(&frames_done);
 }
@@ -585,6 +940,10 @@ uint32_t video_core_take_vsync_edges(void) {
     return __atomic_exchange_n(&vsync_edges, 0, __ATOMIC_ACQ_REL);
 }
 
+uint32_t video_core_get_vsync_total(void) {
+    return load_u32(&vsync_total);
+}
+
 void video_core_take_core1_utilization(uint32_t *busy_us, uint32_t *total_us) {
     if (busy_us) {
         *busy_us = __atomic_exchange_n(&core1_busy_us, 0, __ATOMIC_ACQ_REL);
@@ -18,9 +18,15 @@ typedef struct video_core_config {
     uint sm;
     int dma_chan;
     int post_dma_chan;
+    int crc_dma_chan;
     uint offset_fall_pixrise;
     uint pin_video;
     uint pin_vsync;
+    // Signal integrity monitor SM (line_monitor.pio), independent of the capture PIO.
+    PIO mon_pio;
+    uint mon_sm;
+    uint offset_line_monitor;
+    uint pin_hsync;
 } video_core_config_t;
 
 #define VIDEO_CORE_MAX_PAYLOAD (CAP_BYTES_PER_LINE * 2)
@@ -41,6 +47,12 @@ void video_core_set_vsync_edge(bool fall_edge);
 bool video_core_get_vsync_edge(void);
 void video_core_set_tx_rle_enabled(bool enabled);
 bool video_core_get_tx_rle_enabled(void);
+// Take every Nth accepted VSYNC in continuous mode (1 = every frame).
+void video_core_set_frame_divisor(uint8_t divisor);
+uint8_t video_core_get_frame_divisor(void);
+// Restrict the vendor stream to active lines [first_line, first_line + line_count).
+void video_core_set_roi(uint16_t first_line, uint16_t line_count);
+void video_core_get_roi(uint16_t *out_first_line, uint16_t *out_line_count);
 
 bool video_core_capture_enabled(void);
 bool video_core_test_frame_active(void);
@@ -51,6 +63,10 @@ uint32_t video_core_get_lines_ok(void);
 uint32_t video_core_get_frame_overrun(void);
 uint32_t video_core_get_frame_short(void);
 uint32_t video_core_take_vsync_edges(void);
+uint32_t video_core_get_vsync_total(void);
+// Line packets queued since reset, how many used RLE, and their payload bytes.
+void video_core_get_codec_counters(uint32_t *out_lines, uint32_t *out_rle_lines,
+                                   uint32_t *out_payload_bytes);
 void video_core_take_core1_utilization(uint32_t *busy_us, uint32_t *total_us);
 
 bool video_core_txq_is_empty(void);